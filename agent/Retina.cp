@@ -6,6 +6,8 @@
 
 #include "AbstractFile.h"
 #include "Brain.h"
+#include "gretina.h"
+#include "gscene.h"
 #include "NervousSystem.h"
 #include "RandomNumberGenerator.h"
 #include "Simulation.h"
@@ -144,6 +146,16 @@ void Retina::updateBuffer( short xleft, short ypix )
 #endif
 }
 
+void Retina::updateBuffer( gscene &scene,
+						   const frustumXZ &fxz )
+{
+	// Software equivalent of the above, rendering only the row
+	// of pixels that glReadPixels() would have returned.
+	gretina r( width, brain::retinaheight, buf );
+
+	scene.Draw( r, fxz );
+}
+
 const unsigned char *Retina::getBuffer()
 {
 	return buf;
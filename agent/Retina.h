@@ -3,6 +3,8 @@
 #include "Brain.h"
 #include "Sensor.h"
 
+class frustumXZ;
+class gscene;
 class Nerve;
 class NervousSystem;
 class RandomNumberGenerator;
@@ -21,6 +23,8 @@ class Retina : public Sensor
 
 	void updateBuffer( short xleft,
 					   short ypix );
+	void updateBuffer( gscene &scene,
+					   const frustumXZ &fxz );
 
 	const unsigned char *getBuffer();
 
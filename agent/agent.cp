@@ -22,7 +22,7 @@
 #include "barrier.h"
 #include "BeingCarriedSensor.h"
 #include "CarryingSensor.h"
-#include "datalib.h"
+#include "Checkpoint.h"
 #include "debug.h"
 #include "food.h"
 #include "EnergySensor.h"
@@ -30,10 +30,12 @@
 #include "GenomeUtil.h"
 #include "graphics.h"
 #include "graybin.h"
+#include "gretina.h"
 #include "misc.h"
 #include "MateWaitSensor.h"
 #include "Metabolism.h"
 #include "NervousSystem.h"
+#include "RandomNumberGenerator.h"
 #include "RandomSensor.h"
 #include "Resources.h"
 #include "Retina.h"
@@ -81,6 +83,7 @@ float		agent::gCarryAgentSize2Energy;
 float		agent::gFixedEnergyDrain;
 float		agent::gMaxCarries;
 bool		agent::gVision;
+bool		agent::gSoftwareVision;
 long		agent::gInitMateWait;
 float		agent::gSpeed2DPosition;
 float		agent::gMaxRadius;
@@ -145,7 +148,7 @@ agent::agent(TSimulation* sim, gstage* stage)
 		fBeingCarriedSensor(NULL),
 		fBrain(NULL),
 		fBrainFuncFile(NULL),
-		fPositionWriter(NULL)
+		fRecordPosition(false)
 {
 	Q_CHECK_PTR(sim);
 	Q_CHECK_PTR(stage);
@@ -271,6 +274,11 @@ agent* agent::getfreeagent(TSimulation* simulation, gstage* stage)
     // Set number to total creatures that have ever lived (note this is 1-based)
     c->setTypeNumber( ++agent::agentsEver );
 
+	// Key the agent's random streams (if any) to its number, so its genome
+	// and brain don't depend on the order or thread in which they're built.
+	c->fGenome->getRNG()->stream( c->getTypeNumber() );
+	c->fCns->getRNG()->stream( c->getTypeNumber() );
+
 	// Set agent index.  Used for POV drawing.
 	for (size_t index = 0; index < gAgentIndex.size(); ++index)
 	{
@@ -292,65 +300,19 @@ agent* agent::getfreeagent(TSimulation* simulation, gstage* stage)
 //---------------------------------------------------------------------------    
 void agent::agentdump(ostream& out)
 {
-    out << agent::agentsEver nl;
-    out << agent::agentsliving nl;
-
+	checkpoint::put( out, agent::agentsEver );
 }
 
 
 //---------------------------------------------------------------------------
 // agent::agentload
+//
+// Must follow the loading of all agents, since getfreeagent() advances
+// agentsEver.
 //---------------------------------------------------------------------------    
-void agent::agentload(istream&)
+void agent::agentload(istream& in)
 {
-	qWarning("agent::agentload called. Not supported.");
-#if 0
-    in >> agent::agentsEver;
-    in >> agent::agentsliving;
-
-    agent::agentlist->load(in);
-	
-	long i;
-		
-    for (i = 0; i < gMaxNumAgents; i++)
-        if (!agent::pc[i])
-            break;
-    if (i)
-        error(2,"agent::pc[] array not empty during agentload");
-        
-    //    if (agent::gXSortedAgents.count())
-    //        error(2,"gXSortedAgents list not empty during agentload");
-    if (allxsortedlist::gXSortedAll.getCount(AGENTTYPE))
-        error(2,"gXSortedAll list not empty during agentload");
-        
-    long numagentsallocated = 0;
-    in >> numagentsallocated;
-    for (i = 0; i < numagentsallocated; i++)
-    {
-        agent::pc[i] = new agent;
-        if (agent::pc[i] == NULL)
-            error(2,"Insufficient memory for new agent in agentload");
-        if (agent::agentlist->isone(i))
-        {
-            (agent::pc[i])->load(in);
-            //agent::pc[i]->listLink = agent::gXSortedAgents.add(agent::pc[i]);
-	    	agent::pc[i]->listLink = allxsortedlist::gXSortedAll.add(agent::pc[i]);
-            globals::worldstage.addobject(agent::pc[i]);
-            if ((agent::pc[i])->fIndex != i)
-            {
-                char msg[256];
-                sprintf(msg,
-                    	"pc[i]->fIndex (%ld) does not match actual index (%ld)",
-                    	(agent::pc[i])->fIndex,i);
-                error(2,msg);
-            }
-        }
-        else
-        {
-            (agent::pc[i])->fIndex = i;
-        }
-    }
-#endif
+	checkpoint::get( in, agent::agentsEver );
 }
 
 
@@ -362,72 +324,103 @@ void agent::agentload(istream&)
 //---------------------------------------------------------------------------
 void agent::dump(ostream& out)
 {
-    out << getTypeNumber() nl;
-    out << fIndex nl;
-    out << fAge nl;
-    out << fLastMate nl;
-    assert( false ); // out << fEnergy nl;
-    assert( false ); // out << fFoodEnergy nl;
-    assert( false ); // out << fMaxEnergy nl;
-    out << fSpeed2Energy nl;
-    out << fYaw2Energy nl;
-    out << fSizeAdvantage nl;
-    out << fMass nl;
-    out << fLastPosition[0] sp fLastPosition[1] sp fLastPosition[2] nl;
-    out << fVelocity[0] sp fVelocity[1] sp fVelocity[2] nl;
-    out << fNoseColor[0] sp fNoseColor[1] sp fNoseColor[2] nl;
-    out << fHeuristicFitness nl;
-
-    gobject::dump(out);
-
-    	assert( false ); //fGenome->dump(out); // must port this to AbstractFile
-    if (fBrain != NULL)
-        fBrain->Dump(out);
-    else
-        error(1, "Attempted to dump a agent with no brain");
+	unsigned long agentNumber = getTypeNumber();
+
+	checkpoint::put( out, agentNumber );
+	checkpoint::put( out, fIndex );
+	fGenome->dump( out );
+
+	checkpoint::put( out, fDomain );
+	checkpoint::put( out, fAlive );
+	checkpoint::put( out, fAge );
+	checkpoint::put( out, fLastMate );
+	checkpoint::put( out, fLastEat );
+	checkpoint::putArray( out, fLastEatPosition, 3 );
+	checkpoint::put( out, fLifeSpan );
+	checkpoint::put( out, fDeathByPatch );
+
+	checkpoint::put( out, fEnergy );
+	checkpoint::put( out, fFoodEnergy );
+	checkpoint::put( out, fMaxEnergy );
+	checkpoint::put( out, fSpeed2Energy );
+	checkpoint::put( out, fYaw2Energy );
+	checkpoint::put( out, fSizeAdvantage );
+	checkpoint::put( out, fMass );
+
+	checkpoint::putArray( out, fLastPosition, 3 );
+	checkpoint::putArray( out, fVelocity, 3 );
+	checkpoint::putArray( out, fNoseColor, 3 );
+	checkpoint::put( out, fSpeed );
+	checkpoint::put( out, fMaxSpeed );
+
+	checkpoint::put( out, fHeuristicFitness );
+	checkpoint::put( out, fComplexity );
+	checkpoint::put( out, fCarryRadius );
+
+	gobject::dump( out );
+
+	fBrain->Dump( out );
 }
 
 
 //---------------------------------------------------------------------------
 // agent::load
+//
+// Loads an agent fresh from getfreeagent(). The agent is grown from its
+// saved genome, and then everything the growth derived is overwritten with
+// the saved state.
 //---------------------------------------------------------------------------    
-void agent::load(istream& in)
+void agent::load( istream& in,
+				  long mateWait,
+				  bool recordGenome,
+				  bool recordPosition )
 {
-	qWarning("fix domain issue");
-	
 	unsigned long agentNumber;
-	
-    in >> agentNumber;
-	setTypeNumber( agentNumber );
-    in >> fIndex;
-    in >> fAge;
-    in >> fLastMate;
-    assert( false ); // in >> fEnergy;
-    assert( false ); // in >> fFoodEnergy;
-    assert( false ); // in >> fMaxEnergy;
-    in >> fSpeed2Energy;
-    in >> fYaw2Energy;
-    in >> fSizeAdvantage;
-    in >> fMass;
-    in >> fLastPosition[0] >> fLastPosition[1] >> fLastPosition[2];
-    in >> fVelocity[0] >> fVelocity[1] >> fVelocity[2];
-    in >> fNoseColor[0] >> fNoseColor[1] >> fNoseColor[2];
-    in >> fHeuristicFitness;
-
-    gobject::load(in);
-	
-    assert( false ); //fGenome->load(in); // must port this to AbstractFile
-    if (fBrain == NULL)
-    {
-        fBrain = new Brain(fCns);
-        Q_CHECK_PTR(fBrain);
-    }
-    fBrain->Load(in);
 
-    // done loading in raw information, now setup some derived quantities
-    SetGeometry();
-    SetGraphics();
-    fDomain = fSimulation->WhichDomain(fPosition[0], fPosition[2], 0);
+	checkpoint::get( in, agentNumber );
+	setTypeNumber( agentNumber );
+	fGenome->getRNG()->stream( agentNumber );
+	fCns->getRNG()->stream( agentNumber );
+
+	gAgentIndex.set( fIndex, false );
+	checkpoint::get( in, fIndex );
+	assert( !gAgentIndex.test(fIndex) );
+	gAgentIndex.set( fIndex );
+
+	fGenome->load( in );
+
+	grow( mateWait, recordGenome, false, false, recordPosition );
+
+	checkpoint::get( in, fDomain );
+	checkpoint::get( in, fAlive );
+	checkpoint::get( in, fAge );
+	checkpoint::get( in, fLastMate );
+	checkpoint::get( in, fLastEat );
+	checkpoint::getArray( in, fLastEatPosition, 3 );
+	checkpoint::get( in, fLifeSpan );
+	checkpoint::get( in, fDeathByPatch );
+
+	checkpoint::get( in, fEnergy );
+	checkpoint::get( in, fFoodEnergy );
+	checkpoint::get( in, fMaxEnergy );
+	checkpoint::get( in, fSpeed2Energy );
+	checkpoint::get( in, fYaw2Energy );
+	checkpoint::get( in, fSizeAdvantage );
+	checkpoint::get( in, fMass );
+
+	checkpoint::getArray( in, fLastPosition, 3 );
+	checkpoint::getArray( in, fVelocity, 3 );
+	checkpoint::getArray( in, fNoseColor, 3 );
+	checkpoint::get( in, fSpeed );
+	checkpoint::get( in, fMaxSpeed );
+
+	checkpoint::get( in, fHeuristicFitness );
+	checkpoint::get( in, fComplexity );
+	checkpoint::get( in, fCarryRadius );
+
+	gobject::load( in );
+
+	fBrain->Load( in );
 }
 
 
@@ -519,21 +512,13 @@ void agent::grow( long mateWait,
 	if( recordBrainFunction )
 		fBrainFuncFile = fBrain->startFunctional( getTypeNumber() );
 
-	if( recordPosition )
-	{
-		char path[512];
-		sprintf( path,
-				 "run/motion/position/agents/position_%ld.txt",
-				 getTypeNumber() );
-
-		fPositionWriter = new DataLibWriter( path, true, false );
-
-		const char *colnames[] = {"Timestep", "x", "y", "z", NULL};
-		const datalib::Type coltypes[] = {datalib::INT, datalib::FLOAT, datalib::FLOAT, datalib::FLOAT};
-		fPositionWriter->beginTable( "Positions",
-									 colnames,
-									 coltypes );		
-	}
+	// Keep recent neural activity, or its covariance, in memory for complexity-as-fitness
+	if( brain::gActivityCovariance )
+		fBrain->startActivityCovariance( brain::gActivityCovarianceGaussianize );
+	else if( brain::gActivityHistoryLength > 0 )
+		fBrain->startActivityHistory( brain::gActivityHistoryLength );
+
+	fRecordPosition = recordPosition;
 
     // setup the agent's geometry
     SetGeometry();
@@ -679,6 +664,9 @@ void agent::eat( food* f,
 			* f->getEnergyPolarity()
 			* geneCache.metabolism->eatMultiplier;
 
+		// The food shrank, so its leading edge has moved
+		objectxsortedlist::gXSortedObjects.moveNear( f );
+
 		// The eatMultiplier could have made us exceed our limits.
 		return_actuallyEat.constrain( fEnergy * -1, fMaxEnergy - fEnergy );
 
@@ -805,11 +793,7 @@ float agent::ProjectedHeuristicFitness()
 //---------------------------------------------------------------------------    
 void agent::Die()
 {
-	if( fPositionWriter )
-	{
-		delete fPositionWriter;
-		fPositionWriter = NULL;
-	}
+	fRecordPosition = false;
 
 	if( fLifeSpan.death.reason == LifeSpan::DR_SIMEND )
 	{
@@ -820,6 +804,7 @@ void agent::Die()
     {
         gobject* o = *it;
         o->Dropped();
+        objectxsortedlist::gXSortedObjects.moveNear( o );
     }
     fCarries.clear();
 	
@@ -967,11 +952,19 @@ void agent::UpdateVision()
 			fCamera.setyaw( yaw );
 		}
 		
-		fSimulation->GetAgentPOVWindow()->DrawAgentPOV( this );
+		if( gSoftwareVision )
+		{
+			// Needs no GL context, so may be called from any thread
+			fRetina->updateBuffer( fScene, fFrustum );
+		}
+		else
+		{
+			fSimulation->GetAgentPOVWindow()->DrawAgentPOV( this );
 
-		debugcheck( "after DrawAgentPOV" );
+			debugcheck( "after DrawAgentPOV" );
 
-		fRetina->updateBuffer( xleft, ypix );
+			fRetina->updateBuffer( xleft, ypix );
+		}
 	}
 }
 
@@ -993,12 +986,30 @@ void agent::UpdateBrain()
 //
 // Return energy consumed
 //---------------------------------------------------------------------------
-const float FF = 1.01;
-
 float agent::UpdateBody( float moveFitnessParam,
 						 float speed2dpos,
 						 int solidObjects,
 						 agent* carrier )
+{
+	float energyUsed = UpdateBodyMotion( solidObjects, carrier );
+
+	return UpdateBodyCommit( moveFitnessParam, speed2dpos, solidObjects, energyUsed );
+}
+
+//---------------------------------------------------------------------------
+// agent::UpdateBodyMotion
+//
+// First half of UpdateBody(): works out where the agent is going, including
+// barrier, edge, and collision fixes, into fNextPosition.  Only the agent's
+// own state is changed, so this may run for many agents at once; they all
+// see each other where they were before any of them moved.
+//
+// Return energy consumed
+//---------------------------------------------------------------------------
+const float FF = 1.01;
+
+float agent::UpdateBodyMotion( int solidObjects,
+							   agent* carrier )
 {
     debugcheck( "%lu", Number() );
 	Q_ASSERT( lxor( !BeingCarried(), carrier ) );
@@ -1009,13 +1020,16 @@ float agent::UpdateBody( float moveFitnessParam,
 	
 	// just do x & z dimensions in this version
     SaveLastPosition();
+	fNextPosition[0] = fPosition[0];
+	fNextPosition[2] = fPosition[2];
+	fBodyCollisions.clear();
 	
 	if( BeingCarried() )  // the agent carrying this agent initiated the update
 	{
-		setx( carrier->x() );
-		setz( carrier->z() );
-		dx = x() - LastX();
-		dz = z() - LastX();
+		fNextPosition[0] = carrier->x();
+		fNextPosition[2] = carrier->z();
+		dx = NextX() - LastX();
+		dz = NextZ() - LastX();
 	}
 	else  // this is a normal update (the agent is not being carried)
 	{
@@ -1027,8 +1041,8 @@ float agent::UpdateBody( float moveFitnessParam,
 			dpos = gMaxVelocity;
 		dx = -dpos * sin( yaw() * DEGTORAD );
 		dz = -dpos * cos( yaw() * DEGTORAD );
-		addx( dx );
-		addz( dz );
+		fNextPosition[0] += dx;
+		fNextPosition[2] += dz;
 	#endif
 	}
 
@@ -1135,16 +1149,19 @@ float agent::UpdateBody( float moveFitnessParam,
 		// it on the other side or let the carried agent mate with an agent on the
 		// other side.
 
-		barrier* b = NULL;
-		barrier::gXSortedBarriers.reset();
-		while( barrier::gXSortedBarriers.next(b) )
+		// Walk the links rather than the list's cursor, which other agents may be using
+		for( gdlink<barrier*>* link = barrier::gXSortedBarriers.firstLink();
+			 link;
+			 link = barrier::gXSortedBarriers.nextLink( link ) )
 		{
-			if( (b->xmax() > (    x() - FF * CarryRadius())) ||
+			barrier* b = link->e;
+
+			if( (b->xmax() > (NextX() - FF * CarryRadius())) ||
 				(b->xmax() > (LastX() - FF * CarryRadius())) )
 			{
 				// end of barrier comes after beginning of agent
 				// in either its new or old position
-				if( (b->xmin() > (    x() + FF * CarryRadius())) &&
+				if( (b->xmin() > (NextX() + FF * CarryRadius())) &&
 					(b->xmin() > (LastX() + FF * CarryRadius())) )
 				{
 					// beginning of barrier comes after end of agent,
@@ -1155,18 +1172,18 @@ float agent::UpdateBody( float moveFitnessParam,
 				}
 				else // we have an overlap in x
 				{
-					if( ((b->zmin() < ( z() + FF * CarryRadius())) || (b->zmin() < (LastZ() + FF * CarryRadius()))) &&
-						((b->zmax() > ( z() - FF * CarryRadius())) || (b->zmax() > (LastZ() - FF * CarryRadius()))) )
+					if( ((b->zmin() < ( NextZ() + FF * CarryRadius())) || (b->zmin() < (LastZ() + FF * CarryRadius()))) &&
+						((b->zmax() > ( NextZ() - FF * CarryRadius())) || (b->zmax() > (LastZ() - FF * CarryRadius()))) )
 					{
 						if( barrier::gStickyBarriers )
 						{
-							fPosition[0] = LastX();
-							fPosition[2] = LastZ();
+							fNextPosition[0] = LastX();
+							fNextPosition[2] = LastZ();
 						}
 						else
 						{
 							// also overlap in z, so there may be an intersection
-							float dist  = b->dist(     x(),     z() );
+							float dist  = b->dist( NextX(), NextZ() );
 							float disto = b->dist( LastX(), LastZ() );
 							float p;
 						
@@ -1184,8 +1201,8 @@ float agent::UpdateBody( float moveFitnessParam,
 									if( dist < 0. ) p = -p;
 								}
 
-								addz(  p * b->sina() );
-								addx( -p * b->cosa() );
+								fNextPosition[2] += p * b->sina();
+								fNextPosition[0] += -p * b->cosa();
 
 							} // actual intersection
 							else if( (disto * dist) < 0.0 )
@@ -1196,16 +1213,16 @@ float agent::UpdateBody( float moveFitnessParam,
 								if( disto < 0.0 )
 									p = -p;
 															
-								addz(  p * b->sina() );
-								addx( -p * b->cosa() );
+								fNextPosition[2] += p * b->sina();
+								fNextPosition[0] += -p * b->cosa();
 							}
 						}
 
-						fSimulation->UpdateCollisionsLog( this, OT_BARRIER );
+						fBodyCollisions.push_back( OT_BARRIER );
 					} // overlap in z
 				} // beginning of barrier comes after end of agent
 			} // end of barrier comes after beginning of agent
-		} // while( barrier::gXSortedBarriers.next(b) )
+		} // for each barrier
 
 		// If there are solid objects besides bricks, or
 		// if only bricks are solid and bricks are present in the simulation...
@@ -1244,53 +1261,75 @@ float agent::UpdateBody( float moveFitnessParam,
 		{
 			bool collision = false;
 
-			if( fPosition[0] > globals::worldsize )
+			if( fNextPosition[0] > globals::worldsize )
 			{
 				collision = true;
 				if( globals::wraparound )
-					fPosition[0] -= globals::worldsize;
+					fNextPosition[0] -= globals::worldsize;
 				else
-					fPosition[0] = globals::worldsize;
+					fNextPosition[0] = globals::worldsize;
 			}
-			else if( fPosition[0] < 0.0 )
+			else if( fNextPosition[0] < 0.0 )
 			{
 				collision = true;
 				if( globals::wraparound )
-					fPosition[0] += globals::worldsize;
+					fNextPosition[0] += globals::worldsize;
 				else
-					fPosition[0] = 0.0;
+					fNextPosition[0] = 0.0;
 			}
 			
-			if( fPosition[2] < -globals::worldsize )
+			if( fNextPosition[2] < -globals::worldsize )
 			{
 				collision = true;
 				if( globals::wraparound )
-					fPosition[2] += globals::worldsize;
+					fNextPosition[2] += globals::worldsize;
 				else
-					fPosition[2] = -globals::worldsize;
+					fNextPosition[2] = -globals::worldsize;
 			}
-			else if( fPosition[2] > 0.0 )
+			else if( fNextPosition[2] > 0.0 )
 			{
 				collision = true;
 				if( globals::wraparound )
-					fPosition[2] -= globals::worldsize;
+					fNextPosition[2] -= globals::worldsize;
 				else
-					fPosition[2] = 0.0;
+					fNextPosition[2] = 0.0;
 			}
 
 			if( collision )
 			{
 				if( globals::stickyEdges )
 				{
-					fPosition[0] = LastX();
-					fPosition[2] = LastZ();
+					fNextPosition[0] = LastX();
+					fNextPosition[2] = LastZ();
 				}
 
-				fSimulation->UpdateCollisionsLog( this, OT_EDGE );
+				fBodyCollisions.push_back( OT_EDGE );
 			}
 		}
 	} // if( ! BeingCarried() )
 
+	return energyUsed;
+}
+
+//---------------------------------------------------------------------------
+// agent::UpdateBodyCommit
+//
+// Second half of UpdateBody(): moves the agent to fNextPosition and updates
+// everything that depends on where it is, including the objects it carries.
+// Must be called serially, for agents in x-sorted list order.
+//
+// Return energy consumed, including energyUsed from UpdateBodyMotion()
+//---------------------------------------------------------------------------
+float agent::UpdateBodyCommit( float moveFitnessParam,
+							   float speed2dpos,
+							   int solidObjects,
+							   float energyUsed )
+{
+	fPosition[0] = fNextPosition[0];
+	fPosition[2] = fNextPosition[2];
+
+	for( size_t i = 0; i < fBodyCollisions.size(); i++ )
+		fSimulation->UpdateCollisionsLog( this, (ObjectType) fBodyCollisions[i] );
 
 	// Keep track of the domain in which the agent resides
     short newDomain = fSimulation->WhichDomain( fPosition[0], fPosition[2], fDomain );
@@ -1316,6 +1355,8 @@ float agent::UpdateBody( float moveFitnessParam,
 	rewardmovement( moveFitnessParam, speed2dpos );
 
 	RecordPosition();
+
+	objectxsortedlist::gXSortedObjects.moveNear( this );
 	
 	// Now update any objects we are carrying
 	// (They will not be updated in TSimulation::UpdateAgents*().)
@@ -1335,6 +1376,7 @@ float agent::UpdateBody( float moveFitnessParam,
 			case FOODTYPE:
 				carried->setx( x() );
 				carried->setz( z() );
+				objectxsortedlist::gXSortedObjects.moveNear( carried );
 				fSimulation->SwitchDomain( Domain(), ((food*)carried)->domain(), FOODTYPE );
 				((food*)carried)->domain( Domain() );
 				break;
@@ -1342,6 +1384,7 @@ float agent::UpdateBody( float moveFitnessParam,
 			case BRICKTYPE:
 				carried->setx( x() );
 				carried->setz( z() );
+				objectxsortedlist::gXSortedObjects.moveNear( carried );
 				// bricks do not currently identify their domain, nor are they counted in domains
 				break;
 			
@@ -1355,22 +1398,63 @@ float agent::UpdateBody( float moveFitnessParam,
 }
 
 
+#define CollisionRadiusReductionFactor 0.90
+
 void agent::AvoidCollisions( int solidObjects )
 {
-	// Save the current agent pointer in the master x-sorted list before we mess with it, so we can restore it later
-	objectxsortedlist::gXSortedObjects.setMark( AGENTTYPE );
-	
+	if( objectxsortedlist::gXSortedObjects.gridEnabled() )
+	{
+		float dx = NextX() - LastX();
+		float dz = NextZ() - LastZ();
+		float agtRadius = radius() * CollisionRadiusReductionFactor;
+		vector<gobject*> &nearby = fNearby;	// getNearby() clears it
+
+		objectxsortedlist::gXSortedObjects.getNearby( solidObjects,
+													  min( NextX(), LastX() ) - agtRadius, min( NextZ(), LastZ() ) - agtRadius,
+													  max( NextX(), LastX() ) + agtRadius, max( NextZ(), LastZ() ) + agtRadius,
+													  nearby );
+		nearby.erase( remove( nearby.begin(), nearby.end(), (gobject*) this ), nearby.end() );
+		sort( nearby.begin(), nearby.end(), objectxsortedlist::before );
+
+		// Visit the objects in the same order as the list walks below: back from us, then forward.
+		// We are ordered by where we are going, which only we can see so far.
+		long n = nearby.size();
+		long nprev = 0;
+		float edge = NextX() - radius();
+		while( nprev < n )
+		{
+			gobject* obj = nearby[nprev];
+			float objEdge = obj->x() - obj->radius();
+
+			if( objEdge > edge )
+				break;
+			if( (objEdge == edge) &&
+				((obj->getType() != getType()) ? (obj->getType() > getType()) : (obj->getTypeNumber() > getTypeNumber())) )
+				break;
+			nprev++;
+		}
+
+		for( long i = 0; i < n; i++ )
+		{
+			gobject* obj = i < nprev ? nearby[nprev - 1 - i] : nearby[i];
+			float objRadius = obj->radius() * CollisionRadiusReductionFactor;
+
+			// The same tests that end the list walks, since we may have been moved back
+			if( obj->x() - objRadius > max( NextX(), LastX() ) + agtRadius  ||
+				obj->x() + objRadius < min( NextX(), LastX() ) - agtRadius )
+				continue;
+
+			AvoidCollision( obj, dx, dz, agtRadius );
+		}
+
+		return;
+	}
+
 	// First look backwards in the list (to the left, decreasing x)
 	AvoidCollisionDirectional( PREV, solidObjects );
 
-	// Restore the current agent pointer in the master x-sorted list
-	objectxsortedlist::gXSortedObjects.toMark( AGENTTYPE );
-
 	// Then look forwards in the list (to the right, increasing x)
 	AvoidCollisionDirectional( NEXT, solidObjects );
-	
-	// Restore the current agent pointer in the master x-sorted list
-	objectxsortedlist::gXSortedObjects.toMark( AGENTTYPE );
 }
 
 
@@ -1379,98 +1463,106 @@ void agent::AvoidCollisions( int solidObjects )
 // in Update() before calling AvoidCollisions().
 void agent::AvoidCollisionDirectional( int direction, int solidObjects )
 {
-	#define CollisionRadiusReductionFactor 0.90
-	
 	gobject* obj;
 	
-	float dx = x() - LastX();
-	float dz = z() - LastZ();
+	float dx = NextX() - LastX();
+	float dz = NextZ() - LastZ();
 	float agtRadius = radius() * CollisionRadiusReductionFactor;
 
 	// Look in the specified direction
-	while( objectxsortedlist::gXSortedObjects.anotherObj( direction, solidObjects, &obj ) )
+	objectxsortedlist::iterator it = objectxsortedlist::gXSortedObjects.from( this, direction, solidObjects );
+	while( it.next( &obj ) )
 	{
 		float objRadius = obj->radius() * CollisionRadiusReductionFactor;
 		
 		// Test to see if we're close enough in x; if not, get out, we're done,
 		// because all objects after this one are even farther away
-		// Note: anotherObj() will complain and exit if direction is neither NEXT nor PREV
 		if( direction == NEXT )
 		{
-			if( obj->x() - objRadius > max( x(), LastX() ) + agtRadius )
+			if( obj->x() - objRadius > max( NextX(), LastX() ) + agtRadius )
 				break;
 		}
 		else	// direction == PREV
 		{
-			if( obj->x() + objRadius < min( x(), LastX() ) - agtRadius)
+			if( obj->x() + objRadius < min( NextX(), LastX() ) - agtRadius)
 				break;
 		}
 		
-		// Test to see if we're too far away in z; if so, we're done with this object
-		if( obj->z() - objRadius > max( z(), LastZ() ) + agtRadius  ||
-			obj->z() + objRadius < min( z(), LastZ() ) - agtRadius )
-			continue;
-		
-		// If we're carrying the object, then there's nothing to be done
-		if( Carrying( obj ) )
-			continue;
-		
-		// If we reach here, then the two objects appear to have had contact this time step
-		// and we're not carrying the other object
-		
-		// We only want to adjust the position of our agent if it was traveling in the
-		// direction of the object it is touching, so take a small step from the start
-		// position towards the end position and see whether the distance to the potential
-		// collision object decreases.  ("Small" because we want to avoid the case where
-		// the agent's velocity is great enough to step past the collision object and end
-		// up farther away than it started, after going completely through the collision
-		// object.  Dividing by worldsize should take care of that in any situation.)
-		float xs, zs;
-		float dosquared = (obj->x()-LastX())*(obj->x()-LastX()) + (obj->z()-LastZ())*(obj->z()-LastZ());
-		if( fabs( dx ) > fabs( dz ) )
-		{
-			float s = dz / dx;
-			xs = LastX()  +  dx / globals::worldsize;
-			zs = LastZ()  +  s * (xs - LastX());
-		}
-		else
+		AvoidCollision( obj, dx, dz, agtRadius );
+	}
+}
+
+
+// Adjust our position to avoid obj, if we ran into it.
+// dx and dz are how far we moved this time step.
+void agent::AvoidCollision( gobject* obj, float dx, float dz, float agtRadius )
+{
+	float objRadius = obj->radius() * CollisionRadiusReductionFactor;
+
+	// Test to see if we're too far away in z; if so, we're done with this object
+	if( obj->z() - objRadius > max( NextZ(), LastZ() ) + agtRadius  ||
+		obj->z() + objRadius < min( NextZ(), LastZ() ) - agtRadius )
+		return;
+	
+	// If we're carrying the object, then there's nothing to be done
+	if( Carrying( obj ) )
+		return;
+	
+	// If we reach here, then the two objects appear to have had contact this time step
+	// and we're not carrying the other object
+	
+	// We only want to adjust the position of our agent if it was traveling in the
+	// direction of the object it is touching, so take a small step from the start
+	// position towards the end position and see whether the distance to the potential
+	// collision object decreases.  ("Small" because we want to avoid the case where
+	// the agent's velocity is great enough to step past the collision object and end
+	// up farther away than it started, after going completely through the collision
+	// object.  Dividing by worldsize should take care of that in any situation.)
+	float xs, zs;
+	float dosquared = (obj->x()-LastX())*(obj->x()-LastX()) + (obj->z()-LastZ())*(obj->z()-LastZ());
+	if( fabs( dx ) > fabs( dz ) )
+	{
+		float s = dz / dx;
+		xs = LastX()  +  dx / globals::worldsize;
+		zs = LastZ()  +  s * (xs - LastX());
+	}
+	else
+	{
+		float s = dx / dz;
+		zs = LastZ()  +  dz / globals::worldsize;
+		xs = LastX()  +  s * (zs - LastZ());
+	}
+	float dssquared = (obj->x()-xs)*(obj->x()-xs) + (obj->z()-zs)*(obj->z()-zs);
+	
+	// Test to see if the agent is approaching the potential collision object
+	if( dssquared < dosquared )
+	{
+		// If we reach here, then there was a collision
+		// So calculate where along our path we had to stop in order to avoid it
+		float xf, zf;	// the "fixed" coordinates so as to avoid penetrating the brick
+		GetCollisionFixedCoordinates( LastX(), LastZ(), NextX(), NextZ(), obj->x(), obj->z(), agtRadius, objRadius, &xf, &zf );
+		fNextPosition[0] = xf;
+		fNextPosition[2] = zf;
+
+		ObjectType ot;
+		switch(obj->getType())
 		{
-			float s = dx / dz;
-			zs = LastZ()  +  dz / globals::worldsize;
-			xs = LastX()  +  s * (zs - LastZ());
+		case AGENTTYPE:
+			ot = OT_AGENT;
+			break;
+		case FOODTYPE:
+			ot = OT_FOOD;
+			break;
+		case BRICKTYPE:
+			ot = OT_BRICK;
+			break;
+		default:
+			assert(false);
+			break;
 		}
-		float dssquared = (obj->x()-xs)*(obj->x()-xs) + (obj->z()-zs)*(obj->z()-zs);
-		
-		// Test to see if the agent is approaching the potential collision object
-		if( dssquared < dosquared )
-		{
-			// If we reach here, then there was a collision
-			// So calculate where along our path we had to stop in order to avoid it
-			float xf, zf;	// the "fixed" coordinates so as to avoid penetrating the brick
-			GetCollisionFixedCoordinates( LastX(), LastZ(), x(), z(), obj->x(), obj->z(), agtRadius, objRadius, &xf, &zf );
-			setx( xf );
-			setz( zf );
-
-			ObjectType ot;
-			switch(obj->getType())
-			{
-			case AGENTTYPE:
-				ot = OT_AGENT;
-				break;
-			case FOODTYPE:
-				ot = OT_FOOD;
-				break;
-			case BRICKTYPE:
-				ot = OT_BRICK;
-				break;
-			default:
-				assert(false);
-				break;
-			}
 
-			fSimulation->UpdateCollisionsLog( this, ot );
-			//break;	// can only hit one
-		}
+		fBodyCollisions.push_back( ot );
+		//break;	// can only hit one
 	}
 }
 
@@ -1580,6 +1672,7 @@ void agent::PickupObject( gobject* o )
     debugcheck( "%lu", Number() );
 	
 	o->PickedUp( (gobject*)this, ly() );
+	objectxsortedlist::gXSortedObjects.moveNear( o );
 	fCarries.push_back( o );
 	if( o->radius() > fCarryRadius )
 		fCarryRadius = o->radius();
@@ -1599,6 +1692,7 @@ void agent::DropMostRecent( void )
 	
 	gobject* o = fCarries.back();
 	o->Dropped();
+	objectxsortedlist::gXSortedObjects.moveNear( o );
 	fCarries.pop_back();
 	
 	if( o->radius() == fCarryRadius )
@@ -1620,6 +1714,7 @@ void agent::DropObject( gobject* o )
     debugcheck( "agent # %lu (carrying %d) dropping %s # %lu (carrying %d)", Number(), NumCarries(), OBJECTTYPE( o ), o->getTypeNumber(), o->NumCarries() );
 	
 	o->Dropped();
+	objectxsortedlist::gXSortedObjects.moveNear( o );
 	fCarries.remove( o );
 	if( o->radius() == fCarryRadius )
 	{
@@ -1662,6 +1757,20 @@ void agent::draw()
 }
 
 
+//---------------------------------------------------------------------------
+// agent::softdraw
+//---------------------------------------------------------------------------    
+void agent::softdraw(gretina& r)
+{
+	r.PushMatrix();
+		position(r);
+		r.Scale(fScale, fScale, fScale);
+		gpolyobj::drawcolpolyrange(r, 0, 4, fNoseColor);
+		gpolyobj::drawcolpolyrange(r, 5, 9, fColor);
+	r.PopMatrix();
+}
+
+
 void agent::print()
 {
     cout << "Printing agent #" << getTypeNumber() nl;
@@ -1817,15 +1926,16 @@ float agent::CarryEnergy( void )
 //---------------------------------------------------------------------------
 void agent::RecordPosition( void )
 {
-	if( fPositionWriter )
+	if( fRecordPosition )
 	{
 		//printf( "%3lu %3lu  %6.2f  %6.2f\n", fSimulation->fStep, getTypeNumber(), LastX(), x() );
 		if( LastX() > 5.0  &&  x() == 0.0 )
 			printf( "Got one: %3lu %3lu  %6.2f  %6.2f\n", fSimulation->fStep, getTypeNumber(), LastX(), x() );
-		fPositionWriter->addRow( fSimulation->fStep,
-								 x(),
-								 y(),
-								 z() );
+		fSimulation->fPositionWriter->add( fSimulation->fStep,
+										   getTypeNumber(),
+										   x(),
+										   y(),
+										   z() );
 	}
 }
 
@@ -3,6 +3,7 @@
 
 // System
 #include <algorithm>
+#include <vector>
 
 // qt
 //#include <qrect.h>
@@ -31,7 +32,6 @@ class AbstractFile;
 class agent;
 class BeingCarriedSensor;
 class CarryingSensor;
-class DataLibWriter;
 class EnergySensor;
 class food;
 class MateWaitSensor;
@@ -85,6 +85,7 @@ public:
 	static float	gFixedEnergyDrain;
 	static float	gMaxCarries;
 	static bool		gVision;
+	static bool		gSoftwareVision;
 	static long 	gInitMateWait;
 	static float	gSpeed2DPosition;
 	static float	gMaxRadius;
@@ -119,15 +120,25 @@ public:
     ~agent();
     
     void dump(std::ostream& out);
-    void load(std::istream& in);
+    void load( std::istream& in,
+			   long mateWait,
+			   bool recordGenome,
+			   bool recordPosition );
 	void UpdateVision();
 	void UpdateBrain();
     float UpdateBody( float moveFitnessParam,
 					  float speed2dpos,
 					  int solidObjects,
 					  agent* carrier );
+	float UpdateBodyMotion( int solidObjects,
+							agent* carrier );
+	float UpdateBodyCommit( float moveFitnessParam,
+							float speed2dpos,
+							int solidObjects,
+							float energyUsed );
 	void AvoidCollisions( int solidObjects );
 	void AvoidCollisionDirectional( int direction, int solidObjects );
+	void AvoidCollision( gobject* obj, float dx, float dz, float agtRadius );
 	void GetCollisionFixedCoordinates( float xo, float zo, float xn, float zn, float xb, float zb, float rc, float rb, float *xf, float *zf );
     
     void SetVelocity(float x, float y, float z);
@@ -138,6 +149,7 @@ public:
     void SetMass(float f);
     
     virtual void draw();
+    virtual void softdraw(gretina& r);
     void grow( long mateWait,
 			   bool recordGenome,
 			   bool recordBrainAnatomy,
@@ -167,6 +179,8 @@ public:
     float LastX();
     float LastY();
     float LastZ();
+    float NextX();
+    float NextZ();
     float Velocity(short i);
     float VelocityX();
     float VelocityY();
@@ -291,6 +305,9 @@ protected:
     float fMass; // mass (not used)
     
     float fLastPosition[3];
+    float fNextPosition[3];	// where UpdateBodyMotion() is moving us (only x and z are used)
+	std::vector<int> fBodyCollisions;	// ObjectTypes hit by UpdateBodyMotion(), for the collisions log
+	std::vector<gobject*> fNearby;		// scratch for AvoidCollisions(), kept to save an allocation per step
     float fVelocity[3];
     float fNoseColor[3];
 
@@ -353,7 +370,7 @@ protected:
     short fDomain;
 	
 	AbstractFile *fBrainFuncFile;
-	DataLibWriter *fPositionWriter;
+	bool fRecordPosition;
 	
 	float fCarryRadius;
 };
@@ -370,6 +387,8 @@ inline void agent::SetLastZ(float z) { fLastPosition[2] = z; }
 inline float agent::LastX() { return fLastPosition[0]; }
 inline float agent::LastY() { return fLastPosition[1]; }
 inline float agent::LastZ() { return fLastPosition[2]; }
+inline float agent::NextX() { return fNextPosition[0]; }
+inline float agent::NextZ() { return fNextPosition[2]; }
 inline float agent::Velocity(short i) { return fVelocity[i]; }
 inline float agent::VelocityX() { return fVelocity[0]; }
 inline float agent::VelocityY() { return fVelocity[1]; }
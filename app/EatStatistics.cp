@@ -5,6 +5,8 @@
 #include <iostream>
 #include <limits>
 
+#include "Checkpoint.h"
+
 using namespace std;
 
 #define EAT_STATS_AVERAGE_STEPS 100
@@ -127,3 +129,54 @@ const float *EatStatistics::GetProperty( const string &name )
 		return NULL;
 	}
 }
+
+static void dumpList( ostream &out, const list<long> &l )
+{
+	size_t n = l.size();
+	checkpoint::put( out, n );
+	for( list<long>::const_iterator it = l.begin(); it != l.end(); it++ )
+		checkpoint::put( out, *it );
+}
+
+static void loadList( istream &in, list<long> &l )
+{
+	size_t n;
+	checkpoint::get( in, n );
+	l.clear();
+	for( size_t i = 0; i < n; i++ )
+	{
+		long val;
+		checkpoint::get( in, val );
+		l.push_back( val );
+	}
+}
+
+void EatStatistics::Dump( ostream &out )
+{
+	dumpList( out, average.numAttemptsList );
+	dumpList( out, average.numFailedList );
+	dumpList( out, average.numFailedYawList );
+	dumpList( out, average.numFailedVelList );
+	checkpoint::put( out, average.numAttempts );
+	checkpoint::put( out, average.numFailed );
+	checkpoint::put( out, average.numFailedYaw );
+	checkpoint::put( out, average.numFailedVel );
+	checkpoint::put( out, average.ratioFailed );
+	checkpoint::put( out, average.ratioFailedYaw );
+	checkpoint::put( out, average.ratioFailedVel );
+}
+
+void EatStatistics::Load( istream &in )
+{
+	loadList( in, average.numAttemptsList );
+	loadList( in, average.numFailedList );
+	loadList( in, average.numFailedYawList );
+	loadList( in, average.numFailedVelList );
+	checkpoint::get( in, average.numAttempts );
+	checkpoint::get( in, average.numFailed );
+	checkpoint::get( in, average.numFailedYaw );
+	checkpoint::get( in, average.numFailedVel );
+	checkpoint::get( in, average.ratioFailed );
+	checkpoint::get( in, average.ratioFailedYaw );
+	checkpoint::get( in, average.ratioFailedVel );
+}
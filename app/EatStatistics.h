@@ -1,5 +1,6 @@
 #pragma once
 
+#include <iostream>
 #include <list>
 #include <string>
 
@@ -13,6 +14,9 @@ class EatStatistics
 
 	const float *GetProperty( const std::string &name );
 
+	void Dump( std::ostream &out );
+	void Load( std::istream &in );
+
  private:
 	struct Step
 	{
@@ -36,6 +36,29 @@
 #include "Energy.h"
 #endif
 
+//===========================================================================
+// runHeadless
+//
+// Runs the simulation in a tight loop, with no event loop and no windows.
+// Agent vision is rendered in software. TSimulation::End() reports the
+// exit reason and step rate, then exits the process.
+//===========================================================================
+
+static int runHeadless( int argc, char** argv, const char *worldfilePath, const char *restorePath )
+{
+	QCoreApplication app( argc, argv );
+
+	QCoreApplication::setOrganizationDomain( "indiana.edu" );
+	QCoreApplication::setApplicationName( "polyworld" );
+
+	TSimulation *simulation = new TSimulation( NULL, NULL, worldfilePath, restorePath );
+
+	while( true )
+		simulation->Step();
+
+	return 0;
+}
+
 //===========================================================================
 // main
 //===========================================================================
@@ -52,14 +75,26 @@ int main(int argc, char** argv)
 #endif
 
 	bool debugMode = false;
+	bool headless = false;
 	const char *worldfilePath = NULL;
+	const char *restorePath = NULL;
 	if( argc > 1 )
 	{
 		int argi = 1;
-		if( 0 == strcmp(argv[argi], "--debug") )
+		for( ; (argi < argc) && (0 == strncmp(argv[argi], "--", 2)); argi++ )
 		{
-			debugMode = true;
-			argi++;
+			if( 0 == strcmp(argv[argi], "--debug") )
+				debugMode = true;
+			else if( 0 == strcmp(argv[argi], "--headless") )
+				headless = true;
+			else if( (0 == strcmp(argv[argi], "--restore")) && (argi + 1 < argc) )
+				restorePath = argv[++argi];
+			else
+			{
+				fprintf( stderr, "Unknown option: %s\n", argv[argi] );
+				fprintf( stderr, "usage: %s [--debug | --headless] [--restore checkpoint] [worldfile]\n", argv[0] );
+				return 1;
+			}
 		}
 
 		if( argi < argc )
@@ -69,6 +104,17 @@ int main(int argc, char** argv)
 		}
 	}
 
+	if( headless )
+	{
+		if( debugMode )
+		{
+			fprintf( stderr, "--debug requires the GUI and cannot be used with --headless\n" );
+			return 1;
+		}
+
+		return runHeadless( argc, argv, worldfilePath, restorePath );
+	}
+
 	// Create application instance
 	TPWApp app(argc, argv);
 	
@@ -86,7 +132,7 @@ int main(int argc, char** argv)
 
 	
 	// Create the main window (without passing a menubar)
-	TSceneWindow *sceneWindow = new TSceneWindow( worldfilePath );
+	TSceneWindow *sceneWindow = new TSceneWindow( worldfilePath, restorePath );
 
 	// Either create the debugger or construct the scheduler/gui-timer
 	if( debugMode )
@@ -217,7 +263,7 @@ TPWApp::TPWApp(int& argc, char** argv) : QApplication(argc, argv)
 //---------------------------------------------------------------------------
 // TSceneWindow::TSceneWindow
 //---------------------------------------------------------------------------
-TSceneWindow::TSceneWindow( const char *worldfilePath )
+TSceneWindow::TSceneWindow( const char *worldfilePath, const char *restorePath )
 //	:	QMainWindow(0, "Polyworld", WDestructiveClose | WGroupLeader),
 	:	QMainWindow( 0, 0 ),
 		fWindowsMenu(NULL)
@@ -255,7 +301,7 @@ TSceneWindow::TSceneWindow( const char *worldfilePath )
 	// Create the simulation
 	// NOTE: Must wait until after the above RestoreFromPrefs(), so the window
 	// is the right size when we create the TSimulation object below.
-	fSimulation = new TSimulation( fSceneView, this, worldfilePath );
+	fSimulation = new TSimulation( fSceneView, this, worldfilePath, restorePath );
 	fSceneView->SetSimulation( fSimulation );
 }
 
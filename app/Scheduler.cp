@@ -1,5 +1,59 @@
 #include "Scheduler.h"
 
+#define TaskSizeQuantum 16
+#define MaxPooledTaskSize 256
+
+namespace
+{
+	struct FreeTask
+	{
+		FreeTask *next;
+	};
+
+	SpinMutex taskPoolMutex;
+	FreeTask *taskPool[ MaxPooledTaskSize / TaskSizeQuantum ];
+}
+
+void *ITask::operator new( size_t size )
+{
+	if( size > MaxPooledTaskSize )
+		return ::operator new( size );
+
+	int bucket = (size - 1) / TaskSizeQuantum;
+	FreeTask *t;
+
+	MUTEX( taskPoolMutex,
+		   t = taskPool[bucket];
+		   if( t )
+			   taskPool[bucket] = t->next;
+		   );
+
+	if( t == NULL )
+		t = (FreeTask *)::operator new( (bucket + 1) * TaskSizeQuantum );
+
+	return t;
+}
+
+void ITask::operator delete( void *p, size_t size )
+{
+	if( p == NULL )
+		return;
+
+	if( size > MaxPooledTaskSize )
+	{
+		::operator delete( p );
+		return;
+	}
+
+	int bucket = (size - 1) / TaskSizeQuantum;
+	FreeTask *t = (FreeTask *)p;
+
+	MUTEX( taskPoolMutex,
+		   t->next = taskPool[bucket];
+		   taskPool[bucket] = t;
+		   );
+}
+
 void Scheduler::execMasterTask( TSimulation *sim,
 								ITask &masterTask,
 								bool forceAllSerial )
@@ -101,5 +155,15 @@ void Scheduler::postSerial( ITask *task )
 	{
 		serialTasks.post( task );
 	}
-		
+
+}
+
+int Scheduler::getWorkerCount()
+{
+	return parallelTasks.getThreadCount();
+}
+
+void Scheduler::getWorkerTimes( int worker, double *busy, double *idle )
+{
+	parallelTasks.getTimes( worker, busy, idle );
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+
 #include "Queue.h"
 
 // forward decl
@@ -11,6 +13,11 @@ class ITask
 	virtual ~ITask() {}
 
 	virtual void task_exec( TSimulation *sim ) = 0;
+
+	// Tasks are created and deleted every step (e.g. one per agent death), so
+	// their memory is recycled rather than returned to the heap.
+	static void *operator new( size_t size );
+	static void operator delete( void *p, size_t size );
 };
 
 class Scheduler
@@ -22,8 +29,11 @@ class Scheduler
 	void postParallel( ITask *task );
 	void postSerial( ITask *task );
 
+	int getWorkerCount();
+	void getWorkerTimes( int worker, double *busy, double *idle );
+
  private:
-	BusyFetchQueue<ITask *> parallelTasks;
+	WorkStealingQueue<ITask *> parallelTasks;
 	SerialQueue<ITask *> serialTasks;
 	bool forceAllSerial;
 	TSimulation *sim;
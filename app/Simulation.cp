@@ -29,12 +29,16 @@
 #include "Simulation.h"
 
 // System
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <omp.h>
 #include <sstream>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <sys/errno.h>
 #include <assert.h>
 
@@ -184,7 +188,7 @@ inline float AverageAngles( float a, float b )
 //---------------------------------------------------------------------------
 // TSimulation::TSimulation
 //---------------------------------------------------------------------------
-TSimulation::TSimulation( TSceneView* sceneView, TSceneWindow* sceneWindow, const char *worldfilePath )
+TSimulation::TSimulation( TSceneView* sceneView, TSceneWindow* sceneWindow, const char *worldfilePath, const char *restorePath )
 	:
 		fLockStepWithBirthsDeathsLog(false),
 		fLockstepFile(NULL),
@@ -202,6 +206,7 @@ TSimulation::TSimulation( TSceneView* sceneView, TSceneWindow* sceneWindow, cons
 
 		fLifeSpanLog(NULL),
 		fRecordPosition(false),
+		fPositionWriter(NULL),
 		fRecordContacts(false),
 		fContactsLog(NULL),
 		fRecordCollisions(false),
@@ -210,6 +215,7 @@ TSimulation::TSimulation( TSceneView* sceneView, TSceneWindow* sceneWindow, cons
 		fCarryLog(NULL),
 		fRecordEnergy(false),
 		fEnergyLog(NULL),
+		fAsyncEventLogs(false),
 
 		fBrainAnatomyRecordAll(false),
 		fBrainFunctionRecordAll(false),
@@ -226,6 +232,7 @@ TSimulation::TSimulation( TSceneView* sceneView, TSceneWindow* sceneWindow, cons
 
 		fSceneView(sceneView),
 		fSceneWindow(sceneWindow),
+		fHeadless(sceneView == NULL),
 		fOverheadWindow(NULL),
 		fBirthrateWindow(NULL),
 		fFitnessWindow(NULL),
@@ -240,7 +247,10 @@ TSimulation::TSimulation( TSceneView* sceneView, TSceneWindow* sceneWindow, cons
 		fDelay(0),
 		fDumpFrequency(500),
 		fStatusFrequency(100),
-		fLoadState(false),
+		fLoadState(restorePath != NULL),
+		fRecordCheckPoints(false),
+		fCheckPointPid(0),
+		fRestorePath(restorePath),
 		inited(false),
 		
 		fSolidObjects(0x4),	// only bricks are solid by default, for historical reasons
@@ -270,7 +280,9 @@ TSimulation::TSimulation( TSceneView* sceneView, TSceneWindow* sceneWindow, cons
 		fBrainMonitorStride(25),
 		fGeneSum(NULL),
 		fGeneSum2(NULL),
-		fGeneStatsAgents(NULL),
+		fGeneStatsCount(0),
+		fGeneSumSnapshot(NULL),
+		fGeneSum2Snapshot(NULL),
 		fGeneStatsFile(NULL),
 		fFoodPatchStatsFile(NULL),
 		fNumAgentsNotInOrNearAnyFoodPatch(0),
@@ -298,8 +310,11 @@ TSimulation::~TSimulation()
 	if( fGeneSum2 )
 		free( fGeneSum2 );
 
-    if( fGeneStatsAgents )
-		free( fGeneStatsAgents );
+	if( fGeneSumSnapshot )
+		free( fGeneSumSnapshot );
+
+	if( fGeneSum2Snapshot )
+		free( fGeneSum2Snapshot );
 		
 	if( fGeneStatsFile )
 		fclose( fGeneStatsFile );
@@ -440,7 +455,7 @@ void TSimulation::Step()
 		return;
 	}
 	
-	if( (frame == 0) && (fSimulationSeed != 0) )
+	if( (fStep == 0) && (fSimulationSeed != 0) )
 	{
 		srand48(fSimulationSeed);
 	}
@@ -463,9 +478,11 @@ void TSimulation::Step()
 	
 	debugcheck( "beginning of step %ld", fStep );
 
+	fStepProfiler.beginStep();
+
 	// compute some frame rates
 	timeNow = hirestime();
-	if( fStep == 1 )
+	if( frame == 1 )
 	{
 		fFramesPerSecondOverall = 0.;
 		fSecondsPerFrameOverall = 0.;
@@ -480,10 +497,10 @@ void TSimulation::Step()
 	}
 	else
 	{
-		fFramesPerSecondOverall = fStep / (timeNow - fTimeStart);
+		fFramesPerSecondOverall = frame / (timeNow - fTimeStart);
 		fSecondsPerFrameOverall = 1. / fFramesPerSecondOverall;
 		
-		if( fStep > RecentSteps )
+		if( frame > RecentSteps )
 		{
 			fFramesPerSecondRecent = RecentSteps / (timeNow - sTimePrevious[RecentSteps-1]);
 			fSecondsPerFrameRecent = 1. / fFramesPerSecondRecent;
@@ -492,7 +509,7 @@ void TSimulation::Step()
 		fFramesPerSecondInstantaneous = 1. / (timeNow - sTimePrevious[0]);
 		fSecondsPerFrameInstantaneous = 1. / fFramesPerSecondInstantaneous;
 
-		int numSteps = fStep < RecentSteps ? fStep : RecentSteps;
+		int numSteps = frame < RecentSteps ? frame : RecentSteps;
 		for( int i = numSteps-1; i > 0; i-- )
 			sTimePrevious[i] = sTimePrevious[i-1];
 	}
@@ -518,23 +535,31 @@ void TSimulation::Step()
 	fFoodEnergyOut = 0.0;
 
 	// Update the barriers, now that they can be dynamic
+	fStepProfiler.begin( StepProfiler::Barriers );
 	barrier* b;
 	barrier::gXSortedBarriers.reset();
 	while( barrier::gXSortedBarriers.next( b ) )
 		b->update();
 	barrier::gXSortedBarriers.xsort();
+	fStepProfiler.end( StepProfiler::Barriers );
 	
 	// Update the conditional properties
+	fStepProfiler.begin( StepProfiler::ConditionalProps );
 	fConditionalProps->update( fStep );
+	fStepProfiler.end( StepProfiler::ConditionalProps );
 
 	// Update all agents, using their neurally controlled behaviors
+	fStepProfiler.begin( StepProfiler::UpdateAgents );
 	{
-		// Make the agent POV window the current GL context
-		fAgentPOVWindow->makeCurrent();
+		if( !agent::gSoftwareVision )
+		{
+			// Make the agent POV window the current GL context
+			fAgentPOVWindow->makeCurrent();
 		
-		// Clear the window's color and depth buffers
-		fAgentPOVWindow->qglClearColor( Qt::black );
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			// Clear the window's color and depth buffers
+			fAgentPOVWindow->qglClearColor( Qt::black );
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
 		
 		// These are the agent counts to be used in applying either the LowPopulationAdvantage or the (high) PopulationPenalty
 		// Assume global settings apply, until we know better
@@ -602,8 +627,10 @@ void TSimulation::Step()
 		}
 
 		// Swap buffers for the agent POV window when they're all done
-		fAgentPOVWindow->swapBuffers();
+		if( !agent::gSoftwareVision )
+			fAgentPOVWindow->swapBuffers();
 	}
+	fStepProfiler.end( StepProfiler::UpdateAgents );
 
 	if( fHeuristicFitnessWeight != 0.0 )
 		oldNumBorn = fNumberBornVirtual;
@@ -630,9 +657,11 @@ void TSimulation::Step()
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 	// !!! EXEC MASTER
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+	fStepProfiler.begin( StepProfiler::Interact );
 	fScheduler.execMasterTask( this,
 							   execInteract,
 							   !fParallelInteract );
+	fStepProfiler.end( StepProfiler::Interact );
 		
 	assert( fNumberAlive == objectxsortedlist::gXSortedObjects.getCount(AGENTTYPE) );
 
@@ -649,9 +678,6 @@ void TSimulation::Step()
 	printf( "\n" );
 #endif
 
-    if (fMonitorGeneSeparation && (fNewDeaths > 0))
-        CalculateGeneSeparationAll();
-
 	// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
 	// ^^^ MASTER TASK CreateAgentsTask
 	// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
@@ -667,9 +693,11 @@ void TSimulation::Step()
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 	// !!! EXEC MASTER
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+	fStepProfiler.begin( StepProfiler::CreateAgents );
 	fScheduler.execMasterTask( this,
 							   execCreateAgents,
 							   !fParallelCreateAgents );
+	fStepProfiler.end( StepProfiler::CreateAgents );
 
     if ((fNewLifes || fNewDeaths) && fMonitorGeneSeparation)
     {
@@ -677,20 +705,27 @@ void TSimulation::Step()
             RecordGeneSeparation();
 
 		if (fChartGeneSeparation && fGeneSeparationWindow != NULL)
+		{
+			UpdateGeneSeparationVals();
 			fGeneSeparationWindow->AddPoint(fGeneSepVals, fNumGeneSepVals);
+		}
     }
 
 	// -------------------------
 	// ---- Maintain Bricks ----
 	// -------------------------
 	// maintain bricks, which may be in dynamic patches...
+	fStepProfiler.begin( StepProfiler::MaintainBricks );
 	MaintainBricks();
+	fStepProfiler.end( StepProfiler::MaintainBricks );
 
 	// -----------------------
 	// ---- Maintain Food ----
 	// -----------------------
 	// finally, maintain the world's food supply...
+	fStepProfiler.begin( StepProfiler::MaintainFood );
 	MaintainFood();
+	fStepProfiler.end( StepProfiler::MaintainFood );
 
 	fTotalFoodEnergyIn += fFoodEnergyIn;
 	fTotalFoodEnergyOut += fFoodEnergyOut;
@@ -698,6 +733,8 @@ void TSimulation::Step()
 	fAverageFoodEnergyIn = (float(fStep - 1) * fAverageFoodEnergyIn + fFoodEnergyIn) / float(fStep);
 	fAverageFoodEnergyOut = (float(fStep - 1) * fAverageFoodEnergyOut + fFoodEnergyOut) / float(fStep);
 	
+	fStepProfiler.begin( StepProfiler::Monitoring );
+
 	// Update the various graphical windows
 	if (fGraphics)
 	{
@@ -1303,6 +1340,15 @@ void TSimulation::Step()
 		fCamera.settranslation((0.5+fCameraRadius*sin(camrad))*globals::worldsize, fCameraHeight*globals::worldsize,(-.5+fCameraRadius*cos(camrad))*
 globals::worldsize);
 	}
+
+	fStepProfiler.end( StepProfiler::Monitoring );
+
+	if( fRecordCheckPoints && (fDumpFrequency > 0) && ((fStep % fDumpFrequency) == 0) )
+		WriteCheckPoint();
+
+	fStepProfiler.endStep( fStep,
+						   objectxsortedlist::gXSortedObjects.getCount(AGENTTYPE),
+						   objectxsortedlist::gXSortedObjects.getCount(FOODTYPE) );
 }
 
 //---------------------------------------------------------------------------
@@ -1318,6 +1364,20 @@ void TSimulation::End( const string &reason )
 		Kill( a, LifeSpan::DR_SIMEND );
 	}	
 
+	if( fCheckPointPid > 0 )
+	{
+		waitpid( fCheckPointPid, NULL, 0 );
+		fCheckPointPid = 0;
+	}
+
+	fStepProfiler.stop();
+
+	if( fPositionWriter )
+	{
+		delete fPositionWriter;
+		fPositionWriter = NULL;
+	}
+
 	EndSeparationsLog();
 	EndLifeSpanLog();
 	EndContactsLog();
@@ -1339,7 +1399,27 @@ void TSimulation::End( const string &reason )
 
 	fConditionalProps->dispose();
 
-	printf( "Simulation stopped after step %ld\n", fStep );
+	printf( "Simulation stopped after step %ld (%s), %.2f steps/sec\n", fStep, reason.c_str(), fFramesPerSecondOverall );
+
+	if( fParallelInteract || fParallelCreateAgents )
+	{
+		for( int i = 0; i < fScheduler.getWorkerCount(); i++ )
+		{
+			double busy, idle;
+			fScheduler.getWorkerTimes( i, &busy, &idle );
+			printf( "Scheduler worker %d: busy %.2fs, idle %.2fs\n", i, busy, idle );
+		}
+	}
+
+	if( fParallelBrains )
+	{
+		for( int i = 0; i < fUpdateBrainQueue.getThreadCount(); i++ )
+		{
+			double busy, idle;
+			fUpdateBrainQueue.getTimes( i, &busy, &idle );
+			printf( "Brain worker %d: busy %.2fs, idle %.2fs\n", i, busy, idle );
+		}
+	}
 
 	{
 		ofstream fout( "run/endStep.txt" );
@@ -1355,7 +1435,10 @@ void TSimulation::End( const string &reason )
 
 	// TODO: Clean up the dispose path.
 	// Deleting the SceneWindow deletes *this*.
-	delete fSceneWindow;
+	if( fSceneWindow )
+		delete fSceneWindow;
+	else
+		delete this;
 	
 	exit( 0 );
 }
@@ -1391,7 +1474,7 @@ void TSimulation::Init( const char *argWorldfilePath )
 
     srand(1);
 
-	fGraphics = true;
+	fGraphics = !fHeadless;
     InitWorld();
 
 	proplib::Document *docWorldFile;
@@ -1400,6 +1483,22 @@ void TSimulation::Init( const char *argWorldfilePath )
 	cout << "worldfile = " << docWorldFile->getName() << endl;
 
 	ProcessWorldFile( docWorldFile );
+	fPatchGrid.build( fNumDomains, fDomains, globals::worldsize );
+
+	if( fHeadless )
+	{
+		// There is no GL context to render vision or a movie into
+		if( !agent::gSoftwareVision )
+		{
+			cout << "Headless: rendering agent vision in software" << endl;
+			agent::gSoftwareVision = true;
+		}
+		if( fRecordMovie )
+		{
+			cerr << "Warning: RecordMovie is not supported when headless. Turning off RecordMovie." << endl;
+			fRecordMovie = false;
+		}
+	}
 
 	// Init array tracking number of agents with a given metabolism
 	assert( Metabolism::getNumberOfDefinitions() < MAXMETABOLISMS );
@@ -1415,6 +1514,25 @@ void TSimulation::Init( const char *argWorldfilePath )
 									RandomNumberGenerator::LOCAL );
 	}
 
+	if( fRandomStreams )
+	{
+		RandomNumberGenerator::setStreamSeed( fGenomeSeed, fSimulationSeed );
+		RandomNumberGenerator::set( RandomNumberGenerator::NERVOUS_SYSTEM,
+									RandomNumberGenerator::STREAM );
+		RandomNumberGenerator::set( RandomNumberGenerator::TOPOLOGICAL_DISTORTION,
+									RandomNumberGenerator::STREAM );
+		RandomNumberGenerator::set( RandomNumberGenerator::INIT_WEIGHT,
+									RandomNumberGenerator::STREAM );
+		RandomNumberGenerator::set( RandomNumberGenerator::GENOME,
+									RandomNumberGenerator::STREAM );
+	}
+
+	// With per-agent streams a newborn's genome comes out the same on any
+	// thread, so births can build it in their parallel GrowAgent task. The
+	// one thing needed from it right away is the metabolism, and that's only
+	// a gene when there's more than one.
+	fParallelGenomes = fRandomStreams && (Metabolism::getNumberOfDefinitions() == 1);
+
 	InitNeuralValues();	 // Must be called before genome and brain init
 	
     Brain::braininit();
@@ -1435,7 +1553,11 @@ void TSimulation::Init( const char *argWorldfilePath )
 	agent::gMaxRadius = maxagentradius > maxfoodradius ?
 						  maxagentradius : maxfoodradius;
 
-    InitMonitoringWindows();
+	if( fSpatialGrid )
+		objectxsortedlist::gXSortedObjects.enableGrid( globals::worldsize, 2.0 * agent::gMaxRadius );
+
+	if( fGraphics )
+		InitMonitoringWindows();
 
     if( fNumberFit > 0 )
     {
@@ -1511,6 +1633,19 @@ void TSimulation::Init( const char *argWorldfilePath )
 	if( mkdir( PATH, PwDirMode ) )								\
 		eprintf( "Error making %s directory (%d)\n", PATH, errno );
 
+	// A checkpoint usually lives in the run directory that is about to be
+	// moved aside, so open it first.
+	ifstream restoreIn;
+	if( fLoadState )
+	{
+		restoreIn.open( fRestorePath, ios::binary );
+		if( !restoreIn )
+		{
+			cerr << "Unable to open checkpoint \"" << fRestorePath << "\"" << endl;
+			exit( 1 );
+		}
+	}
+
 	// First save the old directory, if it exists
 	sprintf( s, "run" );
 	sprintf( t, "run_%ld", time(NULL) );
@@ -1519,6 +1654,13 @@ void TSimulation::Init( const char *argWorldfilePath )
 	MKDIR( "run" );
 	MKDIR( "run/stats" );
 
+	if( fRecordStepProfile )
+	{
+		fStepProfiler.start( "run/stats/stepprofile.txt",
+							 fStepProfileFrequency,
+							 fRecordStepTrace ? "run/stats/steptrace.json" : NULL );
+	}
+
 	MKDIR( "run/genome" );
 	MKDIR( "run/genome/meta" );
 	if( fRecordGenomes )
@@ -1530,12 +1672,13 @@ void TSimulation::Init( const char *argWorldfilePath )
 	{
 		MKDIR( "run/motion" );
 		MKDIR( "run/motion/position" );
-		if( fRecordPosition )
-			MKDIR( "run/motion/position/agents" );
 		if( fRecordBarrierPosition )
 			MKDIR( "run/motion/position/barriers" );
 	}
 
+	if( fRecordPosition )
+		fPositionWriter = new PositionWriter( "run/motion/position/positions.bin" );
+
 	if( fRecordContacts || fRecordCollisions || fRecordCarry || fRecordEnergy )
 	{
 		MKDIR( "run/events" );
@@ -1550,12 +1693,11 @@ void TSimulation::Init( const char *argWorldfilePath )
 	if( fBestSoFarBrainAnatomyRecordFrequency || fBestSoFarBrainFunctionRecordFrequency ||
 		fBestRecentBrainAnatomyRecordFrequency || fBestRecentBrainFunctionRecordFrequency ||
 		fBrainAnatomyRecordAll || fBrainFunctionRecordAll ||
-		fBrainAnatomyRecordSeeds || fBrainFunctionRecordSeeds || fAdamiComplexityRecordFrequency || fRecordPosition)
+		fBrainAnatomyRecordSeeds || fBrainFunctionRecordSeeds || fAdamiComplexityRecordFrequency)
 	{
 		int agent_factor = 0;
 
 		if( RecordBrainFunction( 1 ) ) agent_factor++;
-		if( fRecordPosition ) agent_factor++;
 
 		int nfiles = 100 + (fMaxNumAgents * agent_factor);
 
@@ -1686,11 +1828,17 @@ void TSimulation::Init( const char *argWorldfilePath )
 	// If we're going to record the gene means and std devs, we need to allocate a couple of stat arrays
 	if( fRecordGeneStats )
 	{
-		fGeneSum  = (unsigned long*) malloc( sizeof( *fGeneSum  ) * GenomeUtil::schema->getMutableSize() );
+		int ngenes = GenomeUtil::schema->getMutableSize();
+
+		// The sums are kept up to date by Birth() and Kill(), so they start empty
+		fGeneSum  = (unsigned long*) calloc( ngenes, sizeof( *fGeneSum  ) );
 		Q_CHECK_PTR( fGeneSum );
-		fGeneSum2 = (unsigned long*) malloc( sizeof( *fGeneSum2 ) * GenomeUtil::schema->getMutableSize() );
+		fGeneSum2 = (unsigned long*) calloc( ngenes, sizeof( *fGeneSum2 ) );
 		Q_CHECK_PTR( fGeneSum2 );
-		fGeneStatsAgents = (agent**) malloc( sizeof( *fGeneStatsAgents ) * GetMaxAgents() );
+		fGeneSumSnapshot  = (unsigned long*) malloc( sizeof( *fGeneSumSnapshot  ) * ngenes );
+		Q_CHECK_PTR( fGeneSumSnapshot );
+		fGeneSum2Snapshot = (unsigned long*) malloc( sizeof( *fGeneSum2Snapshot ) * ngenes );
+		Q_CHECK_PTR( fGeneSum2Snapshot );
 		
 		fGeneStatsFile = fopen( "run/genome/genestats.txt", "w" );
 		Q_CHECK_PTR( fGeneStatsFile );
@@ -1777,6 +1925,8 @@ void TSimulation::Init( const char *argWorldfilePath )
 
 	srand48(fGenomeSeed);
 
+	fEatStatistics.Init();
+
 	if (!fLoadState)
 	{
 		// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
@@ -1827,14 +1977,28 @@ void TSimulation::Init( const char *argWorldfilePath )
 				fDomains[domainNumber].fBrickPatches[brickPatchNumber].updateOn( 0 );
 			}
 		}
-	}
 
-	fEatStatistics.Init();
+		fTotalFoodEnergyIn = fFoodEnergyIn;
+		fTotalFoodEnergyOut = fFoodEnergyOut;
+		fAverageFoodEnergyIn = 0.0;
+		fAverageFoodEnergyOut = 0.0;
+
+		fCameraAngle = fCameraAngleStart;
+	}
+	else
+	{
+		RestoreCheckPoint( restoreIn );
+		restoreIn.close();
 
-    fTotalFoodEnergyIn = fFoodEnergyIn;
-    fTotalFoodEnergyOut = fFoodEnergyOut;
-    fAverageFoodEnergyIn = 0.0;
-    fAverageFoodEnergyOut = 0.0;
+		// Restored agents don't go through Birth(), so count them into the gene stats here
+		if( fRecordGeneStats )
+		{
+			agent *a;
+			objectxsortedlist::gXSortedObjects.reset();
+			while( objectxsortedlist::gXSortedObjects.nextObj( AGENTTYPE, (gobject**)&a ) )
+				UpdateGeneStats( a, true );
+		}
+	}
 
     fGround.sety(-fGroundClearance);
     fGround.setscale(globals::worldsize);
@@ -1850,10 +2014,10 @@ void TSimulation::Init( const char *argWorldfilePath )
 	// Set up scene and camera
 	fScene.SetStage(&fStage);
 	fScene.SetCamera(&fCamera);
-	fCamera.SetPerspective(fCameraFOV, (float)fSceneView->width() / (float)fSceneView->height(), 0.01, 1.5 * globals::worldsize);	
+	float sceneAspect = fSceneView ? (float)fSceneView->width() / (float)fSceneView->height() : 1.0;
+	fCamera.SetPerspective(fCameraFOV, sceneAspect, 0.01, 1.5 * globals::worldsize);	
 	
 	//The main camera will rotate around the world, so we need to set up the angle and translation  (CMB 03/10/06)
-	fCameraAngle = fCameraAngleStart;
 	float camrad = fCameraAngle * DEGTORAD;
 	fCamera.settranslation((0.5 + fCameraRadius * sin(camrad)) * globals::worldsize,
 						fCameraHeight * globals::worldsize, (-0.5 + fCameraRadius * cos(camrad)) * globals::worldsize);
@@ -1873,7 +2037,7 @@ void TSimulation::Init( const char *argWorldfilePath )
 	//Set up the overhead camera (CMB 3/13/06)
 	fOverheadCamera.setcolor(fCameraColor);
 //	fOverheadCamera.SetFog(false, glFogFunction(), glExpFogDensity(), glLinearFogEnd() );
-	fOverheadCamera.SetPerspective(fCameraFOV, (float)fSceneView->width() / (float)fSceneView->height(),0.01, 1.5 * globals::worldsize);
+	fOverheadCamera.SetPerspective(fCameraFOV, sceneAspect,0.01, 1.5 * globals::worldsize);
 	fOverheadCamera.settranslation(0.5*globals::worldsize, 0.2*globals::worldsize,-0.5*globals::worldsize);
 	fOverheadCamera.SetRotation(0.0, -fCameraFOV, 0.0);
 	//fOverheadCamera.UseLookAt();
@@ -1882,9 +2046,12 @@ void TSimulation::Init( const char *argWorldfilePath )
 //	fStage.AddObject(&fOverheadCamera);
 
 	// Add scene to scene view and to overhead view
-	Q_CHECK_PTR(fSceneView);
-	fSceneView->SetScene(&fScene);
-	fOverheadWindow->SetScene( &fOverheadScene );  //Set up overhead view (CMB 3/13/06)
+	if( fGraphics )
+	{
+		Q_CHECK_PTR(fSceneView);
+		fSceneView->SetScene(&fScene);
+		fOverheadWindow->SetScene( &fOverheadScene );  //Set up overhead view (CMB 3/13/06)
+	}
 
 #define DebugGenetics false
 #if DebugGenetics
@@ -1918,7 +2085,8 @@ void TSimulation::Init( const char *argWorldfilePath )
 	// Set up gene Separation monitoring
 	if (fMonitorGeneSeparation)
     {
-		fGeneSepVals = new float[fMaxNumAgents * (fMaxNumAgents - 1) / 2];
+		fMaxNumGeneSepVals = fMaxNumAgents * (fMaxNumAgents - 1) / 2;
+		fGeneSepVals = new float[fMaxNumGeneSepVals];
         fNumGeneSepVals = 0;
         CalculateGeneSeparationAll();
 
@@ -1929,7 +2097,10 @@ void TSimulation::Init( const char *argWorldfilePath )
         }
 
 		if (fChartGeneSeparation && fGeneSeparationWindow != NULL)
+		{
+			UpdateGeneSeparationVals();
 			fGeneSeparationWindow->AddPoint(fGeneSepVals, fNumGeneSepVals);
+		}
     }
 	
 	// Set up to record a movie, if requested
@@ -2232,6 +2403,8 @@ void TSimulation::InitWorld()
 	fPositionSeed = 42;
     fGenomeSeed = 42;
 	fSimulationSeed = 42;
+	fRandomStreams = false;
+	fParallelGenomes = false;
     fAgentsRfood = RFOOD_TRUE;
     fFitness1Frequency = 100;
     fFitness2Frequency = 2;
@@ -2302,6 +2475,8 @@ void TSimulation::InitWorld()
     fMinGeneSeparation = 1.e+10;
     fMaxGeneSeparation = 0.0;
     fAverageGeneSeparation = 5.e+9;
+	fGeneSepSum = 0.0;
+	fMaxNumGeneSepVals = 0;
     fNumBornSinceCreated = 0;
     fChartGeneSeparation = false; // GeneSeparation (if true, genesepmon must be true)
     fDeathProbability = 0.001;
@@ -2310,9 +2485,13 @@ void TSimulation::InitWorld()
 	fSmiteAgeFrac = 0.25;
     fShowVision = true;
 	fStaticTimestepGeometry = false;
+	fSpatialGrid = false;
 	fRecordMovie = false;
 	fMovieWriter = NULL;
 	fRecordPerformanceStats = true;
+	fRecordStepProfile = false;
+	fStepProfileFrequency = 100;
+	fRecordStepTrace = false;
 
     fFitI = 0;
     fFitJ = 1;
@@ -2370,8 +2549,9 @@ void TSimulation::InitWorld()
 	genome::gEnableGive = false;
 	genome::gEnableCarry = false;
 
-	fGraphics = true;
+	fGraphics = !fHeadless;
     agent::gVision = true;
+    agent::gSoftwareVision = false;
     agent::gMaxVelocity = 1.0;
     fMaxNumAgents = 50;
     agent::gInitMateWait = 25;
@@ -2577,7 +2757,7 @@ void TSimulation::SeedGenome( long agentNumber,
 	{
 		GenomeUtil::seed( genes );
 	}
-	if( randpw() < probabilityOfMutatingSeeds )
+	if( genes->getRNG()->drand() < probabilityOfMutatingSeeds )
 	{
 		genes->mutate();
 	}
@@ -2734,7 +2914,7 @@ void TSimulation::ReadSeedPositionsFromFile()
 
 void TSimulation::InitLifeSpanLog()
 {
-	fLifeSpanLog = new DataLibWriter( "run/lifespans.txt" );
+	fLifeSpanLog = new DataLibWriter( "run/lifespans.txt", false, true, fAsyncEventLogs );
 
 	const char *colnames[] =
 		{
@@ -2794,7 +2974,7 @@ void TSimulation::InitContactsLog()
 	if( !fRecordContacts )
 		return;
 
-	fContactsLog = new DataLibWriter( "run/events/contacts.log" );
+	fContactsLog = new DataLibWriter( "run/events/contacts.log", false, true, fAsyncEventLogs );
 
 	ContactEntry::start( fContactsLog );
 }
@@ -2823,7 +3003,7 @@ void TSimulation::InitCollisionsLog()
 	if( !fRecordCollisions )
 		return;
 
-	fCollisionsLog = new DataLibWriter( "run/events/collisions.log" );
+	fCollisionsLog = new DataLibWriter( "run/events/collisions.log", false, true, fAsyncEventLogs );
 
 	const char *colnames[] =
 		{
@@ -2892,7 +3072,7 @@ void TSimulation::InitCarryLog()
 	if( !fRecordCarry )
 		return;
 
-	fCarryLog = new DataLibWriter( "run/events/carry.log" );
+	fCarryLog = new DataLibWriter( "run/events/carry.log", false, true, fAsyncEventLogs );
 
 	const char *colnames[] =
 		{
@@ -2975,7 +3155,7 @@ void TSimulation::InitEnergyLog()
 	if( !fRecordEnergy )
 		return;
 
-	fEnergyLog = new DataLibWriter( "run/events/energy.log" );
+	fEnergyLog = new DataLibWriter( "run/events/energy.log", false, true, fAsyncEventLogs );
 
 	const char *colnames_template[] =
 		{
@@ -3076,7 +3256,7 @@ void TSimulation::InitSeparationsLog()
 {
 	if( fRecordSeparations )
 	{
-		fSeparationsLog = new DataLibWriter( "run/genome/separations.txt" );
+		fSeparationsLog = new DataLibWriter( "run/genome/separations.txt", false, true, fAsyncEventLogs );
 	}
 	else
 	{
@@ -3148,13 +3328,19 @@ void TSimulation::UpdateAgents()
 		pass++;
 	#endif
 
+		fStepProfiler.start( StepProfiler::Vision );
 		a->UpdateVision();
+		fStepProfiler.stop( StepProfiler::Vision );
+		fStepProfiler.start( StepProfiler::Brain );
 		a->UpdateBrain();
+		fStepProfiler.stop( StepProfiler::Brain );
+		fStepProfiler.start( StepProfiler::Body );
 		if( !a->BeingCarried() )
 			fFoodEnergyOut += a->UpdateBody(fMoveFitnessParameter,
 											agent::gSpeed2DPosition,
 											fSolidObjects,
 											NULL);
+		fStepProfiler.stop( StepProfiler::Body );
 	}
 }
 
@@ -3166,6 +3352,10 @@ void TSimulation::UpdateAgents_StaticTimestepGeometry()
 {
 	if( fParallelBrains )
 	{
+		// Brains are timed as a whole pass, which includes vision rendered
+		// on the master thread (also timed on its own) or in software.
+		fStepProfiler.start( StepProfiler::Brain );
+
 		//************************************************************
 		//************************************************************
 		//************************************************************
@@ -3184,21 +3374,29 @@ void TSimulation::UpdateAgents_StaticTimestepGeometry()
 			//////////////////////////////////////////////////
 #pragma omp master
 			{
-				fStage.Compile();
+				if( !agent::gSoftwareVision )
+					fStage.Compile();
 				objectxsortedlist::gXSortedObjects.reset();
 
 				agent *avision = NULL;
 
 				while (objectxsortedlist::gXSortedObjects.nextObj(AGENTTYPE, (gobject**)&avision))
 				{
-					avision->UpdateVision();
+					// GL vision can only be rendered from this thread
+					if( !agent::gSoftwareVision )
+					{
+						fStepProfiler.start( StepProfiler::Vision );
+						avision->UpdateVision();
+						fStepProfiler.stop( StepProfiler::Vision );
+					}
 
 					fUpdateBrainQueue.post( avision );
 				}
 
 				fUpdateBrainQueue.endOfPosts();
 
-				fStage.Decompile();
+				if( !agent::gSoftwareVision )
+					fStage.Decompile();
 			}
 
 			//////////////////////////////////////////////////
@@ -3209,6 +3407,9 @@ void TSimulation::UpdateAgents_StaticTimestepGeometry()
 
 				while( fUpdateBrainQueue.fetch(&abrain) )
 				{
+					if( agent::gSoftwareVision )
+						abrain->UpdateVision();
+
 					abrain->UpdateBrain();
 				}
 			}
@@ -3222,26 +3423,64 @@ void TSimulation::UpdateAgents_StaticTimestepGeometry()
 		//************************************************************
 		//************************************************************
 		//************************************************************
+
+		fStepProfiler.stop( StepProfiler::Brain );
 	}
 	else
 	{
-		fStage.Compile();
+		if( !agent::gSoftwareVision )
+			fStage.Compile();
 		objectxsortedlist::gXSortedObjects.reset();
 
 		agent *a = NULL;
 
 		while (objectxsortedlist::gXSortedObjects.nextObj(AGENTTYPE, (gobject**)&a))
 		{
+			fStepProfiler.start( StepProfiler::Vision );
 			a->UpdateVision();
+			fStepProfiler.stop( StepProfiler::Vision );
+			fStepProfiler.start( StepProfiler::Brain );
 			a->UpdateBrain();
+			fStepProfiler.stop( StepProfiler::Brain );
 		}
 
-		fStage.Decompile();
+		if( !agent::gSoftwareVision )
+			fStage.Decompile();
 	}
 
 	// ---
-	// --- Body (Serial)
+	// --- Body
 	// ---
+	fStepProfiler.begin( StepProfiler::Body );
+	if( fParallelBody )
+	{
+		// Every agent's motion is worked out against where all objects were
+		// before any agent moved, and then the moves are committed in list
+		// order, so the results don't depend on the number of threads.
+		agent *a;
+
+		fBodyAgents.clear();
+		objectxsortedlist::gXSortedObjects.reset();
+		while( objectxsortedlist::gXSortedObjects.nextObj( AGENTTYPE, (gobject**)&a) )
+		{
+			if( !a->BeingCarried() )
+				fBodyAgents.push_back( a );
+		}
+
+		long n = fBodyAgents.size();
+		fBodyEnergy.resize( n );
+
+#pragma omp parallel for schedule(dynamic, 16)
+		for( long i = 0; i < n; i++ )
+			fBodyEnergy[i] = fBodyAgents[i]->UpdateBodyMotion( fSolidObjects, NULL );
+
+		for( long i = 0; i < n; i++ )
+			fFoodEnergyOut += fBodyAgents[i]->UpdateBodyCommit( fMoveFitnessParameter,
+																 agent::gSpeed2DPosition,
+																 fSolidObjects,
+																 fBodyEnergy[i] );
+	}
+	else
 	{
 		agent *a;
 
@@ -3255,6 +3494,7 @@ void TSimulation::UpdateAgents_StaticTimestepGeometry()
 												 NULL );
 		}
 	}
+	fStepProfiler.end( StepProfiler::Body );
 }
 
 
@@ -3273,8 +3513,8 @@ void TSimulation::Interact()
 
 	fEatStatistics.StepBegin();
 
-	// first x-sort all the objects
-	objectxsortedlist::gXSortedObjects.sort();
+	// first x-sort the objects that have moved
+	objectxsortedlist::gXSortedObjects.sortMoved();
 
 #if DebugShowSort
 	if( fStep == 1 )
@@ -3331,7 +3571,9 @@ void TSimulation::Interact()
 	// -----------------------
 	// Take care of deaths first, plus least-fit determinations
 	// Also use this as a convenient place to compute some stats
+	fStepProfiler.begin( StepProfiler::Death );
 	DeathAndStats();
+	fStepProfiler.end( StepProfiler::Death );
 
 #if DebugSmite
 	if( (fStep >= MinDebugStep) && (fStep <= MaxDebugStep) )
@@ -3396,77 +3638,98 @@ void TSimulation::Interact()
         cDied = FALSE;
 
 		// See if there's an overlap with any other agents
-        while( objectxsortedlist::gXSortedObjects.nextObj( AGENTTYPE, (gobject**) &d ) ) // to end of list or...
-        {
-			if( d == c )	// sanity check; shouldn't happen
+		fStepProfiler.start( StepProfiler::Contact );
+		if( objectxsortedlist::gXSortedObjects.gridEnabled() )
+		{
+			objectxsortedlist::gXSortedObjects.getNearby( AGENTTYPE,
+														  c->x() - c->radius(), c->z() - c->radius(),
+														  c->x() + c->radius(), c->z() + c->radius(),
+														  fNearbyObjects );
+
+			// Only agents that follow c in the list, in list order, so each pair interacts once, as below
+			sort( fNearbyObjects.begin(), fNearbyObjects.end(), objectxsortedlist::before );
+
+			// A pair can kill agents further on in fNearbyObjects (Mate may Smite), and
+			// when serial they are deleted at once, so after a death look again and
+			// pick up after the last agent visited, going by its place in the list.
+			bool resume = false;
+			float resumeEdge = 0.0;
+			unsigned long resumeNumber = 0;
+
+			for( long j = 0; j < (long) fNearbyObjects.size(); j++ )
 			{
-				printf( "***************** d == c **************\n" );
-				continue;
-			}
-			
-            if( (d->x() - d->radius()) >= (c->x() + c->radius()) )
-                break;  // this guy (& everybody else in list) is too far away
+				d = (agent*) fNearbyObjects[j];
 
-            // so if we get here, then c & d are close enough in x to interact
+				if( !objectxsortedlist::before( c, d ) )
+					continue;
 
-			// We used to test only on delta z at this point, thereby using manhattan distance to permit interaction
-			// now modified to use actual distances to tighten things up a little (particularly visible in "toy world"
-			// simulations).  Since we are basing interactions on circumscribing circles, agents may still interact
-			// without having an actual overlap of polygons, but using actual distances reduces the range over which
-			// this may happen and should reduce the number of such incidents.
-			if( sqrt( (d->x()-c->x())*(d->x()-c->x()) + (d->z()-c->z())*(d->z()-c->z()) ) <= (d->radius() + c->radius()) )
-            {
-                // and if we get here then they are also close enough in z,
-                // so must actually worry about their interaction
+				float dEdge = d->x() - d->radius();
 
-				ttPrint( "age %ld: agents # %ld & %ld are close\n", fStep, c->Number(), d->Number() );
+				if( resume && ((dEdge < resumeEdge) || ((dEdge == resumeEdge) && (d->getTypeNumber() <= resumeNumber))) )
+					continue;
 
-				ContactEntry contactEntry( fStep, c, d );
+				if( dEdge >= (c->x() + c->radius()) )
+					break;  // this guy (& everybody else in the vector) is too far away
 
-				if( fRecordSeparations )
+				if( sqrt( (d->x()-c->x())*(d->x()-c->x()) + (d->z()-c->z())*(d->z()-c->z()) ) <= (d->radius() + c->radius()) )
 				{
-					// Force a separation calculation so it gets logged.
-					fSeparationCache.separation( c, d );
-				}
+					long deaths = fNewDeaths;
 
-				// -----------------------
-				// ---- Mate (Normal) ----
-				// -----------------------
-                Mate( c, d, &contactEntry );
+					resumeEdge = dEdge;
+					resumeNumber = d->getTypeNumber();
 
-				// -----------------------
-				// -------- Fight --------
-				// -----------------------
-				bool dDied = false;
-                if (fPower2Energy > 0.0)
-                {
-					Fight( c, d, &contactEntry, &cDied, &dDied );
-                }
+					InteractPair( c, d, &cDied );
 
-				// -----------------------
-				// -------- Give ---------
-				// -----------------------
-				if( genome::gEnableGive )
-				{
-					if( !cDied && !dDied )
+					if( cDied )
+						break;
+
+					if( fNewDeaths != deaths )
 					{
-						Give( c, d, &contactEntry, &cDied, true );
-						if(!cDied)
-						{				
-							Give( d, c, &contactEntry, &dDied, false );
-						}
+						objectxsortedlist::gXSortedObjects.getNearby( AGENTTYPE,
+																	  c->x() - c->radius(), c->z() - c->radius(),
+																	  c->x() + c->radius(), c->z() + c->radius(),
+																	  fNearbyObjects );
+						sort( fNearbyObjects.begin(), fNearbyObjects.end(), objectxsortedlist::before );
+						resume = true;
+						j = -1;
 					}
 				}
-				
-				if( fRecordContacts )
-					contactEntry.log( fContactsLog );
-
-				if( cDied )
-					break;
+			}
+		}
+		else
+		{
+	        while( objectxsortedlist::gXSortedObjects.nextObj( AGENTTYPE, (gobject**) &d ) ) // to end of list or...
+	        {
+				if( d == c )	// sanity check; shouldn't happen
+				{
+					printf( "***************** d == c **************\n" );
+					continue;
+				}
+			
+	            if( (d->x() - d->radius()) >= (c->x() + c->radius()) )
+	                break;  // this guy (& everybody else in list) is too far away
+
+	            // so if we get here, then c & d are close enough in x to interact
+
+				// We used to test only on delta z at this point, thereby using manhattan distance to permit interaction
+				// now modified to use actual distances to tighten things up a little (particularly visible in "toy world"
+				// simulations).  Since we are basing interactions on circumscribing circles, agents may still interact
+				// without having an actual overlap of polygons, but using actual distances reduces the range over which
+				// this may happen and should reduce the number of such incidents.
+				if( sqrt( (d->x()-c->x())*(d->x()-c->x()) + (d->z()-c->z())*(d->z()-c->z()) ) <= (d->radius() + c->radius()) )
+	            {
+	                // and if we get here then they are also close enough in z,
+	                // so must actually worry about their interaction
+					InteractPair( c, d, &cDied );
+
+					if( cDied )
+						break;
 
-            }  // if close enough
-        }  // while (agent::gXSortedAgents.next(d))
+	            }  // if close enough
+	        }  // while (agent::gXSortedAgents.next(d))
+		}
 
+        fStepProfiler.stop( StepProfiler::Contact );
         debugcheck( "after all agent interactions" );
 
         if( cDied )
@@ -3477,7 +3740,9 @@ void TSimulation::Interact()
 		// -----------------------
 		// They finally get to eat (couldn't earlier to keep from conferring
 		// a special advantage on agents early in the sorted list)
+		fStepProfiler.start( StepProfiler::Eat );
 		Eat( c, &cDied );
+		fStepProfiler.stop( StepProfiler::Eat );
 
 		// It ate poison :-(
 		if( cDied )
@@ -3489,7 +3754,11 @@ void TSimulation::Interact()
 		// Have to do carry testing here instead of inside inner loop above,
 		// because agents can carry any kind of object, not just other agents
 		if( genome::gEnableCarry )
+		{
+			fStepProfiler.start( StepProfiler::Carry );
 			Carry( c );
+			fStepProfiler.stop( StepProfiler::Carry );
+		}
 
 		// -----------------------
 		// ------- Fitness -------
@@ -3503,6 +3772,59 @@ void TSimulation::Interact()
 }
 
 
+//---------------------------------------------------------------------------
+// TSimulation::InteractPair
+//
+// Mate, fight, and give, for two agents found to be in contact
+//---------------------------------------------------------------------------
+void TSimulation::InteractPair( agent *c, agent *d, bool *cDied )
+{
+	ttPrint( "age %ld: agents # %ld & %ld are close\n", fStep, c->Number(), d->Number() );
+
+	ContactEntry contactEntry( fStep, c, d );
+
+	fStepProfiler.count( StepProfiler::Contacts );
+
+	if( fRecordSeparations )
+	{
+		// Force a separation calculation so it gets logged.
+		fSeparationCache.separation( c, d );
+	}
+
+	// -----------------------
+	// ---- Mate (Normal) ----
+	// -----------------------
+	Mate( c, d, &contactEntry );
+
+	// -----------------------
+	// -------- Fight --------
+	// -----------------------
+	bool dDied = false;
+	if (fPower2Energy > 0.0)
+	{
+		Fight( c, d, &contactEntry, cDied, &dDied );
+	}
+
+	// -----------------------
+	// -------- Give ---------
+	// -----------------------
+	if( genome::gEnableGive )
+	{
+		if( !*cDied && !dDied )
+		{
+			Give( c, d, &contactEntry, cDied, true );
+			if( !*cDied )
+			{				
+				Give( d, c, &contactEntry, &dDied, false );
+			}
+		}
+	}
+	
+	if( fRecordContacts )
+		contactEntry.log( fContactsLog );
+}
+
+
 //---------------------------------------------------------------------------
 // TSimulation::DeathAndStats
 //---------------------------------------------------------------------------
@@ -3526,12 +3848,11 @@ void TSimulation::DeathAndStats( void )
 				agent* randAgent = NULL;
 	//				int randomIndex = int( floor( randpw() * fDomains[kd].numagents ) );	// pick from this domain
 				int randomIndex = int( floor( randpw() * numagents ) );
-				gdlink<gobject*> *saveCurr = objectxsortedlist::gXSortedObjects.getcurr();	// save the state of the x-sorted list
 
 				// As written, randAgent may not actually be the randomIndex-th agent in the domain, but it will be close,
 				// and as long as there's a single legitimate agent for killing, we will find and kill it
-				objectxsortedlist::gXSortedObjects.reset();
-				while( objectxsortedlist::gXSortedObjects.nextObj( AGENTTYPE, (gobject**) &testAgent ) )
+				objectxsortedlist::iterator it = objectxsortedlist::gXSortedObjects.range( AGENTTYPE );
+				while( it.next( &testAgent ) )
 				{
 					// no qualifications for this agent.  It doesn't even need to be old enough to smite.
 					randAgent = testAgent;	// as long as there's a single legitimate agent for killing, randAgent will be non-NULL
@@ -3541,8 +3862,6 @@ void TSimulation::DeathAndStats( void )
 					if( i > randomIndex )	// don't need to test for non-NULL randAgent, as it is always non-NULL by the time we reach here
 						break;
 				}
-
-				objectxsortedlist::gXSortedObjects.setcurr( saveCurr );	// restore the state of the x-sorted list  V???
 				
 				assert( randAgent != NULL );		// In we're in LOCKSTEP mode, we should *always* have a agent to kill.  If we don't kill a agent, then we are no longer in sync in the LOCKSTEP-BirthsDeaths.log
 				
@@ -3616,16 +3935,8 @@ void TSimulation::DeathAndStats( void )
 		{
 			// Count agents inside FoodPatches
 			// Also: Count agents outside FoodPatches, but within fFoodPatchOuterRange
-			for (int domainNumber = 0; domainNumber < fNumDomains; domainNumber++){
-				for( int foodPatchNumber = 0; foodPatchNumber < fDomains[domainNumber].numFoodPatches; foodPatchNumber++ )
-				{
-					// if agent is inside, then update FoodPatch's agentInsideCount
-					fDomains[domainNumber].fFoodPatches[foodPatchNumber].checkIfAgentIsInside(c->x(), c->z());  
-
-					// if agent is inside the outerrange, then update FoodPatch's agentOuterRangeCount
-					fDomains[domainNumber].fFoodPatches[foodPatchNumber].checkIfAgentIsInsideNeighborhood(c->x(), c->z());  
-				}
-			}
+			// (only the patches near the agent can count it, so the grid tells us which)
+			fPatchGrid.countAgent( c->x(), c->z() );
 		}	
 		
 		// Figure out who is least fit, if we're doing smiting to make room for births
@@ -3692,15 +4003,12 @@ void TSimulation::DeathAndStats( void )
 	// If we're saving gene stats, compute them here
 	if( fRecordGeneStats )
 	{
-		// Because we'll be performing the stats calculations/recording in parallel
-		// with the master task, which will kill and birth agents, we must create a
-		// snapshot of the agents alive right now.
-		int nagents = objectxsortedlist::gXSortedObjects.getCount(AGENTTYPE);
-		objectxsortedlist::gXSortedObjects.reset();
-		for( int i = 0; i < nagents; i++ )
-		{
-			objectxsortedlist::gXSortedObjects.nextObj( AGENTTYPE, (gobject**)fGeneStatsAgents + i );
-		}
+		// Because we'll be recording in parallel with the master task, which will
+		// kill and birth agents, we must snapshot the running sums as they are now.
+		int ngenes = GenomeUtil::schema->getMutableSize();
+		memcpy( fGeneSumSnapshot, fGeneSum, sizeof(*fGeneSum) * ngenes );
+		memcpy( fGeneSum2Snapshot, fGeneSum2, sizeof(*fGeneSum2) * ngenes );
+		long nagents = fGeneStatsCount;
 
 		// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
 		// ^^^ PARALLEL TASK RecordGeneStats
@@ -3708,33 +4016,27 @@ void TSimulation::DeathAndStats( void )
 		class RecordGeneStats : public ITask
 		{
 		public:
-			int nagents;
-			RecordGeneStats( int nagents )
+			long nagents;
+			RecordGeneStats( long nagents )
 			{
 				this->nagents = nagents;
 			}
 
 			virtual void task_exec( TSimulation *sim )
 			{
-				unsigned long *sum = sim->fGeneSum;
-				unsigned long *sum2 = sim->fGeneSum2;
+				unsigned long *sum = sim->fGeneSumSnapshot;
+				unsigned long *sum2 = sim->fGeneSum2Snapshot;
 				int ngenes = GenomeUtil::schema->getMutableSize(); 
 
-				memset( sum, 0, sizeof(*sum) * ngenes );
-				memset( sum2, 0, sizeof(*sum2) * ngenes );
-
-				for( int i = 0; i < nagents; i++ )
-				{
-					sim->fGeneStatsAgents[i]->Genes()->updateSum( sum, sum2 );
-				}
-
 				fprintf( sim->fGeneStatsFile, "%ld", sim->fStep );
 				for( int i = 0; i < ngenes; i++ )
 				{
+					// The sums are in storage order; report them in gene order
+					int offset = GenomeUtil::layout->getMutableDataOffset_nocheck( i );
 					float mean, stddev;
 			
-					mean = (float) sum[i] / (float) nagents;
-					stddev = sqrt( (float) sum2[i] / (float) nagents  -  mean * mean );
+					mean = (float) sum[offset] / (float) nagents;
+					stddev = sqrt( (float) sum2[offset] / (float) nagents  -  mean * mean );
 					fprintf( sim->fGeneStatsFile, " %.1f,%.1f", mean, stddev );
 				}
 				fprintf( sim->fGeneStatsFile, "\n" );
@@ -4040,7 +4342,9 @@ void TSimulation::Mate( agent *c,
 					agent* e = agent::getfreeagent(this, &fStage);
 					Q_CHECK_PTR(e);
 
-					e->Genes()->crossover(c->Genes(), d->Genes(), true);
+					bool genomePending = fParallelGenomes;
+					if( !genomePending )
+						e->Genes()->crossover(c->Genes(), d->Genes(), true);
 
 					Energy eenergy = c->mating( fMateFitnessParameter, fMateWait ) + d->mating( fMateFitnessParameter, fMateWait );
 
@@ -4075,24 +4379,34 @@ void TSimulation::Mate( agent *c,
 					birthPrint( "step %ld: agent # %ld born to %ld & %ld, at (%g,%g,%g), yaw=%g, energy=%g, domain %d (%d & %d)\n",
 								fStep, e->Number(), c->Number(), d->Number(), e->x(), e->y(), e->z(), e->yaw(), e->Energy(), kd, id, jd );
 
-					Birth( e, LifeSpan::BR_NATURAL, c, d );
+					Birth( e, LifeSpan::BR_NATURAL, c, d, genomePending );
 
 					// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
 					// ^^^ PARALLEL TASK GrowAgent
+					// ^^^
+					// ^^^ Parents aren't deleted until the serial tasks run,
+					// ^^^ so their genomes are safe to cross over here.
 					// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
 					class GrowAgent : public ITask
 					{
 					public:
 						agent *e;
 						Energy eenergy;
-						GrowAgent( agent *e, const Energy &eenergy )
+						genome::Genome *g1;
+						genome::Genome *g2;
+						GrowAgent( agent *e, const Energy &eenergy, genome::Genome *g1, genome::Genome *g2 )
 						{
 							this->e = e;
 							this->eenergy = eenergy;
+							this->g1 = g1;
+							this->g2 = g2;
 						}
 
 						virtual void task_exec( TSimulation *sim )
 						{
+							if( g1 )
+								e->Genes()->crossover( g1, g2, true );
+
 							e->grow( sim->fMateWait,
 									 sim->fRecordGenomes,
 									 sim->RecordBrainAnatomy( e->Number() ),
@@ -4107,7 +4421,10 @@ void TSimulation::Mate( agent *c,
 					// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 					// !!! POST PARALLEL
 					// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-					fScheduler.postParallel( new GrowAgent(e, eenergy) );
+					if( genomePending )
+						fScheduler.postParallel( new GrowAgent(e, eenergy, c->Genes(), d->Genes()) );
+					else
+						fScheduler.postParallel( new GrowAgent(e, eenergy, NULL, NULL) );
 
 					// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
 					// ^^^ SERIAL TASK AddAgent
@@ -4116,13 +4433,20 @@ void TSimulation::Mate( agent *c,
 					{
 					public:
 						agent *e;
-						AddAgent( agent *e )
+						bool genomePending;
+						AddAgent( agent *e, bool genomePending )
 						{
 							this->e = e;
+							this->genomePending = genomePending;
 						}
 
 						virtual void task_exec( TSimulation *sim )
 						{
+							if( genomePending && sim->fMonitorGeneSeparation )
+								sim->CalculateGeneSeparation( e );
+							if( genomePending && sim->fRecordGeneStats )
+								sim->UpdateGeneStats( e, true );
+
 							sim->fStage.AddObject(e);
 							gdlink<gobject*> *saveCurr = objectxsortedlist::gXSortedObjects.getcurr();
 							objectxsortedlist::gXSortedObjects.add(e); // Add the new agent directly to the list of objects (no new agent list); the e->listLink that gets auto stored here should be valid immediately
@@ -4135,7 +4459,7 @@ void TSimulation::Mate( agent *c,
 					// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 					// !!! POST SERIAL
 					// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-					fScheduler.postSerial( new AddAgent(e) );
+					fScheduler.postSerial( new AddAgent(e, genomePending) );
 				}
 			}	// steady-state GA vs. natural selection
 		}	// if agents are trying to mate
@@ -4190,13 +4514,11 @@ void TSimulation::Smite( short kd,
 			agent* randAgent = NULL;
 			int randomIndex = int( floor( randpw() * fDomains[kd].numAgents ) );	// pick from this domain
 
-			gdlink<gobject*> *saveCurr = objectxsortedlist::gXSortedObjects.getcurr();	// save the state of the x-sorted list
-
 			// As written, randAgent may not actually be the randomIndex-th agent in the domain, but it will be close,
 			// and as long as there's a single legitimate agent for smiting (right domain, old enough, and not one of the
 			// parents), we will find and smite it
-			objectxsortedlist::gXSortedObjects.reset();
-			while( (i <= randomIndex) && objectxsortedlist::gXSortedObjects.nextObj( AGENTTYPE, (gobject**) &testAgent ) )
+			objectxsortedlist::iterator it = objectxsortedlist::gXSortedObjects.range( AGENTTYPE );
+			while( (i <= randomIndex) && it.next( &testAgent ) )
 			{
 				// If it's from the right domain, it's old enough, and it's not one of the parents, allow it
 				if( testAgent->Domain() == kd )
@@ -4210,8 +4532,6 @@ void TSimulation::Smite( short kd,
 				if( (i > randomIndex) && (randAgent != NULL) )
 					break;
 			}
-														
-			objectxsortedlist::gXSortedObjects.setcurr( saveCurr );	// restore the state of the x-sorted list
 					
 			if( randAgent )	// if we found any legitimately smitable agent...
 			{
@@ -4461,112 +4781,102 @@ void TSimulation::Eat( agent *c, bool *cDied )
 		eatFailedMinAge = true;
 	}
 
-	// look for food in the -x direction
-	ateBackwardFood = false;
-#if CompatibilityMode
-	// go backwards in the list until we reach a place where even the largest possible piece of food
-	// would entirely precede our agent, and no smaller piece of food sorting after it, but failing
-	// to reach the agent can prematurely terminate the scan back (hence the factor of 2.0),
-	// so we can then search forward from there
-	while( objectxsortedlist::gXSortedObjects.prevObj( FOODTYPE, (gobject**) &f ) )
-		if( (f->x() + 2.0*food::gMaxFoodRadius) < (c->x() - c->radius()) )
-			break;
-#else // CompatibilityMode
-	while( objectxsortedlist::gXSortedObjects.prevObj( FOODTYPE, (gobject**) &f ) )
+	if( objectxsortedlist::gXSortedObjects.gridEnabled() )
 	{
-		if( (f->x() + f->radius()) < (c->x() - c->radius()) )
-		{
-			// end of food comes before beginning of agent, so there is no overlap
-			// if we've gone so far back that the largest possible piece of food could not overlap us,
-			// then we can stop searching for this agent's possible foods in the backward direction
-			if( (f->x() + 2.0*food::gMaxFoodRadius) < (c->x() - c->radius()) )
-				break;  // so get out of the backward food while loop
-		}
-		else
+		f = FindFoodToEat( c );
+		if( f )
 		{
-			// beginning of food comes before end of agent, so there is overlap in x
-			// time to check for overlap in z
-			if( fabs( f->z() - c->z() ) < ( f->radius() + c->radius() ) )
+			eatAttempted = true;
+			if( eatAllowed )
 			{
-				eatAttempted = true;
-				if( !eatAllowed )
-					break;
-				// also overlap in z, so they really interact
-				ttPrint( "step %ld: agent # %ld is eating\n", fStep, c->Number() );
-				Energy foodEnergyLost;
-				Energy energyEaten;
-				c->eat( f, fEatFitnessParameter, fEat2Consume, fEatThreshold, fStep, foodEnergyLost, energyEaten );
-				UpdateEnergyLog( c, f, c->Eat(), energyEaten, ELET__EAT );
-								 
-				FoodEnergyOut( foodEnergyLost );
-				
-				eatPrint( "at step %ld, agent %ld at (%g,%g) with rad=%g wasted %g units of food at (%g,%g) with rad=%g\n", fStep, c->Number(), c->x(), c->z(), c->radius(), foodEaten, f->x(), f->z(), f->radius() );
-
-				if(f->isDepleted() )  // all gone
-				{
-					RemoveFood( f );
-				}
-
-				// but this guy only gets to eat from one food source
-				ateBackwardFood = true;
-				break;  // so get out of the backward food while loop
+				objectxsortedlist::gXSortedObjects.setcurr( f->GetListLink() );	// RemoveFood() expects the list to be at f
+				EatFood( c, f );
 			}
 		}
-	}	// backward while loop on food
-#endif // CompatibilityMode
-
-	if( !ateBackwardFood && !eatAttempted )
+	}
+	else
 	{
-	#if ! CompatibilityMode
-		// set the list back to the agent mark, so we can look forward from that point
-		objectxsortedlist::gXSortedObjects.toMark( AGENTTYPE ); // point list back to c
-	#endif
-	
-		// look for food in the +x direction
-		while( objectxsortedlist::gXSortedObjects.nextObj( FOODTYPE, (gobject**) &f ) )
+		// look for food in the -x direction
+		ateBackwardFood = false;
+#if CompatibilityMode
+		// go backwards in the list until we reach a place where even the largest possible piece of food
+		// would entirely precede our agent, and no smaller piece of food sorting after it, but failing
+		// to reach the agent can prematurely terminate the scan back (hence the factor of 2.0),
+		// so we can then search forward from there
+		while( objectxsortedlist::gXSortedObjects.prevObj( FOODTYPE, (gobject**) &f ) )
+			if( (f->x() + 2.0*food::gMaxFoodRadius) < (c->x() - c->radius()) )
+				break;
+#else // CompatibilityMode
+		while( objectxsortedlist::gXSortedObjects.prevObj( FOODTYPE, (gobject**) &f ) )
 		{
-			if( (f->x() - f->radius()) > (c->x() + c->radius()) )
+			if( (f->x() + f->radius()) < (c->x() - c->radius()) )
 			{
-				// beginning of food comes after end of agent, so there is no overlap,
-				// and we can stop searching for this agent's possible foods in the forward direction
-				break;  // so get out of the forward food while loop
+				// end of food comes before beginning of agent, so there is no overlap
+				// if we've gone so far back that the largest possible piece of food could not overlap us,
+				// then we can stop searching for this agent's possible foods in the backward direction
+				if( (f->x() + 2.0*food::gMaxFoodRadius) < (c->x() - c->radius()) )
+					break;  // so get out of the backward food while loop
 			}
 			else
 			{
-	#if CompatibilityMode
-				if( ((f->x() + f->radius()) > (c->x() - c->radius()))  &&		// end of food comes after beginning of agent, and
-					(fabs( f->z() - c->z() ) < (f->radius() + c->radius())) )	// there is overlap in z
-	#else
 				// beginning of food comes before end of agent, so there is overlap in x
 				// time to check for overlap in z
-				if( fabs( f->z() - c->z() ) < (f->radius() + c->radius()) )
-	#endif
+				if( fabs( f->z() - c->z() ) < ( f->radius() + c->radius() ) )
 				{
 					eatAttempted = true;
 					if( !eatAllowed )
 						break;
 					// also overlap in z, so they really interact
-					ttPrint( "step %ld: agent # %ld is eating\n", fStep, c->Number() );
-					Energy foodEnergyLost;
-					Energy energyEaten;
-					c->eat( f, fEatFitnessParameter, fEat2Consume, fEatThreshold, fStep, foodEnergyLost, energyEaten );
-					UpdateEnergyLog( c, f, c->Eat(), energyEaten, ELET__EAT );
+					EatFood( c, f );
 
-					FoodEnergyOut( foodEnergyLost );
-					
-					eatPrint( "at step %ld, agent %ld at (%g,%g) with rad=%g wasted %g units of food at (%g,%g) with rad=%g\n", fStep, c->Number(), c->x(), c->z(), c->radius(), foodEaten, f->x(), f->z(), f->radius() );
+					// but this guy only gets to eat from one food source
+					ateBackwardFood = true;
+					break;  // so get out of the backward food while loop
+				}
+			}
+		}	// backward while loop on food
+#endif // CompatibilityMode
 
-					if( f->isDepleted() )  // all gone
+		if( !ateBackwardFood && !eatAttempted )
+		{
+		#if ! CompatibilityMode
+			// set the list back to the agent mark, so we can look forward from that point
+			objectxsortedlist::gXSortedObjects.toMark( AGENTTYPE ); // point list back to c
+		#endif
+	
+			// look for food in the +x direction
+			while( objectxsortedlist::gXSortedObjects.nextObj( FOODTYPE, (gobject**) &f ) )
+			{
+				if( (f->x() - f->radius()) > (c->x() + c->radius()) )
+				{
+					// beginning of food comes after end of agent, so there is no overlap,
+					// and we can stop searching for this agent's possible foods in the forward direction
+					break;  // so get out of the forward food while loop
+				}
+				else
+				{
+		#if CompatibilityMode
+					if( ((f->x() + f->radius()) > (c->x() - c->radius()))  &&		// end of food comes after beginning of agent, and
+						(fabs( f->z() - c->z() ) < (f->radius() + c->radius())) )	// there is overlap in z
+		#else
+					// beginning of food comes before end of agent, so there is overlap in x
+					// time to check for overlap in z
+					if( fabs( f->z() - c->z() ) < (f->radius() + c->radius()) )
+		#endif
 					{
-						RemoveFood( f );
-					}
+						eatAttempted = true;
+						if( !eatAllowed )
+							break;
+						// also overlap in z, so they really interact
+						EatFood( c, f );
 
-					// but this guy only gets to eat from one food source
-					break;  // so get out of the forward food while loop
+						// but this guy only gets to eat from one food source
+						break;  // so get out of the forward food while loop
+					}
 				}
-			}
-		} // forward while loop on food
-	} // if( !ateBackwardFood )
+			} // forward while loop on food
+		} // if( !ateBackwardFood )
+	}
 
 	if( eatAttempted )
 	{
@@ -4588,6 +4898,77 @@ void TSimulation::Eat( agent *c, bool *cDied )
 	debugcheck( "after all agents had a chance to eat" );
 }
 
+//---------------------------------------------------------------------------
+// TSimulation::EatFood
+//---------------------------------------------------------------------------
+void TSimulation::EatFood( agent *c, food *f )
+{
+	ttPrint( "step %ld: agent # %ld is eating\n", fStep, c->Number() );
+	Energy foodEnergyLost;
+	Energy energyEaten;
+	c->eat( f, fEatFitnessParameter, fEat2Consume, fEatThreshold, fStep, foodEnergyLost, energyEaten );
+	UpdateEnergyLog( c, f, c->Eat(), energyEaten, ELET__EAT );
+					 
+	FoodEnergyOut( foodEnergyLost );
+	
+	eatPrint( "at step %ld, agent %ld at (%g,%g) with rad=%g wasted %g units of food at (%g,%g) with rad=%g\n", fStep, c->Number(), c->x(), c->z(), c->radius(), foodEaten, f->x(), f->z(), f->radius() );
+
+	if( f->isDepleted() )  // all gone
+	{
+		RemoveFood( f );
+	}
+}
+
+//---------------------------------------------------------------------------
+// TSimulation::FindFoodToEat
+//
+// Using the grid, find the piece of food overlapping c that the list walks
+// in Eat() would have found, or NULL if there is none.
+//---------------------------------------------------------------------------
+food *TSimulation::FindFoodToEat( agent *c )
+{
+	objectxsortedlist::gXSortedObjects.getNearby( FOODTYPE,
+												  c->x() - c->radius(), c->z() - c->radius(),
+												  c->x() + c->radius(), c->z() + c->radius(),
+												  fNearbyObjects );
+
+	food *result = NULL;
+#if ! CompatibilityMode
+	bool resultPrecedes = false;
+#endif
+
+	for( size_t i = 0; i < fNearbyObjects.size(); i++ )
+	{
+		food *f = (food*) fNearbyObjects[i];
+
+		if( fabs( f->z() - c->z() ) >= (f->radius() + c->radius()) )
+			continue;	// no overlap in z
+
+#if CompatibilityMode
+		// the first overlapping food in the list
+		if( (f->x() + f->radius()) <= (c->x() - c->radius()) )
+			continue;
+
+		if( !result || objectxsortedlist::before( f, result ) )
+			result = f;
+#else
+		// the last overlapping food preceding c in the list, else the first one following it
+		bool precedes = objectxsortedlist::before( f, c );
+
+		if( !result
+			|| (precedes && !resultPrecedes)
+			|| (precedes && objectxsortedlist::before( result, f ))
+			|| (!precedes && !resultPrecedes && objectxsortedlist::before( f, result )) )
+		{
+			result = f;
+			resultPrecedes = precedes;
+		}
+#endif
+	}
+
+	return result;
+}
+
 //---------------------------------------------------------------------------
 // TSimulation::Carry
 //---------------------------------------------------------------------------
@@ -4623,71 +5004,102 @@ void TSimulation::Pickup( agent* c )
 {
 	gobject* o;
 	
-	// set the list back to the agent mark, so we can look backward from that point
-	objectxsortedlist::gXSortedObjects.toMark( AGENTTYPE ); // point list back to c
-
-	// look in the -x direction for something to carry
-	while( objectxsortedlist::gXSortedObjects.prevObj( fCarryObjects, (gobject**) &o ) )
+	if( objectxsortedlist::gXSortedObjects.gridEnabled() )
 	{
-		if( o->BeingCarried() || (o->NumCarries() > 0) )
-			continue;	// already carrying or being carried, so nothing we can do with it
+		objectxsortedlist::gXSortedObjects.getNearby( fCarryObjects,
+													  c->x() - c->radius(), c->z() - c->radius(),
+													  c->x() + c->radius(), c->z() + c->radius(),
+													  fNearbyObjects );
+		sort( fNearbyObjects.begin(), fNearbyObjects.end(), objectxsortedlist::before );
 
-		if( ( o->x() + o->radius() ) < ( c->x() - c->radius() ) )
+		// visit the objects in the same order as the list walks below: back from c, then forward
+		long n = fNearbyObjects.size();
+		long nprev = lower_bound( fNearbyObjects.begin(), fNearbyObjects.end(), (gobject*) c, objectxsortedlist::before ) - fNearbyObjects.begin();
+
+		for( long i = 0; (i < n) && (c->NumCarries() < agent::gMaxCarries); i++ )
 		{
-			// end of object comes before beginning of agent, so there is no overlap
-			// if we've gone so far back that the largest possible object could not overlap us,
-			// then we can stop searching for this agent's possible pickups in the backward direction
-			if( ( o->x() + 2.0 * max( max( food::gMaxFoodRadius, agent::gMaxRadius ), brick::gBrickRadius ) ) < ( c->x() - c->radius() ) )
-				break;  // so get out of the backward object while loop
-		}
-		else
-		{
-			// beginning of object comes before end of agent, so there is overlap in x
-			// time to check for overlap in z
-			if( fabs( o->z() - c->z() ) < ( o->radius() + c->radius() ) )
+			o = i < nprev ? fNearbyObjects[nprev - 1 - i] : fNearbyObjects[i];
+
+			if( (o == c) || o->BeingCarried() || (o->NumCarries() > 0) )
+				continue;	// already carrying or being carried, so nothing we can do with it
+
+			// getNearby() guarantees overlap in x, so check for overlap in z
+			if( fabs( o->z() - c->z() ) < (o->radius() + c->radius()) )
 			{
-				// also overlap in z, so they really interact
-				ttPrint( "step %ld: agent # %ld is picking up object of type %lu\n", fStep, c->Number(), o->getType() );
-				
-				c->PickupObject( o );
+				ttPrint( "step %ld: agent # %ld is picking up object of type %d\n", fStep, c->Number(), o->getType() );
 
-				if( c->NumCarries() >= agent::gMaxCarries )	// carrying as much as we can,
-					break;								// so get out of the backward while loop
+				c->PickupObject( o );
 			}
 		}
 	}
-
-	// can we pick up anything else?
-	if( c->NumCarries() < agent::gMaxCarries )
+	else
 	{
-		// set the list back to the agent mark, so we can look forward from that point
+		// set the list back to the agent mark, so we can look backward from that point
 		objectxsortedlist::gXSortedObjects.toMark( AGENTTYPE ); // point list back to c
-	
-		// look in the +x direction for something to pick up
-		while( objectxsortedlist::gXSortedObjects.nextObj( fCarryObjects, (gobject**) &o ) )
+
+		// look in the -x direction for something to carry
+		while( objectxsortedlist::gXSortedObjects.prevObj( fCarryObjects, (gobject**) &o ) )
 		{
 			if( o->BeingCarried() || (o->NumCarries() > 0) )
 				continue;	// already carrying or being carried, so nothing we can do with it
-		
-			if( (o->x() - o->radius()) > (c->x() + c->radius()) )
+
+			if( ( o->x() + o->radius() ) < ( c->x() - c->radius() ) )
 			{
-				// beginning of object comes after end of agent, so there is no overlap,
-				// and we can stop searching for this agent's possible pickups in the forward direction
-				break;  // so get out of the forward object while loop
+				// end of object comes before beginning of agent, so there is no overlap
+				// if we've gone so far back that the largest possible object could not overlap us,
+				// then we can stop searching for this agent's possible pickups in the backward direction
+				if( ( o->x() + 2.0 * max( max( food::gMaxFoodRadius, agent::gMaxRadius ), brick::gBrickRadius ) ) < ( c->x() - c->radius() ) )
+					break;  // so get out of the backward object while loop
 			}
 			else
 			{
 				// beginning of object comes before end of agent, so there is overlap in x
 				// time to check for overlap in z
-				if( fabs( o->z() - c->z() ) < (o->radius() + c->radius()) )
+				if( fabs( o->z() - c->z() ) < ( o->radius() + c->radius() ) )
 				{
 					// also overlap in z, so they really interact
-					ttPrint( "step %ld: agent # %ld is picking up object of type %d\n", fStep, c->Number(), o->getType() );
-					
+					ttPrint( "step %ld: agent # %ld is picking up object of type %lu\n", fStep, c->Number(), o->getType() );
+				
 					c->PickupObject( o );
-					
+
 					if( c->NumCarries() >= agent::gMaxCarries )	// carrying as much as we can,
-						break;								// so get out of the forward while loop
+						break;								// so get out of the backward while loop
+				}
+			}
+		}
+
+		// can we pick up anything else?
+		if( c->NumCarries() < agent::gMaxCarries )
+		{
+			// set the list back to the agent mark, so we can look forward from that point
+			objectxsortedlist::gXSortedObjects.toMark( AGENTTYPE ); // point list back to c
+	
+			// look in the +x direction for something to pick up
+			while( objectxsortedlist::gXSortedObjects.nextObj( fCarryObjects, (gobject**) &o ) )
+			{
+				if( o->BeingCarried() || (o->NumCarries() > 0) )
+					continue;	// already carrying or being carried, so nothing we can do with it
+		
+				if( (o->x() - o->radius()) > (c->x() + c->radius()) )
+				{
+					// beginning of object comes after end of agent, so there is no overlap,
+					// and we can stop searching for this agent's possible pickups in the forward direction
+					break;  // so get out of the forward object while loop
+				}
+				else
+				{
+					// beginning of object comes before end of agent, so there is overlap in x
+					// time to check for overlap in z
+					if( fabs( o->z() - c->z() ) < (o->radius() + c->radius()) )
+					{
+						// also overlap in z, so they really interact
+						ttPrint( "step %ld: agent # %ld is picking up object of type %d\n", fStep, c->Number(), o->getType() );
+					
+						c->PickupObject( o );
+					
+						if( c->NumCarries() >= agent::gMaxCarries )	// carrying as much as we can,
+							break;								// so get out of the forward while loop
+					}
 				}
 			}
 		}
@@ -4817,6 +5229,11 @@ void TSimulation::CreateAgents( void )
                 agent* newAgent = agent::getfreeagent(this, &fStage);
                 Q_CHECK_PTR(newAgent);
 
+				// crossover parents, or a random genome; built below
+				genome::Genome *crossover1 = NULL;
+				genome::Genome *crossover2 = NULL;
+				bool randomize = false;
+
                 if ( fNumberFit && (fDomains[id].numdied >= fNumberFit) )
                 {
                     // the list exists and is full
@@ -4835,15 +5252,13 @@ void TSimulation::CreateAgents( void )
 					#if TournamentSelection
 						int parent1, parent2;
 						PickParentsUsingTournament(fNumberFit, &parent1, &parent2);
-						newAgent->Genes()->crossover(fDomains[id].fittest[parent1]->genes,
-													   fDomains[id].fittest[parent2]->genes,
-													   true);
+						crossover1 = fDomains[id].fittest[parent1]->genes;
+						crossover2 = fDomains[id].fittest[parent2]->genes;
 						fNumberCreated2Fit++;
 						gaPrint( "%5ld: domain %d creation from two (%d, %d) fittest (%4lu, %4lu) %4ld\n", fStep, id, parent1, parent2, fDomains[id].fittest[parent1]->agentID, fDomains[id].fittest[parent2]->agentID, fNumberCreated2Fit );
 					#else
-                        newAgent->Genes()->crossover(fDomains[id].fittest[fDomains[id].ifit]->genes,
-                            				  		   fDomains[id].fittest[fDomains[id].jfit]->genes,
-                            				  		   true);
+                        crossover1 = fDomains[id].fittest[fDomains[id].ifit]->genes;
+                        crossover2 = fDomains[id].fittest[fDomains[id].jfit]->genes;
                         fNumberCreated2Fit++;
 						gaPrint( "%5ld: domain %d creation from two (%d, %d) fittest (%4lu, %4lu) %4ld\n", fStep, id, fDomains[id].ifit, fDomains[id].jfit, fDomains[id].fittest[fDomains[id].ifit]->agentID, fDomains[id].fittest[fDomains[id].jfit]->agentID, fNumberCreated2Fit );
                         ijfitinc(&(fDomains[id].ifit), &(fDomains[id].jfit));
@@ -4852,7 +5267,7 @@ void TSimulation::CreateAgents( void )
                     else
                     {
                         // otherwise, just generate a random, hopeful monster
-                        newAgent->Genes()->randomize();
+                        randomize = true;
                         fNumberCreatedRandom++;
 						gaPrint( "%5ld: domain %d creation random (%4ld)\n", fStep, id, fNumberCreatedRandom );
                     }
@@ -4860,11 +5275,22 @@ void TSimulation::CreateAgents( void )
                 else
                 {
                     // otherwise, just generate a random, hopeful monster
-                    newAgent->Genes()->randomize();
+                    randomize = true;
                     fNumberCreatedRandom++;
 					gaPrint( "%5ld: domain %d creation random early (%4ld)\n", fStep, id, fNumberCreatedRandom );
                 }
 
+				// The fittest lists are only updated by serial tasks, so the
+				// parents are still intact when GrowAgent runs.
+				bool genomePending = fParallelGenomes && (crossover1 || randomize);
+				if( !genomePending )
+				{
+					if( crossover1 )
+						newAgent->Genes()->crossover( crossover1, crossover2, true );
+					else if( randomize )
+						newAgent->Genes()->randomize();
+				}
+
 				// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
 				// ^^^ PARALLEL TASK GrowAgent
 				// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
@@ -4872,13 +5298,24 @@ void TSimulation::CreateAgents( void )
 				{
 				public:
 					agent *a;
-					GrowAgent( agent *a )
+					genome::Genome *g1;
+					genome::Genome *g2;
+					bool randomize;
+					GrowAgent( agent *a, genome::Genome *g1, genome::Genome *g2, bool randomize )
 					{
 						this->a = a;
+						this->g1 = g1;
+						this->g2 = g2;
+						this->randomize = randomize;
 					}
 
 					virtual void task_exec( TSimulation *sim )
 					{
+						if( g1 )
+							a->Genes()->crossover( g1, g2, true );
+						else if( randomize )
+							a->Genes()->randomize();
+
 						a->grow( sim->fMateWait,
 								 sim->fRecordGenomes,
 								 sim->RecordBrainAnatomy( a->Number() ),
@@ -4894,13 +5331,20 @@ void TSimulation::CreateAgents( void )
 				{
 				public:
 					agent *a;
-					UpdateStats( agent *a )
+					bool genomePending;
+					UpdateStats( agent *a, bool genomePending )
 					{
 						this->a = a;
+						this->genomePending = genomePending;
 					}
 
 					virtual void task_exec( TSimulation *sim )
 					{
+						if( genomePending && sim->fMonitorGeneSeparation )
+							sim->CalculateGeneSeparation( a );
+						if( genomePending && sim->fRecordGeneStats )
+							sim->UpdateGeneStats( a, true );
+
 						sim->fNeuronGroupCountStats.add( a->GetBrain()->NumNeuronGroups() );
 
 						sim->FoodEnergyIn( a->GetFoodEnergy() );
@@ -4910,7 +5354,10 @@ void TSimulation::CreateAgents( void )
 				// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 				// !!! POST PARALLEL
 				// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-				fScheduler.postParallel( new GrowAgent(newAgent) );
+				if( genomePending )
+					fScheduler.postParallel( new GrowAgent(newAgent, crossover1, crossover2, randomize) );
+				else
+					fScheduler.postParallel( new GrowAgent(newAgent, NULL, NULL, false) );
 
 				float x = randpw() * (fDomains[id].absoluteSizeX - 0.02) + fDomains[id].startX + 0.01;
 				float z = randpw() * (fDomains[id].absoluteSizeZ - 0.02) + fDomains[id].startZ + 0.01;
@@ -4933,9 +5380,9 @@ void TSimulation::CreateAgents( void )
 				// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 				// !!! POST SERIAL 
 				// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-				fScheduler.postSerial( new UpdateStats(newAgent) );
+				fScheduler.postSerial( new UpdateStats(newAgent, genomePending) );
 				
-				Birth( newAgent, LifeSpan::BR_CREATE );
+				Birth( newAgent, LifeSpan::BR_CREATE, NULL, NULL, genomePending );
             }
         }
 
@@ -5255,107 +5702,156 @@ void TSimulation::RecordGeneSeparation()
 
 //---------------------------------------------------------------------------
 // TSimulation::CalculateGeneSeparation
+//
+// Adds ci's row to the separation matrix, comparing it only against the
+// agents already in the matrix, so a birth costs O(N) rather than O(N^2).
 //---------------------------------------------------------------------------
 void TSimulation::CalculateGeneSeparation(agent* ci)
 {
-	// TODO add assert to validate statement below
-	
-	// NOTE: This version assumes ci is *not* currently in gSortedAgents.
-    // It also marks the current position in the list on entry and returns
-    // there before exit so it can be invoked during the insertion of the
-    // newagents list into the existing gSortedAgents list.
-	
-    //objectxsortedlist::gXSortedObjects.mark();
-    objectxsortedlist::gXSortedObjects.setMark( AGENTTYPE );
-	
-    agent* cj = NULL;
-    float genesep;
-    float genesepsum = 0.0;
-    long numgsvalsold = fNumGeneSepVals;
+	long index = ci->Index();
+	long dim = fGeneSepAgents.size();
 
-	objectxsortedlist::gXSortedObjects.reset();
-	while (objectxsortedlist::gXSortedObjects.nextObj(AGENTTYPE, (gobject**)&cj))
-    {
-		genesep = ci->Genes()->separation(cj->Genes());
-        fMaxGeneSeparation = fmax(genesep, fMaxGeneSeparation);
-        fMinGeneSeparation = fmin(genesep, fMinGeneSeparation);
-        genesepsum += genesep;
-        fGeneSepVals[fNumGeneSepVals++] = genesep;
-    }
+	assert( index >= 0 );
 
-    long n = objectxsortedlist::gXSortedObjects.getCount(AGENTTYPE);
-    if (numgsvalsold != (n * (n - 1) / 2))
-    {
-		char tempstring[256];
-        sprintf(tempstring,"%s %s %ld %s %ld %s %ld",
-				"genesepcalc: numgsvalsold not equal to n * (n - 1) / 2.\n",
-				"  numgsvals, n, n * (n - 1) / 2 = ",
-				numgsvalsold,", ",n,", ", n * (n - 1) / 2);
-		error(2, tempstring);
-    }
+	if( index >= dim )
+	{
+		long newdim = max( index + 1, dim * 2 );
+		vector<float> matrix( newdim * newdim, 0.0 );
 
-    if (fNumGeneSepVals != (n * (n + 1) / 2))
-    {
-		char tempstring[256];
-        sprintf(tempstring,"%s %s %ld %s %ld %s %ld",
-			 	"genesepcalc: numgsvals not equal to n * (n + 1) / 2.\n",
-				"  numgsvals, n, n * (n + 1) / 2 = ",
-				fNumGeneSepVals,", ",n,", ",n*(n+1)/2);
-        error(2,tempstring);
-    }
+		for( long i = 0; i < dim; i++ )
+			for( long j = 0; j < dim; j++ )
+				matrix[i * newdim + j] = fGeneSepMatrix[i * dim + j];
 
-    fAverageGeneSeparation = (genesepsum + fAverageGeneSeparation * numgsvalsold) / fNumGeneSepVals;
-	
-    //objectxsortedlist::gXSortedObjects.tomark();
-    objectxsortedlist::gXSortedObjects.toMark(AGENTTYPE);
+		fGeneSepMatrix.swap( matrix );
+		fGeneSepAgents.resize( newdim, NULL );
+		dim = newdim;
+	}
+
+	assert( fGeneSepAgents[index] == NULL );
+
+	for( long j = 0; j < dim; j++ )
+	{
+		agent* cj = fGeneSepAgents[j];
+		if( cj == NULL )
+			continue;
+
+		float genesep = ci->Genes()->separation(cj->Genes());
+
+		fGeneSepMatrix[index * dim + j] = genesep;
+		fGeneSepMatrix[j * dim + index] = genesep;
+		fGeneSepSorted.insert( genesep );
+		fGeneSepSum += genesep;
+	}
+
+	fGeneSepAgents[index] = ci;
+
+	UpdateGeneSeparationStats();
+}
+
+
+//---------------------------------------------------------------------------
+// TSimulation::RemoveGeneSeparation
+//
+// Drops ci's row from the separation matrix.
+//---------------------------------------------------------------------------
+void TSimulation::RemoveGeneSeparation(agent* ci)
+{
+	long index = ci->Index();
+	long dim = fGeneSepAgents.size();
+
+	if( (index >= dim) || (fGeneSepAgents[index] != ci) )
+		return;	// not monitored
+
+	fGeneSepAgents[index] = NULL;
+
+	for( long j = 0; j < dim; j++ )
+	{
+		if( fGeneSepAgents[j] == NULL )
+			continue;
+
+		float genesep = fGeneSepMatrix[index * dim + j];
+
+		fGeneSepSorted.erase( fGeneSepSorted.find(genesep) );
+		fGeneSepSum -= genesep;
+	}
+
+	UpdateGeneSeparationStats();
+}
+
+
+//---------------------------------------------------------------------------
+// TSimulation::UpdateGeneStats
+//
+// Adds a's genome to the running gene sums if born, or takes it away if not.
+//---------------------------------------------------------------------------
+void TSimulation::UpdateGeneStats(agent* a, bool born)
+{
+	a->Genes()->updateRawSum( fGeneSum, fGeneSum2, !born );
+	fGeneStatsCount += born ? 1 : -1;
+}
+
+
+//---------------------------------------------------------------------------
+// TSimulation::UpdateGeneSeparationStats
+//---------------------------------------------------------------------------
+void TSimulation::UpdateGeneSeparationStats()
+{
+	long n = fGeneSepSorted.size();
+
+	if( n == 0 )
+	{
+		fMinGeneSeparation = 1.e+10;
+		fMaxGeneSeparation = 0.0;
+		fAverageGeneSeparation = 0.0;
+		fGeneSepSum = 0.0;	// don't let roundoff accumulate across extinctions
+	}
+	else
+	{
+		fMinGeneSeparation = *fGeneSepSorted.begin();
+		fMaxGeneSeparation = *fGeneSepSorted.rbegin();
+		fAverageGeneSeparation = fGeneSepSum / n;
+	}
 }
 
 
+//---------------------------------------------------------------------------
+// TSimulation::UpdateGeneSeparationVals
+//
+// Copies the pair separations into fGeneSepVals for the chart window.
+//---------------------------------------------------------------------------
+void TSimulation::UpdateGeneSeparationVals()
+{
+	fNumGeneSepVals = fGeneSepSorted.size();
+
+	if( fNumGeneSepVals > fMaxNumGeneSepVals )
+	{
+		delete [] fGeneSepVals;
+		fMaxNumGeneSepVals = fNumGeneSepVals;
+		fGeneSepVals = new float[fMaxNumGeneSepVals];
+	}
+
+	copy( fGeneSepSorted.begin(), fGeneSepSorted.end(), fGeneSepVals );
+}
+
 
 //---------------------------------------------------------------------------
 // TSimulation::CalculateGeneSeparationAll
+//
+// Rebuilds the separation matrix from scratch.
 //---------------------------------------------------------------------------
 void TSimulation::CalculateGeneSeparationAll()
 {
     agent* ci = NULL;
-    agent* cj = NULL;
 
-    float genesep;
-    float genesepsum = 0.0;
-    fMinGeneSeparation = 1.e+10;
-    fMaxGeneSeparation = 0.0;
-    fNumGeneSepVals = 0;
+	fGeneSepAgents.assign( fGeneSepAgents.size(), NULL );
+	fGeneSepSorted.clear();
+	fGeneSepSum = 0.0;
 
     objectxsortedlist::gXSortedObjects.reset();
     while (objectxsortedlist::gXSortedObjects.nextObj(AGENTTYPE, (gobject**)&ci))
-    {
-		objectxsortedlist::gXSortedObjects.setMark(AGENTTYPE);
-
-		while (objectxsortedlist::gXSortedObjects.nextObj(AGENTTYPE, (gobject**)&cj))
-		{	
-            genesep = ci->Genes()->separation(cj->Genes());
-            fMaxGeneSeparation = max(genesep, fMaxGeneSeparation);
-            fMinGeneSeparation = min(genesep, fMinGeneSeparation);
-            genesepsum += genesep;
-            fGeneSepVals[fNumGeneSepVals++] = genesep;
-        }
-		//objectxsortedlist::gXSortedObjects.tomark();
-		objectxsortedlist::gXSortedObjects.toMark(AGENTTYPE);
-    }
+		CalculateGeneSeparation(ci);
 
-    // n * (n - 1) / 2 is how many calculations were made
-	long n = objectxsortedlist::gXSortedObjects.getCount(AGENTTYPE);
-    if (fNumGeneSepVals != (n * (n - 1) / 2))
-    {
-		char tempstring[256];
-        sprintf(tempstring, "%s %s %ld %s %ld %s %ld",
-            "genesepcalcall: numgsvals not equal to n * (n - 1) / 2.\n",
-            "  numgsvals, n, n * (n - 1) / 2 = ",
-            fNumGeneSepVals,", ",n,", ",n * (n - 1) / 2);
-        error(2, tempstring);
-    }
-
-    fAverageGeneSeparation = genesepsum / fNumGeneSepVals;
+	UpdateGeneSeparationStats();
 }
 
 
@@ -5386,10 +5882,16 @@ void TSimulation::ijfitinc(short* i, short* j)
 //---------------------------------------------------------------------------
 // TSimulation::Birth
 //---------------------------------------------------------------------------
+//
+// If genomePending, a's genome is still to be built by a parallel task, and
+// it's up to the caller to update the gene separation and gene stats once it
+// has been.
+//---------------------------------------------------------------------------
 void TSimulation::Birth( agent* a,
 						 LifeSpan::BirthReason reason,
 						 agent* a_parent1,
-						 agent* a_parent2 )
+						 agent* a_parent2,
+						 bool genomePending )
 {
 	fNumberAlive++;
 	fNumberAliveWithMetabolism[ GenomeUtil::getMetabolism(a->Genes())->index ]++;
@@ -5406,6 +5908,18 @@ void TSimulation::Birth( agent* a,
 	// ---
 	fSeparationCache.birth( a );
 
+	// ---
+	// --- Update Gene Separation
+	// ---
+	if( fMonitorGeneSeparation && !genomePending )
+		CalculateGeneSeparation( a );
+
+	// ---
+	// --- Update Gene Stats
+	// ---
+	if( fRecordGeneStats && !genomePending )
+		UpdateGeneStats( a, true );
+
 	// ---
 	// --- Update Birth/Death Log
 	// ---
@@ -5467,6 +5981,18 @@ void TSimulation::Kill( agent* c,
 	// ---
 	fSeparationCache.death( c );
 
+	// ---
+	// --- Update Gene Separation
+	// ---
+	if( fMonitorGeneSeparation )
+		RemoveGeneSeparation( c );
+
+	// ---
+	// --- Update Gene Stats
+	// ---
+	if( fRecordGeneStats )
+		UpdateGeneStats( c, false );
+
 	if( reason == LifeSpan::DR_SIMEND )
 	{
 		c->Die();
@@ -5512,7 +6038,7 @@ void TSimulation::Kill( agent* c,
     if ( rFood
     	&& ((long)objectxsortedlist::gXSortedObjects.getCount(FOODTYPE) < fMaxFoodCount)
 		&& (fDomains[id].foodCount < fDomains[id].maxFoodCount)	// ??? Matt had commented this out; why?
-		&& ((fp = fDomains[id].whichFoodPatch( c->x(), c->z() )) && (fp->foodCount < fp->maxFoodCount))	// ??? Matt had nothing like this here; why?
+		&& ((fp = fPatchGrid.whichFoodPatch( id, c->x(), c->z() )) && (fp->foodCount < fp->maxFoodCount))	// ??? Matt had nothing like this here; why?
     	&& (globals::edges || ((c->x() >= 0.0) && (c->x() <=  globals::worldsize) &&
     	                       (c->z() <= 0.0) && (c->z() >= -globals::worldsize))) )
     {
@@ -5545,9 +6071,7 @@ void TSimulation::Kill( agent* c,
 			{
 				food* f = new food( carcassFoodType, fStep, foodEnergy, c->x(), c->z() );
 				Q_CHECK_PTR( f );
-				gdlink<gobject*> *saveCurr = objectxsortedlist::gXSortedObjects.getcurr();
-				objectxsortedlist::gXSortedObjects.add( f );	// dead agent becomes food
-				objectxsortedlist::gXSortedObjects.setcurr( saveCurr );
+				objectxsortedlist::gXSortedObjects.addNear( f, c );	// dead agent becomes food
 				fStage.AddObject( f );			// put replacement food into the world
 				if( fp )
 				{
@@ -5709,21 +6233,22 @@ void TSimulation::Kill_UpdateBrainData( agent *c )
 		sprintf( s, "run/brain/function/incomplete_brainFunction_%ld.txt", c->Number() );
 		sprintf( t, "run/brain/function/brainFunction_%ld.txt", c->Number() );
 		rename( s, t );
+	}
 
-		// Virgil
-		if ( fComplexityFitnessWeight > 0 )		// Are we using Complexity as a Fitness Function?  If so, set fitness = Complexity here
+	// Virgil
+	if ( fComplexityFitnessWeight > 0 )		// Are we using Complexity as a Fitness Function?  If so, set fitness = Complexity here
+	{
+		if( fComplexityType == "D" )	// special case the difference of complexities case
 		{
-			if( fComplexityType == "D" )	// special case the difference of complexities case
-			{
-				float pComplexity = CalcComplexity_brainfunction( t, "P", 0 );
-				float iComplexity = CalcComplexity_brainfunction( t, "I", 0 );
-				c->SetComplexity( pComplexity - iComplexity );
-			}
-			else if( fComplexityType != "Z" )	// avoid special hack case to evolve towards zero max velocity, for testing purposes only
-			{
-				// otherwise, fComplexityType has the right string in it
-				c->SetComplexity( CalcComplexity_brainfunction( t, fComplexityType.c_str(), 0 ) );
-			}
+			const char *parts[] = { "P", "I" };
+			double complexity[2];
+			CalcAgentComplexity( c, parts, 2, complexity );
+			c->SetComplexity( complexity[0] - complexity[1] );
+		}
+		else if( fComplexityType != "Z" )	// avoid special hack case to evolve towards zero max velocity, for testing purposes only
+		{
+			// otherwise, fComplexityType has the right string in it
+			c->SetComplexity( CalcAgentComplexity( c, fComplexityType.c_str() ) );
 		}
 	}
 
@@ -6122,6 +6647,42 @@ void TSimulation::FoodEnergyOut( const Energy &e ) {
 	fFoodEnergyOut += e[0];
 }
 
+//-------------------------------------------------------------------------------------------
+// TSimulation::CalcAgentComplexity
+//
+// Complexity of a dead agent's brain activity, either from the activity history kept in
+// memory by its Brain or from its brainFunction file.
+//-------------------------------------------------------------------------------------------
+float TSimulation::CalcAgentComplexity( agent* c, const char *parts )
+{
+	if( fComplexityFromMemory )
+		return c->GetBrain()->calcComplexity( parts );
+
+	char filename[256];
+	sprintf( filename, "run/brain/function/brainFunction_%ld.txt", c->Number() );
+
+	return CalcComplexity_brainfunction( filename, parts, 0 );
+}
+
+//-------------------------------------------------------------------------------------------
+// TSimulation::CalcAgentComplexity
+//
+// Several complexity types at once, from a single read of the activity.
+//-------------------------------------------------------------------------------------------
+void TSimulation::CalcAgentComplexity( agent* c, const char **parts, int nparts, double *complexity )
+{
+	if( fComplexityFromMemory )
+	{
+		c->GetBrain()->calcComplexity( parts, nparts, complexity );
+		return;
+	}
+
+	char filename[256];
+	sprintf( filename, "run/brain/function/brainFunction_%ld.txt", c->Number() );
+
+	CalcComplexity_brainfunction( filename, parts, nparts, 0, complexity );
+}
+
 //-------------------------------------------------------------------------------------------
 // TSimulation::AgentFitness
 //-------------------------------------------------------------------------------------------
@@ -6147,16 +6708,14 @@ float TSimulation::AgentFitness( agent* c )
 	{
 		if( c->Complexity() == 0.0 )
 		{
-			char filename[256];
-			sprintf( filename, "run/brain/function/brainFunction_%ld.txt", c->Number() );
 			if( fComplexityType == "D" )	// difference between I and P complexity being used for fitness
 			{
-				float pComplexity = CalcComplexity_brainfunction( filename, "P", 0 );
-				float iComplexity = CalcComplexity_brainfunction( filename, "I", 0 );
+				float pComplexity = CalcAgentComplexity( c, "P" );
+				float iComplexity = CalcAgentComplexity( c, "I" );
 				c->SetComplexity( pComplexity - iComplexity );
 			}
 			else	// fComplexityType contains the appropriate string to select the type of complexity
-				c->SetComplexity( CalcComplexity_brainfunction( filename, fComplexityType.c_str(), 0 ) );
+				c->SetComplexity( CalcAgentComplexity( c, fComplexityType.c_str() ) );
 		}
 		// fitness is normalized (by the sum of the weights) after doing a weighted sum of normalized heuristic fitness and complexity
 		// (Complexity runs between 0.0 and 1.0 in the early simulations.  Is there a way to guarantee this?  Do we want to?)
@@ -6177,6 +6736,7 @@ void TSimulation::ProcessWorldFile( proplib::Document *docWorldFile )
 	fLockStepWithBirthsDeathsLog = doc.get( "PassiveLockstep" );
 	fMaxSteps = doc.get( "MaxSteps" );
 	fEndOnPopulationCrash = doc.get( "EndOnPopulationCrash" );
+	fRecordCheckPoints = doc.get( "RecordCheckPoints" );
 	fDumpFrequency = doc.get( "CheckPointFrequency" );
 	fStatusFrequency = doc.get( "StatusFrequency" );
 	{
@@ -6195,10 +6755,13 @@ void TSimulation::ProcessWorldFile( proplib::Document *docWorldFile )
 	agent::gVision = doc.get( "Vision" );
 	fShowVision = doc.get( "ShowVision" );
 	fStaticTimestepGeometry = doc.get( "StaticTimestepGeometry" );
+	fSpatialGrid = doc.get( "SpatialGrid" );
 	fParallelInitAgents = doc.get( "ParallelInitAgents" );
 	fParallelInteract = doc.get( "ParallelInteract" );
 	fParallelCreateAgents = doc.get( "ParallelCreateAgents" );
 	fParallelBrains = doc.get( "ParallelBrains" );
+	fParallelBody = doc.get( "ParallelBody" );
+	agent::gSoftwareVision = doc.get( "SoftwareVision" );
 	brain::gMinWin = doc.get( "RetinaWidth" );
 	agent::gMaxVelocity = doc.get( "MaxVelocity" );
 	fMinNumAgents = doc.get( "MinAgents" );
@@ -6219,6 +6782,7 @@ void TSimulation::ProcessWorldFile( proplib::Document *docWorldFile )
     fPositionSeed = doc.get( "PositionSeed" );
     fGenomeSeed = doc.get( "InitSeed" );
 	fSimulationSeed = doc.get( "SimulationSeed" );
+	fRandomStreams = doc.get( "RandomStreams" );
 	{
 		proplib::Property &rfood = doc.get( "AgentsAreFood" );
 		if( (string)rfood == "Fight" )
@@ -7963,6 +8527,7 @@ void TSimulation::ProcessWorldFile( proplib::Document *docWorldFile )
 	fRecordCollisions = doc.get( "RecordCollisions" );
 	fRecordCarry = doc.get( "RecordCarry" );
 	fRecordEnergy = doc.get( "RecordEnergy" );
+	fAsyncEventLogs = doc.get( "AsyncEventLogs" );
 	fBrainAnatomyRecordAll = doc.get( "BrainAnatomyRecordAll" );
 	fBrainFunctionRecordAll = doc.get( "BrainFunctionRecordAll" );
 	fBrainAnatomyRecordSeeds = doc.get( "BrainAnatomyRecordSeeds" );
@@ -7974,6 +8539,9 @@ void TSimulation::ProcessWorldFile( proplib::Document *docWorldFile )
 	
 	fRecordGeneStats = doc.get( "RecordGeneStats" );
 	fRecordPerformanceStats = doc.get( "RecordPerformanceStats" );
+	fRecordStepProfile = doc.get( "RecordStepProfile" );
+	fStepProfileFrequency = doc.get( "StepProfileFrequency" );
+	fRecordStepTrace = doc.get( "RecordStepTrace" );
 	fRecordFoodPatchStats = doc.get( "RecordFoodPatchStats" );
 	fCalcFoodPatchAgentCounts |= fRecordFoodPatchStats;
 	fRecordComplexity = doc.get( "RecordComplexity" );
@@ -8018,6 +8586,7 @@ void TSimulation::ProcessWorldFile( proplib::Document *docWorldFile )
 		
 	fComplexityType = (string)doc.get( "ComplexityType" );
 	fComplexityFitnessWeight = doc.get( "ComplexityFitnessWeight" );
+	fComplexityFromMemory = doc.get( "ComplexityFromMemory" );
 	fHeuristicFitnessWeight = doc.get( "HeuristicFitnessWeight" );
 	if( fComplexityFitnessWeight > 0.0 )
 	{
@@ -8026,7 +8595,24 @@ void TSimulation::ProcessWorldFile( proplib::Document *docWorldFile )
 			cerr << "Warning: Attempted to use Complexity as fitness func without recording Complexity.  Turning on RecordComplexity." nl;
 			fRecordComplexity = true;
 		}
-		if( ! fBrainFunctionRecordAll )	//Not recording BrainFunction?
+		if( fComplexityFromMemory )
+		{
+			string accumulate = doc.get( "ComplexityAccumulate" );
+			if( accumulate == "Covariance" || accumulate == "GaussianizedCovariance" )
+			{
+				// Brains keep a running covariance of their activity instead of a history
+				brain::gActivityCovariance = true;
+				brain::gActivityCovarianceGaussianize = accumulate == "GaussianizedCovariance";
+			}
+			else
+			{
+				// Brains keep as many timesteps of activity as complexity would read from a brainFunction file
+				brain::gActivityHistoryLength = get_brainfunction_max_timesteps();
+				if( brain::gActivityHistoryLength <= 0 )
+					brain::gActivityHistoryLength = genome::gMaxLifeSpan;
+			}
+		}
+		else if( ! fBrainFunctionRecordAll )	//Not recording BrainFunction?
 		{
 			cerr << "Warning: Attempted to use Complexity as fitness func without recording brain function.  Turning on RecordBrainFunctionAll." nl;
 			fBrainFunctionRecordAll = true;
@@ -8045,6 +8631,7 @@ void TSimulation::ProcessWorldFile( proplib::Document *docWorldFile )
 	globals::recordFileType = (bool)doc.get( "CompressFiles" )
 		? AbstractFile::TYPE_GZIP_FILE
 		: AbstractFile::TYPE_FILE;
+	brain::gBinaryBrainFunction = doc.get( "BinaryBrainFunction" );
 
 	fFogFunction = ((string)doc.get( "FogFunction" ))[0];
 	assert( glFogFunction() == fFogFunction );
@@ -8159,139 +8746,562 @@ void TSimulation::ProcessWorldFile( proplib::Document *docWorldFile )
 	}	
 }
 
+//---------------------------------------------------------------------------
+// Checkpoint helpers
+//---------------------------------------------------------------------------
+
+// Simulation-wide values that evolve from step to step, in checkpoint order.
+#define CHECKPOINT_SCALARS( X )											\
+	X( fNumberAlive ) X( fNumberBorn ) X( fNumberBornVirtual )			\
+	X( fNumberDied ) X( fNumberDiedAge ) X( fNumberDiedEnergy )			\
+	X( fNumberDiedFight ) X( fNumberDiedEat ) X( fNumberDiedEdge )		\
+	X( fNumberDiedSmite ) X( fNumberDiedPatch )							\
+	X( fNumberCreated ) X( fNumberCreatedRandom )						\
+	X( fNumberCreated1Fit ) X( fNumberCreated2Fit )						\
+	X( fNumberFights ) X( fBirthDenials ) X( fMiscDenials )				\
+	X( fLastCreated ) X( fMaxGapCreate ) X( fNumBornSinceCreated )		\
+	X( fMaxFitness ) X( fNumAverageFitness ) X( fAverageFitness )		\
+	X( fPrevAvgFitness )												\
+	X( fTotalFoodEnergyIn ) X( fTotalFoodEnergyOut )					\
+	X( fAverageFoodEnergyIn ) X( fAverageFoodEnergyOut )				\
+	X( fCameraAngle ) X( fFitI ) X( fFitJ ) X( fNumSmited )
+
+// Per-domain values, in checkpoint order.
+#define CHECKPOINT_DOMAIN_SCALARS( X )									\
+	X( numAgents ) X( numcreated ) X( numborn ) X( numbornsincecreated )	\
+	X( numdied ) X( lastcreate ) X( maxgapcreate ) X( numToCreate )		\
+	X( foodCount ) X( numFoodPatchesGrown ) X( ifit ) X( jfit )			\
+	X( fNumSmited )
+
+static void dumpFitStruct( ostream &out, FitStruct *fs )
+{
+	checkpoint::put( out, fs->agentID );
+	checkpoint::put( out, fs->fitness );
+	checkpoint::put( out, fs->complexity );
+	if( fs->genes )
+		fs->genes->dump( out );
+}
+
+static void loadFitStruct( istream &in, FitStruct *fs )
+{
+	checkpoint::get( in, fs->agentID );
+	checkpoint::get( in, fs->fitness );
+	checkpoint::get( in, fs->complexity );
+	if( fs->genes )
+		fs->genes->load( in );
+}
+
+// Objects are referred to by type and type number, which are unique among
+// the living.
+static void putObjectRef( ostream &out, gobject *o )
+{
+	int type = o->getType();
+	unsigned long number = o->getTypeNumber();
+
+	checkpoint::put( out, type );
+	checkpoint::put( out, number );
+}
+
+typedef map< pair<int, unsigned long>, gobject * > CheckPointObjectMap;
+
+static gobject *getObjectRef( istream &in, CheckPointObjectMap &objects )
+{
+	int type;
+	unsigned long number;
+
+	checkpoint::get( in, type );
+	checkpoint::get( in, number );
+
+	CheckPointObjectMap::iterator it = objects.find( make_pair(type, number) );
+	if( it == objects.end() )
+	{
+		cerr << "Corrupt checkpoint: no object of type " << type << " with number " << number << endl;
+		exit( 1 );
+	}
+
+	return it->second;
+}
+
+static void checkHeaderValue( const char *name, long expected, long actual )
+{
+	if( expected != actual )
+	{
+		cerr << "Checkpoint does not match the worldfile: " << name << " is " << actual << " in the checkpoint but " << expected << " in the worldfile" << endl;
+		exit( 1 );
+	}
+}
+
+//---------------------------------------------------------------------------
+// TSimulation::WriteCheckPoint
+//
+// Writes a checkpoint from a forked child, so the simulation only pays for
+// the fork. The file is written under a temporary name and renamed into
+// place, so run/checkpoint.pwck is always complete.
+//---------------------------------------------------------------------------
+void TSimulation::WriteCheckPoint()
+{
+	if( fCheckPointPid > 0 )
+	{
+		if( waitpid( fCheckPointPid, NULL, WNOHANG ) == 0 )
+		{
+			fprintf( stderr, "warning: checkpoint from a previous step still being written; skipping checkpoint at step %ld\n", fStep );
+			return;
+		}
+		fCheckPointPid = 0;
+	}
+
+	pid_t pid = fork();
+	if( pid < 0 )
+	{
+		eprintf( "Unable to fork checkpoint writer (%d)\n", errno );
+	}
+	else if( pid == 0 )
+	{
+		Dump( "run/checkpoint.pwck.tmp" );
+		rename( "run/checkpoint.pwck.tmp", "run/checkpoint.pwck" );
+		_exit( 0 );
+	}
+	else
+	{
+		fCheckPointPid = pid;
+	}
+}
+
 //---------------------------------------------------------------------------
 // TSimulation::Dump
+//
+// Writes everything needed to continue the simulation from the end of the
+// current step. Monitoring windows and log files are not part of the state.
+// RestoreCheckPoint() must read back exactly what is written here.
 //---------------------------------------------------------------------------
-void TSimulation::Dump()
+void TSimulation::Dump( const char *path )
 {
-    filebuf fb;
-    if (fb.open("pw.dump", ios_base::out) == 0)
-    {
-        error(1, "Unable to dump state to \"pw.dump\" file");
-        return;
-    }
+	ofstream out( path, ios::binary );
+	if( !out )
+	{
+		eprintf( "Unable to write checkpoint to \"%s\"\n", path );
+		return;
+	}
 
-    ostream out(&fb);
-    char version[16];
-    sprintf(version, "%s", "pw1");
-
-    out << version nl;
-    out << fStep nl;
-    out << fCameraAngle nl;
-    out << fNumberCreated nl;
-    out << fNumberCreatedRandom nl;
-    out << fNumberCreated1Fit nl;
-    out << fNumberCreated2Fit nl;
-    out << fNumberDied nl;
-    out << fNumberDiedAge nl;
-    out << fNumberDiedEnergy nl;
-    out << fNumberDiedFight nl;
-    out << fNumberDiedEdge nl;
-	out << fNumberDiedSmite nl;
-    out << fNumberBorn nl;
-	out << fNumberBornVirtual nl;
-    out << fNumberFights nl;
-    out << fMiscDenials nl;
-    out << fLastCreated nl;
-    out << fMaxGapCreate nl;
-    out << fNumBornSinceCreated nl;
-
-    out << fMonitorAgentRank nl;
-    out << fMonitorAgentRankOld nl;
-    out << fAgentTracking nl;
-    out << fOverHeadRank nl;
-    out << fOverHeadRankOld nl;
-    out << fMaxGeneSeparation nl;
-    out << fMinGeneSeparation nl;
-    out << fAverageGeneSeparation nl;
-    out << fMaxFitness nl;
-    out << fAverageFitness nl;
-    out << fAverageFoodEnergyIn nl;
-    out << fAverageFoodEnergyOut nl;
-    out << fTotalFoodEnergyIn nl;
-    out << fTotalFoodEnergyOut nl;
-
-    agent::agentdump(out);
-
-    out << objectxsortedlist::gXSortedObjects.getCount(FOODTYPE) nl;
-	food* f = NULL;
-	objectxsortedlist::gXSortedObjects.reset();
-	while (objectxsortedlist::gXSortedObjects.nextObj(FOODTYPE, (gobject**)&f))
-		f->dump(out);
-					
-    out << fNumberFit nl;
-    out << fFitI nl;
-    out << fFitJ nl;
-    for (int index = 0; index < fNumberFit; index++)
-    {
-		out << fFittest[index]->agentID nl;
-        out << fFittest[index]->fitness nl;
-        assert(false); // fFittest[index]->genes->dump(out); // port to AbstractFile
-    }
-	out << fNumberRecentFit nl;
-    for (int index = 0; index < fNumberRecentFit; index++)
-    {
-		out << fRecentFittest[index]->agentID nl;
-		out << fRecentFittest[index]->fitness nl;
-//		fRecentFittest[index]->genes->Dump(out);	// we don't save the genes in the bestRecent list
-    }
+	// ---
+	// --- Header
+	// ---
+	{
+		int version = CheckpointVersion;
+		long genomeSize = GenomeUtil::schema->getMutableSize();
 
-    out << fNumDomains nl;
-    for (int id = 0; id < fNumDomains; id++)
-    {
-        out << fDomains[id].numAgents nl;
-        out << fDomains[id].numcreated nl;
-        out << fDomains[id].numborn nl;
-        out << fDomains[id].numbornsincecreated nl;
-        out << fDomains[id].numdied nl;
-        out << fDomains[id].lastcreate nl;
-        out << fDomains[id].maxgapcreate nl;
-        out << fDomains[id].ifit nl;
-        out << fDomains[id].jfit nl;
-
-        int numfitid = 0;
-        if (fDomains[id].fittest)
-        {
-            int i;
-            for (i = 0; i < fNumberFit; i++)
-            {
-                if (fDomains[id].fittest[i])
-                    numfitid++;
-                else
-                    break;
-            }
-            out << numfitid nl;
+		checkpoint::putTag( out, CheckpointMagic );
+		checkpoint::put( out, version );
+		checkpoint::put( out, fStep );
+		checkpoint::put( out, fMaxNumAgents );
+		checkpoint::put( out, genomeSize );
+		checkpoint::put( out, fNumDomains );
+		checkpoint::put( out, fNumberFit );
+		checkpoint::put( out, fNumberRecentFit );
+	}
 
-            for (i = 0; i < numfitid; i++)
-            {
-				out << fDomains[id].fittest[i]->agentID nl;
-                out << fDomains[id].fittest[i]->fitness nl;
-                assert(false); // fDomains[id].fittest[i]->genes->dump(out); // port to AbstractFile
-            }
-        }
-        else
-            out << numfitid nl;
-    }
-	
-	// Dump monitor windows
-	if (fBirthrateWindow != NULL)
-		fBirthrateWindow->Dump(out);
+	// ---
+	// --- Simulation scalars and statistics
+	// ---
+	checkpoint::putTag( out, "SIMU" );
+#define PUT( FIELD ) checkpoint::put( out, FIELD );
+	CHECKPOINT_SCALARS( PUT );
+#undef PUT
+	checkpoint::putArray( out, fNumberAliveWithMetabolism, MAXMETABOLISMS );
+	fLifeSpanStats.dump( out );
+	fNeuronGroupCountStats.dump( out );
+	fLifeSpanRecentStats.dump( out );
+	fLifeFractionRecentStats.dump( out );
+	fEatStatistics.Dump( out );
 
-	if (fFitnessWindow != NULL)
-		fFitnessWindow->Dump(out);
+	// ---
+	// --- Fittest lists
+	// ---
+	checkpoint::putTag( out, "FITS" );
+	if( fNumberFit > 0 )
+	{
+		for( int i = 0; i < fNumberFit; i++ )
+			dumpFitStruct( out, fFittest[i] );
+		for( int i = 0; i < fNumberRecentFit; i++ )
+			dumpFitStruct( out, fRecentFittest[i] );
+	}
 
-	if (fFoodEnergyWindow != NULL)
-		fFoodEnergyWindow->Dump(out);
+	// ---
+	// --- Domains and their patches
+	// ---
+	checkpoint::putTag( out, "DOMS" );
+	for( int id = 0; id < fNumDomains; id++ )
+	{
+		Domain &domain = fDomains[id];
 
-	if (fPopulationWindow != NULL)
-		fPopulationWindow->Dump(out);
+		checkpoint::put( out, domain.numFoodPatches );
+		checkpoint::put( out, domain.numBrickPatches );
+#define PUT( FIELD ) checkpoint::put( out, domain.FIELD );
+		CHECKPOINT_DOMAIN_SCALARS( PUT );
+#undef PUT
+		if( domain.fittest )
+		{
+			for( int i = 0; i < fNumberFit; i++ )
+				dumpFitStruct( out, domain.fittest[i] );
+		}
+		for( int i = 0; i < domain.numFoodPatches; i++ )
+			domain.fFoodPatches[i].dump( out );
+		for( int i = 0; i < domain.numBrickPatches; i++ )
+			domain.fBrickPatches[i].dump( out );
+	}
 
-	if (fGeneSeparationWindow != NULL)
-		fGeneSeparationWindow->Dump(out);
-		
+	checkpoint::putTag( out, "PROP" );
+	fConditionalProps->dump( out );
 
-    out.flush();
-    fb.close();
+	// ---
+	// --- Food, in creation order
+	// ---
+	checkpoint::putTag( out, "FOOD" );
+	{
+		long count = food::gAllFood.size();
+		checkpoint::put( out, count );
+
+		for( food::FoodList::iterator it = food::gAllFood.begin(); it != food::gAllFood.end(); ++it )
+		{
+			food *f = *it;
+			FoodPatch *fp = f->getPatch();
+			int patchDomain = fp ? fp->domainNumberOfParent : -1;
+			int patchIndex = fp ? int(fp - fDomains[patchDomain].fFoodPatches) : -1;
+
+			checkpoint::putString( out, f->getFoodType()->name );
+			checkpoint::put( out, patchDomain );
+			checkpoint::put( out, patchIndex );
+			f->dump( out );
+		}
+	}
+
+	// ---
+	// --- Bricks
+	// ---
+	checkpoint::putTag( out, "BRCK" );
+	{
+		long count = objectxsortedlist::gXSortedObjects.getCount( BRICKTYPE );
+		checkpoint::put( out, count );
+
+		brick *b;
+		objectxsortedlist::gXSortedObjects.reset();
+		while( objectxsortedlist::gXSortedObjects.nextObj(BRICKTYPE, (gobject**)&b) )
+		{
+			BrickPatch *bp = b->myBrickPatch;
+			int patchDomain = bp ? bp->domainNumberOfParent : -1;
+			int patchIndex = bp ? int(bp - fDomains[patchDomain].fBrickPatches) : -1;
+
+			checkpoint::put( out, patchDomain );
+			checkpoint::put( out, patchIndex );
+			b->dump( out );
+		}
+	}
+
+	// ---
+	// --- Agents
+	// ---
+	checkpoint::putTag( out, "AGNT" );
+	{
+		long count = objectxsortedlist::gXSortedObjects.getCount( AGENTTYPE );
+		checkpoint::put( out, count );
+
+		agent *a;
+		objectxsortedlist::gXSortedObjects.reset();
+		while( objectxsortedlist::gXSortedObjects.nextObj(AGENTTYPE, (gobject**)&a) )
+			a->dump( out );
+	}
+
+	// ---
+	// --- Object orderings, which decide the order of interactions
+	// ---
+	checkpoint::putTag( out, "ORDR" );
+	{
+		long count = objectxsortedlist::gXSortedObjects.count();
+		checkpoint::put( out, count );
+
+		gobject *o;
+		objectxsortedlist::gXSortedObjects.reset();
+		while( objectxsortedlist::gXSortedObjects.next(o) )
+			putObjectRef( out, o );
+
+		count = fWorldCast.size();
+		checkpoint::put( out, count );
+
+		for( TCastList::iterator it = fWorldCast.begin(); it != fWorldCast.end(); ++it )
+			putObjectRef( out, *it );
+	}
+
+	// ---
+	// --- Carried objects
+	// ---
+	checkpoint::putTag( out, "CARY" );
+	{
+		gobject *o;
+		objectxsortedlist::gXSortedObjects.reset();
+		while( objectxsortedlist::gXSortedObjects.next(o) )
+		{
+			if( o->NumCarries() == 0 )
+				continue;
+
+			bool more = true;
+			checkpoint::put( out, more );
+			putObjectRef( out, o );
+
+			long count = o->NumCarries();
+			checkpoint::put( out, count );
+			for( gobject::gObjectList::iterator it = o->fCarries.begin(); it != o->fCarries.end(); ++it )
+				putObjectRef( out, *it );
+		}
+
+		bool more = false;
+		checkpoint::put( out, more );
+	}
+
+	// ---
+	// --- Class counters and the global random number generator, last, so
+	// --- nothing above disturbs it on restore.
+	// ---
+	checkpoint::putTag( out, "GLOB" );
+	agent::agentdump( out );
+	food::fooddump( out );
+	brick::brickdump( out );
+	RandomNumberGenerator::dumpGlobal( out );
+
+	checkpoint::putTag( out, "END " );
+
+	out.close();
+	if( out.fail() )
+		eprintf( "Error writing checkpoint to \"%s\"\n", path );
+}
+
+//---------------------------------------------------------------------------
+// TSimulation::RestoreCheckPoint
+//
+// Replaces the initial population, food and bricks with the contents of a
+// checkpoint written by Dump(). Called from Init() once the worldfile has
+// been processed and the run directory created.
+//---------------------------------------------------------------------------
+void TSimulation::RestoreCheckPoint( istream &in )
+{
+	if( fLockStepWithBirthsDeathsLog )
+	{
+		cerr << "Restoring a checkpoint is not supported in lockstep mode" << endl;
+		exit( 1 );
+	}
+
+	// ---
+	// --- Header
+	// ---
+	{
+		int version;
+		long maxNumAgents;
+		long genomeSize;
+		long numDomains;
+		int numberFit;
+		int numberRecentFit;
+
+		checkpoint::expectTag( in, CheckpointMagic );
+		checkpoint::get( in, version );
+		checkHeaderValue( "version", CheckpointVersion, version );
+		checkpoint::get( in, fStep );
+		checkpoint::get( in, maxNumAgents );
+		checkHeaderValue( "MaxAgents", fMaxNumAgents, maxNumAgents );
+		checkpoint::get( in, genomeSize );
+		checkHeaderValue( "genome size", GenomeUtil::schema->getMutableSize(), genomeSize );
+		checkpoint::get( in, numDomains );
+		checkHeaderValue( "Domains", fNumDomains, numDomains );
+		checkpoint::get( in, numberFit );
+		checkHeaderValue( "NumberFittest", fNumberFit, numberFit );
+		checkpoint::get( in, numberRecentFit );
+		checkHeaderValue( "NumberRecentFittest", fNumberRecentFit, numberRecentFit );
+	}
+
+	// ---
+	// --- Simulation scalars and statistics
+	// ---
+	checkpoint::expectTag( in, "SIMU" );
+#define GET( FIELD ) checkpoint::get( in, FIELD );
+	CHECKPOINT_SCALARS( GET );
+#undef GET
+	checkpoint::getArray( in, fNumberAliveWithMetabolism, MAXMETABOLISMS );
+	fLifeSpanStats.load( in );
+	fNeuronGroupCountStats.load( in );
+	fLifeSpanRecentStats.load( in );
+	fLifeFractionRecentStats.load( in );
+	fEatStatistics.Load( in );
+
+	// ---
+	// --- Fittest lists
+	// ---
+	checkpoint::expectTag( in, "FITS" );
+	if( fNumberFit > 0 )
+	{
+		for( int i = 0; i < fNumberFit; i++ )
+			loadFitStruct( in, fFittest[i] );
+		for( int i = 0; i < fNumberRecentFit; i++ )
+			loadFitStruct( in, fRecentFittest[i] );
+	}
+
+	// ---
+	// --- Domains and their patches
+	// ---
+	checkpoint::expectTag( in, "DOMS" );
+	for( int id = 0; id < fNumDomains; id++ )
+	{
+		Domain &domain = fDomains[id];
+		int numFoodPatches;
+		int numBrickPatches;
+
+		checkpoint::get( in, numFoodPatches );
+		checkHeaderValue( "FoodPatches", domain.numFoodPatches, numFoodPatches );
+		checkpoint::get( in, numBrickPatches );
+		checkHeaderValue( "BrickPatches", domain.numBrickPatches, numBrickPatches );
+#define GET( FIELD ) checkpoint::get( in, domain.FIELD );
+		CHECKPOINT_DOMAIN_SCALARS( GET );
+#undef GET
+		if( domain.fittest )
+		{
+			for( int i = 0; i < fNumberFit; i++ )
+				loadFitStruct( in, domain.fittest[i] );
+		}
+		for( int i = 0; i < domain.numFoodPatches; i++ )
+			domain.fFoodPatches[i].load( in );
+		for( int i = 0; i < domain.numBrickPatches; i++ )
+			domain.fBrickPatches[i].load( in );
+	}
+
+	checkpoint::expectTag( in, "PROP" );
+	fConditionalProps->load( in );
+
+	CheckPointObjectMap objects;
+
+	// ---
+	// --- Food
+	// ---
+	checkpoint::expectTag( in, "FOOD" );
+	{
+		long count;
+		checkpoint::get( in, count );
+
+		for( long i = 0; i < count; i++ )
+		{
+			string foodTypeName = checkpoint::getString( in );
+			const FoodType *foodType = FoodType::lookup( foodTypeName );
+			if( foodType == NULL )
+			{
+				cerr << "Checkpoint refers to unknown food type \"" << foodTypeName << "\"" << endl;
+				exit( 1 );
+			}
+
+			int patchDomain;
+			int patchIndex;
+			checkpoint::get( in, patchDomain );
+			checkpoint::get( in, patchIndex );
+
+			food *f = new food( foodType, 0, Energy(0.0), 0.0, 0.0 );
+			Q_CHECK_PTR( f );
+			f->load( in );
+			f->setPatch( patchIndex < 0 ? NULL : &fDomains[patchDomain].fFoodPatches[patchIndex] );
+
+			objects[ make_pair(f->getType(), f->getTypeNumber()) ] = f;
+		}
+	}
+
+	// ---
+	// --- Bricks
+	// ---
+	checkpoint::expectTag( in, "BRCK" );
+	{
+		long count;
+		checkpoint::get( in, count );
+
+		for( long i = 0; i < count; i++ )
+		{
+			int patchDomain;
+			int patchIndex;
+			checkpoint::get( in, patchDomain );
+			checkpoint::get( in, patchIndex );
+
+			brick *b = new brick( Color(), 0.0, 0.0 );
+			Q_CHECK_PTR( b );
+			b->load( in );
+			b->setPatch( patchIndex < 0 ? NULL : &fDomains[patchDomain].fBrickPatches[patchIndex] );
+
+			objects[ make_pair(b->getType(), b->getTypeNumber()) ] = b;
+		}
+	}
+
+	// ---
+	// --- Agents
+	// ---
+	checkpoint::expectTag( in, "AGNT" );
+	{
+		long count;
+		checkpoint::get( in, count );
+
+		for( long i = 0; i < count; i++ )
+		{
+			agent *a = agent::getfreeagent( this, &fStage );
+			Q_ASSERT( a != NULL );
+
+			a->load( in, fMateWait, fRecordGenomes, fRecordPosition );
+			fSeparationCache.birth( a );
+
+			objects[ make_pair(a->getType(), a->getTypeNumber()) ] = a;
+		}
+	}
+
+	// ---
+	// --- Object orderings
+	// ---
+	checkpoint::expectTag( in, "ORDR" );
+	{
+		long count;
+
+		checkpoint::get( in, count );
+		checkHeaderValue( "object count", objects.size(), count );
+		for( long i = 0; i < count; i++ )
+			objectxsortedlist::gXSortedObjects.addLast( getObjectRef(in, objects) );
+
+		checkpoint::get( in, count );
+		for( long i = 0; i < count; i++ )
+			fStage.AddObject( getObjectRef(in, objects) );
+	}
+
+	// ---
+	// --- Carried objects
+	// ---
+	checkpoint::expectTag( in, "CARY" );
+	{
+		bool more;
+
+		for( checkpoint::get(in, more); more; checkpoint::get(in, more) )
+		{
+			gobject *carrier = getObjectRef( in, objects );
+			long count;
+
+			checkpoint::get( in, count );
+			for( long i = 0; i < count; i++ )
+			{
+				gobject *o = getObjectRef( in, objects );
+				o->SetCarriedBy( carrier );
+				carrier->fCarries.push_back( o );
+			}
+		}
+	}
+
+	// ---
+	// --- Class counters and the global random number generator
+	// ---
+	checkpoint::expectTag( in, "GLOB" );
+	agent::agentload( in );
+	food::foodload( in );
+	brick::brickload( in );
+	RandomNumberGenerator::loadGlobal( in );
+
+	checkpoint::expectTag( in, "END " );
+
+	cout << "Restored checkpoint \"" << fRestorePath << "\" at step " << fStep << endl;
 }
 
 
@@ -8300,12 +9310,9 @@ void TSimulation::Dump()
 //---------------------------------------------------------------------------
 short TSimulation::WhichDomain(float x, float z, short d)
 {
-	for (short i = 0; i < fNumDomains; i++)
-	{
-		if (((x >= fDomains[i].startX) && (x <= fDomains[i].endX)) && 
-			((z >= fDomains[i].startZ) && (z <= fDomains[i].endZ)))
-			return i;
-	}
+	short i = fPatchGrid.whichDomain( x, z );
+	if( i >= 0 )
+		return i;
 
 	// If we reach here, we failed to find a domain, so kvetch and quit
 	
@@ -5,7 +5,11 @@
 	#include <errno.h>
 #endif
 
+#include <sys/types.h>
+
+#include <set>
 #include <string>
+#include <vector>
 
 // qt
 #include <qobject.h>
@@ -16,15 +20,19 @@
 // Local
 #include "agent.h"
 #include "barrier.h"
+#include "Checkpoint.h"
 #include "datalib.h"
 #include "EatStatistics.h"
 #include "Energy.h"
 #include "food.h"
+#include "PositionLog.h"
 #include "Scheduler.h"
 #include "SeparationCache.h"
+#include "StepProfiler.h"
 #include "gmisc.h"
 #include "graphics.h"
 #include "gstage.h"
+#include "PatchGrid.h"
 #include "TextStatusWindow.h"
 #include "OverheadView.h"
 
@@ -207,6 +215,8 @@ public:
 	void	add( float v )	{ sum += v; sum2 += v*v; count++; mn = v < mn ? v : mn; mx = v > mx ? v : mx; }
 	void	reset()			{ mn = FLT_MAX; mx = FLT_MIN; sum = sum2 = count = 0; }
 	unsigned long samples() { return( count ); }
+	void	dump( std::ostream &out )	{ checkpoint::put( out, mn ); checkpoint::put( out, mx ); checkpoint::put( out, sum ); checkpoint::put( out, sum2 ); checkpoint::put( out, count ); }
+	void	load( std::istream &in )	{ checkpoint::get( in, mn ); checkpoint::get( in, mx ); checkpoint::get( in, sum ); checkpoint::get( in, sum2 ); checkpoint::get( in, count ); }
 
 private:
 	float	mn;		// minimum
@@ -232,6 +242,8 @@ public:
 	void	add( float v )	{ if( count < w ) { sum += v; sum2 += v*v; mn = v < mn ? v : mn; mx = v > mx ? v : mx; history[index++] = v; count++; } else { if( index >= w ) index = 0; sum += v - history[index]; sum2 += v*v - history[index]*history[index]; if( v >= mx ) mx = v; else if( history[index] == mx ) needMax = true; if( v <= mn ) mn = v; else if( history[index] == mn ) needMin = true; history[index++] = v; } }
 	void	reset()			{ mn = FLT_MAX; mx = FLT_MIN; sum = sum2 = count = index = 0; needMin = needMax = false; }
 	unsigned long samples() { return( count ); }
+	void	dump( std::ostream &out )	{ checkpoint::put( out, w ); checkpoint::put( out, mn ); checkpoint::put( out, mx ); checkpoint::put( out, sum ); checkpoint::put( out, sum2 ); checkpoint::put( out, count ); checkpoint::put( out, index ); checkpoint::put( out, needMin ); checkpoint::put( out, needMax ); checkpoint::putArray( out, history, w ); }
+	void	load( std::istream &in )	{ unsigned int width; checkpoint::get( in, width ); assert( width == w ); checkpoint::get( in, mn ); checkpoint::get( in, mx ); checkpoint::get( in, sum ); checkpoint::get( in, sum2 ); checkpoint::get( in, count ); checkpoint::get( in, index ); checkpoint::get( in, needMin ); checkpoint::get( in, needMax ); checkpoint::getArray( in, history, w ); }
 
 private:
 	float	mn;		// minimum
@@ -257,7 +269,7 @@ class TSceneWindow: public QMainWindow
 	Q_OBJECT
 
 public:
-	TSceneWindow( const char *worldfilePath );
+	TSceneWindow( const char *worldfilePath, const char *restorePath = NULL );
 	virtual ~TSceneWindow();
 	
 	void CreateSimulationScheduler();
@@ -349,7 +361,7 @@ class TSimulation : public QObject
 	Q_OBJECT
 
 public:
-	TSimulation( TSceneView* sceneView, TSceneWindow* sceneWindow, const char *worldfilePath );
+	TSimulation( TSceneView* sceneView, TSceneWindow* sceneWindow, const char *worldfilePath, const char *restorePath = NULL );
 	virtual ~TSimulation();
 	
 	void Start();
@@ -422,6 +434,7 @@ public:
 	DataLibWriter *fLifeSpanLog;
 
 	bool fRecordPosition;
+	PositionWriter *fPositionWriter;
 	bool fRecordBarrierPosition;
 	bool fRecordContacts;
 	DataLibWriter *fContactsLog;
@@ -431,6 +444,7 @@ public:
 	DataLibWriter *fCarryLog;
 	bool fRecordEnergy;
 	DataLibWriter *fEnergyLog;
+	bool fAsyncEventLogs;	// format and write the event logs on a background thread
 
 	bool fBrainAnatomyRecordAll;
 	bool fBrainFunctionRecordAll;
@@ -522,6 +536,9 @@ private:
 	void UpdateAgents_StaticTimestepGeometry();
 
 	void Interact();
+	void InteractPair( agent *c,
+					   agent *d,
+					   bool *cDied );
 	void DeathAndStats();
 	void MateLockstep();
 	int GetMatePotential( agent *x );
@@ -552,6 +569,9 @@ private:
 			   bool toMarkOnDeath );
 	void Eat( agent *c,
 			  bool *cDied );
+	void EatFood( agent *c,
+				  food *f );
+	food *FindFoodToEat( agent *c );
 	void Carry( agent *c );
 	void Pickup( agent *c );
 	void Drop( agent *c );
@@ -563,6 +583,10 @@ private:
 	void RecordGeneSeparation();
 	void CalculateGeneSeparation(agent* ci);
 	void CalculateGeneSeparationAll();
+	void RemoveGeneSeparation(agent* ci);
+	void UpdateGeneStats(agent* a, bool born);
+	void UpdateGeneSeparationStats();
+	void UpdateGeneSeparationVals();
 
 	// Following two functions only determine whether or not we should create the relevant files.
 	// Linking, renaming, and unlinking are handled according to the specific recording options.
@@ -574,7 +598,8 @@ private:
 	void Birth( agent* a,
 				LifeSpan::BirthReason reason,
 				agent* a_parent1 = NULL,
-				agent* a_parent2 = NULL );
+				agent* a_parent2 = NULL,
+				bool genomePending = false );
  private:
 	void Kill( agent* inAgent,
 			   LifeSpan::DeathReason reason );
@@ -588,14 +613,19 @@ private:
 	void FoodEnergyOut( const Energy &e );
 
 	float AgentFitness( agent* c );
+	float CalcAgentComplexity( agent* c, const char *parts );
+	void CalcAgentComplexity( agent* c, const char **parts, int nparts, double *complexity );
 	
 	void ProcessWorldFile( proplib::Document *docWorldFile );
 
-	void Dump();
+	void Dump( const char *path );
+	void WriteCheckPoint();
+	void RestoreCheckPoint( std::istream &in );
 	
 
 	TSceneView* fSceneView;
 	TSceneWindow* fSceneWindow;
+	bool fHeadless;	// no scene window, no monitoring windows, no GL
 	TOverheadView* fOverheadWindow;      //CMB 3/17/06
 	TChartWindow* fBirthrateWindow;
 	TChartWindow* fFitnessWindow;
@@ -607,7 +637,8 @@ private:
 	TTextStatusWindow* fTextStatusWindow;
 
 	Scheduler fScheduler;
-	BusyFetchQueue<agent *> fUpdateBrainQueue;
+	StepProfiler fStepProfiler;
+	WorkStealingQueue<agent *> fUpdateBrainQueue;
 	
 	long fMaxSteps;
 	bool fEndOnPopulationCrash;
@@ -616,6 +647,9 @@ private:
 	int fDumpFrequency;
 	int fStatusFrequency;
 	bool fLoadState;
+	bool fRecordCheckPoints;
+	pid_t fCheckPointPid;	// process writing the most recent checkpoint, or 0
+	const char *fRestorePath;
 	bool inited;
 	
 	gstage fStage;	
@@ -651,11 +685,15 @@ private:
 	bool fShowTextStatus;
 	bool fRecordGeneStats;
 	bool fRecordPerformanceStats;
+	bool fRecordStepProfile;
+	int fStepProfileFrequency;
+	bool fRecordStepTrace;
 	bool fRecordFoodPatchStats;
 	bool fCalcFoodPatchAgentCounts;
 	
 	std::string fComplexityType;
 	float fComplexityFitnessWeight;
+	bool fComplexityFromMemory;
 	float fHeuristicFitnessWeight;
 
 	long fNewLifes;
@@ -684,6 +722,8 @@ private:
 	long fPositionSeed;
 	long fGenomeSeed;
 	long fSimulationSeed;
+	bool fRandomStreams;
+	bool fParallelGenomes;
 
 	float fEatFitnessParameter;
 	float fEatThreshold;
@@ -800,6 +840,11 @@ private:
 	bool fChartGeneSeparation;
 	float* fGeneSepVals;
 	long fNumGeneSepVals;
+	long fMaxNumGeneSepVals;
+	std::vector<agent*> fGeneSepAgents;		// indexed by agent::Index()
+	std::vector<float> fGeneSepMatrix;		// fGeneSepAgents.size() squared
+	std::multiset<float> fGeneSepSorted;	// separation of every pair of agents in fGeneSepAgents
+	double fGeneSepSum;
 	Stat fLifeSpanStats;
 	Stat fNeuronGroupCountStats;
 	Stat fCurrentNeuronGroupCountStats;
@@ -819,22 +864,30 @@ private:
 	int fNumSmited;
 	bool fShowVision;
 	bool fStaticTimestepGeometry;
+	bool fSpatialGrid;
+	std::vector<gobject*> fNearbyObjects;	// scratch space for objectxsortedlist::getNearby()
 	bool fParallelInitAgents;
 	bool fParallelInteract;
 	bool fParallelCreateAgents;
 	bool fParallelBrains;
+	bool fParallelBody;
+	std::vector<agent*> fBodyAgents;	// scratch space for the parallel body update
+	std::vector<float> fBodyEnergy;
 	bool fGraphics;
 	long fBrainMonitorStride;
 	
 	bool fRecordMovie;
 	class PwMovieWriter *fMovieWriter;
 	
-	unsigned long* fGeneSum;	// sum, for computing mean
+	unsigned long* fGeneSum;	// sum over living agents, in genome storage order, for computing mean
 	unsigned long* fGeneSum2;	// sum of squares, for computing std. dev.
-	agent** fGeneStatsAgents;   // list of agents to be used for computing stats.
+	long fGeneStatsCount;		// number of agents in fGeneSum
+	unsigned long* fGeneSumSnapshot;	// copies of the above for the RecordGeneStats task
+	unsigned long* fGeneSum2Snapshot;
 	FILE* fGeneStatsFile;
 
 	SeparationCache fSeparationCache;
+	PatchGrid fPatchGrid;	// which domain and food patch a point is in
 	
 	FILE* fFoodPatchStatsFile;
 
@@ -30,6 +30,10 @@ namespace brain
 	short gMinWin;
 	short retinawidth;
 	short retinaheight;
+	long gActivityHistoryLength = 0;
+	bool gActivityCovariance = false;
+	bool gActivityCovarianceGaussianize = false;
+	bool gBinaryBrainFunction = false;
 
 }
 
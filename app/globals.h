@@ -129,6 +129,10 @@ namespace brain
 	extern short gMinWin;
 	extern short retinawidth;
 	extern short retinaheight;
+	extern long gActivityHistoryLength;	// timesteps of activity kept in memory by each Brain (0 = none)
+	extern bool gActivityCovariance;	// each Brain accumulates its activity covariance instead
+	extern bool gActivityCovarianceGaussianize;
+	extern bool gBinaryBrainFunction;	// record brainFunction files in the binary format
 
 } // namespace brain
 
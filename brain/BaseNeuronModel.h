@@ -8,6 +8,7 @@
 
 #include "AbstractFile.h"
 #include "Brain.h"
+#include "Checkpoint.h"
 #include "Genome.h"
 #include "globals.h"
 #include "misc.h"
@@ -178,6 +179,35 @@ class BaseNeuronModel : public NeuronModel
 #endif
 	}
 
+	virtual void prepare_update()
+	{
+	}
+
+	virtual void dump( std::ostream &out )
+	{
+		checkpoint::putArray( out, neuron, dims->numneurons );
+		checkpoint::putArray( out, neuronactivation, dims->numneurons );
+		checkpoint::putArray( out, newneuronactivation, dims->numneurons );
+		checkpoint::putArray( out, synapse, dims->numsynapses );
+		checkpoint::putArray( out, groupblrate, dims->numgroups );
+		checkpoint::putArray( out, grouplrate, dims->numgroups * dims->numgroups * 4 );
+	}
+
+	virtual void load( std::istream &in )
+	{
+		checkpoint::getArray( in, neuron, dims->numneurons );
+		checkpoint::getArray( in, neuronactivation, dims->numneurons );
+		checkpoint::getArray( in, newneuronactivation, dims->numneurons );
+		checkpoint::getArray( in, synapse, dims->numsynapses );
+		checkpoint::getArray( in, groupblrate, dims->numgroups );
+		checkpoint::getArray( in, grouplrate, dims->numgroups * dims->numgroups * 4 );
+
+#if DesignerBrains
+		for( int i = 0; i < dims->numneurons; i++ )
+			groupsize[neuron[i].group]++;
+#endif
+	}
+
 	virtual void dumpAnatomical( AbstractFile *file )
 	{
 		size_t	sizeCM;
@@ -263,6 +293,11 @@ class BaseNeuronModel : public NeuronModel
 		}
 	}
 
+	virtual void getActivations( float *activations )
+	{
+		memcpy( activations, neuronactivation, dims->numneurons * sizeof(float) );
+	}
+
 	virtual void render( short patchwidth, short patchheight )
 	{
 		if ((neuron == NULL) || (synapse == NULL))
@@ -18,6 +18,10 @@
 // Local
 #include "AbstractFile.h"
 #include "agent.h"
+#include "BrainFunctionFile.h"
+#include "Checkpoint.h"
+#include "complexity_brain.h"
+#include "CovarianceAccumulator.h"
 #include "debug.h"
 #include "FiringRateModel.h"
 #include "GenomeUtil.h"
@@ -110,7 +114,14 @@ void Brain::braindestruct()
 //---------------------------------------------------------------------------
 Brain::Brain(NervousSystem *_cns)
 	:	cns(_cns),
-		mygenes(NULL)	// but don't delete them, because we don't new them
+		mygenes(NULL),	// but don't delete them, because we don't new them
+		distortionRng(NULL),
+		weightRng(NULL),
+		functionalWriter(NULL),
+		activityHistory(NULL),
+		activityHistoryMaxTimesteps(0),
+		activityHistoryNumTimesteps(0),
+		activityCovariance(NULL)
 {
 	if (!Brain::classinited)
 		braininit();	
@@ -138,6 +149,14 @@ Brain::Brain(NervousSystem *_cns)
 Brain::~Brain()
 {
 	delete neuralnet;
+	delete functionalWriter;
+	free( activityHistory );
+	delete activityCovariance;
+
+	if( distortionRng )
+		RandomNumberGenerator::dispose( distortionRng );
+	if( weightRng )
+		RandomNumberGenerator::dispose( weightRng );
 }
 
 //---------------------------------------------------------------------------
@@ -179,7 +198,12 @@ AbstractFile *Brain::startFunctional( long index )
 	char filename[256];
 
 	sprintf( filename, "run/brain/function/incomplete_brainFunction_%ld.txt", index );
-	file = AbstractFile::open( globals::recordFileType, filename, "w" );
+
+	// Binary files compress each block themselves, so they can be mapped by readers
+	if( brain::gBinaryBrainFunction )
+		file = AbstractFile::open( AbstractFile::TYPE_FILE, filename, "w" );
+	else
+		file = AbstractFile::open( globals::recordFileType, filename, "w" );
 
 	if( !file )
 	{
@@ -187,7 +211,12 @@ AbstractFile *Brain::startFunctional( long index )
 		goto bail;
 	}
 
-	file->printf( "version 1\n" );
+	if( brain::gBinaryBrainFunction )
+		functionalWriter = new BrainFunctionWriter( file,
+													dims.numneurons,
+													globals::recordFileType == AbstractFile::TYPE_GZIP_FILE );
+	else
+		file->printf( "version 1\n" );
 
 	// print the header, with index (agent number)
 	file->printf( "brainFunction %ld", index );	
@@ -216,7 +245,16 @@ void Brain::endFunctional( AbstractFile *file, float fitness )
 	if( !file )
 		return;
 
-	file->printf( "end fitness = %g\n", fitness );
+	if( functionalWriter )
+	{
+		functionalWriter->end( fitness );
+		delete functionalWriter;
+		functionalWriter = NULL;
+	}
+	else
+	{
+		file->printf( "end fitness = %g\n", fitness );
+	}
 	delete file;
 }
 
@@ -228,7 +266,146 @@ void Brain::writeFunctional( AbstractFile *file )
 	if( !file )
 		return;
 
-	neuralnet->writeFunctional( file );
+	if( functionalWriter )
+		neuralnet->getActivations( functionalWriter->addTimestep() );
+	else
+		neuralnet->writeFunctional( file );
+}
+
+//---------------------------------------------------------------------------
+// Brain::startActivityHistory
+//
+// Begin keeping the activations of the last maxTimesteps updates in memory.
+// Like startFunctional(), this should be called after Prebirth().
+//---------------------------------------------------------------------------
+void Brain::startActivityHistory( long maxTimesteps )
+{
+	assert( maxTimesteps > 0 );
+
+	free( activityHistory );
+	activityHistory = (float *)malloc( maxTimesteps * dims.numneurons * sizeof(float) );
+	Q_CHECK_PTR( activityHistory );
+
+	activityHistoryMaxTimesteps = maxTimesteps;
+	activityHistoryNumTimesteps = 0;
+}
+
+//---------------------------------------------------------------------------
+// Brain::startActivityCovariance
+//
+// Begin accumulating the covariance of all activations, which is all
+// complexity needs, rather than keeping a history of them.
+//---------------------------------------------------------------------------
+void Brain::startActivityCovariance( bool gaussianize )
+{
+	delete activityCovariance;
+	activityCovariance = new CovarianceAccumulator( dims.numneurons, gaussianize );
+}
+
+//---------------------------------------------------------------------------
+// Brain::recordActivityHistory
+//---------------------------------------------------------------------------
+void Brain::recordActivityHistory()
+{
+	long row = activityHistoryNumTimesteps % activityHistoryMaxTimesteps;
+
+	neuralnet->getActivations( activityHistory + row * dims.numneurons );
+
+	activityHistoryNumTimesteps++;
+}
+
+//---------------------------------------------------------------------------
+// Brain::calcComplexity
+//
+// Computes complexity from the in-memory activity history, equivalent to
+// running CalcComplexity_brainfunction() on this brain's brainFunction file.
+//---------------------------------------------------------------------------
+double Brain::calcComplexity( const char *parts )
+{
+	if( activityCovariance )
+	{
+		double complexity;
+		calcComplexity( &parts, 1, &complexity );
+		return complexity;
+	}
+
+	gsl_matrix *activity = activityMatrix();
+	if( !activity )
+		return 0.0;
+
+	return CalcComplexityWithLifetimeMatrix_brainfunction( activity,
+														   parts,
+														   dims.numInputNeurons,
+														   dims.numOutputNeurons );
+}
+
+//---------------------------------------------------------------------------
+// Brain::calcComplexity
+//
+// Several complexity types at once; complexity[i] is for parts[i].
+//---------------------------------------------------------------------------
+void Brain::calcComplexity( const char **parts, int nparts, double *complexity )
+{
+	if( activityCovariance )
+	{
+		gsl_matrix *COV = activityCovariance->covariance();
+		CalcComplexityWithCOV_brainfunction( COV,
+											 activityCovariance->getCount(),
+											 parts,
+											 nparts,
+											 dims.numInputNeurons,
+											 dims.numOutputNeurons,
+											 complexity );
+		gsl_matrix_free( COV );
+		return;
+	}
+
+	gsl_matrix *activity = activityMatrix();
+	if( !activity )
+	{
+		for( int i = 0; i < nparts; i++ )
+			complexity[i] = 0.0;
+		return;
+	}
+
+	CalcComplexityWithLifetimeMatrix_brainfunction( activity,
+													parts,
+													nparts,
+													dims.numInputNeurons,
+													dims.numOutputNeurons,
+													complexity );
+}
+
+//---------------------------------------------------------------------------
+// Brain::activityMatrix
+//
+// The activity history as a matrix, oldest timestep first, as it would be
+// read from the brainFunction file. NULL if there is no history.
+//---------------------------------------------------------------------------
+gsl_matrix *Brain::activityMatrix()
+{
+	if( !activityHistory )
+		return NULL;
+
+	long numrows = min( activityHistoryNumTimesteps, activityHistoryMaxTimesteps );
+	if( numrows == 0 )
+		return NULL;
+
+	long firstrow = activityHistoryNumTimesteps > activityHistoryMaxTimesteps
+		? activityHistoryNumTimesteps % activityHistoryMaxTimesteps
+		: 0;
+
+	gsl_matrix *activity = gsl_matrix_alloc( numrows, dims.numneurons );
+
+	for( long i = 0; i < numrows; i++ )
+	{
+		float *activations = activityHistory + ((firstrow + i) % activityHistoryMaxTimesteps) * dims.numneurons;
+
+		for( int j = 0; j < dims.numneurons; j++ )
+			gsl_matrix_set( activity, i, j, activations[j] );
+	}
+
+	return activity;
 }
 
 //---------------------------------------------------------------------------
@@ -236,46 +413,61 @@ void Brain::writeFunctional( AbstractFile *file )
 //---------------------------------------------------------------------------
 void Brain::Dump(std::ostream& out)
 {
-#define DIM(NAME) out << dims.NAME << " "
-	DIM(numneurons);
-	DIM(numsynapses);
-	DIM(numgroups);
-	DIM(numInputNeurons);
-	DIM(numNonInputNeurons);
-	DIM(numOutputNeurons);
-	DIM(firstOutputNeuron);
-	DIM(firstNonInputNeuron);
-	DIM(firstInternalNeuron);
-#undef DIM
-
-	out << energyuse nl;
+	checkpoint::put( out, dims );
+	checkpoint::put( out, energyuse );
 
 	neuralnet->dump( out );
+
+	checkpoint::put( out, activityHistoryMaxTimesteps );
+	checkpoint::put( out, activityHistoryNumTimesteps );
+	if( activityHistory )
+		checkpoint::putArray( out, activityHistory, activityHistoryMaxTimesteps * dims.numneurons );
+
+	bool hasCovariance = activityCovariance != NULL;
+	checkpoint::put( out, hasCovariance );
+	if( hasCovariance )
+		activityCovariance->dump( out );
+
+	rng->dump( out );
 }
 
 
 //---------------------------------------------------------------------------
 // Brain::Load
+//
+// Expects the brain to have been grown from the same genome already, so the
+// sensors and nerves are wired up; this overwrites the grown network. The
+// RNG is restored last, undoing whatever growth consumed from it.
 //---------------------------------------------------------------------------
 void Brain::Load(std::istream& in)
 {
-#define DIM(NAME) in >> dims.NAME
-	DIM(numneurons);
-	DIM(numsynapses);
-	DIM(numgroups);
-	DIM(numInputNeurons);
-	DIM(numNonInputNeurons);
-	DIM(numOutputNeurons);
-	DIM(firstOutputNeuron);
-	DIM(firstNonInputNeuron);
-	DIM(firstInternalNeuron);
-#undef DIM
-
-	in >> energyuse;
+	checkpoint::get( in, dims );
+	checkpoint::get( in, energyuse );
 
     InitNeuralNet( 0.0 );
 
 	neuralnet->load( in );
+	neuralnet->prepare_update();
+
+	long maxTimesteps, numTimesteps;
+	checkpoint::get( in, maxTimesteps );
+	checkpoint::get( in, numTimesteps );
+	if( maxTimesteps > 0 )
+	{
+		startActivityHistory( maxTimesteps );
+		checkpoint::getArray( in, activityHistory, activityHistoryMaxTimesteps * dims.numneurons );
+		activityHistoryNumTimesteps = numTimesteps;
+	}
+
+	bool hasCovariance;
+	checkpoint::get( in, hasCovariance );
+	if( hasCovariance )
+	{
+		startActivityCovariance( brain::gActivityCovarianceGaussianize );
+		activityCovariance->load( in );
+	}
+
+	rng->load( in );
 }
 
 
@@ -1057,6 +1249,8 @@ void Brain::GrowDesignedBrain( Genome* g )
     if (numsyn != (dims.numsynapses))
         error(2,"Bad neural architecture, numsyn (",numsyn,") not equal to numsynapses (",dims.numsynapses,")");
 
+	neuralnet->prepare_update();
+
     energyuse = brain::gNeuralValues.maxneuron2energy * float(dims.numneurons) / float(brain::gNeuralValues.maxneurons)
               + brain::gNeuralValues.maxsynapse2energy * float(dims.numsynapses) / float(brain::gNeuralValues.maxsynapses);
 
@@ -1185,7 +1379,9 @@ void Brain::GrowSynapses( Genome *g,
 	Gene *td_seedGene;
 	if( brain::gNeuralValues.enableTopologicalDistortionRngSeed )
 	{
-		td_rng = RandomNumberGenerator::create( RandomNumberGenerator::TOPOLOGICAL_DISTORTION );
+		if( distortionRng == NULL )
+			distortionRng = RandomNumberGenerator::create( RandomNumberGenerator::TOPOLOGICAL_DISTORTION );
+		td_rng = distortionRng;
 		td_seedGene = g->gene( "TopologicalDistortionRngSeed" );
 	}
 	else
@@ -1197,7 +1393,9 @@ void Brain::GrowSynapses( Genome *g,
 	Gene *weight_seedGene;
 	if( brain::gEnableInitWeightRngSeed )
 	{
-		weight_rng = RandomNumberGenerator::create( RandomNumberGenerator::INIT_WEIGHT );
+		if( weightRng == NULL )
+			weightRng = RandomNumberGenerator::create( RandomNumberGenerator::INIT_WEIGHT );
+		weight_rng = weightRng;
 		weight_seedGene = g->gene( "InitWeightRngSeed" );
 	}
 	else
@@ -1337,15 +1535,6 @@ void Brain::GrowSynapses( Genome *g,
 			synapseCount_brain++;
 		}
 	}
-
-	if( brain::gNeuralValues.enableTopologicalDistortionRngSeed )
-	{
-		RandomNumberGenerator::dispose( td_rng );
-	}
-	if( brain::gEnableInitWeightRngSeed )
-	{
-		RandomNumberGenerator::dispose( weight_rng );
-	}
 }
 
 //---------------------------------------------------------------------------
@@ -1707,6 +1896,8 @@ void Brain::Grow( Genome* g )
 		dims.numsynapses = numsyn;
 	}
 	//printf( "numsynapses=%ld\n", numsyn );
+
+	neuralnet->prepare_update();
 	
 	// ---
 	// --- Calculate Energy Use
@@ -1752,6 +1943,16 @@ void Brain::Prebirth( long agentNumber, bool recordBrainAnatomy )
 void Brain::Update( bool bprint )
 {	 
 	neuralnet->update( bprint );
+
+	if( activityHistory )
+		recordActivityHistory();
+
+	if( activityCovariance )
+	{
+		__ALLOC_STACK_BUFFER( activations, float, dims.numneurons );
+		neuralnet->getActivations( activations );
+		activityCovariance->add( activations );
+	}
 }
 
 
@@ -4,6 +4,7 @@
 #include <istream>
 #include <ostream>
 #include <string>
+#include <gsl/gsl_matrix.h>
 
 // Local
 #include "NeuronModel.h"
@@ -37,6 +38,8 @@
 // Forward declarations
 class AbstractFile;
 class agent;
+class BrainFunctionWriter;
+class CovarianceAccumulator;
 namespace genome
 {
 	class Genome;
@@ -82,11 +85,18 @@ public:
 	AbstractFile* startFunctional( long index );
 	void endFunctional( AbstractFile* file, float fitness );
 	void writeFunctional( AbstractFile* file );
+
+	void startActivityHistory( long maxTimesteps );
+	void startActivityCovariance( bool gaussianize );
+	double calcComplexity( const char *parts );
+	void calcComplexity( const char **parts, int nparts, double *complexity );
         
     void Render(short patchwidth, short patchheight);
 	
 protected:
 	friend class agent;
+
+	gsl_matrix *activityMatrix();
 	
     static bool classinited;
 
@@ -98,8 +108,23 @@ protected:
     float energyuse;
 
 	RandomNumberGenerator *rng;
+	// Reseeded from genes for every group pair; allocated on first use.
+	RandomNumberGenerator *distortionRng;
+	RandomNumberGenerator *weightRng;
+
+	BrainFunctionWriter *functionalWriter;	// non-NULL while recording a binary brainFunction file
+
+	// Ring buffer of the most recent neuron activations (one row per timestep),
+	// used to compute complexity without a round-trip through brainFunction files.
+	float *activityHistory;
+	long activityHistoryMaxTimesteps;
+	long activityHistoryNumTimesteps;	// total recorded, may exceed max
+
+	// Alternative to the history: covariance of all activations so far.
+	CovarianceAccumulator *activityCovariance;
     
     void InitNeuralNet( float initial_activation );
+	void recordActivityHistory();
     short NearestFreeNeuron(short iin, bool* used, short num, short exclude);
 	
 	void GrowDesignedBrain( genome::Genome* g );
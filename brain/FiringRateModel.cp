@@ -1,5 +1,11 @@
 #include "FiringRateModel.h"
 
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
 #include "debug.h"
 #include "Genome.h"
 #include "GenomeSchema.h"
@@ -23,10 +29,19 @@ using namespace genome;
 FiringRateModel::FiringRateModel( NervousSystem *cns )
 : BaseNeuronModel<Neuron, Synapse>( cns )
 {
+	numsynapses_prepared = 0;
+	synapse_efficacy = NULL;
+	synapse_fromneuron = NULL;
+	synapse_toneuron = NULL;
+	synapse_lrate = NULL;
 }
 
 FiringRateModel::~FiringRateModel()
 {
+	free( synapse_efficacy );
+	free( synapse_fromneuron );
+	free( synapse_toneuron );
+	free( synapse_lrate );
 }
 
 void FiringRateModel::init_derived( float initial_activation )
@@ -70,85 +85,149 @@ void FiringRateModel::set_neuron( int index,
 
 void FiringRateModel::dump( ostream &out )
 {
-	long i;
+	sync_synapses();
 
-    for (i = 0; i < dims->numneurons; i++)
-	{
-		Neuron &n = neuron[i];
-        out << n.group
-			sp n.bias
-			sp n.tau
-			sp n.startsynapses
-			sp n.endsynapses
-			nl;
-	}
+	BaseNeuronModel<Neuron, Synapse>::dump( out );
+}
+
+void FiringRateModel::load( istream &in )
+{
+	BaseNeuronModel<Neuron, Synapse>::load( in );
+}
+
+void FiringRateModel::prepare_update()
+{
+	long numsynapses = dims->numsynapses;
+	long numgroups = dims->numgroups;
 
-    for (i = 0; i < dims->numneurons; i++)
-        out << neuronactivation[i] nl;
+#define __ALLOC(NAME, TYPE, N) if(NAME) free(NAME); NAME = (TYPE *)calloc(N, sizeof(TYPE)); assert(NAME);
 
-    for (i = 0; i < dims->numsynapses; i++)
+	__ALLOC( synapse_efficacy, float, numsynapses );
+	__ALLOC( synapse_fromneuron, int, numsynapses );
+	__ALLOC( synapse_toneuron, int, numsynapses );
+	__ALLOC( synapse_lrate, float, numsynapses );
+
+#undef __ALLOC
+
+	for( long k = 0; k < numsynapses; k++ )
 	{
-		Synapse &s = synapse[i];
-        out << s.efficacy
-            sp s.fromneuron
-			sp s.toneuron
-			nl;
+		Synapse &syn = synapse[k];
+		short i, j, ii, jj;
+
+		// Same decoding of the sign-encoded neuron indices that update() used
+		// to do for every synapse on every timestep.
+        if (syn.toneuron >= 0) // 0 can't happen it's an input neuron
+        {
+            i = syn.toneuron;
+            ii = 0;
+        }
+        else
+        {
+            i = -syn.toneuron;
+            ii = 1;
+        }
+        if ( (syn.fromneuron > 0) ||
+            ((syn.toneuron  == 0) && (syn.efficacy >= 0.0)) )
+        {
+            j = syn.fromneuron;
+            jj = 0;
+        }
+        else
+        {
+            j = -syn.fromneuron;
+            jj = 1;
+        }
+        // Note: If .toneuron == 0, and .efficacy were to equal
+        // 0.0 for an inhibitory synapse, we would choose the
+        // wrong learningrate, but we prevent efficacy from going
+        // to zero during update & initialization to prevent this.
+        // Similarly, learningrate is guaranteed to be < 0.0 for
+        // inhibitory synapses.
+
+		synapse_efficacy[k] = syn.efficacy;
+		synapse_fromneuron[k] = j;
+		synapse_toneuron[k] = i;
+		synapse_lrate[k] = grouplrate[index4(neuron[i].group,neuron[j].group,ii,jj, numgroups,2,2)];
 	}
 
-    for (i = 0; i < dims->numgroups; i++)
-        out << groupblrate[i] nl;
+	numsynapses_prepared = numsynapses;
+}
 
-    for (i = 0; i < (dims->numgroups * dims->numgroups * 4); i++)
-        out << grouplrate[i] nl;
+void FiringRateModel::sync_synapses()
+{
+	for( long k = 0; k < numsynapses_prepared; k++ )
+		synapse[k].efficacy = synapse_efficacy[k];
 }
 
-void FiringRateModel::load( istream &in )
+void FiringRateModel::dumpAnatomical( AbstractFile *file )
 {
-	long i;
+	sync_synapses();
 
-    for (i = 0; i < dims->numneurons; i++)
-	{
-		Neuron &n = neuron[i];
-        in >> n.group
-		   >> n.bias
-		   >> n.tau
-		   >> n.startsynapses
-		   >> n.endsynapses;
-
-#if DesignerBrains
-		groupsize[i]++;
-#endif
-	}
+	BaseNeuronModel<Neuron, Synapse>::dumpAnatomical( file );
+}
+
+void FiringRateModel::render( short patchwidth, short patchheight )
+{
+	sync_synapses();
 
-    for (i = 0; i < dims->numneurons; i++)
-        in >> neuronactivation[i];
+	BaseNeuronModel<Neuron, Synapse>::render( patchwidth, patchheight );
+}
+
+//---------------------------------------------------------------------------
+// Weighted sum of a neuron's inputs over its synapses [start,end).
+//
+// The AVX2 path gathers 8 presynaptic activations at a time, which reorders
+// the floating-point sum; it is only compiled when the build enables AVX2
+// (e.g. CPPFLAGS=-mavx2). Otherwise the sum is accumulated in synapse order,
+// giving results identical to the original array-of-structs loop.
+//---------------------------------------------------------------------------
+static inline float excitation( float bias,
+								const float *efficacy,
+								const int *fromneuron,
+								const float *activation,
+								long start,
+								long end )
+{
+	long k = start;
+	float sum = bias;
 
-    for (i = 0; i < dims->numsynapses; i++)
+#if defined(__AVX2__)
+	if( end - start >= 8 )
 	{
-		Synapse &s = synapse[i];
-        in >> s.efficacy
-		   >> s.fromneuron
-		   >> s.toneuron;
+		__m256 vsum = _mm256_setzero_ps();
+		for( ; k + 8 <= end; k += 8 )
+		{
+			__m256i vfrom = _mm256_loadu_si256( (const __m256i *)(fromneuron + k) );
+			__m256 vact = _mm256_i32gather_ps( activation, vfrom, sizeof(float) );
+			vsum = _mm256_add_ps( vsum, _mm256_mul_ps(_mm256_loadu_ps(efficacy + k), vact) );
+		}
+		float lanes[8];
+		_mm256_storeu_ps( lanes, vsum );
+		for( int l = 0; l < 8; l++ )
+			sum += lanes[l];
 	}
+#endif
 
-    for (i = 0; i < dims->numgroups; i++)
-        in >> groupblrate[i];
+	for( ; k < end; k++ )
+		sum += efficacy[k] * activation[fromneuron[k]];
 
-    for (i = 0; i < (dims->numgroups * dims->numgroups * 4); i++)
-        in >> grouplrate[i];	
+	return sum;
 }
 
 void FiringRateModel::update( bool bprint )
 {
     debugcheck( "(firing-rate brain) on entry" );
 
-    short i,j,ii,jj;
+    short i;
     long k;
     if ((neuron == NULL) || (synapse == NULL) || (neuronactivation == NULL))
         return;
 
+    assert( numsynapses_prepared == dims->numsynapses );
+
 	IF_BPRINTED
 	(
+		sync_synapses();
         printf("neuron (toneuron)  fromneuron   synapse   efficacy\n");
         
         for( i = dims->firstNonInputNeuron; i < dims->numneurons; i++ )
@@ -174,12 +253,12 @@ void FiringRateModel::update( bool bprint )
 
 	for( i = dims->firstOutputNeuron; i < dims->firstInternalNeuron; i++ )
 	{
-        newneuronactivation[i] = neuron[i].bias;
-        for( k = neuron[i].startsynapses; k < neuron[i].endsynapses; k++ )
-        {
-            newneuronactivation[i] += synapse[k].efficacy *
-               neuronactivation[abs(synapse[k].fromneuron)];
-		}              
+        newneuronactivation[i] = excitation( neuron[i].bias,
+											 synapse_efficacy,
+											 synapse_fromneuron,
+											 neuronactivation,
+											 neuron[i].startsynapses,
+											 neuron[i].endsynapses );
 //		if( newneuronactivation[i] < minExcitation )
 //			minExcitation = newneuronactivation[i];
 //		if( newneuronactivation[i] > maxExcitation )
@@ -214,12 +293,12 @@ void FiringRateModel::update( bool bprint )
 	float logisticsSlope = brain::gLogisticsSlope;
     for( i = dims->firstInternalNeuron; i < numneurons; i++ )
     {
-		float newactivation = neuron[i].bias;
-        for( k = neuron[i].startsynapses; k < neuron[i].endsynapses; k++ )
-        {
-            newactivation += synapse[k].efficacy *
-               neuronactivation[abs(synapse[k].fromneuron)];
-		}
+		float newactivation = excitation( neuron[i].bias,
+										  synapse_efficacy,
+										  synapse_fromneuron,
+										  neuronactivation,
+										  neuron[i].startsynapses,
+										  neuron[i].endsynapses );
         //newneuronactivation[i] = logistic(newneuronactivation[i], brain::gLogisticsSlope);
 
 		if( tauGene )
@@ -241,6 +320,7 @@ void FiringRateModel::update( bool bprint )
 	if( (TSimulation::fAge > 1) && (numDebugBrains < 10) )
 	{
 		numDebugBrains++;
+		sync_synapses();
 //		if( numDebugBrains > 2 )
 //			exit( 0 );
 		printf( "***** age = %ld *****\n", TSimulation::fAge );
@@ -283,50 +363,78 @@ void FiringRateModel::update( bool bprint )
 
 //	printf( "yaw activation = %g\n", newneuronactivation[yawneuron] );
 
-    float learningrate;
+	// Hebbian learning. Every synapse is independent of the others, so the SSE2
+	// path processes four at a time using the same float operations, in the
+	// same order, as the scalar loop that handles the remainder.
 	long numsynapses = dims->numsynapses;
-	long numgroups = dims->numgroups;
-    for (k = 0; k < numsynapses; k++)
-    {
-		FiringRateModel__Synapse &syn = synapse[k];
+	float halfMaxWeight = 0.5f * brain::gMaxWeight;
+	k = 0;
 
-        if (syn.toneuron >= 0) // 0 can't happen it's an input neuron
-        {
-            i = syn.toneuron;
-            ii = 0;
-        }
-        else
-        {
-            i = -syn.toneuron;
-            ii = 1;
-        }
-        if ( (syn.fromneuron > 0) ||
-            ((syn.toneuron  == 0) && (syn.efficacy >= 0.0)) )
-        {
-            j = syn.fromneuron;
-            jj = 0;
-        }
-        else
-        {
-            j = -syn.fromneuron;
-            jj = 1;
-        }
-        // Note: If .toneuron == 0, and .efficacy were to equal
-        // 0.0 for an inhibitory synapse, we would choose the
-        // wrong learningrate, but we prevent efficacy from going
-        // to zero below & during initialization to prevent this.
-        // Similarly, learningrate is guaranteed to be < 0.0 for
-        // inhibitory synapses.
-        learningrate = grouplrate[index4(neuron[i].group,neuron[j].group,ii,jj, numgroups,2,2)];
+#if defined(__SSE2__)
+	{
+		const __m128 vhalf = _mm_set1_ps( 0.5f );
+		const __m128 vone = _mm_set1_ps( 1.0f );
+		const __m128 vzero = _mm_setzero_ps();
+		const __m128 vmininhibitory = _mm_set1_ps( -1.e-10f );
+		const __m128 vdecay = _mm_set1_ps( 1.0f - brain::gDecayRate );
+		const __m128 vhalfmax = _mm_set1_ps( halfMaxWeight );
+		const __m128 vmax = _mm_set1_ps( brain::gMaxWeight );
+		const __m128 vnegmax = _mm_set1_ps( -brain::gMaxWeight );
+		const __m128 vabsmask = _mm_castsi128_ps( _mm_set1_epi32(0x7fffffff) );
+
+		for( ; k + 4 <= numsynapses; k += 4 )
+		{
+			const int *to = synapse_toneuron + k;
+			const int *from = synapse_fromneuron + k;
+
+			__m128 learningrate = _mm_loadu_ps( synapse_lrate + k );
+			__m128 post = _mm_setr_ps( newneuronactivation[to[0]],
+									   newneuronactivation[to[1]],
+									   newneuronactivation[to[2]],
+									   newneuronactivation[to[3]] );
+			__m128 pre = _mm_setr_ps( neuronactivation[from[0]],
+									  neuronactivation[from[1]],
+									  neuronactivation[from[2]],
+									  neuronactivation[from[3]] );
+
+			__m128 efficacy = _mm_add_ps( _mm_loadu_ps(synapse_efficacy + k),
+										  _mm_mul_ps(_mm_mul_ps(learningrate, _mm_sub_ps(post, vhalf)),
+													 _mm_sub_ps(pre, vhalf)) );
+			__m128 absefficacy = _mm_and_ps( efficacy, vabsmask );
+
+			// decayed and clamped, for synapses past half the max weight
+			__m128 decayed = _mm_mul_ps( efficacy,
+										 _mm_sub_ps(vone,
+													_mm_div_ps(_mm_mul_ps(vdecay, _mm_sub_ps(absefficacy, vhalfmax)),
+															   vhalfmax)) );
+			decayed = _mm_min_ps( _mm_max_ps(decayed, vnegmax), vmax );
+
+			// sign preserving, for everything else
+			__m128 excitatory = _mm_cmpge_ps( learningrate, vzero );
+			__m128 signkept = _mm_or_ps( _mm_and_ps(excitatory, _mm_max_ps(vzero, efficacy)),
+										 _mm_andnot_ps(excitatory, _mm_min_ps(vmininhibitory, efficacy)) );
+
+			__m128 large = _mm_cmpgt_ps( absefficacy, vhalfmax );
+			efficacy = _mm_or_ps( _mm_and_ps(large, decayed),
+								  _mm_andnot_ps(large, signkept) );
+
+			_mm_storeu_ps( synapse_efficacy + k, efficacy );
+		}
+	}
+#endif
+
+    for( ; k < numsynapses; k++ )
+    {
+		float learningrate = synapse_lrate[k];
 
-		float efficacy = syn.efficacy + learningrate
-			             * (newneuronactivation[i]-0.5f)
-			             * (   neuronactivation[j]-0.5f);
+		float efficacy = synapse_efficacy[k] + learningrate
+			             * (newneuronactivation[synapse_toneuron[k]]-0.5f)
+			             * (   neuronactivation[synapse_fromneuron[k]]-0.5f);
 
-        if (fabs(efficacy) > (0.5f * brain::gMaxWeight))
+        if (fabs(efficacy) > halfMaxWeight)
         {
             efficacy *= 1.0f - (1.0f - brain::gDecayRate) *
-                (fabs(efficacy) - 0.5f * brain::gMaxWeight) / (0.5f * brain::gMaxWeight);
+                (fabs(efficacy) - halfMaxWeight) / halfMaxWeight;
             if (efficacy > brain::gMaxWeight)
                 efficacy = brain::gMaxWeight;
             else if (efficacy < -brain::gMaxWeight)
@@ -345,7 +453,7 @@ void FiringRateModel::update( bool bprint )
                 efficacy = MIN(-1.e-10f, efficacy);
         }
 
-		syn.efficacy = efficacy;
+		synapse_efficacy[k] = efficacy;
     }
 
     debugcheck( "after updating synapses" );
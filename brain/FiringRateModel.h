@@ -50,8 +50,24 @@ class FiringRateModel : public BaseNeuronModel<FiringRateModel__Neuron, FiringRa
 	virtual void dump( std::ostream &out );
 	virtual void load( std::istream &in );
 
+	virtual void prepare_update();
 	virtual void update( bool bprint );
 
+	virtual void dumpAnatomical( AbstractFile *file );
+	virtual void render( short patchwidth, short patchheight );
+
  private:
+	void sync_synapses();
+
 	genome::Gene *tauGene;
+
+	// Structure-of-arrays copy of synapse[], built by prepare_update() so the
+	// update kernels can stream through contiguous arrays. While prepared,
+	// these efficacies are the authoritative ones; sync_synapses() copies them
+	// back into synapse[] for the code that still reads the array of structs.
+	long numsynapses_prepared;
+	float *synapse_efficacy;
+	int *synapse_fromneuron;	// abs(fromneuron)
+	int *synapse_toneuron;		// abs(toneuron)
+	float *synapse_lrate;		// grouplrate entry, resolved from the sign encoding
 };
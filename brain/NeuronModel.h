@@ -62,12 +62,16 @@ class NeuronModel
 	virtual void set_groupblrate( int group,
 								  float value ) = 0;
 
+	// called once the anatomy is complete (grown or loaded), before update()
+	virtual void prepare_update() = 0;
+
 	virtual void update( bool bprint ) = 0;
 
 	virtual void dumpAnatomical( AbstractFile *file ) = 0;
 
 	virtual void startFunctional( AbstractFile *file ) = 0;
 	virtual void writeFunctional( AbstractFile *file ) = 0;
+	virtual void getActivations( float *activations ) = 0;
 
 	virtual void dump( std::ostream &out ) = 0;
 	virtual void load( std::istream &in ) = 0;
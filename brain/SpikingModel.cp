@@ -103,86 +103,16 @@ void SpikingModel::set_neuron( int index,
 
 void SpikingModel::dump( ostream &out )
 {
-	long i;
+	BaseNeuronModel<Neuron, Synapse>::dump( out );
 
-    for (i = 0; i < dims->numneurons; i++)
-	{
-		Neuron &n = neuron[i];
-        out << n.group
-			sp n.bias
-			sp n.startsynapses
-			sp n.endsynapses
-			sp n.v
-			sp n.u
-			sp n.STDP
-			sp n.maxfiringcount
-			nl;
-	}
-
-    for (i = 0; i < dims->numneurons; i++)
-        out << neuronactivation[i] nl;
-
-    for (i = 0; i < dims->numOutputNeurons; i++)
-        out << outputActivation[i] nl;
-
-    for (i = 0; i < dims->numsynapses; i++)
-	{
-		Synapse &s = synapse[i];
-        out << s.efficacy
-            sp s.fromneuron
-			sp s.toneuron
-			sp s.delta
-			nl;
-	}
-
-    for (i = 0; i < dims->numgroups; i++)
-        out << groupblrate[i] nl;
-
-    for (i = 0; i < (dims->numgroups * dims->numgroups * 4); i++)
-        out << grouplrate[i] nl;
+	checkpoint::putArray( out, outputActivation, dims->numOutputNeurons );
 }
 
 void SpikingModel::load( istream &in )
 {
-	long i;
-
-    for (i = 0; i < dims->numneurons; i++)
-	{
-		Neuron &n = neuron[i];
-        in >> n.group
-		   >> n.bias
-		   >> n.startsynapses
-		   >> n.endsynapses
-		   >> n.v
-		   >> n.u
-		   >> n.STDP
-		   >> n.maxfiringcount;
-
-#if DesignerBrains
-		groupsize[i]++;
-#endif
-	}
-
-    for (i = 0; i < dims->numneurons; i++)
-        in >> neuronactivation[i];
-
-    for (i = 0; i < dims->numOutputNeurons; i++)
-        in >> outputActivation[i];
-
-    for (i = 0; i < dims->numsynapses; i++)
-	{
-		Synapse &s = synapse[i];
-        in >> s.efficacy
-		   >> s.fromneuron
-		   >> s.toneuron
-		   >> s.delta;
-	}
-
-    for (i = 0; i < dims->numgroups; i++)
-        in >> groupblrate[i];
+	BaseNeuronModel<Neuron, Synapse>::load( in );
 
-    for (i = 0; i < (dims->numgroups * dims->numgroups * 4); i++)
-        in >> grouplrate[i];
+	checkpoint::getArray( in, outputActivation, dims->numOutputNeurons );
 }
 
 void SpikingModel::update( bool bprint )
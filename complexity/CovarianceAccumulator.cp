@@ -0,0 +1,158 @@
+#include "CovarianceAccumulator.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <gsl/gsl_cdf.h>
+
+#include "Checkpoint.h"
+
+#define NumBins 32
+
+//---------------------------------------------------------------------------
+// CovarianceAccumulator::CovarianceAccumulator
+//---------------------------------------------------------------------------
+CovarianceAccumulator::CovarianceAccumulator( int nvars,
+											  bool gaussianize,
+											  double lo,
+											  double hi )
+{
+	assert( nvars > 0 );
+	assert( hi > lo );
+
+	this->nvars = nvars;
+	this->gaussianize = gaussianize;
+	this->lo = lo;
+	this->hi = hi;
+
+	n = 0;
+	mean = new double[nvars];
+	comoment = new double[nvars * (nvars + 1) / 2];
+	delta = new double[nvars];
+	memset( mean, 0, nvars * sizeof(double) );
+	memset( comoment, 0, nvars * (nvars + 1) / 2 * sizeof(double) );
+
+	if( gaussianize )
+	{
+		histogram = new int[nvars * NumBins];
+		memset( histogram, 0, nvars * NumBins * sizeof(int) );
+	}
+	else
+	{
+		histogram = NULL;
+	}
+}
+
+//---------------------------------------------------------------------------
+// CovarianceAccumulator::~CovarianceAccumulator
+//---------------------------------------------------------------------------
+CovarianceAccumulator::~CovarianceAccumulator()
+{
+	delete [] mean;
+	delete [] comoment;
+	delete [] delta;
+	delete [] histogram;
+}
+
+//---------------------------------------------------------------------------
+// CovarianceAccumulator::add
+//---------------------------------------------------------------------------
+void CovarianceAccumulator::add( const float *x )
+{
+	n++;
+
+	// Update the means, keeping the deviation from the old mean...
+	for( int i = 0; i < nvars; i++ )
+	{
+		double xi = gaussianize ? gaussianized( i, x[i] ) : x[i];
+		delta[i] = xi - mean[i];
+		mean[i] += delta[i] / n;
+	}
+
+	// ...and the co-moments, with the deviation from the new mean.
+	// (xj - new mean) = (xj - old mean) * (n - 1) / n
+	double scale = double(n - 1) / n;
+	double *c = comoment;
+	for( int i = 0; i < nvars; i++ )
+	{
+		double d = delta[i] * scale;
+		for( int j = 0; j <= i; j++ )
+			*c++ += d * delta[j];
+	}
+}
+
+//---------------------------------------------------------------------------
+// CovarianceAccumulator::covariance
+//---------------------------------------------------------------------------
+gsl_matrix *CovarianceAccumulator::covariance()
+{
+	gsl_matrix *COV = gsl_matrix_alloc( nvars, nvars );
+	double norm = n > 1 ? 1.0 / (n - 1) : 0.0;
+
+	const double *c = comoment;
+	for( int i = 0; i < nvars; i++ )
+	{
+		for( int j = 0; j <= i; j++ )
+		{
+			double cov = *c++ * norm;
+			gsl_matrix_set( COV, i, j, cov );
+			gsl_matrix_set( COV, j, i, cov );
+		}
+	}
+
+	return COV;
+}
+
+//---------------------------------------------------------------------------
+// CovarianceAccumulator::gaussianized
+//
+// Maps x to the normal quantile of its rank among the values var has had so
+// far, interpolating within its histogram bin, then adds it to the
+// histogram. The first value of each variable maps to 0.
+//---------------------------------------------------------------------------
+double CovarianceAccumulator::gaussianized( int var, double x )
+{
+	int *bins = histogram + var * NumBins;
+
+	double pos = (x - lo) / (hi - lo) * NumBins;
+	if( pos < 0.0 )
+		pos = 0.0;
+	else if( pos >= NumBins )
+		pos = NumBins - 1e-9;
+	int bin = int( pos );
+
+	long below = 0;
+	for( int i = 0; i < bin; i++ )
+		below += bins[i];
+
+	double rank = below + bins[bin] * (pos - bin);
+	double p = (rank + 0.5) / n;	// n already counts this observation
+
+	bins[bin]++;
+
+	return gsl_cdf_ugaussian_Pinv( p );
+}
+
+//---------------------------------------------------------------------------
+// CovarianceAccumulator::dump
+//---------------------------------------------------------------------------
+void CovarianceAccumulator::dump( std::ostream &out )
+{
+	checkpoint::put( out, n );
+	checkpoint::putArray( out, mean, nvars );
+	checkpoint::putArray( out, comoment, nvars * (nvars + 1) / 2 );
+	if( histogram )
+		checkpoint::putArray( out, histogram, nvars * NumBins );
+}
+
+//---------------------------------------------------------------------------
+// CovarianceAccumulator::load
+//---------------------------------------------------------------------------
+void CovarianceAccumulator::load( std::istream &in )
+{
+	checkpoint::get( in, n );
+	checkpoint::getArray( in, mean, nvars );
+	checkpoint::getArray( in, comoment, nvars * (nvars + 1) / 2 );
+	if( histogram )
+		checkpoint::getArray( in, histogram, nvars * NumBins );
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+
+#include <gsl/gsl_matrix.h>
+
+//===========================================================================
+// CovarianceAccumulator
+//
+// Running means and co-moments of a set of variables, updated one
+// observation at a time (Welford's method), so their covariance is
+// available without keeping the observations. Memory is O(nvars^2)
+// however many observations are added.
+//
+// Optionally each value is Gaussianized first: replaced by the standard
+// normal quantile of its rank among the values of its variable seen so far,
+// as estimated by a histogram over [lo, hi]. This approximates the
+// rank-order Gaussianization that gsamp() applies to a whole time series.
+//===========================================================================
+class CovarianceAccumulator
+{
+ public:
+	CovarianceAccumulator( int nvars,
+						   bool gaussianize,
+						   double lo = 0.0,
+						   double hi = 1.0 );
+	~CovarianceAccumulator();
+
+	void add( const float *x );
+
+	int getVarCount() { return nvars; }
+	long getCount() { return n; }
+
+	// Sample covariance (n - 1 denominator, like gsl_stats_covariance()) of
+	// the observations so far. The caller frees it.
+	gsl_matrix *covariance();
+
+	void dump( std::ostream &out );
+	void load( std::istream &in );
+
+ private:
+	double gaussianized( int var, double x );
+
+	int nvars;
+	bool gaussianize;
+	double lo;
+	double hi;
+
+	long n;
+	double *mean;
+	double *comoment;	// lower triangle, row by row
+	double *delta;		// scratch for add()
+
+	int *histogram;		// NumBins per variable, only if gaussianize
+};
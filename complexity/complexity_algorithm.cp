@@ -1,6 +1,8 @@
 #include "complexity_algorithm.h"
 #include "next_combination.h"
 
+#include <string.h>
+
 #include <iostream>
 
 // RescaleCOV and Fix_I can go away, as RescaleCOV should always be off
@@ -363,6 +365,89 @@ double determinant( gsl_matrix* m )
 }
 
 
+//---------------------------------------------------------------------------
+// SubsetWorkspace
+//
+// Scratch space for the integration of subsets of a covariance matrix of
+// size n, allocated once and reused for every subset rather than
+// allocating a cross-section and an LU decomposition per subset.
+//---------------------------------------------------------------------------
+class SubsetWorkspace
+{
+ public:
+	SubsetWorkspace( int n )
+	{
+		m = gsl_matrix_alloc( n, n );
+		p = gsl_permutation_alloc( n );
+	}
+
+	~SubsetWorkspace()
+	{
+		gsl_matrix_free( m );
+		gsl_permutation_free( p );
+	}
+
+	// Same result as CalcI_k()
+	double CalcI_k( gsl_matrix* COV, const int* indexes, int k )
+	{
+		gsl_matrix_view COV_k = gsl_matrix_submatrix( m, 0, 0, k, k );
+		for( int row = 0; row < k; row++ )
+			for( int col = 0; col < k; col++ )
+				gsl_matrix_set( &COV_k.matrix, row, col, gsl_matrix_get(COV, indexes[row], indexes[col]) );
+
+		gsl_permutation p_k = { (size_t)k, p->data };
+		int signum;
+		gsl_linalg_LU_decomp( &COV_k.matrix, &p_k, &signum );
+		double det = fabs( gsl_linalg_LU_det(&COV_k.matrix, signum) );
+
+		// COV_k now holds the decomposition, so take the variances from COV
+	#if Fix_I
+		double sum_Hxi = 0.0;
+		for( int i = 0; i < k; i++ )
+			sum_Hxi += c_log( gsl_matrix_get(COV, indexes[i], indexes[i]) );
+		return( 0.5 * (sum_Hxi  -  c_log( det )) );
+	#else
+		return( -0.5 * c_log( det ) );
+	#endif
+	}
+
+ private:
+	gsl_matrix* m;
+	gsl_permutation* p;
+};
+
+
+//---------------------------------------------------------------------------
+// sumI_subsets()
+//
+// Sums I_k over nsubsets subsets of size k, stored one after another in
+// subsets[]. The subsets are evaluated in parallel, each thread with its
+// own workspace, but summed in order so the result doesn't depend on the
+// number of threads.
+//---------------------------------------------------------------------------
+static double sumI_subsets( gsl_matrix* COV, const int* subsets, int nsubsets, int k )
+{
+	double* I_k = new double[nsubsets];
+
+#pragma omp parallel
+	{
+		SubsetWorkspace workspace( k );
+
+	#pragma omp for schedule(static)
+		for( int i = 0; i < nsubsets; i++ )
+			I_k[i] = workspace.CalcI_k( COV, subsets + i*k, k );
+	}
+
+	double sum = 0.0;
+	for( int i = 0; i < nsubsets; i++ )
+		sum += I_k[i];
+
+	delete [] I_k;
+
+	return( sum );
+}
+
+
 //---------------------------------------------------------------------------
 // Calculate C_k (linear I - actual I for subset size k)
 // For any but the edge cases, an approximation is calculated
@@ -405,14 +490,17 @@ double calcC_k( gsl_matrix* COV, double I_n, int k )
 	// as the number of subsets, N_choose_k, grows to astronomical values.
 	// Instead we approximate it with a modest number of samples.
 
+	// Every k draws the same sequence of samples, as it always has. Agents
+	// may be evaluated in parallel, so each call has its own generator.
 	gsl_rng *randNumGen = create_rng( DEFAULT_SEED );
 
-	int indexes[k];
-	double EI_k = 0.0;
+	// Draw all the subsets first, then evaluate them together
+	int* subsets = new int[NumSamples * k];
 	
 	for( int i = 0; i < NumSamples; i++ )
 	{
 		// Choose a random subset of size k out of the n random variables
+		int* indexes = subsets + i*k;
 		int numChosen = 0;
 		int numVisited = 0;
 		for( int j = 0; j < n; j++ )
@@ -422,13 +510,13 @@ double calcC_k( gsl_matrix* COV, double I_n, int k )
 				indexes[numChosen++] = j;
 			numVisited++;
 		}
-		
-		EI_k += CalcI_k( COV, indexes, k );
 	}
-	
+
 	dispose_rng( randNumGen );
+	
+	double EI_k = sumI_subsets( COV, subsets, NumSamples, k ) / NumSamples;
 
-	EI_k /= NumSamples;
+	delete [] subsets;
 	
 	return( LI_k - EI_k );
 }
@@ -436,36 +524,71 @@ double calcC_k( gsl_matrix* COV, double I_n, int k )
 
 //---------------------------------------------------------------------------
 // Calculate C_k for k = n - 1
+//
+// Every subset of size n-1 leaves out one variable i, and the determinant
+// of what's left is det(COV) * inverse(COV)[i][i], so a single LU
+// decomposition and inverse of COV give all n of them. Works in logs,
+// which also keeps large brains from over/underflowing the determinant.
+// Falls back on the subset-by-subset calculation if COV is singular.
 //---------------------------------------------------------------------------
-// double calcC_nm1( gsl_matrix* COV, double I_n )
-// {
-// 	int n = COV->size1;
-// 
-// 	double sumI_nm1 = 0;
-// 
-// 	for( int i = 0; i < n; i++ )
-// 	{
-// 		int b[n-1];
-// 		int b_length = n-1;
-// 
-// 		for( int j = 0; j < n; j++ )
-// 		{
-// 			if( j < i )
-// 				b[j] = j;		
-// 			else if( j > i )
-// 				b[j-1] = j;
-// 		
-// 		}
-// 
-// 		//Technically we don't have to store this array, but for now lets stay consistent with the MATLAB code
-// 		gsl_matrix* Xed_COV =  matrix_crosssection( COV, b, b_length );
-// 		double det = determinant( Xed_COV );
-// 		sumI_nm1 += CalcI( Xed_COV, det );
-// 		gsl_matrix_free( Xed_COV );		// this should solve the big memory leak problem
-// 	}
-// 
-// 	return( I_n - (I_n + sumI_nm1)/n );
-// }
+double calcC_nm1( gsl_matrix* COV, double I_n )
+{
+	int n = COV->size1;
+
+	gsl_matrix* ludecomp = gsl_matrix_alloc( n, n );
+	gsl_matrix_memcpy( ludecomp, COV );
+	gsl_permutation* p = gsl_permutation_alloc( n );
+	int signum;
+	gsl_linalg_LU_decomp( ludecomp, p, &signum );
+
+	bool singular = false;
+	for( int i = 0; i < n; i++ )
+		if( gsl_matrix_get(ludecomp, i, i) == 0.0 )
+			singular = true;
+
+	double sumI_nm1 = 0;
+
+	if( !singular )
+	{
+		gsl_matrix* inverse = gsl_matrix_alloc( n, n );
+		gsl_linalg_LU_invert( ludecomp, p, inverse );
+		double log_det = gsl_linalg_LU_lndet( ludecomp ) * c_log( M_E );
+
+		double sum_Hxi = 0.0;
+		for( int i = 0; i < n; i++ )
+			sum_Hxi += c_log( gsl_matrix_get(COV, i, i) );
+
+		for( int i = 0; i < n; i++ )
+		{
+			double log_det_i = log_det + c_log( fabs(gsl_matrix_get(inverse, i, i)) );
+		#if Fix_I
+			sumI_nm1 += 0.5 * (sum_Hxi - c_log( gsl_matrix_get(COV, i, i) )  -  log_det_i);
+		#else
+			sumI_nm1 += -0.5 * log_det_i;
+		#endif
+		}
+
+		gsl_matrix_free( inverse );
+	}
+
+	gsl_permutation_free( p );
+	gsl_matrix_free( ludecomp );
+
+	if( singular )
+	{
+		int* subsets = new int[n * (n-1)];
+		for( int i = 0; i < n; i++ )
+			for( int j = 0, col = 0; j < n; j++ )
+				if( j != i )
+					subsets[i*(n-1) + col++] = j;
+
+		sumI_nm1 = sumI_subsets( COV, subsets, n, n-1 );
+
+		delete [] subsets;
+	}
+
+	return( I_n * (n-1) / n  -  sumI_nm1 / n );
+}
 
 
 //---------------------------------------------------------------------------
@@ -478,6 +601,10 @@ double calcC_k( gsl_matrix* COV, double I_n, int k )
 double calcC_k_exact( gsl_matrix* COV, double I_n, int k )
 {
 	int n = COV->size1;
+
+	if( k == n-1 )
+		return( calcC_nm1( COV, I_n ) );
+
 	int index[n];
 	
 	for( int i = 0; i < n; i++ )
@@ -486,16 +613,28 @@ double calcC_k_exact( gsl_matrix* COV, double I_n, int k )
 	double sumI_k = 0;
 	int n_choose_k = 0;
 
+	// Collect the subsets in batches and evaluate each batch in parallel
+	const int BatchSize = 1024;
+	int* subsets = new int[BatchSize * k];
+	int nsubsets = 0;
+	bool more;
+
 	do
 	{
-		gsl_matrix* Xed_COV =  matrix_crosssection( COV, index, k );
-		double det = determinant( Xed_COV );
-		sumI_k += CalcI( Xed_COV, det );
-		gsl_matrix_free( Xed_COV );
-		
+		memcpy( subsets + nsubsets*k, index, k * sizeof(int) );
+		nsubsets++;
 		n_choose_k++;
+
+		more = next_combination( index, index+k, index+n );
+		if( nsubsets == BatchSize || !more )
+		{
+			sumI_k += sumI_subsets( COV, subsets, nsubsets, k );
+			nsubsets = 0;
+		}
 	}
-	while( next_combination( index, index+k, index+n ) );
+	while( more );
+
+	delete [] subsets;
 	
 // 	printf( "Used %s, n=%d, k=%d, n_choose_k=%d, C_k=%g\n",
 // 			__func__, n, k, n_choose_k, (I_n * k / n  -  sumI_k / n_choose_k) );
@@ -554,15 +693,32 @@ double CalcComplexityWithMatrix( gsl_matrix* data )
 //---------------------------------------------------------------------------
 double CalcApproximateFullComplexityWithMatrix( gsl_matrix* data, int numPoints )
 {
-	double complexity = 0.0;
-	
     // if have an invalid matrix return 0.
     if( data == NULL )
     {
     	fprintf( stderr, "\n%s passed NULL data matrix\n", __func__ );
-    	return complexity;
+    	return 0.0;
 	}
-	
+
+	gsl_matrix* COV = CalcComplexityCOV( data );
+	double complexity = CalcApproximateFullComplexityWithCOV( COV, numPoints );
+	gsl_matrix_free( COV );
+
+	return( complexity );
+}
+
+
+//---------------------------------------------------------------------------
+// CalcComplexityCOV
+//
+// Conditions the data (a little noise, then Gaussianization if enabled) and
+// returns its covariance matrix, from which the complexity of the data or
+// of any subset of its columns can be calculated.
+//
+// Note: data is modified.
+//---------------------------------------------------------------------------
+gsl_matrix* CalcComplexityCOV( gsl_matrix* data )
+{
     gsl_matrix* o = NULL;
 
 	// Inject a little bit of noise into the data matrix
@@ -583,11 +739,24 @@ double CalcApproximateFullComplexityWithMatrix( gsl_matrix* data, int numPoints
 	
 	// We calculate the covariance matrix and use it to compute Complexity.
 	gsl_matrix* COV = calcCOV( o );
-	size_t n = COV->size1;	// same as size2
 
     if( Gaussianize )
 		gsl_matrix_free( o );	// free this iff we allocated it (don't free data)
 
+	return( COV );
+}
+
+
+//---------------------------------------------------------------------------
+// CalcApproximateFullComplexityWithCOV
+//
+// numPoints is the number of subset sizes k at which Ck(X) is calculated
+//---------------------------------------------------------------------------
+double CalcApproximateFullComplexityWithCOV( gsl_matrix* COV, int numPoints )
+{
+	double complexity = 0.0;
+	size_t n = COV->size1;	// same as size2
+
 	double det = determinant( COV );
 	double I_n = CalcI( COV, det );
 #if RescaleCOV
@@ -660,8 +829,6 @@ double CalcApproximateFullComplexityWithMatrix( gsl_matrix* data, int numPoints
 		complexity /= n;	// based on Olbrich et al 2008, How should complexity scale with system size?, Eur. Phys. J. B
 	}
 
-	gsl_matrix_free( COV );
-
 	return( complexity );
 }
 
@@ -32,7 +32,7 @@ gsl_matrix* matrix_subset_col( gsl_matrix* mInput, int* columns, int numColumns
 double determinant( gsl_matrix* );
 double CalcI( gsl_matrix* COV, double det );
 double CalcI_k( gsl_matrix*, int* , int );
-// double calcC_nm1( gsl_matrix*, double ); // requires a square covariance Matrix
+double calcC_nm1( gsl_matrix*, double ); // requires a square covariance Matrix
 double calcC_k( gsl_matrix * COV, double I_n, int k );
 double calcC_k_exact( gsl_matrix* COV, double I_n, int k );
 
@@ -47,6 +47,8 @@ int qsort_compare_rows0( const void *a, const void *b );
 double CalcComplexityWithMatrix( gsl_matrix* data );
 double CalcComplexityWithVector( gsl_vector* vector, size_t blockDuration, size_t blockOffset );
 double CalcApproximateFullComplexityWithMatrix( gsl_matrix* data, int numPoints );
+gsl_matrix* CalcComplexityCOV( gsl_matrix* data );
+double CalcApproximateFullComplexityWithCOV( gsl_matrix* COV, int numPoints );
 double CalcApproximateFullComplexityWithVector( gsl_vector* vector, size_t blockDuration, size_t blockOffset, int numPoints );
 
 #endif // COMPLEXITY_ALGORITHM_H
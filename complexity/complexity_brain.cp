@@ -6,6 +6,7 @@
 #include <list>
 
 #include "AbstractFile.h"
+#include "BrainFunctionFile.h"
 #include "complexity_algorithm.h"
 
 using namespace std;
@@ -65,23 +66,55 @@ CalcComplexity_brainfunction_result *
 		callback->begin(parms, nparms);
 	}
 
-#pragma omp parallel for
+	// Consecutive parms for the same file are computed together, from a
+	// single read of the file and a single covariance matrix.
+	vector<int> groups;
 	for(int iparm = 0; iparm < nparms; iparm++)
 	{
-		CalcComplexity_brainfunction_parms *parm = &parms[iparm];
+		if( (iparm == 0)
+			|| (strcmp(parms[iparm].path, parms[iparm - 1].path) != 0)
+			|| (parms[iparm].ignore_timesteps_after != parms[iparm - 1].ignore_timesteps_after) )
+		{
+			groups.push_back(iparm);
+		}
+	}
+	int ngroups = groups.size();
+	groups.push_back(nparms);
 
-		double Complexity = CalcComplexity_brainfunction(parm->path,
-								 parm->parts,
-								 parm->ignore_timesteps_after,
-								 result->agent_number + iparm,
-								 result->lifespan + iparm,
-								 result->num_neurons + iparm);
-		result->complexity[iparm] = Complexity;
+#pragma omp parallel for schedule(dynamic)
+	for(int igroup = 0; igroup < ngroups; igroup++)
+	{
+		int begin = groups[igroup];
+		int nparts = groups[igroup + 1] - begin;
+		const char *parts[nparts];
 
-		if(callback)
+		for(int i = 0; i < nparts; i++)
 		{
-		  callback->parms_result(result,
-					 iparm);
+			parts[i] = parms[begin + i].parts;
+		}
+
+		long agent_number, lifespan, num_neurons;
+
+		CalcComplexity_brainfunction(parms[begin].path,
+					     parts,
+					     nparts,
+					     parms[begin].ignore_timesteps_after,
+					     result->complexity + begin,
+					     &agent_number,
+					     &lifespan,
+					     &num_neurons);
+
+		for(int iparm = begin; iparm < begin + nparts; iparm++)
+		{
+			result->agent_number[iparm] = agent_number;
+			result->lifespan[iparm] = lifespan;
+			result->num_neurons[iparm] = num_neurons;
+
+			if(callback)
+			{
+			  callback->parms_result(result,
+						 iparm);
+			}
 		}
 	}
 
@@ -120,38 +153,158 @@ double CalcComplexity_brainfunction(const char *fnameAct,
 	if( activity == NULL )
 		return( 0.0 );
 
-    // If agent lived fewer timesteps than it has neurons, or it hasn't lived long enough,
-    // return Complexity = 0.0.
-    if( activity->size2 > activity->size1 || activity->size1 < IgnoreAgentsThatLivedLessThan_N_Timesteps )
-    	return( 0.0 );
-	
 // 	fflush( stdout );
 // 	printf( "\nactivity rows(size1) = %lu, columns(size2) = %lu\n", activity->size1, activity->size2 );
 // 	for( size_t i = 0; i < activity->size1; i++ )
 // 		printf( "%lu  %g\n", i, gsl_matrix_get( activity, i, 0 ));
 // 	fflush( stdout );
 
-	return CalcComplexityWithMatrix_brainfunction(activity,
-												  part,
-												  numinputneurons,
-												  numoutputneurons);
-	
-	gsl_matrix_free( activity );
+	return CalcComplexityWithLifetimeMatrix_brainfunction(activity,
+														  part,
+														  numinputneurons,
+														  numoutputneurons);
 }
 
 //---------------------------------------------------------------------------
-// CalcComplexityWithMatrix_brainfunction
+// CalcComplexity_brainfunction
+//
+// Computes several complexity types, complexity[i] for parts[i], from one
+// read of the file.
 //---------------------------------------------------------------------------
-double CalcComplexityWithMatrix_brainfunction(gsl_matrix *activity,
-											  const char *part,
-											  long numinputneurons,
-											  long numoutputneurons)
+void CalcComplexity_brainfunction(const char *fnameAct,
+				  const char **parts,
+				  int nparts,
+				  int ignore_timesteps_after,
+				  double *complexity,
+				  long *agent_number,
+				  long *lifespan,
+				  long *num_neurons)
 {
-	if( numinputneurons == 0 )
-		return( -2 );
+	long numinputneurons = 0;		// this value will be defined by readin_brainfunction()
+	long numoutputneurons = 0;
 	
-	setGaussianize( FLAG_useGSAMP );
+	gsl_matrix * activity = readin_brainfunction(fnameAct,
+												 ignore_timesteps_after,
+												 MaxNumTimeStepsToComputeComplexityOver,
+												 agent_number,
+												 lifespan,
+												 num_neurons,
+												 &numinputneurons,
+												 &numoutputneurons);
 	
+	// If the brain file was invalid or memory allocation failed, just return 0.0
+	if( activity == NULL )
+	{
+		for( int i = 0; i < nparts; i++ )
+			complexity[i] = 0.0;
+		return;
+	}
+
+	CalcComplexityWithLifetimeMatrix_brainfunction(activity,
+												   parts,
+												   nparts,
+												   numinputneurons,
+												   numoutputneurons,
+												   complexity);
+}
+
+//---------------------------------------------------------------------------
+// CalcComplexityWithLifetimeMatrix_brainfunction
+//
+// Applies the same lifespan screening as CalcComplexity_brainfunction() to
+// an activity matrix that was already assembled, whether read from a
+// brainFunction file or recorded in memory by the Brain.  The matrix should
+// hold no more than get_brainfunction_max_timesteps() rows.
+//
+// Note: activity is freed by this function.
+//---------------------------------------------------------------------------
+double CalcComplexityWithLifetimeMatrix_brainfunction(gsl_matrix *activity,
+													  const char *part,
+													  long numinputneurons,
+													  long numoutputneurons)
+{
+	double complexity = 0.0;
+
+    // If agent lived fewer timesteps than it has neurons, or it hasn't lived long enough,
+    // return Complexity = 0.0.
+    if( activity->size2 <= activity->size1 && activity->size1 >= IgnoreAgentsThatLivedLessThan_N_Timesteps )
+	{
+		complexity = CalcComplexityWithMatrix_brainfunction(activity,
+															part,
+															numinputneurons,
+															numoutputneurons);
+	}
+
+	gsl_matrix_free( activity );
+
+	return complexity;
+}
+
+//---------------------------------------------------------------------------
+// CalcComplexityWithLifetimeMatrix_brainfunction
+//
+// Several complexity types at once; complexity[i] is for parts[i].
+//
+// Note: activity is freed by this function.
+//---------------------------------------------------------------------------
+void CalcComplexityWithLifetimeMatrix_brainfunction(gsl_matrix *activity,
+													const char **parts,
+													int nparts,
+													long numinputneurons,
+													long numoutputneurons,
+													double *complexity)
+{
+    if( activity->size2 <= activity->size1 && activity->size1 >= IgnoreAgentsThatLivedLessThan_N_Timesteps )
+	{
+		CalcComplexityWithMatrix_brainfunction(activity,
+											   parts,
+											   nparts,
+											   numinputneurons,
+											   numoutputneurons,
+											   complexity);
+	}
+	else
+	{
+		for( int i = 0; i < nparts; i++ )
+			complexity[i] = 0.0;
+	}
+
+	gsl_matrix_free( activity );
+}
+
+//---------------------------------------------------------------------------
+// get_brainfunction_max_timesteps
+//
+// The number of (most recent) timesteps of an agent's life that are used to
+// compute complexity.  Returns 0 if the whole lifetime is used.
+//---------------------------------------------------------------------------
+int get_brainfunction_max_timesteps()
+{
+	return MaxNumTimeStepsToComputeComplexityOver;
+}
+
+static void CalcComplexityOfParts(gsl_matrix *COV,
+								  const char **parts,
+								  int nparts,
+								  long numinputneurons,
+								  long numoutputneurons,
+								  double *complexity);
+
+//---------------------------------------------------------------------------
+// select_brainfunction_columns
+//
+// Decodes one complexity type (e.g. "P", "HB" or "A0") into the activity
+// columns it covers and the number of points to integrate over. Returns
+// false for "A", which covers all of them.
+//---------------------------------------------------------------------------
+static bool select_brainfunction_columns(const char *part,
+										 long numneurons,
+										 long numinputneurons,
+										 long numoutputneurons,
+										 int *columns,
+										 int *ncolumns,
+										 int *num_points)
+{
 	int flagAll = 0;
 	int flagPro = 0;
 	int flagInp = 0;
@@ -159,7 +312,7 @@ double CalcComplexityWithMatrix_brainfunction(gsl_matrix *activity,
 	int flagHea = 0;
 	
 	int startPro = numinputneurons;
-	int numPro = activity->size2 - numinputneurons;	// size 2 is number of columns == number of neurons
+	int numPro = numneurons - numinputneurons;
 	int indexPro[numPro];
 	
 	int startInp = 0;
@@ -172,7 +325,7 @@ double CalcComplexityWithMatrix_brainfunction(gsl_matrix *activity,
 	
 	int indexHea = 1;
 	
-	int num_points = 1;
+	*num_points = 1;
 	
 	for( unsigned int j = 0; j < strlen( part ); j++ )
 	{
@@ -180,7 +333,7 @@ double CalcComplexityWithMatrix_brainfunction(gsl_matrix *activity,
 		if( isdigit( part[j] ) )
 		{
 			const char* num_points_str = &(part[j]);
-			num_points = atoi( num_points_str );
+			*num_points = atoi( num_points_str );
 			break;
 		}
 		
@@ -217,14 +370,10 @@ double CalcComplexityWithMatrix_brainfunction(gsl_matrix *activity,
 	}
 		
 	if (flagAll == 1)
-	{
-		double complexity = CalcApproximateFullComplexityWithMatrix( activity, num_points );
-		return complexity;
-	}
+		return false;
 	
 	// Accumulate the indexes of neurons related to the requested complexity type
 	
-	int columns[activity->size2];	// size 2 is number of columns == number of neurons
 	int numColumns = 0;
 
 	if( flagInp == 1 )
@@ -258,6 +407,39 @@ double CalcComplexityWithMatrix_brainfunction(gsl_matrix *activity,
 			columns[i] = indexBeh[j++];
 		numColumns += numBeh;
 	}
+
+	*ncolumns = numColumns;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// CalcComplexityWithMatrix_brainfunction
+//---------------------------------------------------------------------------
+double CalcComplexityWithMatrix_brainfunction(gsl_matrix *activity,
+											  const char *part,
+											  long numinputneurons,
+											  long numoutputneurons)
+{
+	if( numinputneurons == 0 )
+		return( -2 );
+	
+	setGaussianize( FLAG_useGSAMP );
+	
+	int columns[activity->size2];	// size 2 is number of columns == number of neurons
+	int numColumns;
+	int num_points;
+
+	if( !select_brainfunction_columns(part,
+									  activity->size2,
+									  numinputneurons,
+									  numoutputneurons,
+									  columns,
+									  &numColumns,
+									  &num_points) )
+	{
+		return CalcApproximateFullComplexityWithMatrix( activity, num_points );
+	}
 	
 	gsl_matrix* subset = matrix_subset_col( activity, columns, numColumns );
 	
@@ -268,6 +450,119 @@ double CalcComplexityWithMatrix_brainfunction(gsl_matrix *activity,
 	return complexity;				
 }
 
+//---------------------------------------------------------------------------
+// CalcComplexityWithMatrix_brainfunction
+//
+// Several complexity types at once; complexity[i] is for parts[i]. The
+// covariance of the whole activity matrix is computed once, and each type
+// takes the cross-section of it for its own neurons. The conditioning noise
+// and Gaussianization are then drawn for the whole matrix rather than for
+// each subset, so subset results differ from the single-type function's at
+// the level of that noise.
+//---------------------------------------------------------------------------
+void CalcComplexityWithMatrix_brainfunction(gsl_matrix *activity,
+											const char **parts,
+											int nparts,
+											long numinputneurons,
+											long numoutputneurons,
+											double *complexity)
+{
+	if( numinputneurons == 0 )
+	{
+		for( int i = 0; i < nparts; i++ )
+			complexity[i] = -2;
+		return;
+	}
+	
+	setGaussianize( FLAG_useGSAMP );
+
+	gsl_matrix* COV = CalcComplexityCOV( activity );
+
+	CalcComplexityOfParts( COV, parts, nparts, numinputneurons, numoutputneurons, complexity );
+
+	gsl_matrix_free( COV );
+}
+
+//---------------------------------------------------------------------------
+// CalcComplexityWithCOV_brainfunction
+//
+// Complexity from an activity covariance that was accumulated as the agent
+// lived (see CovarianceAccumulator) over numtimesteps timesteps, with the
+// same screening as CalcComplexityWithLifetimeMatrix_brainfunction().
+// complexity[i] is for parts[i].
+//
+// Note: COV is modified.
+//---------------------------------------------------------------------------
+void CalcComplexityWithCOV_brainfunction(gsl_matrix *COV,
+										 long numtimesteps,
+										 const char **parts,
+										 int nparts,
+										 long numinputneurons,
+										 long numoutputneurons,
+										 double *complexity)
+{
+	if( (long)COV->size1 > numtimesteps || numtimesteps < IgnoreAgentsThatLivedLessThan_N_Timesteps )
+	{
+		for( int i = 0; i < nparts; i++ )
+			complexity[i] = 0.0;
+		return;
+	}
+
+	if( numinputneurons == 0 )
+	{
+		for( int i = 0; i < nparts; i++ )
+			complexity[i] = -2;
+		return;
+	}
+
+	// Stands in for the variance of the noise CalcComplexityCOV() adds to the
+	// activity, which keeps constant neurons from making COV singular.
+	for( size_t i = 0; i < COV->size1; i++ )
+		gsl_matrix_set( COV, i, i, gsl_matrix_get(COV, i, i) + 0.00001 * 0.00001 );
+
+	CalcComplexityOfParts( COV, parts, nparts, numinputneurons, numoutputneurons, complexity );
+}
+
+//---------------------------------------------------------------------------
+// CalcComplexityOfParts
+//
+// Each complexity type takes the cross-section of the full activity
+// covariance for its own neurons.
+//---------------------------------------------------------------------------
+static void CalcComplexityOfParts(gsl_matrix *COV,
+								  const char **parts,
+								  int nparts,
+								  long numinputneurons,
+								  long numoutputneurons,
+								  double *complexity)
+{
+	long numneurons = COV->size1;
+	int columns[numneurons];
+
+	for( int i = 0; i < nparts; i++ )
+	{
+		int numColumns;
+		int num_points;
+
+		if( !select_brainfunction_columns(parts[i],
+										  numneurons,
+										  numinputneurons,
+										  numoutputneurons,
+										  columns,
+										  &numColumns,
+										  &num_points) )
+		{
+			complexity[i] = CalcApproximateFullComplexityWithCOV( COV, num_points );
+		}
+		else
+		{
+			gsl_matrix* COV_part = matrix_crosssection( COV, columns, numColumns );
+			complexity[i] = CalcApproximateFullComplexityWithCOV( COV_part, num_points );
+			gsl_matrix_free( COV_part );
+		}
+	}
+}
+
 
 //---------------------------------------------------------------------------
 // get_list_of_brainfunction_logfiles
@@ -501,6 +796,60 @@ gsl_matrix * readin_brainanatomy( const char* fname )
 }
 
 
+//---------------------------------------------------------------------------
+// readin_brainfunction_binary
+//
+// Same as readin_brainfunction(), for a binary brainFunction file.
+//---------------------------------------------------------------------------
+static gsl_matrix * readin_brainfunction_binary(const char* fname,
+												int ignore_timesteps_after,
+												int max_timesteps,
+												long *agent_number,
+												long *lifespan,
+												long *num_neurons,
+												long *num_ineurons,
+												long *num_oneurons)
+{
+	BrainFunctionReader reader;
+
+	if( !reader.open(fname) )
+		return NULL;
+
+	if( agent_number )
+		*agent_number = reader.getAgentNumber();
+	if( num_neurons )
+		*num_neurons = reader.getNeuronCount();
+	if( num_ineurons )
+		*num_ineurons = reader.getInputNeuronCount();
+	if( num_oneurons )
+		*num_oneurons = reader.getOutputNeuronCount();
+	if( lifespan )
+		*lifespan = reader.getTimestepCount();
+
+	long end = reader.getTimestepCount();
+	if( ignore_timesteps_after > 0 )
+		end = min( end, (long)ignore_timesteps_after );
+
+	long begin = 0;
+	if( max_timesteps > 0 )
+		begin = max( 0L, end - max_timesteps );
+
+	long numrows = end - begin;
+	int numcols = reader.getNeuronCount();
+
+	if( numrows <= 0 )
+	{
+		cerr << "brainFunction file '" << fname << "' is corrupt; numcols=" << numcols << ", numrows=" << numrows << endl;
+		return NULL;
+	}
+
+	gsl_matrix * activity = gsl_matrix_alloc( numrows, numcols );
+
+	reader.read( begin, numrows, activity->data, activity->tda );
+
+	return activity;
+}
+
 //---------------------------------------------------------------------------
 // readin_brainfunction
 //---------------------------------------------------------------------------
@@ -520,6 +869,17 @@ gsl_matrix * readin_brainfunction(const char* fname,
 // 	printf( "\nmax_timesteps = %d\n", max_timesteps );
 	assert( ignore_timesteps_after >= 0 );		// just to be safe.
 
+	// Binary files are never gzipped as a whole, so the abstract path is the real one
+	if( BrainFunctionReader::isBinary(fname) )
+		return readin_brainfunction_binary( fname,
+											ignore_timesteps_after,
+											max_timesteps,
+											agent_number,
+											lifespan,
+											num_neurons,
+											num_ineurons,
+											num_oneurons );
+
 	AbstractFile *FunctionFile;
 	if( (FunctionFile = AbstractFile::open(fname, "r")) == NULL )
 	{
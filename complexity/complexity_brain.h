@@ -70,6 +70,41 @@ double CalcComplexityWithMatrix_brainfunction(gsl_matrix *matrix,
 											  const char *parts,
 											  long numinputneurons,
 											  long numoutputneurons);
+double CalcComplexityWithLifetimeMatrix_brainfunction(gsl_matrix *matrix,
+													  const char *parts,
+													  long numinputneurons,
+													  long numoutputneurons);
+
+// Several complexity types from one activity matrix; complexity[i] is for
+// parts[i].
+void CalcComplexity_brainfunction(const char *path,
+								  const char **parts,
+								  int nparts,
+								  int ignore_timesteps_after,
+								  double *complexity,
+								  long *agent_number = NULL,
+								  long *lifespan = NULL,
+								  long *num_neurons = NULL);
+void CalcComplexityWithMatrix_brainfunction(gsl_matrix *matrix,
+											const char **parts,
+											int nparts,
+											long numinputneurons,
+											long numoutputneurons,
+											double *complexity);
+void CalcComplexityWithLifetimeMatrix_brainfunction(gsl_matrix *matrix,
+													const char **parts,
+													int nparts,
+													long numinputneurons,
+													long numoutputneurons,
+													double *complexity);
+void CalcComplexityWithCOV_brainfunction(gsl_matrix *COV,
+										 long numtimesteps,
+										 const char **parts,
+										 int nparts,
+										 long numinputneurons,
+										 long numoutputneurons,
+										 double *complexity);
+int get_brainfunction_max_timesteps();
 
 std::vector<std::string> get_list_of_brainfunction_logfiles( std::string );
 std::vector<std::string> get_list_of_brainanatomy_logfiles( std::string );
@@ -7,6 +7,7 @@
 
 #include "datalib.h"
 #include "misc.h"
+#include "PositionLog.h"
 
 
 using namespace std;
@@ -40,6 +41,8 @@ MotionComplexity::MotionComplexity( const char *path_run,
 	this->path_run = path_run;
 	this->min_epoch_presence = min_epoch_presence;
 
+	positions = new PositionReader( (string(path_run) + "/motion/position/positions.bin").c_str() );
+
 	computeEpochs( step_begin,
 				   step_end,
 				   epochlen );
@@ -52,6 +55,7 @@ MotionComplexity::MotionComplexity( const char *path_run,
 // -----------------------------------------------------------------------------
 MotionComplexity::~MotionComplexity()
 {
+	delete positions;
 }
 
 // -----------------------------------------------------------------------------
@@ -239,116 +243,96 @@ gsl_matrix *MotionComplexity::populateMatrix( Epoch &epoch )
 #endif
 
 	// ---
-	// --- Alloc Matrix
+	// --- Presence Filter
 	// ---
-	int nagents = epoch.agents.size();
-	int nsteps = epoch.end - epoch.begin + 1;
-	int nrows = nagents * NDIMS;
-	int ncols = nsteps;
-	assert(nrows > 0 && ncols > 0);
-
-	gsl_matrix *matrix_pos = gsl_matrix_alloc(nrows,
-											  ncols);
+	typedef map<long, pair<Agent *, int> > RowMap;
+	RowMap rows;
 
-	int row_x = 0;
-	int row_z = 1;
-	long nil_count = 0;
-
-	// ---
-	// --- Iterate Agents
-	// ---
 	itfor( AgentList, epoch.agents, it )
 	{
 		Agent &agent = *it;
 
-		// ---
-		// --- Open Position File
-		// ---
-		char path[512];
-		sprintf( path,
-				 "%s/motion/position/position_%ld.txt",
-				 path_run, agent.number );
-
-		DataLibReader in( path );
-		in.seekTable( "Positions" );
-
-		// ---
-		// --- Presence Filter
-		// ---
 		if(getPresence(agent, epoch) < min_epoch_presence)
 		{
 			DEBUG(printf("agent %ld below presence threshold\n", agent.number));
 			continue;
 		}
 
-		// ---
-		// --- Iterate Steps
-		// ---
-		for(long step = epoch.begin;
-		    step <= epoch.end;
-		    step++)
-		{
-			float x;
-			float z;
+		int row_x = rows.size() * NDIMS;
+		rows[agent.number] = make_pair( &agent, row_x );
+	}
 
-			if( step >= agent.begin && step <= agent.end )
-			{
-				in.seekRow( step - agent.birth );
+	epoch.complexity.nagents = rows.size();
 
-				x = in.col( "x" );
-				z = in.col( "z" );
-			}
-			else
-			{
-				nil_count++;
+	if( rows.empty() )
+	{
+		// All agents were filtered out
+		return NULL;
+	}
+
+	// ---
+	// --- Alloc Matrix
+	// ---
+	int nsteps = epoch.end - epoch.begin + 1;
+	int nrows = rows.size() * NDIMS;
+	int ncols = nsteps;
+	assert(nrows > 0 && ncols > 0);
+
+	gsl_matrix *matrix_pos = gsl_matrix_alloc(nrows,
+											  ncols);
+
+	// Every agent/step not found in the log keeps a nil value.
+	for( int row = 0; row < nrows; row++ )
+	{
+		for( int col = 0; col < ncols; col++ )
+		{
 #if NIL_TYPE == NIL_ZERO
-				x = 0;
-				z = 0;
+			gsl_matrix_set( matrix_pos, row, col, 0 );
 #elif NIL_TYPE == NIL_RAND
-				x = randpw() * 10;
-				z = randpw() * 10;
+			gsl_matrix_set( matrix_pos, row, col, randpw() * 10 );
 #endif
-			}
-
-			DEBUG( printf(" step=%ld, agent=%ld, (x,z)=(%f,%f)\n", step, agent.number, x, z) );
-
-			gsl_matrix_set(matrix_pos,
-						   row_x,
-						   step - epoch.begin,
-						   x);
-			gsl_matrix_set(matrix_pos,
-						   row_z,
-						   step - epoch.begin,
-						   z);
 		}
-
-		row_x += 2;
-		row_z += 2;
 	}
+	long nil_count = long(rows.size()) * nsteps;
 
 	// ---
-	// --- Post-Processing Matrix Fixup
+	// --- Scan the Epoch's Steps
 	// ---
-	if(row_x == 0)
-	{
-		// All agents were filtered out
-		gsl_matrix_free(matrix_pos);
-		matrix_pos = NULL;
-	}
-	else
+	vector<positionlog::Position> block;
+	long step;
+
+	positions->seekStep( epoch.begin );
+
+	while( positions->nextStep(step, block) && (step <= epoch.end) )
 	{
-		if(row_x != nrows)
+		itfor( vector<positionlog::Position>, block, it )
 		{
-			// some agents didn't pass the MIN_EPOCH_PRESENCE threshhold
-			// shrink the number of rows.
+			RowMap::iterator itrow = rows.find( it->agent );
+			if( itrow == rows.end() )
+				continue;
+
+			Agent &agent = *itrow->second.first;
+			if( step < agent.begin || step > agent.end )
+				continue;
+
+			int row_x = itrow->second.second;
+			int row_z = row_x + 1;
 
-	  		DEBUG(printf("shrinking matrix from %ld to %ld rows.\n", nrows, row_x));
+			DEBUG( printf(" step=%ld, agent=%ld, (x,z)=(%f,%f)\n", step, agent.number, it->x, it->z) );
+
+			gsl_matrix_set(matrix_pos,
+						   row_x,
+						   step - epoch.begin,
+						   it->x);
+			gsl_matrix_set(matrix_pos,
+						   row_z,
+						   step - epoch.begin,
+						   it->z);
 
-			matrix_pos->size1 = row_x;
+			nil_count--;
 		}
 	}
 
-	epoch.complexity.nagents = row_x / 2;
 	epoch.complexity.nil_ratio = float(nil_count) / (epoch.complexity.nagents * NDIMS * nsteps);
 
 	return matrix_pos;
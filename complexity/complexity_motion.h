@@ -5,6 +5,8 @@
 
 #include "complexity_algorithm.h"
 
+class PositionReader;
+
 class MotionComplexity
 {
  public:
@@ -58,4 +60,5 @@ class MotionComplexity
  private:
 	const char *path_run;
 	float min_epoch_presence;
+	PositionReader *positions;
 };
@@ -11,6 +11,7 @@
 
 // Local
 #include "agent.h"
+#include "Checkpoint.h"
 #include "globals.h"
 #include "graphics.h"
 #include "brick.h"
@@ -80,6 +81,16 @@ void BrickPatch::updateOn( long step )
 	}
 }
 
+void BrickPatch::dump( ostream &out )
+{
+	checkpoint::put( out, isOn );
+}
+
+void BrickPatch::load( istream &in )
+{
+	checkpoint::get( in, isOn );
+}
+
 void BrickPatch::addBricks()
 {
 	for( int i = 0; i < brickCount; i++ )
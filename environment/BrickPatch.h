@@ -33,6 +33,9 @@ class BrickPatch : public Patch
 
 	void updateOn( long step );
 
+	void dump( ostream &out );
+	void load( istream &in );
+
  private:
 	void addBricks();
 	void removeBricks();
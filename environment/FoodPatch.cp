@@ -11,6 +11,7 @@
 
 // Local
 #include "agent.h"
+#include "Checkpoint.h"
 #include "globals.h"
 #include "graphics.h"
 #include "food.h"
@@ -131,6 +132,28 @@ food *FoodPatch::addFood( long step )
 	return NULL;
 }
 
+//-------------------------------------------------------------------------------------------
+// FoodPatch::dump
+//-------------------------------------------------------------------------------------------
+void FoodPatch::dump( ostream &out )
+{
+	checkpoint::put( out, foodCount );
+	checkpoint::put( out, foodGrown );
+
+	onCondition->dump( out );
+}
+
+//-------------------------------------------------------------------------------------------
+// FoodPatch::load
+//-------------------------------------------------------------------------------------------
+void FoodPatch::load( istream &in )
+{
+	checkpoint::get( in, foodCount );
+	checkpoint::get( in, foodGrown );
+
+	onCondition->load( in );
+}
+
 //===========================================================================
 // TimeOnCondition
 //===========================================================================
@@ -323,3 +346,13 @@ bool FoodPatch::MaxPopGroupOnCondition::turnedOff( long step )
 {
 	return state.end == step;
 }
+
+void FoodPatch::MaxPopGroupOnCondition::dump( ostream &out )
+{
+	checkpoint::put( out, state );
+}
+
+void FoodPatch::MaxPopGroupOnCondition::load( istream &in )
+{
+	checkpoint::get( in, state );
+}
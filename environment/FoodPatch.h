@@ -42,6 +42,9 @@ class FoodPatch : public Patch
 	bool initFoodGrown();
 	void initFoodGrown( bool setInitFoodGrown );
 
+	void dump( ostream &out );
+	void load( istream &in );
+
 	//===========================================================================
 	// OnCondition
 	//===========================================================================
@@ -52,6 +55,8 @@ class FoodPatch : public Patch
 		virtual void updateOn( long step ) = 0;
 		virtual bool on( long step ) = 0;
 		virtual bool turnedOff( long step ) = 0;
+		virtual void dump( ostream &out ) {}
+		virtual void load( istream &in ) {}
 	};
 
 	//===========================================================================
@@ -102,6 +107,8 @@ class FoodPatch : public Patch
 		virtual void updateOn( long step );
 		virtual bool on( long step );
 		virtual bool turnedOff( long step );
+		virtual void dump( ostream &out );
+		virtual void load( istream &in );
 
 	private:
 		// This is the data we're configured with.
@@ -0,0 +1,181 @@
+// PatchGrid.cp - spatial lookup of domains and food patches
+
+// Self
+#include "PatchGrid.h"
+
+// System
+#include <assert.h>
+
+// Local
+#include "FoodPatch.h"
+#include "Simulation.h"
+
+using namespace std;
+
+#define CellsPerSide 64
+
+//---------------------------------------------------------------------------
+// PatchGrid::PatchGrid
+//---------------------------------------------------------------------------
+PatchGrid::PatchGrid()
+{
+	built = false;
+	domains = NULL;
+}
+
+//---------------------------------------------------------------------------
+// PatchGrid::~PatchGrid
+//---------------------------------------------------------------------------
+PatchGrid::~PatchGrid()
+{
+}
+
+//---------------------------------------------------------------------------
+// PatchGrid::build
+//---------------------------------------------------------------------------
+void PatchGrid::build( int numDomains, Domain *domains, float worldsize )
+{
+	assert( worldsize > 0 );
+
+	this->domains = domains;
+
+	// The world runs over x = [0, worldsize] and z = [-worldsize, 0]
+	originX = 0.0;
+	originZ = -worldsize;
+	invCellSize = CellsPerSide / worldsize;
+
+	vector< vector<short> > cellDomainLists( CellsPerSide * CellsPerSide );
+	vector< vector<PatchEntry> > cellPatchLists( CellsPerSide * CellsPerSide );
+	int cx0, cz0, cx1, cz1;
+
+	for( short d = 0; d < numDomains; d++ )
+	{
+		Domain &dom = domains[d];
+
+		cellRange( dom.startX, dom.startZ, dom.endX, dom.endZ, &cx0, &cz0, &cx1, &cz1 );
+		for( int cz = cz0; cz <= cz1; cz++ )
+			for( int cx = cx0; cx <= cx1; cx++ )
+				cellDomainLists[cz * CellsPerSide + cx].push_back( d );
+
+		for( int i = 0; i < dom.numFoodPatches; i++ )
+		{
+			// An ellipse's neighborhood fits the same box as a rectangle's
+			FoodPatch *fp = &(dom.fFoodPatches[i]);
+			float range = fp->neighborhoodSize > 0.0 ? fp->neighborhoodSize : 0.0;
+			PatchEntry entry = { d, fp };
+
+			cellRange( fp->startX - range, fp->startZ - range, fp->endX + range, fp->endZ + range,
+					   &cx0, &cz0, &cx1, &cz1 );
+			for( int cz = cz0; cz <= cz1; cz++ )
+				for( int cx = cx0; cx <= cx1; cx++ )
+					cellPatchLists[cz * CellsPerSide + cx].push_back( entry );
+		}
+	}
+
+	// Flatten the lists, so a cell's candidates are contiguous
+	cellDomains.assign( 1, 0 );
+	cellPatches.assign( 1, 0 );
+	domainIndex.clear();
+	patchEntries.clear();
+
+	for( int cell = 0; cell < CellsPerSide * CellsPerSide; cell++ )
+	{
+		domainIndex.insert( domainIndex.end(), cellDomainLists[cell].begin(), cellDomainLists[cell].end() );
+		cellDomains.push_back( domainIndex.size() );
+
+		patchEntries.insert( patchEntries.end(), cellPatchLists[cell].begin(), cellPatchLists[cell].end() );
+		cellPatches.push_back( patchEntries.size() );
+	}
+
+	built = true;
+}
+
+//---------------------------------------------------------------------------
+// PatchGrid::whichDomain
+//---------------------------------------------------------------------------
+short PatchGrid::whichDomain( float x, float z )
+{
+	assert( built );
+
+	int cell = cellOf( x, z );
+
+	for( int i = cellDomains[cell]; i < cellDomains[cell + 1]; i++ )
+	{
+		Domain &dom = domains[domainIndex[i]];
+
+		if( (x >= dom.startX) && (x <= dom.endX) && (z >= dom.startZ) && (z <= dom.endZ) )
+			return domainIndex[i];
+	}
+
+	return -1;
+}
+
+//---------------------------------------------------------------------------
+// PatchGrid::whichFoodPatch
+//---------------------------------------------------------------------------
+FoodPatch *PatchGrid::whichFoodPatch( short domain, float x, float z )
+{
+	assert( built );
+
+	int cell = cellOf( x, z );
+
+	for( int i = cellPatches[cell]; i < cellPatches[cell + 1]; i++ )
+	{
+		PatchEntry &entry = patchEntries[i];
+
+		if( (entry.domain == domain) && entry.patch->pointIsInside( x, z, 0.0 ) )
+			return entry.patch;
+	}
+
+	return NULL;
+}
+
+//---------------------------------------------------------------------------
+// PatchGrid::countAgent
+//---------------------------------------------------------------------------
+void PatchGrid::countAgent( float x, float z )
+{
+	assert( built );
+
+	int cell = cellOf( x, z );
+
+	for( int i = cellPatches[cell]; i < cellPatches[cell + 1]; i++ )
+	{
+		FoodPatch *fp = patchEntries[i].patch;
+
+		fp->checkIfAgentIsInside( x, z );
+		fp->checkIfAgentIsInsideNeighborhood( x, z );
+	}
+}
+
+//---------------------------------------------------------------------------
+// PatchGrid::cellOf
+//
+// Clamps to the edge cells, and is monotonic in x and z, so a point inside
+// a box always lands in one of the cells cellRange() gives for the box.
+//---------------------------------------------------------------------------
+int PatchGrid::cellOf( float x, float z )
+{
+	int cx = int( (x - originX) * invCellSize );
+	int cz = int( (z - originZ) * invCellSize );
+
+	cx = cx < 0 ? 0 : (cx >= CellsPerSide ? CellsPerSide - 1 : cx);
+	cz = cz < 0 ? 0 : (cz >= CellsPerSide ? CellsPerSide - 1 : cz);
+
+	return cz * CellsPerSide + cx;
+}
+
+//---------------------------------------------------------------------------
+// PatchGrid::cellRange
+//---------------------------------------------------------------------------
+void PatchGrid::cellRange( float x0, float z0, float x1, float z1,
+						   int *cx0, int *cz0, int *cx1, int *cz1 )
+{
+	int lo = cellOf( x0, z0 );
+	int hi = cellOf( x1, z1 );
+
+	*cx0 = lo % CellsPerSide;
+	*cz0 = lo / CellsPerSide;
+	*cx1 = hi % CellsPerSide;
+	*cz1 = hi / CellsPerSide;
+}
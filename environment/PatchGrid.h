@@ -0,0 +1,68 @@
+//---------------------------------------------------------------------------
+//	File:		PatchGrid.h
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+// Forward declarations
+class Domain;
+class FoodPatch;
+
+//===========================================================================
+// PatchGrid
+//
+// Uniform grid over the world whose cells list the domains and food patches
+// (grown by their neighborhoods) that overlap them, so the patch or domain
+// under a point is found by testing only a cell's few candidates instead of
+// every patch in every domain. Candidates are kept in domain, then patch,
+// order, so each lookup finds the same patch the linear scans did.
+//
+// Patches and domains don't move once the worldfile is processed, so the
+// grid is built once, by build().
+//===========================================================================
+class PatchGrid
+{
+ public:
+	PatchGrid();
+	~PatchGrid();
+
+	void build( int numDomains, Domain *domains, float worldsize );
+
+	// Index of the first domain containing (x, z), or -1.
+	short whichDomain( float x, float z );
+
+	// First of the domain's food patches containing (x, z), or NULL; the
+	// same result as Domain::whichFoodPatch().
+	FoodPatch *whichFoodPatch( short domain, float x, float z );
+
+	// Does checkIfAgentIsInside() and checkIfAgentIsInsideNeighborhood() for
+	// every food patch that (x, z) could be in or near.
+	void countAgent( float x, float z );
+
+ private:
+	struct PatchEntry
+	{
+		short domain;
+		FoodPatch *patch;
+	};
+
+	int cellOf( float x, float z );
+	void cellRange( float x0, float z0, float x1, float z1,
+					int *cx0, int *cz0, int *cx1, int *cz1 );
+
+	bool built;
+	float originX;
+	float originZ;
+	float invCellSize;
+
+	Domain *domains;
+
+	// Each cell's candidates are [cellDomains[cell], cellDomains[cell+1])
+	// in domainIndex and likewise for patches.
+	std::vector<int> cellDomains;
+	std::vector<short> domainIndex;
+	std::vector<int> cellPatches;
+	std::vector<PatchEntry> patchEntries;
+};
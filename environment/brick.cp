@@ -17,6 +17,7 @@
 
 // Local
 #include "agent.h"
+#include "Checkpoint.h"
 #include "globals.h"
 #include "graphics.h"
 
@@ -62,12 +63,34 @@ brick::~brick()
 }
 
 
+//-------------------------------------------------------------------------------------------
+// brick::brickdump
+//-------------------------------------------------------------------------------------------
+void brick::brickdump( ostream& out )
+{
+	checkpoint::put( out, NumBricks );
+}
+
+
+//-------------------------------------------------------------------------------------------
+// brick::brickload
+//-------------------------------------------------------------------------------------------
+void brick::brickload( istream& in )
+{
+	checkpoint::get( in, NumBricks );
+}
+
+
 //-------------------------------------------------------------------------------------------
 // brick::dump
 //-------------------------------------------------------------------------------------------
 void brick::dump( ostream& out )
 {
-    out << fPosition[0] sp fPosition[1] sp fPosition[2] nl;
+	unsigned long number = getTypeNumber();
+
+	checkpoint::put( out, number );
+
+	gobject::dump( out );
 }
 
 
@@ -76,12 +99,12 @@ void brick::dump( ostream& out )
 //-------------------------------------------------------------------------------------------
 void brick::load(istream& in)
 {
-	float x, y, z;
-	
-    in >> x >> y >> z;
-	
-	assert( false ); // need to store color
-    //initBrick( x, y, z );
+	unsigned long number;
+
+	checkpoint::get( in, number );
+	setTypeNumber( number );
+
+	gobject::load( in );
 }
 
 
@@ -29,6 +29,8 @@ class brick : public gboxf
 	static float gCarryBrick2Energy;
 
 	static long GetNumBricks();
+	static void brickdump(ostream& out);
+	static void brickload(istream& in);
 
 	BrickPatch* myBrickPatch;
 	
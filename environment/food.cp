@@ -17,6 +17,7 @@
 
 // Local
 #include "agent.h"
+#include "Checkpoint.h"
 #include "globals.h"
 #include "graphics.h"
 
@@ -79,13 +80,40 @@ food::~food()
 }
 
 
+//-------------------------------------------------------------------------------------------
+// food::fooddump
+//-------------------------------------------------------------------------------------------
+void food::fooddump(ostream& out)
+{
+	checkpoint::put( out, fFoodEver );
+}
+
+
+//-------------------------------------------------------------------------------------------
+// food::foodload
+//-------------------------------------------------------------------------------------------
+void food::foodload(istream& in)
+{
+	checkpoint::get( in, fFoodEver );
+}
+
+
 //-------------------------------------------------------------------------------------------
 // food::dump
+//
+// The food type and patch are written by the caller, which needs them to
+// construct the food before it can be loaded.
 //-------------------------------------------------------------------------------------------
 void food::dump(ostream& out)
 {
-    assert(false); //out << fEnergy nl;
-    out << fPosition[0] sp fPosition[1] sp fPosition[2] nl;
+	unsigned long number = getTypeNumber();
+
+	checkpoint::put( out, number );
+	checkpoint::put( out, fCreationStep );
+	checkpoint::put( out, fEnergy );
+	checkpoint::put( out, fDomain );
+
+	gobject::dump( out );
 }
 
 
@@ -94,10 +122,17 @@ void food::dump(ostream& out)
 //-------------------------------------------------------------------------------------------
 void food::load(istream& in)
 {
-    assert(false); //in >> fEnergy;
-    in >> fPosition[0] >> fPosition[1] >> fPosition[2];
+	unsigned long number;
 
+	checkpoint::get( in, number );
+	checkpoint::get( in, fCreationStep );
+	checkpoint::get( in, fEnergy );
+	checkpoint::get( in, fDomain );
+
+	setTypeNumber( number );
     initlen();
+
+	gobject::load( in );
 }
 
 
@@ -44,6 +44,9 @@ public:
 	typedef list<food *> FoodList;
 	static FoodList gAllFood;
 
+	static void fooddump(ostream& out);
+	static void foodload(istream& in);
+
     food( const FoodType *foodType, long step );
     food( const FoodType *foodType, long step, const Energy &e );
     food( const FoodType *foodType, long step, const Energy &e, float x, float z);
@@ -59,6 +62,8 @@ public:
 	const Energy &getEnergy();
 	const EnergyPolarity &getEnergyPolarity();
 
+	const FoodType *getFoodType();
+
 	void setPatch(FoodPatch* fp);
 	FoodPatch* getPatch();
 
@@ -95,6 +100,7 @@ protected:
 //===========================================================================
 inline const Energy &food::getEnergy() { return fEnergy; }
 inline const EnergyPolarity &food::getEnergyPolarity() { return foodType->energyPolarity; }
+inline const FoodType *food::getFoodType() { return foodType; }
 inline void food::setPatch(FoodPatch* fp) { patch=fp; }
 inline FoodPatch* food::getPatch() { return patch; }
 inline short food::domain() { return fDomain; }
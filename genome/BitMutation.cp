@@ -0,0 +1,78 @@
+#include "BitMutation.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "RandomNumberGenerator.h"
+
+//---------------------------------------------------------------------------
+// genome::mutateBits
+//---------------------------------------------------------------------------
+void genome::mutateBits( unsigned char *data,
+						 long nbits,
+						 double rate,
+						 RandomNumberGenerator *rng )
+{
+	if( rate <= 0.0 )
+		return;
+
+	if( rate >= 1.0 )
+	{
+		for( long byte = 0; byte < (nbits >> 3); byte++ )
+			data[byte] ^= 0xff;
+		for( long bit = nbits & ~7L; bit < nbits; bit++ )
+			data[bit >> 3] ^= (unsigned char)(0x80 >> (bit & 7));
+		return;
+	}
+
+	// P(skip >= k) = (1 - rate)^k, the chance of k bits in a row not flipping.
+	double scale = 1.0 / log1p( -rate );
+
+	for( long bit = -1; ; )
+	{
+		double skip = floor( log(1.0 - rng->drand()) * scale );
+		if( skip >= double(nbits - bit - 1) )
+			break;
+
+		bit += long(skip) + 1;
+		data[bit >> 3] ^= (unsigned char)(0x80 >> (bit & 7));
+	}
+}
+
+//---------------------------------------------------------------------------
+// genome::copyBits
+//---------------------------------------------------------------------------
+void genome::copyBits( unsigned char *dst,
+					   const unsigned char *src,
+					   long begbit,
+					   long endbit )
+{
+	if( begbit >= endbit )
+		return;
+
+	long begbyte = begbit >> 3;
+	long endbyte = endbit >> 3;
+	unsigned char headmask = (unsigned char)(0xff >> (begbit & 7));
+	unsigned char tailmask = (unsigned char)(0xff << (8 - (endbit & 7)));
+
+#define BLEND(BYTE, MASK) dst[BYTE] = (unsigned char)((dst[BYTE] & ~(MASK)) | (src[BYTE] & (MASK)))
+
+	if( begbyte == endbyte )
+	{
+		BLEND( begbyte, headmask & tailmask );
+		return;
+	}
+
+	if( begbit & 7 )
+	{
+		BLEND( begbyte, headmask );
+		begbyte++;
+	}
+
+	memcpy( dst + begbyte, src + begbyte, endbyte - begbyte );
+
+	if( endbit & 7 )
+		BLEND( endbyte, tailmask );
+
+#undef BLEND
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+class RandomNumberGenerator;
+
+//===========================================================================
+// Bit kernels for genome crossover and mutation
+//
+// Bits are numbered from the most significant bit of byte 0, which is the
+// order crossover points and mutations have always used.
+//===========================================================================
+namespace genome
+{
+	// Flips each of the first nbits bits independently with probability
+	// rate. Rather than drawing a number per bit, draws the geometrically
+	// distributed gap to the next flip, so the cost is proportional to the
+	// number of flips.
+	void mutateBits( unsigned char *data,
+					 long nbits,
+					 double rate,
+					 RandomNumberGenerator *rng );
+
+	// Copies bits [begbit, endbit) of src to dst, leaving the rest of dst
+	// alone. Whole bytes are copied with memcpy; only the partial bytes at
+	// either end are masked.
+	void copyBits( unsigned char *dst,
+				   const unsigned char *src,
+				   long begbit,
+				   long endbit );
+}
@@ -5,18 +5,14 @@
 #include <string.h>
 
 #include "AbstractFile.h"
+#include "BitMutation.h"
+#include "Checkpoint.h"
 #include "GenomeLayout.h"
 #include "misc.h"
+#include "RandomNumberGenerator.h"
 
-
-#ifdef __ALTIVEC__
-	// Turn pw_UseAltivec on to use ALTIVEC if it's available
-	#define pw_UseAltivec false
-#endif
-
-#if pw_UseAltivec
-	// veclib
-	#include <vecLib/vBLAS.h>
+#if defined(__SSE2__)
+	#include <emmintrin.h>
 #endif
 
 using namespace genome;
@@ -57,11 +53,15 @@ Genome::Genome( GenomeSchema *schema,
 	nbytes = schema->getMutableSize();
 
 	alloc();
+
+	rng = RandomNumberGenerator::create( RandomNumberGenerator::GENOME );
 }
 
 Genome::~Genome()
 {
 	delete [] mutable_data ;
+
+	RandomNumberGenerator::dispose( rng );
 }
 
 Gene *Genome::gene( const char *name )
@@ -102,37 +102,6 @@ unsigned int Genome::get_raw_uint( long byte )
 	return (unsigned int)get_raw( byte );
 }
 
-void Genome::updateSum( unsigned long *sum, unsigned long *sum2 )
-{
-	// This function is more verbose than necessary because we're optimizing
-	// for speed. This loop is run *a lot*. So, we move the if(gray) outside
-	// the loop and implement the get_raw() logic in here.
-	if( gray )
-	{
-		for( int i = 0; i < nbytes; i++ )
-		{
-			int layoutOffset = layout->getMutableDataOffset_nocheck( i );
-			unsigned long raw = (unsigned long)mutable_data[layoutOffset];
-
-			raw = binofgray[raw];
-
-			sum[i] += raw;
-			sum2[i] += raw * raw;
-		}
-	}
-	else
-	{
-		for( int i = 0; i < nbytes; i++ )
-		{
-			int layoutOffset = layout->getMutableDataOffset_nocheck( i );
-			unsigned long raw = (unsigned long)mutable_data[layoutOffset];
-
-			sum[i] += raw;
-			sum2[i] += raw * raw;
-		}
-	}
-}
-
 int Genome::getGroupCount( NeurGroupType type )
 {
 	if( (type == NGT_INPUT) || (type == NGT_OUTPUT) )
@@ -307,6 +276,11 @@ void Genome::seed( Gene *gene,
 								  SEEDVAL(rawval_ratio) );
 }
 
+RandomNumberGenerator *Genome::getRNG()
+{
+	return rng;
+}
+
 void Genome::randomize( float bitonprob )
 {
 	// do a random initialization of the bitstring
@@ -314,7 +288,7 @@ void Genome::randomize( float bitonprob )
     {
         for (long bit = 0; bit < 8; bit++)
         {
-            if (randpw() < bitonprob)
+            if (rng->drand() < bitonprob)
                 mutable_data[byte] |= char(1 << (7-bit));
             else
                 mutable_data[byte] &= char(255 ^ (1 << (7-bit)));
@@ -324,21 +298,12 @@ void Genome::randomize( float bitonprob )
 
 void Genome::randomize()
 {
-	randomize( gene("BitProbability")->to_ImmutableInterpolated()->interpolate(randpw()) );
+	randomize( gene("BitProbability")->to_ImmutableInterpolated()->interpolate(rng->drand()) );
 }
 
 void Genome::mutate()
 {
-	float rate = get( "MutationRate" );
-
-    for (long byte = 0; byte < nbytes; byte++)
-    {
-        for (long bit = 0; bit < 8; bit++)
-        {
-            if (randpw() < rate)
-                mutable_data[byte] ^= char(1 << (7-bit));
-        }
-    }
+	mutateBits( mutable_data, nbytes * 8, get("MutationRate"), rng );
 }
 
 void Genome::crossover( Genome *g1, Genome *g2, bool mutate )
@@ -349,18 +314,18 @@ void Genome::crossover( Genome *g1, Genome *g2, bool mutate )
 	
     // Randomly select number of crossover points from chosen genome
     long numCrossPoints;
-    if (randpw() < 0.5)
+    if (rng->drand() < 0.5)
         numCrossPoints = g1->get( "CrossoverPointCount" );
     else
 		numCrossPoints = g2->get( "CrossoverPointCount" );
     
 	// allocate crossover buffer on stack -- fast & automatically free'd
-	long *crossoverPoints = (long *)alloca( numCrossPoints * sizeof(long) );
+	long *crossoverPoints = (long *)alloca( (numCrossPoints + 1) * sizeof(long) );
 
 	long numphysbytes = schema->getPhysicalCount();
 
     // guarantee crossover in "physiology" genes
-    crossoverPoints[0] = long(randpw() * numphysbytes * 8 - 1);
+    crossoverPoints[0] = long(rng->drand() * numphysbytes * 8 - 1);
     crossoverPoints[1] = numphysbytes * 8;
 
 	// Sanity checking
@@ -372,7 +337,7 @@ void Genome::crossover( Genome *g1, Genome *g2, bool mutate )
     
     for (i = 2; i <= numCrossPoints; i++) 
     {
-        long newCrossPoint = long(randpw() * (nbytes - numphysbytes) * 8 - 1) + crossoverPoints[1];
+        long newCrossPoint = long(rng->drand() * (nbytes - numphysbytes) * 8 - 1) + crossoverPoints[1];
         bool equal;
         do
         {
@@ -384,7 +349,7 @@ void Genome::crossover( Genome *g1, Genome *g2, bool mutate )
             }
             
             if (equal)
-                newCrossPoint = long(randpw() * (nbytes - numphysbytes) * 8 - 1) + crossoverPoints[1];
+                newCrossPoint = long(rng->drand() * (nbytes - numphysbytes) * 8 - 1) + crossoverPoints[1];
                 
         } while (equal);
         
@@ -420,98 +385,40 @@ void Genome::crossover( Genome *g1, Genome *g2, bool mutate )
 	float mrate = 0.0;
     if (mutate)
     {
-        if (randpw() < 0.5)
+        if (rng->drand() < 0.5)
             mrate = g1->get( "MutationRate" );
         else
             mrate = g2->get( "MutationRate" );
     }
     
-    long begbyte = 0;
-    long endbyte = -1;
-    long bit;
-    bool first = (randpw() < 0.5);
-    const Genome* g;
-    
-	// now do crossover using the ordered pts
+    bool first = (rng->drand() < 0.5);
+    long nbits = nbytes * 8;
+    long begbit = 0;
+
+	// now do crossover using the ordered pts: bits before a point come from
+	// one genome and the point itself starts the stretch from the other
     for (i = 0; i <= numCrossPoints + 1; i++)
     {
-		// for copying the end of the genome
-        if (i == numCrossPoints + 1)
-        {
-            if (endbyte == nbytes - 1)
-            {
-            	// already copied last byte (done) so just get out of the loop
-                break;
-			}             
-                
-            endbyte = nbytes - 1;
-        }
-        else
-        {
-            endbyte = crossoverPoints[i] >> 3;
-		}
-        g = first ? g1 : g2;
-        
+        long endbit = (i == numCrossPoints + 1) ? nbits : crossoverPoints[i];
+        if (endbit > nbits)
+            endbit = nbits;
+        if (endbit < begbit)
+            endbit = begbit;
+
 #ifdef DUMPBITS    
-        cout << "**copying bytes " << begbyte << " to " << endbyte
-             << " from the ";
-        if (first)
-            cout << "first genome" nl;
-        else
-            cout << "second genome" nl;
+        cout << "**copying bits " << begbit << " to " << endbit
+             << " from the " << (first ? "first" : "second") << " genome" nl;
         cout.flush();
 #endif
 
-        if (mutate)
-        {
-            for (j = begbyte; j < endbyte; j++)
-            {
-                mutable_data[j] = g->mutable_data[j];    // copy from the appropriate genome
-                for (bit = 0; bit < 8; bit++)
-                {
-                    if (randpw() < mrate)
-                        mutable_data[j] ^= char(1 << (7-bit));	// this goes left to right, corresponding more directly to little-endian machines, but leave it alone (at least for now)
-                }
-            }
-        }
-        else
-        {
-            for (j = begbyte; j < endbyte; j++)
-                mutable_data[j] = g->mutable_data[j];    // copy from the appropriate genome
-        }
-        
-        if (i != (numCrossPoints + 1))  // except on the last stretch...
-        {
-            first = !first;
-            bit = crossoverPoints[i] - (endbyte << 3);
-            
-            if (first)
-            {	// this goes left to right, corresponding more directly to little-endian machines, but leave it alone (at least for now)
-                mutable_data[endbyte] = char((g2->mutable_data[endbyte] & (255 << (8 - bit)))
-                   					 | (g1->mutable_data[endbyte] & (255 >> bit)));
-			}                  
-            else
-            {	// this goes left to right, corresponding more directly to little-endian machines, but leave it alone (at least for now)
-                mutable_data[endbyte] = char((g1->mutable_data[endbyte] & (255 << (8 - bit)))
-                   					 | (g2->mutable_data[endbyte] & (255 >> bit)));
-			}
-						              
-            begbyte = endbyte + 1;
-        }
-        else
-        {
-            mutable_data[endbyte] = g->mutable_data[endbyte];
-		}
-		            
-        if (mutate)
-        {
-            for (bit = 0; bit < 8; bit++)
-            {
-                if (randpw() < mrate)
-                    mutable_data[endbyte] ^= char(1 << (7 - bit));	// this goes left to right, corresponding more directly to little-endian machines, but leave it alone (at least for now)
-            }
-        }
+        copyBits( mutable_data, (first ? g1 : g2)->mutable_data, begbit, endbit );
+
+        begbit = endbit;
+        first = !first;
     }
+
+    if (mutate)
+        mutateBits( mutable_data, nbits, mrate, rng );
 }
 
 void Genome::copyFrom( Genome *g )
@@ -521,133 +428,140 @@ void Genome::copyFrom( Genome *g )
 	memcpy( mutable_data, g->mutable_data, nbytes );
 }
 
-float Genome::separation( Genome *g )
+#if defined(__SSE2__)
+//---------------------------------------------------------------------------
+// graydecode
+//
+// Gray-to-binary decode of 16 bytes at once; same result as binofgray[].
+// SSE2 has no 8-bit shifts, so shift 16-bit lanes and mask off the bits
+// that crossed in from the neighboring byte.
+//---------------------------------------------------------------------------
+static inline __m128i graydecode( __m128i g )
 {
-	assert( schema == g->schema );
+	g = _mm_xor_si128( g, _mm_and_si128(_mm_srli_epi16(g, 1), _mm_set1_epi8(0x7f)) );
+	g = _mm_xor_si128( g, _mm_and_si128(_mm_srli_epi16(g, 2), _mm_set1_epi8(0x3f)) );
+	g = _mm_xor_si128( g, _mm_and_si128(_mm_srli_epi16(g, 4), _mm_set1_epi8(0x0f)) );
 
-#if pw_UseAltivec
-	#warning compiling with (broken) ALTIVEC code
-#else
-	int sep = 0;
+	return g;
+}
 #endif
-	float fsep = 0.f;
-    unsigned char* gi = mutable_data;
-    unsigned char* gj = g->mutable_data;
-    
-    if( gray )
-    {
-#if pw_UseAltivec
-		float val_gi[ nbytes ];
-		float val_gj[ nbytes ];
-		short size = 4;
 
-                long max = nbytes / size;
-                long left = nbytes - (max * size);
+#if defined(__SSE2__) && defined(__LP64__)
+//---------------------------------------------------------------------------
+// addsum8
+//
+// Adds (or subtracts) eight 16-bit lanes to sum[0..7], widening to 64 bits.
+//---------------------------------------------------------------------------
+static inline void addsum8( unsigned long *sum, __m128i w, bool subtract )
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i w32[2] = { _mm_unpacklo_epi16(w, zero), _mm_unpackhi_epi16(w, zero) };
 
-		float result[ max * size ];
+	for( int j = 0; j < 2; j++ )
+	{
+		__m128i w64[2] = { _mm_unpacklo_epi32(w32[j], zero), _mm_unpackhi_epi32(w32[j], zero) };
 
-		for (long i = 0; i < nbytes; i++)
+		for( int k = 0; k < 2; k++ )
 		{
-			val_gi[i] = binofgray[gi[i]];
-			val_gj[i] = binofgray[gj[i]];
+			__m128i *s = (__m128i *)(sum + 4*j + 2*k);
+			__m128i v = _mm_loadu_si128( s );
+			v = subtract ? _mm_sub_epi64( v, w64[k] ) : _mm_add_epi64( v, w64[k] );
+			_mm_storeu_si128( s, v );
 		}
-		
+	}
+}
+#endif
 
-		for (long i = 0; i < max; i++)
-		{
-			vector float vGi = vec_ld(size, val_gi + size * i);
-			vector float vGj = vec_ld(size, val_gj + size * i);
-			
-			vector float diff = vec_sub(vGi, vGj);
-			
-			vec_st(diff, size, result + i * size);
-			
-		}
-		
-		fsep = cblas_sasum(size * max, result, 1);
-		vector float vGi = vec_ld(left, val_gi + size * max);
-		vector float vGj = vec_ld(left, val_gj + size * max);
-		
-		vector float diff = vec_sub(vGi, vGj);
-		vector float absdiff = vec_abs(diff);
-		
-		vec_st(absdiff, left, result);
-		
-		for (long j = 0; j < left ;  j++)
-		{
-			fsep += result[j];
-		}
-#else
-    for (long i = 0; i < nbytes; i++)
-        {
-            short vi, vj;
-            vi = binofgray[ * (gi++)];
-            vj = binofgray[ * (gj++)];
-            sep += abs(vi - vj);
-        }
+//---------------------------------------------------------------------------
+// Genome::updateRawSum
+//
+// Adds the decoded value of each byte, and its square, to sum[] and sum2[],
+// or takes them away if subtract.  The sums are indexed in storage order
+// rather than gene order, which needs no layout lookups and so goes 16 bytes
+// at a time; use GenomeLayout::getMutableDataOffset() to read them by gene.
+//---------------------------------------------------------------------------
+void Genome::updateRawSum( unsigned long *sum, unsigned long *sum2, bool subtract )
+{
+	long i = 0;
+
+#if defined(__SSE2__) && defined(__LP64__)
+	const __m128i zero = _mm_setzero_si128();
+
+	for( ; i + 16 <= nbytes; i += 16 )
+	{
+		__m128i v = _mm_loadu_si128( (const __m128i *)(mutable_data + i) );
+		if( gray )
+			v = graydecode( v );
+
+		__m128i lo = _mm_unpacklo_epi8( v, zero );
+		__m128i hi = _mm_unpackhi_epi8( v, zero );
+
+		addsum8( sum + i, lo, subtract );
+		addsum8( sum + i + 8, hi, subtract );
+		addsum8( sum2 + i, _mm_mullo_epi16(lo, lo), subtract );	// 255^2 still fits in 16 bits
+		addsum8( sum2 + i + 8, _mm_mullo_epi16(hi, hi), subtract );
+	}
 #endif
-    }
-    else
-    {
-#if pw_UseAltivec
-		float val_gi[ nbytes ];
-		float val_gj[ nbytes ];
-		short size = 4;
-		
-		long max = nbytes / size;
-		long left = nbytes - (max * size);
-		
-		float result[ max * size ];
-		
-		for (long i = 0; i < nbytes; i++)
+
+	for( ; i < nbytes; i++ )
+	{
+		unsigned long raw = gray ? binofgray[mutable_data[i]] : mutable_data[i];
+
+		if( subtract )
 		{
-			val_gi[i] = gi[i];
-			val_gj[i] = gj[i];
+			sum[i] -= raw;
+			sum2[i] -= raw * raw;
 		}
-		
-		
-		for (long i = 0; i < max; i++)
+		else
 		{
-			vector float vGi = vec_ld(size, val_gi + size * i);
-			vector float vGj = vec_ld(size, val_gj + size * i);
-			
-			vector float diff = vec_sub(vGi, vGj);
-			
-			vec_st(diff, size, result + i * size);
-			
+			sum[i] += raw;
+			sum2[i] += raw * raw;
 		}
-		
-		fsep = cblas_sasum(size * max, result, 1);
-		vector float vGi = vec_ld(left, val_gi + size * max);
-		vector float vGj = vec_ld(left, val_gj + size * max);
-		
-		vector float diff = vec_sub(vGi, vGj);
-		vector float absdiff = vec_abs(diff);
-		
-		vec_st(absdiff, left, result);
-		
-		for (long j = 0; j < left ;  j++)
+	}
+}
+
+float Genome::separation( Genome *g )
+{
+	assert( schema == g->schema );
+
+	const unsigned char *gi = mutable_data;
+	const unsigned char *gj = g->mutable_data;
+	long sep = 0;
+	long i = 0;
+
+#if defined(__SSE2__)
+	// sum of absolute differences, 16 bytes per iteration
+	__m128i vsep = _mm_setzero_si128();
+
+	for( ; i + 16 <= nbytes; i += 16 )
+	{
+		__m128i vi = _mm_loadu_si128( (const __m128i *)(gi + i) );
+		__m128i vj = _mm_loadu_si128( (const __m128i *)(gj + i) );
+
+		if( gray )
 		{
-			fsep += result[j];
+			vi = graydecode( vi );
+			vj = graydecode( vj );
 		}
-#else
-        for (long i = 0; i < nbytes; i++)
-        {
-            short vi, vj;
-            vi = * (gi++);
-            vj = * (gj++);
-            sep += abs(vi - vj);
-        }
-#endif
-    }
-#if pw_UseAltivec
-    fsep /= (255.0f * float(nbytes));
-    return fsep;
-#else
-	fsep = float(sep) / (255 * nbytes);
-    return fsep;
+
+		vsep = _mm_add_epi64( vsep, _mm_sad_epu8(vi, vj) );
+	}
+
+	sep = _mm_cvtsi128_si32( vsep ) + _mm_cvtsi128_si32( _mm_srli_si128(vsep, 8) );
 #endif
-	
+
+	if( gray )
+	{
+		for( ; i < nbytes; i++ )
+			sep += abs( binofgray[gi[i]] - binofgray[gj[i]] );
+	}
+	else
+	{
+		for( ; i < nbytes; i++ )
+			sep += abs( gi[i] - gj[i] );
+	}
+
+	return float(sep) / (255 * nbytes);
 }
 
 float Genome::mateProbability( Genome *g )
@@ -701,6 +615,16 @@ void Genome::load( AbstractFile *in )
 	}
 }
 
+void Genome::dump( ostream &out )
+{
+	checkpoint::putArray( out, mutable_data, nbytes );
+}
+
+void Genome::load( istream &in )
+{
+	checkpoint::getArray( in, mutable_data, nbytes );
+}
+
 void Genome::print()
 {
 	long lobit = 0;
@@ -10,6 +10,7 @@
 
 // forward decl
 class AbstractFile;
+class RandomNumberGenerator;
 
 namespace genome
 {
@@ -56,7 +57,7 @@ namespace genome
 					int to );
 
 		unsigned int get_raw_uint( long byte );
-		void updateSum( unsigned long *sum, unsigned long *sum2 );
+		void updateRawSum( unsigned long *sum, unsigned long *sum2, bool subtract = false );
 
 		int getGroupCount( NeurGroupType type );
 		int getNeuronCount( NeuronType type,
@@ -85,6 +86,9 @@ namespace genome
 				   Gene *to,
 				   float rawval_ratio );
 
+		// Randomization, mutation and crossover draw from this generator.
+		RandomNumberGenerator *getRNG();
+
 		void randomize( float bitonprob );
 		void randomize();
 
@@ -98,6 +102,8 @@ namespace genome
 
 		void dump( AbstractFile *out );
 		void load( AbstractFile *in );
+		void dump( std::ostream &out );
+		void load( std::istream &in );
 
 		void print();
 		void print( long lobit, long hibit );
@@ -123,6 +129,7 @@ namespace genome
 		unsigned char *mutable_data;
 		int nbytes;
 		bool gray;
+		RandomNumberGenerator *rng;
 	};
 
 
@@ -8,6 +8,7 @@
 #include "GenomeLayout.h"
 #include "globals.h"
 #include "Metabolism.h"
+#include "RandomNumberGenerator.h"
 
 using namespace genome;
 
@@ -344,7 +345,7 @@ void GenomeUtil::seed( Genome *g )
 
 	if( Metabolism::getNumberOfDefinitions() > 1 )
 	{
-		SEED( MetabolismIndex, randpw() );
+		SEED( MetabolismIndex, g->getRNG()->drand() );
 	}
 
 	SEED( Red, 0.5 );
@@ -9,6 +9,7 @@
 #include "gcamera.h"
 
 // System
+#include <assert.h>
 #include <gl.h>
 #include <glu.h>
 #include <iostream>
@@ -17,6 +18,7 @@
 // Local
 #include "misc.h"
 #include "graphics.h"
+#include "gretina.h"
 
 using namespace std;
 
@@ -64,7 +66,11 @@ gcamera::gcamera()
 		fFollowObject(NULL),
 		fPerspectiveFixed(false),
 		fPerspectiveInUse(false),
-		glFogOn(false)				// this will be turned on for cameras attached to agents at the SetGraphics() function
+		glFogOn(false),				// this will be turned on for cameras attached to agents at the SetGraphics() function
+		sFogFunction('O'),
+		fExpFogDensity(0.0),
+		fLinearFogStart(0.0),
+		iLinearFogEnd(0)
 {
 	fPosition[0] = 0.0;
     fPosition[1] = 0.0;
@@ -294,6 +300,37 @@ void gcamera::Use()
 }
 
 
+//---------------------------------------------------------------------------
+// gcamera::Use
+//
+// Software equivalent of UsePerspective() and Use(), including the fog
+// settings, for rendering into a gretina.
+//---------------------------------------------------------------------------      
+void gcamera::Use(gretina& r)
+{
+	assert( !fUsingLookAt );
+
+	r.SetCamera(this);
+	r.Perspective(fFOV, fAspect, fNear, fFar);
+
+	if (glFogOn)
+		r.Fog(sFogFunction, fExpFogDensity, fLinearFogStart, iLinearFogEnd);
+	else
+		r.Fog('O', 0.0, 0.0, 1.0);
+
+	r.LoadIdentity();
+
+	r.Rotate(-fAngle[2], 0.0, 0.0, 1.0); // roll  (z)
+	r.Rotate(-fAngle[1], 1.0, 0.0, 0.0); // pitch (x)
+	r.Rotate(-fAngle[0], 0.0, 1.0, 0.0); // yaw   (y)
+			
+	r.Translate(-fPosition[0], -fPosition[1], -fPosition[2]);
+    
+	if (fFollowObject != NULL)
+		fFollowObject->inverseposition(r);
+}
+
+
 //---------------------------------------------------------------------------
 // gcamera::print
 //---------------------------------------------------------------------------      
@@ -330,6 +367,13 @@ void gcamera::print()
 //---------------------------------------------------------------------------    
 void gcamera::SetFog( bool fog, char function, float density, int end )
 {
+	// remembered for Use(gretina&)
+	glFogOn = fog;
+	sFogFunction = function;
+	fExpFogDensity = density;
+	fLinearFogStart = fNear;
+	iLinearFogEnd = end;
+
 	if( fog )			
 	{
 		glEnable(GL_FOG);				// turn on Fog to give the agents depth perception
@@ -11,6 +11,9 @@
 // Local
 #include "gsquare.h"
 
+// Forward declarations
+class gretina;
+
 
 //===========================================================================
 // gcamera
@@ -30,6 +33,7 @@ public:
 	void SetFog( bool fog, char function, float density, int end );
 
 	void Use();
+	void Use(gretina& r);
     virtual void print();
     
 	void AttachTo(gobject* gobj);
@@ -61,6 +65,7 @@ private:
 
 	char sFogFunction;
 	float fExpFogDensity;
+	float fLinearFogStart;
 	int   iLinearFogEnd;
 	
 };
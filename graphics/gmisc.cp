@@ -19,6 +19,7 @@
 #include "globals.h"
 #include "gobject.h"
 #include "graphics.h"
+#include "gretina.h"
 #include "misc.h"
 
 // Self
@@ -133,6 +134,46 @@ void TGraphicObjectList::Draw(const frustumXZ& fxz)
 }
 
 
+//-------------------------------------------------------------------------------------------
+// TGraphicObjectList::Draw
+//
+// Software rendering; the camera to skip comes from the gretina rather than
+// fCurrentCamera, so that several agents may be rendered at once.
+//-------------------------------------------------------------------------------------------
+void TGraphicObjectList::Draw(gretina& r)
+{
+	TGraphicObjectList::const_iterator iter = begin();
+	for (; iter != end(); ++iter)
+	{
+		gobject* obj = *iter;
+		Q_CHECK_PTR(obj);
+				
+		if (obj != (gobject*)r.GetCamera())
+        	obj->softdraw(r);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------
+// TGraphicObjectList::Draw
+//-------------------------------------------------------------------------------------------
+void TGraphicObjectList::Draw(gretina& r, const frustumXZ& fxz)
+{
+	TGraphicObjectList::const_iterator iter = begin();
+	for (; iter != end(); ++iter)
+	{
+		gobject* obj = *iter;
+		Q_CHECK_PTR(obj);
+				
+		if (obj != (gobject*)r.GetCamera())
+		{
+            if( fxz.Inside( obj->getposptr() ) )//object position inside frustum?
+                obj->softdraw(r);
+		}
+	}
+}
+
+
 //-------------------------------------------------------------------------------------------
 // TGraphicObjectList::Print
 //-------------------------------------------------------------------------------------------
@@ -274,6 +315,32 @@ void drawunitcube()
 }
 
 
+//-------------------------------------------------------------------------------------------
+// drawunitcube
+//-------------------------------------------------------------------------------------------
+void drawunitcube(gretina& r)
+{
+	static const int faces[6][4] = { {0, 1, 3, 2},
+									 {0, 4, 5, 1},
+									 {4, 6, 7, 5},
+									 {2, 3, 7, 6},
+									 {5, 7, 3, 1},
+									 {0, 2, 6, 4} };	// same order as drawunitcube()
+
+	for (int i = 0; i < 6; i++)
+	{
+		float face[4][3];
+		for (int j = 0; j < 4; j++)
+		{
+			face[j][0] = ucube[faces[i][j]][0];
+			face[j][1] = ucube[faces[i][j]][1];
+			face[j][2] = ucube[faces[i][j]][2];
+		}
+		r.Polygon(4, &face[0][0]);
+	}
+}
+
+
 //-------------------------------------------------------------------------------------------
 // frameunitcube
 //-------------------------------------------------------------------------------------------
@@ -337,9 +404,6 @@ void frustumXZ::Set(float x, float z, float ang, float fov, float rad)
 }
 
 
-static long infrustum = 0;
-static long outfrustum = 0;
-
 int frustumXZ::Inside(float* p) const
 {
     float ang = atan2(x0 - p[0], z0 - p[2]);
@@ -350,17 +414,14 @@ int frustumXZ::Inside(float* p) const
     {
         if (ang < angmin)
         {
-            outfrustum++;
             return 0;
         }
         else if (ang > angmax)
         {
-            outfrustum++;
             return 0;
         }
         else
         {
-            infrustum++;
             return 1;
         }
     }
@@ -368,17 +429,14 @@ int frustumXZ::Inside(float* p) const
     {
         if (ang > angmin)
         {
-            infrustum++;
             return 1;
         }
         else if (ang < angmax)
         {
-            infrustum++;
             return 1;
         }
         else
         {
-            outfrustum++;
             return 0;
         }
     }
@@ -19,8 +19,10 @@
 class gcamera;
 class glight;
 class gobject;
+class gretina;
 
 void drawunitcube();
+void drawunitcube(gretina& r);
 void frameunitcube();
 
 
@@ -63,6 +65,8 @@ public:
 
     virtual void Draw();
     virtual void Draw(const frustumXZ& fxz);
+    void Draw(gretina& r);
+    void Draw(gretina& r, const frustumXZ& fxz);
     
     void Print();
                 
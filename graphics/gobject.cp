@@ -8,8 +8,10 @@
 #include <stdlib.h>
 
 // Local
+#include "Checkpoint.h"
 #include "globals.h"
 #include "gmisc.h"
+#include "gretina.h"
 #include "misc.h"
 
 using namespace std;
@@ -49,6 +51,9 @@ void gobject::init()
 	fColor[2] = rand() / 32767.0;
 	fColor[3] = 0.;
 	listLink = NULL;
+	gridCell = -1;
+	gridSlot = -1;
+	xMoved = false;
 	fCarriedBy = NULL;
 	fTypeNumber = 0;
 	fCarryOffset[0] = 0.0;
@@ -57,33 +62,28 @@ void gobject::init()
 }
  
     
+// Carry relationships are object pointers, so they are left to the caller.
 void gobject::dump(ostream& out)
 {
-    if (fName)
-        out << fName nl;
-    else
-        out << "NULL" nl;
-    out << fPosition[0] sp fPosition[1] sp fPosition[2] nl;
-    out << fAngle[0] sp fAngle[1] sp fAngle[2] nl;
-    out << fColor[0] sp fColor[1] sp fColor[2] sp fColor[3] nl;
-    out << fScale nl;
-    out << fRadius nl;
-    out << fRotated nl;
+	checkpoint::putArray( out, fPosition, 3 );
+	checkpoint::putArray( out, fAngle, 3 );
+	checkpoint::putArray( out, fColor, 4 );
+	checkpoint::put( out, fScale );
+	checkpoint::put( out, fRadius );
+	checkpoint::put( out, fRotated );
+	checkpoint::putArray( out, fCarryOffset, 3 );
 }
 
 
 void gobject::load(istream& in)
 {
-    if (fName)
-        delete fName;
-    fName = new char[256];
-    in >> fName;
-    in >> fPosition[0] >> fPosition[1] >> fPosition[2];
-    in >> fAngle[0] >> fAngle[1] >> fAngle[2];
-    in >> fColor[0] >> fColor[1] >> fColor[2] >> fColor[3];
-    in >> fScale;
-    in >> fRadius;
-    in >> fRotated;
+	checkpoint::getArray( in, fPosition, 3 );
+	checkpoint::getArray( in, fAngle, 3 );
+	checkpoint::getArray( in, fColor, 4 );
+	checkpoint::get( in, fScale );
+	checkpoint::get( in, fRadius );
+	checkpoint::get( in, fRotated );
+	checkpoint::getArray( in, fCarryOffset, 3 );
 }
 
 
@@ -106,6 +106,11 @@ void gobject::draw()
 }
 
 
+void gobject::softdraw(gretina&)
+{
+}
+
+
 void gobject::SetName(const char* pc)
 {
     fName = new char[strlen(pc)+1];
@@ -306,6 +311,55 @@ void gobject::inverseposition()
 	inversetranslate();
 }
 
+
+// software equivalents of the above, for use with a gretina
+void gobject::translate(gretina& r)
+{
+	r.Translate(fPosition[0], fPosition[1], fPosition[2]);
+}
+
+
+void gobject::rotate(gretina& r)
+{
+	if (fRotated)
+	{
+		r.Rotate(fAngle[0], 0.0, 1.0, 0.0);	// y
+		r.Rotate(fAngle[1], 1.0, 0.0, 0.0); 	// x
+		r.Rotate(fAngle[2], 0.0, 0.0, 1.0);	// z
+	}
+}
+
+
+void gobject::position(gretina& r)
+{
+	translate(r);
+	rotate(r);
+}
+
+
+void gobject::inversetranslate(gretina& r)
+{
+	r.Translate(-fPosition[0], -fPosition[1], -fPosition[2]);
+}
+
+
+void gobject::inverserotate(gretina& r)
+{
+	if (fRotated)
+	{
+		r.Rotate(-fAngle[2], 0.0, 0.0, 1.0);	// z
+		r.Rotate(-fAngle[1], 1.0, 0.0, 0.0); 	// x
+		r.Rotate(-fAngle[0], 0.0, 1.0, 0.0);	// y
+	}
+}
+
+
+void gobject::inverseposition(gretina& r)
+{
+	inverserotate(r);
+	inversetranslate(r);
+}
+
 bool gobject::IsCarrying( int type )
 {
     itfor( gObjectList, fCarries, it )
@@ -46,6 +46,9 @@
 
 using namespace std;
 
+// Forward declarations
+class gretina;
+
 //===========================================================================
 // gobject
 //===========================================================================
@@ -54,6 +57,7 @@ class gobject // graphical object
 public:
     virtual void print();
     virtual void draw();
+    virtual void softdraw(gretina& r);	// software equivalent of draw(), for agent vision
     
     void settranslation(float* p);
     void settranslation(float p0, float p1 = 0.0, float p2 = 0.0);
@@ -120,6 +124,13 @@ public:
     void inverserotate();
     void inverseposition();
 
+    void translate(gretina& r);
+    void rotate(gretina& r);
+    void position(gretina& r);
+    void inversetranslate(gretina& r);
+    void inverserotate(gretina& r);
+    void inverseposition(gretina& r);
+
     /* Get and set the objects type (AGENTTYPE, FOODTYPE, or BRICKTYPE) */
     int getType();
     void setType(int newType);
@@ -129,12 +140,17 @@ public:
     gdlink<gobject*>* listLink;    
     gdlink<gobject*>* GetListLink();
 
+    int gridCell;	// location in objectxsortedlist's grid, if it has one
+    int gridSlot;
+    bool xMoved;	// waiting in objectxsortedlist for sortMoved()
+
 	bool BeingCarried( void );
 	gobject* CarriedBy( void );
 	int NumCarries( void );
 	bool IsCarrying(int type);
 	void PickedUp( gobject* carrier, float dy );
 	void Dropped( void );
+	void SetCarriedBy( gobject* carrier );	// relinks a restored carry without moving anything
 
 	typedef std::list<gobject*> gObjectList;
 
@@ -201,6 +217,7 @@ inline void gobject::setTypeNumber( unsigned long typeNumber ) { fTypeNumber = t
 inline gdlink<gobject*>* gobject::GetListLink() { return listLink; }
 inline bool gobject::BeingCarried( void ) { return (fCarriedBy != NULL); }
 inline gobject* gobject::CarriedBy( void ) { return fCarriedBy; }
+inline void gobject::SetCarriedBy( gobject* carrier ) { fCarriedBy = carrier; }
 inline int gobject::NumCarries() { return fCarries.size(); }
 inline std::list<gobject*> gobject::CarryList() { return fCarries; }
 
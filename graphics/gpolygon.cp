@@ -9,6 +9,7 @@
 #include <qapplication.h>
 
 // Local
+#include "gretina.h"
 #include "misc.h"
 
 using namespace std;
@@ -121,6 +122,19 @@ void gpoly::draw()
 }
 
 
+void gpoly::softdraw(gretina& r)
+{
+	float color[4] = { fColor[0], fColor[1], fColor[2], 1.0 };	// as for glColor3fv()
+	r.SetColor(color);
+	
+    r.PushMatrix();
+      position(r);
+      r.Scale(fScale, fScale, fScale);
+      r.Polygon(fNumPoints, fVertices);
+    r.PopMatrix();
+}
+
+
 void gpoly::print()
 {
     gobject::print();
@@ -236,6 +250,25 @@ void gpolyobj::draw()
 }
 
 
+void gpolyobj::drawcolpolyrange(gretina& r, long i1, long i2, float* color)
+{
+	r.SetColor(color);
+
+	for (long i = i1; i <= i2; i++)
+		r.Polygon(fPolygon[i].fNumPoints, fPolygon[i].fVertices);
+}
+
+
+void gpolyobj::softdraw(gretina& r)
+{
+    r.PushMatrix();
+      position(r);
+      r.Scale(fScale, fScale, fScale);
+      drawcolpolyrange(r, 0, fNumPolygons - 1, fColor);
+    r.PopMatrix();
+}
+
+
 void gpolyobj::print()
 {
     gobject::print();
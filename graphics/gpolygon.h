@@ -44,6 +44,7 @@ public:
     float radiusscale();
     
     virtual void draw();
+    virtual void softdraw(gretina& r);
     virtual void print();
         
 protected:
@@ -90,8 +91,10 @@ public:
 	long numPolygons();
 
     void drawcolpolyrange(long i1, long i2, float* color);
+    void drawcolpolyrange(gretina& r, long i1, long i2, float* color);
     
     virtual void draw();
+    virtual void softdraw(gretina& r);
     virtual void print();
 
     
@@ -0,0 +1,389 @@
+/********************************************************************/
+/* PolyWorld:  An Artificial Life Ecological Simulator              */
+/* by Larry Yaeger                                                  */
+/* Copyright Apple Computer 1990,1991,1992                          */
+/********************************************************************/
+
+// gretina.cp: implementation of gretina, a software renderer for agent vision
+
+// Self
+#include "gretina.h"
+
+// System
+#include <algorithm>
+#include <alloca.h>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// Local
+#include "misc.h"
+
+using namespace std;
+
+//===========================================================================
+// gretina
+//===========================================================================
+
+//---------------------------------------------------------------------------
+// gretina::gretina
+//---------------------------------------------------------------------------
+gretina::gretina( int width, int height, unsigned char *buf )
+	:	fWidth(width),
+		fHeight(height),
+		fBuf(buf),
+		fCamera(NULL),
+		fStackDepth(0),
+		fFogFunction('O'),
+		fFogDensity(0.0),
+		fFogStart(0.0),
+		fFogEnd(1.0)
+{
+	fDepth = new float[width];
+
+	Perspective( 90.0, 1.0, 0.00001, 10000.0 );	// same defaults as gcamera
+	LoadIdentity();
+
+	fColor[0] = fColor[1] = fColor[2] = fColor[3] = 1.0;
+
+	Clear();
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::~gretina
+//---------------------------------------------------------------------------
+gretina::~gretina()
+{
+	delete [] fDepth;
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::Clear
+//
+// Black, like the agent POV window
+//---------------------------------------------------------------------------
+void gretina::Clear()
+{
+	for( int i = 0; i < fWidth; i++ )
+	{
+		fBuf[i*4    ] = 0;
+		fBuf[i*4 + 1] = 0;
+		fBuf[i*4 + 2] = 0;
+		fBuf[i*4 + 3] = 255;
+
+		fDepth[i] = FLT_MAX;
+	}
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::Perspective
+//
+// Equivalent of gluPerspective(), except that only the row of pixels at
+// height/2 -- the row agent::SetGraphics() chooses for ypix -- is rendered.
+//---------------------------------------------------------------------------
+void gretina::Perspective( float fovy, float aspect, float near, float far )
+{
+	float f = 1.0 / tan( 0.5 * fovy * DEGTORAD );
+	float rowNDC = 2.0 * ((fHeight / 2) + 0.5) / fHeight  -  1.0;
+
+	fXScale = f / aspect;
+	fRowSlope = rowNDC / f;
+	fNear = near;
+	fFar = far;
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::Fog
+//
+// Fog color is always black, as it is for the GL fog.
+//---------------------------------------------------------------------------
+void gretina::Fog( char function, float density, float start, float end )
+{
+	fFogFunction = function;
+	fFogDensity = density;
+	fFogStart = start;
+	fFogEnd = end;
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::LoadIdentity
+//---------------------------------------------------------------------------
+void gretina::LoadIdentity()
+{
+	float *m = fMatrix[fStackDepth];
+
+	memset( m, 0, 12 * sizeof(float) );
+	m[0] = m[4] = m[8] = 1.0;
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::PushMatrix
+//---------------------------------------------------------------------------
+void gretina::PushMatrix()
+{
+	assert( fStackDepth < kMaxStackDepth - 1 );
+
+	memcpy( fMatrix[fStackDepth + 1], fMatrix[fStackDepth], 12 * sizeof(float) );
+	fStackDepth++;
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::PopMatrix
+//---------------------------------------------------------------------------
+void gretina::PopMatrix()
+{
+	assert( fStackDepth > 0 );
+
+	fStackDepth--;
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::Translate
+//---------------------------------------------------------------------------
+void gretina::Translate( float x, float y, float z )
+{
+	float *m = fMatrix[fStackDepth];
+
+	m[ 9] += m[0]*x + m[3]*y + m[6]*z;
+	m[10] += m[1]*x + m[4]*y + m[7]*z;
+	m[11] += m[2]*x + m[5]*y + m[8]*z;
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::Rotate
+//
+// Same matrix as glRotatef()
+//---------------------------------------------------------------------------
+void gretina::Rotate( float angle, float x, float y, float z )
+{
+	if( angle == 0.0 )
+		return;
+
+	float *m = fMatrix[fStackDepth];
+	float s = sin( angle * DEGTORAD );
+	float c = cos( angle * DEGTORAD );
+	float t = 1.0 - c;
+	float r[9] =	// column-major
+	{
+		x*x*t + c,		y*x*t + z*s,	x*z*t - y*s,
+		x*y*t - z*s,	y*y*t + c,		y*z*t + x*s,
+		x*z*t + y*s,	y*z*t - x*s,	z*z*t + c
+	};
+	float n[9];
+
+	for( int col = 0; col < 3; col++ )
+	{
+		for( int row = 0; row < 3; row++ )
+		{
+			n[col*3 + row] = m[row    ] * r[col*3    ]
+						   + m[row + 3] * r[col*3 + 1]
+						   + m[row + 6] * r[col*3 + 2];
+		}
+	}
+
+	memcpy( m, n, 9 * sizeof(float) );
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::Scale
+//---------------------------------------------------------------------------
+void gretina::Scale( float x, float y, float z )
+{
+	float *m = fMatrix[fStackDepth];
+
+	m[0] *= x; m[1] *= x; m[2] *= x;
+	m[3] *= y; m[4] *= y; m[5] *= y;
+	m[6] *= z; m[7] *= z; m[8] *= z;
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::SetColor
+//---------------------------------------------------------------------------
+void gretina::SetColor( const float *color )
+{
+	fColor[0] = color[0];
+	fColor[1] = color[1];
+	fColor[2] = color[2];
+	fColor[3] = color[3];
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::Polygon
+//
+// Since only one row of pixels is rendered, a polygon reduces to the segment
+// where it crosses the plane through the eye that contains that row.
+//---------------------------------------------------------------------------
+void gretina::Polygon( long numPoints, const float *vertices )
+{
+	if( numPoints < 3 )
+		return;
+
+	const float *m = fMatrix[fStackDepth];
+	float *eye = (float *)alloca( numPoints * 3 * sizeof(float) );
+	float *side = (float *)alloca( numPoints * sizeof(float) );
+
+	// transform to eye coordinates, and find which side of the row's plane each vertex is on
+	for( long i = 0; i < numPoints; i++ )
+	{
+		const float *v = vertices + i*3;
+		float *e = eye + i*3;
+
+		e[0] = m[0]*v[0] + m[3]*v[1] + m[6]*v[2] + m[ 9];
+		e[1] = m[1]*v[0] + m[4]*v[1] + m[7]*v[2] + m[10];
+		e[2] = m[2]*v[0] + m[5]*v[1] + m[8]*v[2] + m[11];
+
+		side[i] = e[1] + fRowSlope * e[2];
+	}
+
+	// a convex polygon crosses the plane in (at most) a single segment
+	float ends[2][3];
+	int numEnds = 0;
+
+	for( long i = 0; (i < numPoints) && (numEnds < 2); i++ )
+	{
+		long j = (i + 1) % numPoints;
+		float *a = eye + i*3;
+		float *b = eye + j*3;
+
+		if( side[i] == 0.0 )
+		{
+			ends[numEnds][0] = a[0];
+			ends[numEnds][1] = a[1];
+			ends[numEnds][2] = a[2];
+			numEnds++;
+		}
+		else if( (side[i] < 0.0) != (side[j] < 0.0) && (side[j] != 0.0) )
+		{
+			float t = side[i] / (side[i] - side[j]);
+
+			ends[numEnds][0] = a[0] + t * (b[0] - a[0]);
+			ends[numEnds][1] = a[1] + t * (b[1] - a[1]);
+			ends[numEnds][2] = a[2] + t * (b[2] - a[2]);
+			numEnds++;
+		}
+	}
+
+	if( numEnds == 2 )
+		Span( ends[0], ends[1] );
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::Span
+//
+// Clip an eye-space segment on the sampled row to the near and far planes,
+// then rasterize it with the same pixel-center rule as GL.
+//---------------------------------------------------------------------------
+void gretina::Span( const float *a, const float *b )
+{
+	float t0 = 0.0;
+	float t1 = 1.0;
+	float dz = b[2] - a[2];
+
+	// near plane: z <= -fNear, far plane: z >= -fFar
+	if( dz == 0.0 )
+	{
+		if( (a[2] > -fNear) || (a[2] < -fFar) )
+			return;
+	}
+	else
+	{
+		float tNear = (-fNear - a[2]) / dz;
+		float tFar = (-fFar - a[2]) / dz;
+
+		if( dz > 0.0 )
+		{
+			t1 = min( t1, tNear );
+			t0 = max( t0, tFar );
+		}
+		else
+		{
+			t0 = max( t0, tNear );
+			t1 = min( t1, tFar );
+		}
+
+		if( t0 >= t1 )
+			return;
+	}
+
+	float xa = a[0] + t0 * (b[0] - a[0]);
+	float wa = -(a[2] + t0 * dz);
+	float xb = a[0] + t1 * (b[0] - a[0]);
+	float wb = -(a[2] + t1 * dz);
+
+	// window x coordinates
+	float ua = (fXScale * xa / wa  +  1.0) * 0.5 * fWidth;
+	float ub = (fXScale * xb / wb  +  1.0) * 0.5 * fWidth;
+
+	if( ua == ub )
+		return;
+
+	if( ua > ub )
+	{
+		float tmp;
+		tmp = ua; ua = ub; ub = tmp;
+		tmp = wa; wa = wb; wb = tmp;
+	}
+
+	// pixels whose centers lie in [ua, ub)
+	int first = max( 0, (int)ceil(ua - 0.5) );
+	int last = min( fWidth - 1, (int)ceil(ub - 0.5) - 1 );
+
+	float invwa = 1.0 / wa;
+	float invwb = 1.0 / wb;
+	float du = 1.0 / (ub - ua);
+
+	for( int i = first; i <= last; i++ )
+	{
+		// 1/w is linear in window coordinates
+		float lambda = (i + 0.5 - ua) * du;
+		float depth = 1.0 / (invwa + lambda * (invwb - invwa));
+
+		Fragment( i, depth );
+	}
+}
+
+
+//---------------------------------------------------------------------------
+// gretina::Fragment
+//---------------------------------------------------------------------------
+void gretina::Fragment( int x, float depth )
+{
+	if( depth >= fDepth[x] )
+		return;
+
+	fDepth[x] = depth;
+
+	float fog;
+	switch( fFogFunction )
+	{
+	case 'E':
+		fog = exp( -fFogDensity * depth );
+		break;
+	case 'L':
+		fog = (fFogEnd - depth) / (fFogEnd - fFogStart);
+		break;
+	default:
+		fog = 1.0;
+		break;
+	}
+	fog = clamp( fog, 0.0f, 1.0f );
+
+	unsigned char *pixel = fBuf + x*4;
+	for( int i = 0; i < 3; i++ )
+		pixel[i] = (unsigned char)(clamp( fog * fColor[i], 0.0f, 1.0f ) * 255.0  +  0.5);
+	pixel[3] = (unsigned char)(clamp( fColor[3], 0.0f, 1.0f ) * 255.0  +  0.5);
+}
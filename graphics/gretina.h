@@ -0,0 +1,87 @@
+/********************************************************************/
+/* PolyWorld:  An Artificial Life Ecological Simulator              */
+/* by Larry Yaeger                                                  */
+/* Copyright Apple Computer 1990,1991,1992                          */
+/********************************************************************/
+
+// gretina.h: declaration of gretina, a software renderer for agent vision
+
+#ifndef GRETINA_H
+#define GRETINA_H
+
+// Forward declarations
+class gcamera;
+
+
+//===========================================================================
+// gretina
+//
+// Renders the single row of pixels that an agent's Retina samples (the row
+// that would be read back with glReadPixels() from the agent's POV viewport),
+// without using OpenGL.  The interface mirrors the subset of GL used by the
+// gobject draw() methods -- a modelview matrix stack, flat-colored convex
+// polygons, a depth test, and fog -- so each object's softdraw() can follow
+// its draw() line for line.
+//
+// A gretina holds no shared state, so any number of them may be used
+// concurrently from different threads, provided the scene is not modified.
+//===========================================================================
+class gretina
+{
+public:
+	gretina( int width, int height, unsigned char *buf );
+	~gretina();
+
+	void Clear();
+
+	void SetCamera( const gcamera *camera );
+	const gcamera *GetCamera() const;
+
+	void Perspective( float fovy, float aspect, float near, float far );
+	void Fog( char function, float density, float start, float end );
+
+	void LoadIdentity();
+	void PushMatrix();
+	void PopMatrix();
+	void Translate( float x, float y, float z );
+	void Rotate( float angle, float x, float y, float z );	// degrees, about a principal axis
+	void Scale( float x, float y, float z );
+
+	void SetColor( const float *color );
+
+	// A convex polygon, in the current modelview coordinates (3 floats per vertex)
+	void Polygon( long numPoints, const float *vertices );
+
+private:
+	enum { kMaxStackDepth = 8 };
+
+	void Span( const float *a, const float *b );
+	void Fragment( int x, float depth );
+
+	int fWidth;
+	int fHeight;
+	unsigned char *fBuf;	// RGBA
+	float *fDepth;
+
+	const gcamera *fCamera;
+
+	float fMatrix[kMaxStackDepth][12];	// 3x4 affine, column-major like GL
+	int fStackDepth;
+
+	float fXScale;	// projection of x/-z onto [-1,1]
+	float fRowSlope;	// y/-z of the sampled row of pixels
+	float fNear;
+	float fFar;
+
+	char fFogFunction;	// 'O', 'E', or 'L', as for the GL fog
+	float fFogDensity;
+	float fFogStart;
+	float fFogEnd;
+
+	float fColor[4];
+};
+
+inline void gretina::SetCamera( const gcamera *camera ) { fCamera = camera; }
+inline const gcamera *gretina::GetCamera() const { return fCamera; }
+
+#endif
@@ -10,6 +10,7 @@
 #include "gscene.h"
 
 // System
+#include <assert.h>
 #include <iostream>
 #include <gl.h>
 
@@ -19,6 +20,7 @@
 // Local
 #include "gcamera.h"
 #include "graphics.h"
+#include "gretina.h"
 #include "gstage.h"
 #include "misc.h"
 
@@ -157,6 +159,27 @@ void gscene::Draw(const frustumXZ& fxz)
 
 
 
+//---------------------------------------------------------------------------
+// gscene::Draw
+//
+// Software rendering into r.  The camera must already exist, since MakeCamera()
+// is not safe to call from several threads at once.
+//---------------------------------------------------------------------------
+void gscene::Draw(gretina& r, const frustumXZ& fxz)
+{
+	assert( fCamera != NULL );
+
+	r.LoadIdentity();
+	if (!fCameraFixed)
+		fCamera->Use(r);
+	else
+		r.SetCamera(fCamera);
+		
+	if (fStage != NULL)
+		fStage->Draw(r, fxz);
+}
+
+
 //---------------------------------------------------------------------------
 // gscene::Print
 //---------------------------------------------------------------------------
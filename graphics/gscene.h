@@ -13,6 +13,7 @@
 // Forward declarations
 class frustumXZ;
 class gcamera;
+class gretina;
 class gstage;
 
 
@@ -34,6 +35,7 @@ public:
     
 	void Draw();
 	void Draw(const frustumXZ& fxz);
+	void Draw(gretina& r, const frustumXZ& fxz);
 	void Print();
     
     bool PerspectiveSet();
@@ -8,6 +8,7 @@
 // Local
 #include "gmisc.h"
 #include "graphics.h"
+#include "gretina.h"
 #include "misc.h"
 
 
@@ -176,6 +177,19 @@ void gbox::draw()
 }
 
 
+void gbox::softdraw(gretina& r)
+{
+	float color[4] = { fColor[0], fColor[1], fColor[2], 1.0 };	// as for glColor3fv()
+	r.SetColor(color);
+	
+	r.PushMatrix();
+		position(r);
+		r.Scale(fScale * fLength[0], fScale * fLength[1], fScale * fLength[2]);
+		drawunitcube(r);
+    r.PopMatrix();
+}
+
+
 void gbox::print()
 {
     gobject::print();
@@ -111,6 +111,7 @@ public:
     float lz()   { return fLength[2]; }
     float radiusscale() { return fRadiusScale; }
     virtual void draw();
+    virtual void softdraw(gretina& r);
     virtual void print();
 
 protected:    
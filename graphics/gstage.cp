@@ -18,6 +18,7 @@
 #include "glight.h"
 #include "gmisc.h"
 #include "graphics.h"
+#include "gretina.h"
 #include "misc.h"
 #include "objectlist.h"
 
@@ -208,6 +209,25 @@ void gstage::Draw(const frustumXZ& fxz)
 }
 
 
+//---------------------------------------------------------------------------
+// gstage::Draw
+//
+// Software rendering.  There is no lighting in the software path, and the
+// current camera is carried by the gretina, so this leaves the stage untouched.
+//---------------------------------------------------------------------------
+void gstage::Draw(gretina& r, const frustumXZ& fxz)
+{
+	if (fSetList != NULL)
+		fSetList->Draw(r); 	// ground plane always drawn, as above
+                               
+	if (fPropList != NULL)
+		fPropList->Draw(r, fxz);
+
+	if (fCastList != NULL)
+		fCastList->Draw(r, fxz);
+}
+
+
 //---------------------------------------------------------------------------
 // gstage::Print
 //---------------------------------------------------------------------------
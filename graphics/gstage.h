@@ -20,6 +20,7 @@ class gcamera;
 class glight;
 class glightmodel;
 class gobject;
+class gretina;
 
 class gstage
 {
@@ -40,6 +41,7 @@ public:
 	void Decompile();
 	void Draw();
 	void Draw(const frustumXZ& fxz);
+	void Draw(gretina& r, const frustumXZ& fxz);
 	void Print();
     
 	// The following are added mostly for some quick & dirty testing.
@@ -57,8 +57,7 @@ class Agent(object):
             "Lifespans file required"
         
         self.genome_filename = "%s/genome/genome_%d.txt" % (run_dir, id)
-        self.positions_filename = "%s/motion/position/position_%d.txt"\
-                                % (run_dir, id)
+        self.positions_filename = "%s/motion/position/positions.bin" % (run_dir)
 
         self.anat_filename = {}
         self.anat_filename['birth'] = "%s/brain/anatomy/brainAnatomy_%d_birth.txt"\
@@ -177,7 +176,7 @@ class Agent(object):
 
     def _get_positions(self):
         if os.path.isfile(self.positions_filename):
-            return Positions(self.positions_filename)
+            return Positions(self.run_dir, self.id)
         else:
             return None
     
@@ -5,24 +5,22 @@ Contains Positions class, which represents all the motion of an agent.
 """
 
 from lazy import Lazy
-import datalib
+import positionlog
 import os.path
 
 class Positions: 
-    def __init__(self, filename):
-        self.filename = filename
-        assert os.path.isfile(self.filename),\
-                "Invalid motion file: %s" % self.filename
+    def __init__(self, run_dir, id):
+        self.run_dir = run_dir
+        self.id = id
+        assert os.path.isfile(positionlog.path_log(run_dir)),\
+                "Invalid motion file: %s" % positionlog.path_log(run_dir)
 
     @Lazy
     def positions(self):
         ''' Lazy loading of position data'''
-        position_table = datalib.parse(self.filename,
-                          keycolname='Timestep')['Positions']
-        
-        positions = {}
-        for row in position_table.rowlist:
-            positions.update({ row['Timestep'] : (row['x'], row['y'], row['z']) })
+        positions = positionlog.read_agent(self.run_dir, self.id)
+        if positions is None:
+            positions = {}
         
         return positions
 
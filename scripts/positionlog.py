@@ -0,0 +1,103 @@
+import os
+import struct
+
+####################################################################################
+###
+### Reader for run/motion/position/positions.bin, the binary log of all agent
+### positions written by PositionWriter (see utils/PositionLog.h for the format).
+###
+####################################################################################
+
+LOG_MAGIC = b'PWPL'
+INDEX_MAGIC = b'PWPI'
+VERSION = 1
+
+HEADER = struct.Struct('=4si')
+BLOCK = struct.Struct('=ii')
+RECORD = struct.Struct('=ifff')
+BLOCK_ENTRY = struct.Struct('=iq')
+AGENT_ENTRY = struct.Struct('=iiiq')
+
+def path_log(path_run):
+    return os.path.join(path_run, 'motion/position/positions.bin')
+
+####################################################################################
+###
+### FUNCTION read_agent()
+###
+### Returns a dict of step -> (x, y, z) for one agent, or None if the agent
+### was never recorded.
+###
+####################################################################################
+def read_agent(path_run, agent):
+    path = path_log(path_run)
+    f = open(path, 'rb')
+
+    magic, version = HEADER.unpack(f.read(HEADER.size))
+    assert magic == LOG_MAGIC and version == VERSION, "Not a position log: %s" % path
+
+    index = __read_index(path + '.idx')
+    if index != None:
+        if agent not in index:
+            return None
+        first, last, offset = index[agent]
+    else:
+        first, last, offset = 0, None, HEADER.size
+
+    positions = {}
+    f.seek(offset)
+    while True:
+        header = f.read(BLOCK.size)
+        if len(header) < BLOCK.size:
+            break
+        step, count = BLOCK.unpack(header)
+        if last != None and step > last:
+            break
+
+        data = f.read(count * RECORD.size)
+        if len(data) < count * RECORD.size:
+            break
+
+        for i in range(count):
+            a, x, y, z = RECORD.unpack_from(data, i * RECORD.size)
+            if a == agent:
+                positions[step] = (x, y, z)
+                break
+
+    f.close()
+
+    if not positions:
+        return None
+    return positions
+
+####################################################################################
+###
+### FUNCTION __read_index()
+###
+### Returns a dict of agent -> (firstStep, lastStep, offset), or None if there
+### is no index (e.g. the run didn't finish).
+###
+####################################################################################
+def __read_index(path):
+    if not os.path.isfile(path):
+        return None
+
+    f = open(path, 'rb')
+    magic, version = HEADER.unpack(f.read(HEADER.size))
+    if magic != INDEX_MAGIC or version != VERSION:
+        f.close()
+        return None
+
+    nblocks, = struct.unpack('=i', f.read(4))
+    f.seek(nblocks * BLOCK_ENTRY.size, os.SEEK_CUR)
+
+    nagents, = struct.unpack('=i', f.read(4))
+    data = f.read(nagents * AGENT_ENTRY.size)
+    f.close()
+
+    index = {}
+    for i in range(nagents):
+        agent, first, last, offset = AGENT_ENTRY.unpack_from(data, i * AGENT_ENTRY.size)
+        index[agent] = (first, last, offset)
+
+    return index
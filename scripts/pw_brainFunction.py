@@ -5,6 +5,23 @@ import numpy
 #from copy import copy
 #import numpy
 
+def read_lines( input_filename ):
+	'''returns the lines of a brainFunction file, converting a binary one to text'''
+	f = open( input_filename, 'rb' )
+	magic = f.read(4)
+	f.close()
+
+	if magic != 'PWBF':
+		return open( input_filename ).readlines()
+
+	import common_functions, subprocess
+	cmd = [ common_functions.pw_env('complexity'), 'brainfunction-text', input_filename ]
+	proc = subprocess.Popen( cmd, stdout=subprocess.PIPE )
+	stdout = proc.communicate()[0]
+	assert proc.returncode == 0, "could not convert binary brainFunction file"
+
+	return stdout.splitlines()
+
 class pw_brainFunction:
 	'''holds the data of a polyworld brainFunction file'''
 
@@ -24,7 +41,10 @@ class pw_brainFunction:
 		if not input_filename:
 			return None
 		
-		lines = [ x.strip() for x in open( input_filename ).readlines() ]
+		lines = [ x.strip() for x in read_lines( input_filename ) ]
+
+		if lines[0].startswith('version'):
+			lines.pop(0)
 
 		# brainFunction 157 15 8 17 0 2-3 4-5 6-7
 		# format: 
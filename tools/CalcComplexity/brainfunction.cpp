@@ -2,6 +2,7 @@
 
 #include <ctype.h>		// for isdigit()
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
 
 #include <iostream>
@@ -11,6 +12,7 @@
 
 #include "brainfunction.h"
 
+#include "BrainFunctionFile.h"
 #include "main.h"
 
 using namespace std;
@@ -72,6 +74,19 @@ int process_brainfunction(int argc, char *argv[])
 		arg = argv[argi];
 	}
 
+	const char *path_table = NULL;
+
+	if(arg == "--table")
+	{
+		consume_arg(argc, argv, argi);
+		if(argc < 3)
+		{
+			show_usage("Must specify table path and brain function file.");
+		}
+		path_table = consume_arg(argc, argv, argi);
+		arg = argv[argi];
+	}
+
 	list<string> files;
 
 	if(arg == "--list")
@@ -200,9 +215,34 @@ int process_brainfunction(int argc, char *argv[])
 		}
 	}
 
+	DataLibWriter *table = NULL;
+	if(path_table)
+	{
+		table = new DataLibWriter(path_table);
+
+		const char *colnames[ncombos + 4];
+		datalib::Type coltypes[ncombos + 3];
+
+		colnames[0] = "Agent";
+		colnames[1] = "Lifespan";
+		colnames[2] = "NumNeurons";
+		coltypes[0] = coltypes[1] = coltypes[2] = datalib::INT;
+		for(int i = 0; i < ncombos; i++)
+		{
+			colnames[i + 3] = part_combos[i];
+			coltypes[i + 3] = datalib::FLOAT;
+		}
+		colnames[ncombos + 3] = NULL;
+
+		table->beginTable("Complexity",
+				  colnames,
+				  coltypes);
+	}
+
 	Callback_bf callback(bare,
 			  part_combos,
-			  ncombos);
+			  ncombos,
+			  table);
 
 	// --- perform calculations
 	CalcComplexity_brainfunction_result *result = CalcComplexity_brainfunction(parms,
@@ -210,9 +250,64 @@ int process_brainfunction(int argc, char *argv[])
 										   &callback);
 	delete result;
 
+	if(table)
+	{
+		table->endTable();
+		delete table;
+	}
+
 	return 0;
 }
 
+//---------------------------------------------------------------------------
+// process_brainfunction_text
+//
+// Writes a binary brainFunction file to stdout in the text format.
+//---------------------------------------------------------------------------
+int process_brainfunction_text(int argc, char *argv[])
+{
+	if(argc != 2)
+	{
+		show_usage("Must specify one brain function file.");
+	}
+
+	const char *path = argv[1];
+	BrainFunctionReader reader;
+
+	if( !BrainFunctionReader::isBinary(path) )
+	{
+		cerr << "'" << path << "' is not a binary brainFunction file." << endl;
+		return 1;
+	}
+
+	if( !reader.open(path) )
+		return 1;
+
+	int numneurons = reader.getNeuronCount();
+	float *activations = new float[numneurons];
+
+	printf("version 1\n");
+	printf("%s\n", reader.getHeader().c_str());
+
+	for(long t = 0; t < reader.getTimestepCount(); t++)
+	{
+		reader.read(t, 1, activations, numneurons);
+
+		for(int i = 0; i < numneurons; i++)
+		{
+			printf("%d %g\n", i, activations[i]);
+		}
+	}
+
+	if( reader.isComplete() )
+	{
+		printf("end fitness = %g\n", reader.getFitness());
+	}
+
+	delete [] activations;
+
+	return 0;
+}
 
 #if DEBUG
 //---------------------------------------------------------------------------
@@ -324,6 +419,22 @@ void Callback_bf::display(CalcComplexity_brainfunction_result *result) {
 
 		printf("%10f ", result->complexity[parms_index]);
 
+		if(table && icombo == nparts_combos - 1)
+		{
+			int first = parms_index - icombo;
+			Variant cols[nparts_combos + 3];
+
+			cols[0] = result->agent_number[first];
+			cols[1] = result->lifespan[first];
+			cols[2] = result->num_neurons[first];
+			for(int i = 0; i < nparts_combos; i++)
+			{
+				cols[i + 3] = result->complexity[first + i];
+			}
+
+			table->addRow(cols);
+		}
+
 		if(icombo == nparts_combos - 1)
 		{
 			if(!bare)
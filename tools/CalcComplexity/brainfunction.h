@@ -1,18 +1,21 @@
 #pragma once
 
 int process_brainfunction(int argc, char *argv[]);
+int process_brainfunction_text(int argc, char *argv[]);
 
 
 #ifdef BRAINFUNCTION_CPP
 
 #include "complexity.h"
+#include "datalib.h"
 
 class Callback_bf : public CalcComplexity_brainfunction_callback
 {
 public:
 	Callback_bf(bool _bare,
 		    const char **_parts_combos,
-		    int _nparts_combos) : bare(_bare), parts_combos(_parts_combos), nparts_combos(_nparts_combos), reported(NULL) {}
+		    int _nparts_combos,
+		    DataLibWriter *_table = NULL) : bare(_bare), parts_combos(_parts_combos), nparts_combos(_nparts_combos), table(_table), reported(NULL) {}
 	virtual ~Callback_bf() {}
 
 	virtual void begin(CalcComplexity_brainfunction_parms *parms,
@@ -26,6 +29,7 @@ private:
 	bool bare;
 	const char **parts_combos;
 	int nparts_combos;
+	DataLibWriter *table;
 	bool *reported;
 	int last_displayed;
 };
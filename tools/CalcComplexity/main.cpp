@@ -45,6 +45,10 @@ int main( int argc, char *argv[] )
 	{
 		exit_value = process_brainfunction(argc, argv);
 	}
+	else if(mode == "brainfunction-text")
+	{
+		exit_value = process_brainfunction_text(argc, argv);
+	}
 	else
 	{
 		show_usage(string("invalid mode: ") + mode);
@@ -63,12 +67,17 @@ void show_usage(string msg)
 	cerr << endl;
 	cerr << "--- Brain Function ---" << endl;
 
-	cout << "CalcComplexity brainfunction [--bare] (<func_file> | --list <func_file>... --) [N] [[APIBH]+\\d*]..." << endl;
+	cout << "CalcComplexity brainfunction [--bare] [--table <path>] (<func_file> | --list <func_file>... --) [N] [[APIBH]+\\d*]..." << endl;
 	cout << "\t(Ignoring --bare...)" << endl;
+	cout << "\t--table also writes the results to a datalib table, one row per file, as they complete.\n\t\tFiles are processed in parallel, each read once for all of its complexity types." << endl;
 	cout << "\tThe 1st argument is the brainFunction file (or list of files) to compute the complexity for.\n\t\tBoth complete and incomplete brainFunction files are supported." << endl;
 	cout << "\tThe 2nd argument is optional, and is the number of timesteps since the beginning\n\t\tof the agent's life to compute the Complexity over.\n\t\tEx: a value of 100 will compute Complexity across the first 100 steps of the agent's life." << endl; 
 	cerr << "\tThe 3rd argument is optional, and can be 'A', 'P', 'I', 'B', 'H' or any meaningful combination thereof.\n\t\tIt specifies whether you want to compute the Complexity of All, Processing, Input, Behavior,\n\t\tor Health+Behavior neurons. By default it computes the Complexity for A, P, I, B, and HB.\n\t\tAny of the complexity types may have one or more digits appended to specify the number of\n\t\tpoints to use in integrating the area between the (k/N)I(X) and <I(X_k)> curves. If not specified,\n\t\tthe default is effectively 1 (one), which yields the traditional 'simplified TSE complexity'.\n\t\tA value of 0 (zero) will use all points (all values of k) thus yielding full TSE complexity." << endl;
 
+	cerr << endl;
+	cerr << "CalcComplexity brainfunction-text <func_file>" << endl;
+	cerr << "\tWrites a binary brainFunction file to stdout in the text format." << endl;
+
 	cerr << endl;
 	cerr << "--- Motion ---" << endl;
 
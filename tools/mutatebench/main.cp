@@ -0,0 +1,300 @@
+// Compares the geometric-skip mutation and masked-copy crossover kernels
+// used by Genome against the loops they replaced, for speed, and checks the
+// bits they produce: mutation by its flip distribution, crossover against a
+// bit-at-a-time reference.
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <vector>
+
+#include "BitMutation.h"
+#include "RandomNumberGenerator.h"
+
+using namespace genome;
+using namespace std;
+
+void usage()
+{
+	fprintf( stderr, "usage: mutatebench [nbytes [rate [iterations]]]\n" );
+	exit( 1 );
+}
+
+//---------------------------------------------------------------------------
+// The mutation loop Genome used before.
+//---------------------------------------------------------------------------
+void legacy_mutate( unsigned char *data, long nbytes, float rate, RandomNumberGenerator *rng )
+{
+	for( long byte = 0; byte < nbytes; byte++ )
+	{
+		for( long bit = 0; bit < 8; bit++ )
+		{
+			if( rng->drand() < rate )
+				data[byte] ^= char(1 << (7-bit));
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// The copy loop of Genome::crossover before copyBits(), without mutation.
+// Its boundary bytes don't split at quite the same bits, so it's only timed.
+//---------------------------------------------------------------------------
+void legacy_crossover( unsigned char *dst, const unsigned char *g1, const unsigned char *g2,
+					   long nbytes, const long *points, int npoints )
+{
+	long begbyte = 0;
+	long endbyte = -1;
+	bool first = true;
+
+	for( int i = 0; i <= npoints; i++ )
+	{
+		// for copying the end of the genome
+		if( i == npoints )
+		{
+			if( endbyte == nbytes - 1 )
+				break;
+			endbyte = nbytes - 1;
+		}
+		else
+		{
+			endbyte = points[i] >> 3;
+		}
+		const unsigned char *g = first ? g1 : g2;
+
+		for( long j = begbyte; j < endbyte; j++ )
+			dst[j] = g[j];
+
+		if( i != npoints )
+		{
+			first = !first;
+			long bit = points[i] - (endbyte << 3);
+
+			if( first )
+				dst[endbyte] = (unsigned char)((g2[endbyte] & (255 << (8 - bit))) | (g1[endbyte] & (255 >> bit)));
+			else
+				dst[endbyte] = (unsigned char)((g1[endbyte] & (255 << (8 - bit))) | (g2[endbyte] & (255 >> bit)));
+
+			begbyte = endbyte + 1;
+		}
+		else
+		{
+			dst[endbyte] = g[endbyte];
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// Bit-at-a-time copy of [begbit, endbit), the reference copyBits() is
+// checked against.  Genome never used it.
+//---------------------------------------------------------------------------
+void reference_copy( unsigned char *dst, const unsigned char *src, long begbit, long endbit )
+{
+	long byte = begbit >> 3;
+	for( long bit = begbit; bit < endbit && (bit & 7); bit++ )
+	{
+		unsigned char mask = (unsigned char)(0x80 >> (bit & 7));
+		dst[byte] = (unsigned char)((dst[byte] & ~mask) | (src[byte] & mask));
+		if( (bit & 7) == 7 )
+			byte++;
+	}
+	for( ; byte < (endbit >> 3); byte++ )
+		dst[byte] = src[byte];
+	for( long bit = (endbit & ~7L) > begbit ? (endbit & ~7L) : begbit; bit < endbit; bit++ )
+	{
+		unsigned char mask = (unsigned char)(0x80 >> (bit & 7));
+		dst[bit >> 3] = (unsigned char)((dst[bit >> 3] & ~mask) | (src[bit >> 3] & mask));
+	}
+}
+
+//---------------------------------------------------------------------------
+// Timer
+//---------------------------------------------------------------------------
+double now()
+{
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+//---------------------------------------------------------------------------
+// FlipStats
+//
+// Tallies the bits that differ from the original genome, per genome and
+// per bit position.
+//---------------------------------------------------------------------------
+struct FlipStats
+{
+	long nbits;
+	long ngenomes;
+	double sum;
+	double sum2;
+	vector<long> perbit;
+
+	FlipStats( long nbits ) : nbits(nbits), ngenomes(0), sum(0), sum2(0), perbit(nbits, 0) {}
+
+	void add( const unsigned char *a, const unsigned char *b )
+	{
+		long n = 0;
+		for( long bit = 0; bit < nbits; bit++ )
+		{
+			if( (a[bit >> 3] ^ b[bit >> 3]) & (0x80 >> (bit & 7)) )
+			{
+				perbit[bit]++;
+				n++;
+			}
+		}
+		ngenomes++;
+		sum += n;
+		sum2 += double(n) * n;
+	}
+
+	// Chi-square of the per-bit flip counts against a uniform rate, in
+	// units of its degrees of freedom (about 1 - rate when flips are uniform).
+	double uniformity()
+	{
+		double expected = sum / nbits;
+		if( expected == 0 )
+			return 0;
+		double chi2 = 0;
+		for( long bit = 0; bit < nbits; bit++ )
+		{
+			double d = perbit[bit] - expected;
+			chi2 += d * d / expected;
+		}
+		return chi2 / (nbits - 1);
+	}
+
+	void print( const char *name, double rate )
+	{
+		double mean = sum / ngenomes;
+		double var = sum2 / ngenomes - mean * mean;
+		printf( "  %-10s flips/genome mean = %8.3f (expect %8.3f), var = %8.3f (expect %8.3f), chi2/df = %.3f\n",
+				name,
+				mean, nbits * rate,
+				var, nbits * rate * (1 - rate),
+				uniformity() );
+	}
+};
+
+int main( int argc, char **argv )
+{
+	long nbytes = 2500;
+	double rate = 0.01;
+	long iterations = 10000;
+
+	if( argc > 4 )
+		usage();
+	if( argc > 1 && (nbytes = atol(argv[1])) <= 0 )
+		usage();
+	if( argc > 2 && ((rate = atof(argv[2])) < 0 || rate > 1) )
+		usage();
+	if( argc > 3 && (iterations = atol(argv[3])) <= 0 )
+		usage();
+
+	long nbits = nbytes * 8;
+
+	RandomNumberGenerator::set( RandomNumberGenerator::GENOME, RandomNumberGenerator::LOCAL );
+	RandomNumberGenerator *rng = RandomNumberGenerator::create( RandomNumberGenerator::GENOME );
+	rng->seed( 42 );
+
+	vector<unsigned char> g1( nbytes ), g2( nbytes ), child( nbytes ), check( nbytes );
+	for( long i = 0; i < nbytes; i++ )
+	{
+		g1[i] = (unsigned char)(rng->drand() * 256);
+		g2[i] = (unsigned char)(rng->drand() * 256);
+	}
+
+	printf( "genome = %ld bytes, rate = %g, iterations = %ld\n", nbytes, rate, iterations );
+
+	// ---
+	// --- Mutation
+	// ---
+	{
+		double t;
+		double tlegacy, tgeometric;
+
+		t = now();
+		for( long i = 0; i < iterations; i++ )
+			legacy_mutate( &child[0], nbytes, rate, rng );
+		tlegacy = now() - t;
+
+		t = now();
+		for( long i = 0; i < iterations; i++ )
+			mutateBits( &child[0], nbits, rate, rng );
+		tgeometric = now() - t;
+
+		printf( "mutate:    legacy = %9.3f us, geometric = %9.3f us, speedup = %.1fx\n",
+				1e6 * tlegacy / iterations,
+				1e6 * tgeometric / iterations,
+				tlegacy / tgeometric );
+
+		FlipStats legacy( nbits ), geometric( nbits );
+		for( long i = 0; i < iterations; i++ )
+		{
+			child = g1;
+			legacy_mutate( &child[0], nbytes, rate, rng );
+			legacy.add( &g1[0], &child[0] );
+
+			child = g1;
+			mutateBits( &child[0], nbits, rate, rng );
+			geometric.add( &g1[0], &child[0] );
+		}
+		legacy.print( "legacy", rate );
+		geometric.print( "geometric", rate );
+	}
+
+	// ---
+	// --- Crossover copy
+	// ---
+	{
+		const int npoints = 8;
+		long points[npoints];
+		double tlegacy = 0, tmasked = 0;
+
+		for( long i = 0; i < iterations; i++ )
+		{
+			for( int j = 0; j < npoints; j++ )
+				points[j] = long(rng->drand() * nbits);
+			for( int j = 1; j < npoints; j++ )
+				for( int k = j; k > 0 && points[k] < points[k-1]; k-- )
+				{
+					long tmp = points[k]; points[k] = points[k-1]; points[k-1] = tmp;
+				}
+
+			double t = now();
+			legacy_crossover( &check[0], &g1[0], &g2[0], nbytes, points, npoints );
+			tlegacy += now() - t;
+
+			t = now();
+			for( int j = 0; j <= npoints; j++ )
+				copyBits( &child[0], (j & 1 ? &g2[0] : &g1[0]),
+						  j == 0 ? 0 : points[j-1],
+						  j == npoints ? nbits : points[j] );
+			tmasked += now() - t;
+
+			for( int j = 0; j <= npoints; j++ )
+				reference_copy( &check[0], (j & 1 ? &g2[0] : &g1[0]),
+								j == 0 ? 0 : points[j-1],
+								j == npoints ? nbits : points[j] );
+
+			if( memcmp(&child[0], &check[0], nbytes) != 0 )
+			{
+				fprintf( stderr, "crossover mismatch on iteration %ld\n", i );
+				exit( 1 );
+			}
+		}
+
+		printf( "crossover: legacy = %9.3f us, masked    = %9.3f us, speedup = %.1fx\n",
+				1e6 * tlegacy / iterations,
+				1e6 * tmasked / iterations,
+				tlegacy / tmasked );
+	}
+
+	RandomNumberGenerator::dispose( rng );
+
+	return 0;
+}
@@ -0,0 +1,370 @@
+#include "BrainFunctionFile.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "AbstractFile.h"
+
+using namespace std;
+
+//===========================================================================
+// BrainFunctionWriter
+//===========================================================================
+
+//---------------------------------------------------------------------------
+// BrainFunctionWriter::BrainFunctionWriter
+//---------------------------------------------------------------------------
+BrainFunctionWriter::BrainFunctionWriter( AbstractFile *file, int numneurons, bool compress )
+{
+	this->file = file;
+	this->numneurons = numneurons;
+	this->compress = compress;
+
+	block = new float[ BrainFunctionBlockTimesteps * numneurons ];
+	blockTimesteps = 0;
+
+	if( compress )
+	{
+		compressedCapacity = compressBound( BrainFunctionBlockTimesteps * numneurons * sizeof(float) );
+		compressed = new unsigned char[ compressedCapacity ];
+	}
+	else
+	{
+		compressedCapacity = 0;
+		compressed = NULL;
+	}
+
+	uint32_t version = BrainFunctionBinaryVersion;
+	uint32_t flags = compress ? BRAINFUNCTION_COMPRESSED : 0;
+
+	file->write( BrainFunctionMagic, 1, 4 );
+	file->write( &version, sizeof(version), 1 );
+	file->write( &flags, sizeof(flags), 1 );
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionWriter::~BrainFunctionWriter
+//---------------------------------------------------------------------------
+BrainFunctionWriter::~BrainFunctionWriter()
+{
+	delete [] block;
+	delete [] compressed;
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionWriter::addTimestep
+//---------------------------------------------------------------------------
+float *BrainFunctionWriter::addTimestep()
+{
+	if( blockTimesteps == BrainFunctionBlockTimesteps )
+		flushBlock();
+
+	return block + (blockTimesteps++ * numneurons);
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionWriter::end
+//---------------------------------------------------------------------------
+void BrainFunctionWriter::end( float fitness )
+{
+	flushBlock();
+
+	uint32_t endMarker = 0;
+
+	file->write( &endMarker, sizeof(endMarker), 1 );
+	file->write( &fitness, sizeof(fitness), 1 );
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionWriter::flushBlock
+//---------------------------------------------------------------------------
+void BrainFunctionWriter::flushBlock()
+{
+	if( blockTimesteps == 0 )
+		return;
+
+	uint32_t n = blockTimesteps;
+	uLongf rawSize = blockTimesteps * numneurons * sizeof(float);
+	const void *data = block;
+	uLongf nbytes = rawSize;
+
+	if( compress )
+	{
+		uLongf compressedSize = compressedCapacity;
+
+		if( (compress2( compressed, &compressedSize, (const Bytef *)block, rawSize, Z_BEST_SPEED ) == Z_OK)
+			&& (compressedSize < rawSize) )
+		{
+			data = compressed;
+			nbytes = compressedSize;
+		}
+	}
+
+	uint32_t nbytes32 = nbytes;
+
+	file->write( &n, sizeof(n), 1 );
+	file->write( &nbytes32, sizeof(nbytes32), 1 );
+	file->write( data, 1, nbytes );
+
+	blockTimesteps = 0;
+}
+
+//===========================================================================
+// BrainFunctionReader
+//===========================================================================
+
+//---------------------------------------------------------------------------
+// BrainFunctionReader::isBinary
+//---------------------------------------------------------------------------
+bool BrainFunctionReader::isBinary( const char *path )
+{
+	FILE *f = fopen( path, "r" );
+	if( !f )
+		return false;
+
+	char magic[4];
+	bool result = (fread( magic, 1, 4, f ) == 4) && (memcmp( magic, BrainFunctionMagic, 4 ) == 0);
+
+	fclose( f );
+
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionReader::BrainFunctionReader
+//---------------------------------------------------------------------------
+BrainFunctionReader::BrainFunctionReader()
+{
+	map = NULL;
+	mapSize = 0;
+	scratch = NULL;
+
+	close();
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionReader::~BrainFunctionReader
+//---------------------------------------------------------------------------
+BrainFunctionReader::~BrainFunctionReader()
+{
+	close();
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionReader::close
+//---------------------------------------------------------------------------
+void BrainFunctionReader::close()
+{
+	if( map )
+		munmap( map, mapSize );
+	map = NULL;
+	mapSize = 0;
+
+	delete [] scratch;
+	scratch = NULL;
+
+	header.clear();
+	agentNumber = 0;
+	numneurons = 0;
+	numinputneurons = 0;
+	numoutputneurons = 0;
+	numtimesteps = 0;
+	complete = false;
+	fitness = 0.0;
+	blocks.clear();
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionReader::open
+//---------------------------------------------------------------------------
+bool BrainFunctionReader::open( const char *path )
+{
+	close();
+
+	int fd = ::open( path, O_RDONLY );
+	if( fd < 0 )
+	{
+		fprintf( stderr, "Could not open brainFunction file '%s'\n", path );
+		return false;
+	}
+
+	struct stat st;
+	if( fstat(fd, &st) == 0 && st.st_size > 0 )
+	{
+		mapSize = st.st_size;
+		map = mmap( NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if( map == MAP_FAILED )
+			map = NULL;
+	}
+	::close( fd );
+
+	if( !map )
+	{
+		fprintf( stderr, "Could not map brainFunction file '%s'\n", path );
+		mapSize = 0;
+		return false;
+	}
+
+	const unsigned char *p = (const unsigned char *)map;
+	const unsigned char *end = p + mapSize;
+	uint32_t version, flags;
+
+	if( (mapSize < 12) || (memcmp( p, BrainFunctionMagic, 4 ) != 0) )
+	{
+		fprintf( stderr, "'%s' is not a binary brainFunction file\n", path );
+		close();
+		return false;
+	}
+	memcpy( &version, p + 4, sizeof(version) );
+	memcpy( &flags, p + 8, sizeof(flags) );
+	p += 12;
+
+	if( version != BrainFunctionBinaryVersion )
+	{
+		fprintf( stderr, "brainFunction file '%s' has unsupported version %u\n", path, version );
+		close();
+		return false;
+	}
+
+	const unsigned char *nl = (const unsigned char *)memchr( p, '\n', end - p );
+	if( !nl )
+	{
+		fprintf( stderr, "brainFunction file '%s' has no header\n", path );
+		close();
+		return false;
+	}
+	header.assign( (const char *)p, nl - p );
+	p = nl + 1;
+
+	if( sscanf( header.c_str(), "brainFunction %ld %d %d %d", &agentNumber, &numneurons, &numinputneurons, &numoutputneurons ) != 4
+		|| numneurons <= 0 )
+	{
+		fprintf( stderr, "brainFunction file '%s' has an invalid header: %s\n", path, header.c_str() );
+		close();
+		return false;
+	}
+
+	size_t rowBytes = numneurons * sizeof(float);
+
+	// index the blocks. a truncated final block is ignored.
+	while( end - p >= 4 )
+	{
+		uint32_t n;
+		memcpy( &n, p, sizeof(n) );
+
+		if( n == 0 )
+		{
+			if( end - p >= 8 )
+			{
+				memcpy( &fitness, p + 4, sizeof(fitness) );
+				complete = true;
+			}
+			break;
+		}
+
+		// Blocks decode into a scratch buffer of BrainFunctionBlockTimesteps,
+		// so a bigger one means the file is corrupt, like a truncated one
+		if( (end - p < 8) || (n > BrainFunctionBlockTimesteps) )
+			break;
+
+		Block b;
+		memcpy( &b.nbytes, p + 4, sizeof(b.nbytes) );
+		p += 8;
+
+		if( ((size_t)(end - p) < b.nbytes) || (b.nbytes > n * rowBytes) )
+			break;
+
+		b.first = numtimesteps;
+		b.numtimesteps = n;
+		b.data = p;
+		blocks.push_back( b );
+
+		numtimesteps += n;
+		p += b.nbytes;
+	}
+
+	scratch = new float[ BrainFunctionBlockTimesteps * numneurons ];
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionReader::decode
+//---------------------------------------------------------------------------
+const float *BrainFunctionReader::decode( const Block &b )
+{
+	size_t rawSize = b.numtimesteps * numneurons * sizeof(float);
+
+	if( b.nbytes == rawSize )
+	{
+		// uncompressed blocks are used in place, unless misaligned
+		if( ((size_t)b.data % sizeof(float)) == 0 )
+			return (const float *)b.data;
+
+		memcpy( scratch, b.data, rawSize );
+		return scratch;
+	}
+
+	assert( b.numtimesteps <= BrainFunctionBlockTimesteps );
+
+	uLongf size = rawSize;
+	int rc = uncompress( (Bytef *)scratch, &size, b.data, b.nbytes );
+	if( (rc != Z_OK) || (size != rawSize) )
+	{
+		fprintf( stderr, "Corrupt block in brainFunction file for agent %ld\n", agentNumber );
+		memset( scratch, 0, rawSize );
+	}
+
+	return scratch;
+}
+
+//---------------------------------------------------------------------------
+// BrainFunctionReader::read
+//---------------------------------------------------------------------------
+template<typename T>
+void BrainFunctionReader::readT( long first, long n, T *dest, size_t stride )
+{
+	assert( (first >= 0) && (first + n <= numtimesteps) );
+
+	long last = first + n;
+
+	for( size_t i = 0; i < blocks.size(); i++ )
+	{
+		const Block &b = blocks[i];
+		long bfirst = max( first, b.first );
+		long blast = min( last, b.first + b.numtimesteps );
+
+		if( bfirst >= blast )
+			continue;
+
+		const float *data = decode( b );
+
+		for( long t = bfirst; t < blast; t++ )
+		{
+			const float *src = data + (t - b.first) * numneurons;
+			T *row = dest + (t - first) * stride;
+
+			for( int j = 0; j < numneurons; j++ )
+				row[j] = src[j];
+		}
+	}
+}
+
+void BrainFunctionReader::read( long first, long n, double *dest, size_t stride )
+{
+	readT( first, n, dest, stride );
+}
+
+void BrainFunctionReader::read( long first, long n, float *dest, size_t stride )
+{
+	readT( first, n, dest, stride );
+}
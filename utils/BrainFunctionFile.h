@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+class AbstractFile;
+
+//
+// Binary brainFunction files. These have the same path as text brainFunction
+// files and are told apart by their leading magic. Layout (native byte order):
+//
+//   "PWBF", uint32 version, uint32 flags
+//   the text header line, exactly as in a text file:
+//     "brainFunction <agent> <neurons> <inputs> <outputs> <synapses> <born><organs>\n"
+//   blocks of up to BrainFunctionBlockTimesteps timesteps:
+//     uint32 numTimesteps, uint32 nbytes,
+//     float32 activations, numneurons per timestep, zlib compressed if
+//     nbytes is less than the uncompressed size
+//   end of a completed file:
+//     uint32 0, float32 fitness
+//
+// A file whose agent is still alive simply ends after its last block.
+//
+#define BrainFunctionMagic "PWBF"
+#define BrainFunctionBinaryVersion 1
+#define BrainFunctionBlockTimesteps 256
+
+enum
+{
+	BRAINFUNCTION_COMPRESSED = 1 << 0
+};
+
+//===========================================================================
+// BrainFunctionWriter
+//===========================================================================
+class BrainFunctionWriter
+{
+ public:
+	// Writes the binary preamble. The caller then writes the text header line.
+	BrainFunctionWriter( AbstractFile *file, int numneurons, bool compress );
+	~BrainFunctionWriter();
+
+	// Returns space for the activations of the next timestep.
+	float *addTimestep();
+	void end( float fitness );
+
+ private:
+	void flushBlock();
+
+	AbstractFile *file;
+	int numneurons;
+	bool compress;
+
+	float *block;
+	int blockTimesteps;
+	unsigned char *compressed;
+	size_t compressedCapacity;
+};
+
+//===========================================================================
+// BrainFunctionReader
+//
+// Maps the file and decodes blocks straight into the caller's matrix.
+//===========================================================================
+class BrainFunctionReader
+{
+ public:
+	static bool isBinary( const char *path );
+
+	BrainFunctionReader();
+	~BrainFunctionReader();
+
+	// Returns false, with a message on stderr, if the file can't be used.
+	bool open( const char *path );
+	void close();
+
+	const std::string &getHeader() { return header; }
+	long getAgentNumber() { return agentNumber; }
+	int getNeuronCount() { return numneurons; }
+	int getInputNeuronCount() { return numinputneurons; }
+	int getOutputNeuronCount() { return numoutputneurons; }
+	long getTimestepCount() { return numtimesteps; }
+	bool isComplete() { return complete; }
+	float getFitness() { return fitness; }
+
+	// Copies timesteps [first, first + n) into dest, one row of numneurons
+	// per timestep, rows separated by stride elements.
+	void read( long first, long n, double *dest, size_t stride );
+	void read( long first, long n, float *dest, size_t stride );
+
+ private:
+	struct Block
+	{
+		long first;
+		long numtimesteps;
+		const unsigned char *data;
+		uint32_t nbytes;
+	};
+
+	const float *decode( const Block &b );
+	template<typename T> void readT( long first, long n, T *dest, size_t stride );
+
+	void *map;
+	size_t mapSize;
+
+	std::string header;
+	long agentNumber;
+	int numneurons;
+	int numinputneurons;
+	int numoutputneurons;
+	long numtimesteps;
+	bool complete;
+	float fitness;
+
+	std::vector<Block> blocks;
+	float *scratch;
+};
@@ -0,0 +1,58 @@
+#include "Checkpoint.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+namespace checkpoint
+{
+	//---------------------------------------------------------------------------
+	// putString
+	//---------------------------------------------------------------------------
+	void putString( ostream &out, const string &s )
+	{
+		uint32_t len = s.length();
+		put( out, len );
+		out.write( s.c_str(), len );
+	}
+
+	//---------------------------------------------------------------------------
+	// getString
+	//---------------------------------------------------------------------------
+	string getString( istream &in )
+	{
+		uint32_t len = 0;
+		get( in, len );
+
+		string s( len, '\0' );
+		if( len > 0 )
+			in.read( &s[0], len );
+
+		return s;
+	}
+
+	//---------------------------------------------------------------------------
+	// putTag
+	//---------------------------------------------------------------------------
+	void putTag( ostream &out, const char *tag )
+	{
+		out.write( tag, 4 );
+	}
+
+	//---------------------------------------------------------------------------
+	// expectTag
+	//---------------------------------------------------------------------------
+	void expectTag( istream &in, const char *tag )
+	{
+		char buf[4];
+
+		in.read( buf, 4 );
+		if( !in || (memcmp(buf, tag, 4) != 0) )
+		{
+			cerr << "Corrupt or incompatible checkpoint: expected section '" << string(tag, 4) << "'" << endl;
+			exit( 1 );
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <iostream>
+#include <string>
+
+//
+// Simulation checkpoints. A checkpoint is a raw dump of simulation state in
+// native byte order, so it is only meaningful to the same build of Polyworld
+// run against the same worldfile. Floating-point values are written as raw
+// bits rather than text so that a restored run continues exactly where the
+// original left off. Sections are introduced by four-character tags, which
+// catch a reader and writer that have fallen out of step.
+//
+#define CheckpointMagic "PWCK"
+#define CheckpointVersion 1
+
+namespace checkpoint
+{
+	template<typename T>
+	inline void put( std::ostream &out, const T &value )
+	{
+		out.write( (const char *)&value, sizeof(T) );
+	}
+
+	template<typename T>
+	inline void get( std::istream &in, T &value )
+	{
+		in.read( (char *)&value, sizeof(T) );
+	}
+
+	template<typename T>
+	inline void putArray( std::ostream &out, const T *values, size_t n )
+	{
+		out.write( (const char *)values, n * sizeof(T) );
+	}
+
+	template<typename T>
+	inline void getArray( std::istream &in, T *values, size_t n )
+	{
+		in.read( (char *)values, n * sizeof(T) );
+	}
+
+	void putString( std::ostream &out, const std::string &s );
+	std::string getString( std::istream &in );
+
+	void putTag( std::ostream &out, const char *tag );
+	void expectTag( std::istream &in, const char *tag );
+}
@@ -0,0 +1,873 @@
+#include "Expression.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+namespace proplib
+{
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	// --- STRUCT Value
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	struct Value
+	{
+		enum Type { BOOL, INT, FLOAT, STRING } type;
+		bool b;
+		long i;
+		double f;
+		string s;
+
+		Value() : type(INT), b(false), i(0), f(0.0) {}
+
+		static Value Bool( bool b ) { Value v; v.type = BOOL; v.b = b; return v; }
+		static Value Int( long i ) { Value v; v.type = INT; v.i = i; return v; }
+		static Value Float( double f ) { Value v; v.type = FLOAT; v.f = f; return v; }
+		static Value String( const string &s ) { Value v; v.type = STRING; v.s = s; return v; }
+
+		bool isNumber() const { return type != STRING; }
+		long toInt() const { return type == BOOL ? (b ? 1 : 0) : i; }
+		double toFloat() const { return type == FLOAT ? f : (double)toInt(); }
+
+		bool truth() const
+		{
+			switch( type )
+			{
+			case BOOL: return b;
+			case INT: return i != 0;
+			case FLOAT: return f != 0.0;
+			case STRING: return !s.empty();
+			}
+			return false;
+		}
+
+		// Formats like Python 2's print statement
+		string format() const
+		{
+			char buf[64];
+
+			switch( type )
+			{
+			case BOOL:
+				return b ? "True" : "False";
+			case INT:
+				sprintf( buf, "%ld", i );
+				return buf;
+			case FLOAT:
+				sprintf( buf, "%.12g", f );
+				if( !strpbrk(buf, ".eni") )
+					strcat( buf, ".0" );
+				return buf;
+			case STRING:
+				return s;
+			}
+			return "";
+		}
+	};
+
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	// --- FUNCTION lexNumber()
+	// ---
+	// --- Python 2 int and float literals, minus the ones we don't bother
+	// --- with (octal, hex, long). Advances p past the literal.
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	static bool lexNumber( const char *&p, Value &result )
+	{
+		const char *start = p;
+		bool isFloat = false;
+
+		while( isdigit(*p) )
+			p++;
+		if( *p == '.' )
+		{
+			isFloat = true;
+			p++;
+			while( isdigit(*p) )
+				p++;
+		}
+		if( (p == start) || ((p == start + 1) && (*start == '.')) )
+			return false;
+		if( (*p == 'e') || (*p == 'E') )
+		{
+			isFloat = true;
+			p++;
+			if( (*p == '+') || (*p == '-') )
+				p++;
+			if( !isdigit(*p) )
+				return false;
+			while( isdigit(*p) )
+				p++;
+		}
+		if( isalnum(*p) || (*p == '_') )
+			return false;
+
+		string text( start, p - start );
+		if( isFloat )
+		{
+			result = Value::Float( strtod(text.c_str(), NULL) );
+		}
+		else
+		{
+			if( (text.length() > 1) && (text[0] == '0') )
+				return false; // octal
+			errno = 0;
+			long i = strtol( text.c_str(), NULL, 10 );
+			if( errno == ERANGE )
+				return false;
+			result = Value::Int( i );
+		}
+
+		return true;
+	}
+
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	// --- FUNCTION parseSymbolValue()
+	// ---
+	// --- Interprets a symbol's text the way the Python evaluator does: as
+	// --- a literal if it looks like a number or bool, otherwise a string.
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	static bool parseSymbolValue( const string &text, Value &result )
+	{
+		if( text == "True" )
+		{
+			result = Value::Bool( true );
+			return true;
+		}
+		if( text == "False" )
+		{
+			result = Value::Bool( false );
+			return true;
+		}
+
+		const char *p = text.c_str();
+		bool negate = false;
+		if( (*p == '-') || (*p == '+') )
+		{
+			negate = *p == '-';
+			p++;
+		}
+		if( lexNumber(p, result) && (*p == '\0') )
+		{
+			if( negate )
+			{
+				if( result.type == Value::FLOAT )
+					result.f = -result.f;
+				else
+					result.i = -result.i;
+			}
+			return true;
+		}
+
+		// Python would have been handed this unquoted, as something other
+		// than a plain literal.
+		char *end;
+		strtod( text.c_str(), &end );
+		if( *end == '\0' )
+			return false;
+
+		result = Value::String( text );
+		return true;
+	}
+
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	// --- CLASS Expression::Node and subclasses
+	// ---
+	// --- eval() returns false for anything Python would have to handle,
+	// --- including its runtime errors.
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	class Expression::Node
+	{
+	public:
+		virtual ~Node() {}
+		virtual bool eval( const SymbolTable &symbols, Value &result ) = 0;
+		virtual bool isConst() { return false; }
+	};
+
+	class ConstNode : public Expression::Node
+	{
+	public:
+		ConstNode( const Value &value ) : value(value) {}
+		virtual bool eval( const SymbolTable &symbols, Value &result ) { result = value; return true; }
+		virtual bool isConst() { return true; }
+
+		Value value;
+	};
+
+	class SymbolNode : public Expression::Node
+	{
+	public:
+		SymbolNode( const string &name ) : name(name) {}
+
+		virtual bool eval( const SymbolTable &symbols, Value &result )
+		{
+			SymbolTable::const_iterator it = symbols.find( name );
+			if( it == symbols.end() )
+				return false;
+			return parseSymbolValue( it->second, result );
+		}
+
+		string name;
+	};
+
+	enum Op
+	{
+		OP_NEG, OP_POS, OP_NOT,
+		OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_FLOORDIV, OP_MOD, OP_POW,
+		OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE
+	};
+
+	class UnaryNode : public Expression::Node
+	{
+	public:
+		UnaryNode( Op op, Node *operand ) : op(op), operand(operand) {}
+		virtual ~UnaryNode() { delete operand; }
+
+		virtual bool eval( const SymbolTable &symbols, Value &result )
+		{
+			Value x;
+			if( !operand->eval(symbols, x) )
+				return false;
+
+			if( op == OP_NOT )
+			{
+				result = Value::Bool( !x.truth() );
+				return true;
+			}
+
+			if( !x.isNumber() )
+				return false;
+
+			if( x.type == Value::FLOAT )
+				result = Value::Float( op == OP_NEG ? -x.f : x.f );
+			else
+				result = Value::Int( op == OP_NEG ? -x.toInt() : x.toInt() );
+			return true;
+		}
+
+		Op op;
+		Node *operand;
+	};
+
+	class BinaryNode : public Expression::Node
+	{
+	public:
+		BinaryNode( Op op, Node *left, Node *right ) : op(op), left(left), right(right) {}
+		virtual ~BinaryNode() { delete left; delete right; }
+
+		virtual bool eval( const SymbolTable &symbols, Value &result )
+		{
+			Value a, b;
+			if( !left->eval(symbols, a) || !right->eval(symbols, b) )
+				return false;
+
+			if( op >= OP_EQ )
+				return compare( a, b, result );
+			else
+				return arith( a, b, result );
+		}
+
+		bool compare( const Value &a, const Value &b, Value &result )
+		{
+			int cmp;
+
+			if( a.isNumber() && b.isNumber() )
+			{
+				if( (a.type != Value::FLOAT) && (b.type != Value::FLOAT) )
+					cmp = a.toInt() < b.toInt() ? -1 : a.toInt() > b.toInt() ? 1 : 0;
+				else
+					cmp = a.toFloat() < b.toFloat() ? -1 : a.toFloat() > b.toFloat() ? 1 : 0;
+			}
+			else if( (a.type == Value::STRING) && (b.type == Value::STRING) )
+			{
+				cmp = a.s.compare( b.s );
+			}
+			else
+			{
+				// Python 2 orders mismatched types by type name; not worth it
+				if( (op != OP_EQ) && (op != OP_NE) )
+					return false;
+				result = Value::Bool( op == OP_NE );
+				return true;
+			}
+
+			switch( op )
+			{
+			case OP_EQ: result = Value::Bool( cmp == 0 ); break;
+			case OP_NE: result = Value::Bool( cmp != 0 ); break;
+			case OP_LT: result = Value::Bool( cmp < 0 ); break;
+			case OP_LE: result = Value::Bool( cmp <= 0 ); break;
+			case OP_GT: result = Value::Bool( cmp > 0 ); break;
+			case OP_GE: result = Value::Bool( cmp >= 0 ); break;
+			default: assert( false );
+			}
+			return true;
+		}
+
+		bool arith( const Value &a, const Value &b, Value &result )
+		{
+			if( (op == OP_ADD) && (a.type == Value::STRING) && (b.type == Value::STRING) )
+			{
+				result = Value::String( a.s + b.s );
+				return true;
+			}
+
+			if( !a.isNumber() || !b.isNumber() )
+				return false;
+
+			if( (a.type == Value::FLOAT) || (b.type == Value::FLOAT) )
+			{
+				double x = a.toFloat(), y = b.toFloat();
+				double r;
+
+				switch( op )
+				{
+				case OP_ADD: r = x + y; break;
+				case OP_SUB: r = x - y; break;
+				case OP_MUL: r = x * y; break;
+				case OP_DIV:
+					if( y == 0.0 ) return false;
+					r = x / y;
+					break;
+				case OP_FLOORDIV:
+					if( y == 0.0 ) return false;
+					r = floor( x / y );
+					break;
+				case OP_MOD:
+					if( y == 0.0 ) return false;
+					r = fmod( x, y );
+					if( (r != 0.0) && ((r < 0.0) != (y < 0.0)) )
+						r += y;
+					break;
+				case OP_POW:
+					if( (x == 0.0) && (y < 0.0) ) return false;
+					if( (x < 0.0) && (y != floor(y)) ) return false;
+					r = pow( x, y );
+					break;
+				default: assert( false ); return false;
+				}
+
+				result = Value::Float( r );
+				return true;
+			}
+
+			long x = a.toInt(), y = b.toInt();
+			long r;
+
+			// Python promotes to long on overflow; let it.
+			switch( op )
+			{
+			case OP_ADD:
+				r = (long)((unsigned long)x + (unsigned long)y);
+				if( ((x < 0) == (y < 0)) && ((r < 0) != (x < 0)) ) return false;
+				break;
+			case OP_SUB:
+				r = (long)((unsigned long)x - (unsigned long)y);
+				if( ((x < 0) != (y < 0)) && ((r < 0) != (x < 0)) ) return false;
+				break;
+			case OP_MUL:
+				if( (x != 0) && ((labs(x) > 0x7fffffffL) || (labs(y) > 0x7fffffffL)) ) return false;
+				r = x * y;
+				break;
+			case OP_DIV:
+			case OP_FLOORDIV:
+				if( y == 0 ) return false;
+				r = x / y;
+				if( ((x % y) != 0) && ((x < 0) != (y < 0)) )
+					r--;
+				break;
+			case OP_MOD:
+				if( y == 0 ) return false;
+				r = x % y;
+				if( (r != 0) && ((r < 0) != (y < 0)) )
+					r += y;
+				break;
+			case OP_POW:
+				if( y < 0 )
+				{
+					if( x == 0 ) return false;
+					result = Value::Float( pow((double)x, (double)y) );
+					return true;
+				}
+				if( labs(x) <= 1 )
+				{
+					r = (x == -1) ? ((y % 2) ? -1 : 1) : ((y == 0) ? 1 : x);
+					break;
+				}
+				r = 1;
+				for( long n = 0; n < y; n++ )
+				{
+					if( labs(r) > 0x7fffffffL || labs(x) > 0x7fffffffL ) return false;
+					r *= x;
+				}
+				break;
+			default: assert( false ); return false;
+			}
+
+			result = Value::Int( r );
+			return true;
+		}
+
+		Op op;
+		Node *left;
+		Node *right;
+	};
+
+	// Python's and/or yield one of their operands, not a bool
+	class LogicalNode : public Expression::Node
+	{
+	public:
+		LogicalNode( bool isAnd, Node *left, Node *right ) : isAnd(isAnd), left(left), right(right) {}
+		virtual ~LogicalNode() { delete left; delete right; }
+
+		virtual bool eval( const SymbolTable &symbols, Value &result )
+		{
+			if( !left->eval(symbols, result) )
+				return false;
+			if( result.truth() != isAnd )
+				return true;
+			return right->eval( symbols, result );
+		}
+
+		bool isAnd;
+		Node *left;
+		Node *right;
+	};
+
+	class ConditionalNode : public Expression::Node
+	{
+	public:
+		ConditionalNode( Node *cond, Node *ifTrue, Node *ifFalse ) : cond(cond), ifTrue(ifTrue), ifFalse(ifFalse) {}
+		virtual ~ConditionalNode() { delete cond; delete ifTrue; delete ifFalse; }
+
+		virtual bool eval( const SymbolTable &symbols, Value &result )
+		{
+			Value c;
+			if( !cond->eval(symbols, c) )
+				return false;
+			return (c.truth() ? ifTrue : ifFalse)->eval( symbols, result );
+		}
+
+		Node *cond;
+		Node *ifTrue;
+		Node *ifFalse;
+	};
+
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	// --- CLASS ExpressionParser
+	// ---
+	// --- Recursive descent over Python's grammar for the forms we handle.
+	// --- Every parse function returns NULL if the text is unsupported. Nodes
+	// --- whose operands are constant are folded as they are built.
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	class ExpressionParser
+	{
+	public:
+		ExpressionParser( const string &source ) : source(source), p(this->source.c_str()) {}
+
+		Expression::Node *parse()
+		{
+			Expression::Node *node = parseConditional();
+			skipSpace();
+			if( node && (*p != '\0') )
+			{
+				delete node;
+				return NULL;
+			}
+			return node;
+		}
+
+	private:
+		void skipSpace()
+		{
+			while( isspace(*p) )
+				p++;
+		}
+
+		// Consumes op if it is next, and isn't the start of a longer operator
+		bool accept( const char *op )
+		{
+			skipSpace();
+			size_t n = strlen( op );
+			if( strncmp(p, op, n) != 0 )
+				return false;
+			if( isalpha(op[0]) && (isalnum(p[n]) || (p[n] == '_')) )
+				return false;
+			if( !isalpha(op[0]) && (n == 1) && (p[1] == '=' || p[1] == op[0]) && strchr("*/<>=!", op[0]) )
+				return false;
+			p += n;
+			return true;
+		}
+
+		static Expression::Node *fold( Expression::Node *node )
+		{
+			static SymbolTable noSymbols;
+			Value value;
+
+			if( node->eval(noSymbols, value) )
+			{
+				delete node;
+				return new ConstNode( value );
+			}
+			return node;
+		}
+
+		static bool truthOf( Expression::Node *node )
+		{
+			return ((ConstNode *)node)->value.truth();
+		}
+
+		Expression::Node *parseConditional()
+		{
+			Expression::Node *ifTrue = parseOr();
+			if( !ifTrue || !accept("if") )
+				return ifTrue;
+
+			Expression::Node *cond = parseOr();
+			if( !cond || !accept("else") )
+			{
+				delete ifTrue;
+				delete cond;
+				return NULL;
+			}
+
+			Expression::Node *ifFalse = parseConditional();
+			if( !ifFalse )
+			{
+				delete ifTrue;
+				delete cond;
+				return NULL;
+			}
+
+			if( cond->isConst() )
+			{
+				bool c = truthOf( cond );
+				delete cond;
+				delete (c ? ifFalse : ifTrue);
+				return c ? ifTrue : ifFalse;
+			}
+
+			return new ConditionalNode( cond, ifTrue, ifFalse );
+		}
+
+		Expression::Node *parseOr()
+		{
+			return parseLogical( false );
+		}
+
+		Expression::Node *parseLogical( bool isAnd )
+		{
+			Expression::Node *left = isAnd ? parseNot() : parseLogical( true );
+
+			while( left && accept(isAnd ? "and" : "or") )
+			{
+				Expression::Node *right = isAnd ? parseNot() : parseLogical( true );
+				if( !right )
+				{
+					delete left;
+					return NULL;
+				}
+
+				if( left->isConst() )
+				{
+					// A constant left operand decides which side is the result
+					if( truthOf(left) != isAnd )
+					{
+						delete right;
+					}
+					else
+					{
+						delete left;
+						left = right;
+					}
+				}
+				else
+				{
+					left = new LogicalNode( isAnd, left, right );
+				}
+			}
+
+			return left;
+		}
+
+		Expression::Node *parseNot()
+		{
+			if( accept("not") )
+			{
+				Expression::Node *operand = parseNot();
+				return operand ? fold( new UnaryNode(OP_NOT, operand) ) : NULL;
+			}
+			return parseComparison();
+		}
+
+		bool acceptComparison( Op &op )
+		{
+			if( accept("==") ) op = OP_EQ;
+			else if( accept("!=") ) op = OP_NE;
+			else if( accept("<=") ) op = OP_LE;
+			else if( accept(">=") ) op = OP_GE;
+			else if( accept("<") ) op = OP_LT;
+			else if( accept(">") ) op = OP_GT;
+			else return false;
+			return true;
+		}
+
+		Expression::Node *parseComparison()
+		{
+			Expression::Node *left = parseArith();
+			Op op;
+
+			if( !left || !acceptComparison(op) )
+				return left;
+
+			Expression::Node *right = parseArith();
+			if( !right )
+			{
+				delete left;
+				return NULL;
+			}
+
+			Expression::Node *node = fold( new BinaryNode(op, left, right) );
+
+			// Chained comparisons (a < b < c) are left to Python
+			if( acceptComparison(op) )
+			{
+				delete node;
+				return NULL;
+			}
+
+			return node;
+		}
+
+		Expression::Node *parseArith()
+		{
+			Expression::Node *left = parseTerm();
+
+			while( left )
+			{
+				Op op;
+				if( accept("+") ) op = OP_ADD;
+				else if( accept("-") ) op = OP_SUB;
+				else break;
+
+				Expression::Node *right = parseTerm();
+				if( !right )
+				{
+					delete left;
+					return NULL;
+				}
+				left = fold( new BinaryNode(op, left, right) );
+			}
+
+			return left;
+		}
+
+		Expression::Node *parseTerm()
+		{
+			Expression::Node *left = parseFactor();
+
+			while( left )
+			{
+				Op op;
+				if( accept("*") ) op = OP_MUL;
+				else if( accept("//") ) op = OP_FLOORDIV;
+				else if( accept("/") ) op = OP_DIV;
+				else if( accept("%") ) op = OP_MOD;
+				else break;
+
+				Expression::Node *right = parseFactor();
+				if( !right )
+				{
+					delete left;
+					return NULL;
+				}
+				left = fold( new BinaryNode(op, left, right) );
+			}
+
+			return left;
+		}
+
+		Expression::Node *parseFactor()
+		{
+			Op op;
+			if( accept("-") ) op = OP_NEG;
+			else if( accept("+") ) op = OP_POS;
+			else return parsePower();
+
+			Expression::Node *operand = parseFactor();
+			return operand ? fold( new UnaryNode(op, operand) ) : NULL;
+		}
+
+		Expression::Node *parsePower()
+		{
+			Expression::Node *left = parseAtom();
+			if( !left || !accept("**") )
+				return left;
+
+			Expression::Node *right = parseFactor();
+			if( !right )
+			{
+				delete left;
+				return NULL;
+			}
+			return fold( new BinaryNode(OP_POW, left, right) );
+		}
+
+		Expression::Node *parseAtom()
+		{
+			skipSpace();
+
+			if( *p == '(' )
+			{
+				p++;
+				Expression::Node *node = parseConditional();
+				if( node && !accept(")") )
+				{
+					delete node;
+					return NULL;
+				}
+				return node;
+			}
+
+			if( isdigit(*p) || ((*p == '.') && isdigit(p[1])) )
+			{
+				Value value;
+				if( !lexNumber(p, value) )
+					return NULL;
+				return new ConstNode( value );
+			}
+
+			if( *p == '"' )
+			{
+				const char *end = strchr( p + 1, '"' );
+				if( end == NULL )
+					return NULL;
+				Value value = Value::String( string(p + 1, end - p - 1) );
+				p = end + 1;
+				return new ConstNode( value );
+			}
+
+			if( isalpha(*p) || (*p == '_') )
+			{
+				const char *start = p;
+				while( isalnum(*p) || (*p == '_') )
+					p++;
+				string name( start, p - start );
+
+				if( name == "True" )
+					return new ConstNode( Value::Bool(true) );
+				if( name == "False" )
+					return new ConstNode( Value::Bool(false) );
+				if( (name == "and") || (name == "or") || (name == "not") || (name == "if") || (name == "else")
+					|| (name == "in") || (name == "is") || (name == "lambda") || (name == "None") )
+				{
+					return NULL;
+				}
+
+				// Calls, attributes and subscripts are left to Python
+				skipSpace();
+				if( (*p == '(') || (*p == '.') || (*p == '[') )
+					return NULL;
+
+				return new SymbolNode( name );
+			}
+
+			return NULL;
+		}
+
+		string source;
+		const char *p;
+	};
+
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	// --- CLASS Expression
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	Expression::Cache Expression::cache;
+
+	Expression::Expression( Node *root )
+	{
+		this->root = root;
+	}
+
+	Expression::~Expression()
+	{
+		delete root;
+	}
+
+	bool Expression::eval( const string &text,
+						   const SymbolTable &symbols,
+						   string &result )
+	{
+		Cache::iterator it = cache.find( text );
+		Expression *expr;
+
+		if( it == cache.end() )
+		{
+			expr = compile( text );
+			cache[text] = expr;
+		}
+		else
+		{
+			expr = it->second;
+		}
+
+		if( expr == NULL )
+			return false;
+
+		Value value;
+		if( !expr->root->eval(symbols, value) )
+			return false;
+
+		result = value.format();
+		return true;
+	}
+
+	Expression *Expression::compile( const string &text )
+	{
+		// The Python evaluator hands the text to the shell inside double
+		// quotes and then to Python inside a single-quoted string, so undo
+		// the shell's escapes and give up on anything either would treat
+		// specially.
+		string source;
+		for( const char *p = text.c_str(); *p; p++ )
+		{
+			if( (*p == '\\') && p[1] && strchr("\"\\$`", p[1]) )
+			{
+				p++;
+				source += *p;
+			}
+			else if( strchr("$`", *p) )
+			{
+				return NULL;
+			}
+			else
+			{
+				source += *p;
+			}
+		}
+		if( source.find_first_of("'\\") != string::npos )
+			return NULL;
+
+		Node *root = ExpressionParser( source ).parse();
+		if( root == NULL )
+			return NULL;
+
+		return new Expression( root );
+	}
+}
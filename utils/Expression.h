@@ -0,0 +1,48 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace proplib
+{
+	// Maps a symbol name to its value, as the text of a scalar property.
+	typedef std::map<std::string,std::string> SymbolTable;
+
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	// --- CLASS Expression
+	// ---
+	// --- Native evaluation of the Python expressions found in $( ... ).
+	// --- Handles the subset worldfiles actually use: int, float, bool and
+	// --- string literals; symbols; arithmetic; comparisons; and, or, not;
+	// --- and "x if cond else y", all with Python 2 semantics (e.g. integer
+	// --- division floors) and Python's formatting of the result.
+	// ---
+	// --- Anything else (function calls, chained comparisons, runtime
+	// --- errors) is reported as unsupported so the caller can fall back on
+	// --- the Python interpreter, which also produces the error messages.
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	class Expression
+	{
+	public:
+		// Returns false if the expression must be evaluated by Python.
+		// Expressions are compiled once per distinct text and cached.
+		static bool eval( const std::string &text,
+						  const SymbolTable &symbols,
+						  std::string &result );
+
+		class Node;
+
+	private:
+		Expression( Node *root );
+		~Expression();
+
+		static Expression *compile( const std::string &text );
+
+		typedef std::map<std::string, Expression *> Cache;
+		static Cache cache;
+
+		Node *root;
+	};
+}
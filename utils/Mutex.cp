@@ -81,6 +81,16 @@ ConditionMonitor::~ConditionMonitor()
 	pthread_cond_destroy( &cond );
 }
 
+void ConditionMonitor::lock()
+{
+	WaitMutex::lock();
+}
+
+void ConditionMonitor::unlock()
+{
+	WaitMutex::unlock();
+}
+
 void ConditionMonitor::notify()
 {
 	int rc = pthread_cond_signal( &cond );
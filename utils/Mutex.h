@@ -81,6 +81,9 @@ class ConditionMonitor : public IMonitor, public WaitMutex
 	ConditionMonitor();
 	virtual ~ConditionMonitor();
 
+	virtual void lock();
+	virtual void unlock();
+
 	virtual void notify();
 	virtual void notifyAll();
 	virtual void wait();
@@ -0,0 +1,428 @@
+#include "PositionLog.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+using namespace positionlog;
+
+static const char LogMagic[4] = {'P', 'W', 'P', 'L'};
+static const char IndexMagic[4] = {'P', 'W', 'P', 'I'};
+static const int32_t Version = 1;
+
+static const size_t HeaderSize = sizeof(LogMagic) + sizeof(Version);
+static const size_t RecordSize = sizeof(Record);
+
+#define WRITE(X) fwrite( &(X), sizeof(X), 1, f )
+#define READ(X) (fread( &(X), sizeof(X), 1, f ) == 1)
+
+//---------------------------------------------------------------------------
+// PositionWriter::PositionWriter
+//---------------------------------------------------------------------------
+PositionWriter::PositionWriter( const char *path )
+{
+	this->path = path;
+
+	f = fopen( path, "wb" );
+	if( f == NULL )
+	{
+		fprintf( stderr, "Failed opening position log \"%s\" for writing\n", path );
+		exit( 1 );
+	}
+
+	fwrite( LogMagic, sizeof(LogMagic), 1, f );
+	WRITE( Version );
+
+	offset = HeaderSize;
+	blockStep = -1;
+}
+
+//---------------------------------------------------------------------------
+// PositionWriter::~PositionWriter
+//---------------------------------------------------------------------------
+PositionWriter::~PositionWriter()
+{
+	close();
+}
+
+//---------------------------------------------------------------------------
+// PositionWriter::add
+//---------------------------------------------------------------------------
+void PositionWriter::add( long step, long agent, float x, float y, float z )
+{
+	assert( f );
+
+	if( step != blockStep )
+	{
+		assert( step > blockStep );
+		flushBlock();
+		blockStep = (int32_t)step;
+	}
+
+	map<long, AgentEntry>::iterator it = agents.find( agent );
+	if( it == agents.end() )
+	{
+		AgentEntry &entry = agents[agent];
+		entry.firstStep = entry.lastStep = (int32_t)step;
+		entry.offset = offset;
+	}
+	else
+	{
+		it->second.lastStep = (int32_t)step;
+	}
+
+	Record rec = { (int32_t)agent, x, y, z };
+	block.push_back( rec );
+}
+
+//---------------------------------------------------------------------------
+// PositionWriter::close
+//---------------------------------------------------------------------------
+void PositionWriter::close()
+{
+	if( f == NULL )
+		return;
+
+	flushBlock();
+	fclose( f );
+	f = NULL;
+
+	writeIndex();
+}
+
+//---------------------------------------------------------------------------
+// PositionWriter::flushBlock
+//
+// Writes the records of the current step, if any, as one block.
+//---------------------------------------------------------------------------
+void PositionWriter::flushBlock()
+{
+	if( block.empty() )
+		return;
+
+	BlockEntry entry = { blockStep, offset };
+	blocks.push_back( entry );
+
+	int32_t count = block.size();
+	WRITE( blockStep );
+	WRITE( count );
+	fwrite( &block[0], RecordSize, count, f );
+
+	offset += 2 * sizeof(int32_t) + count * RecordSize;
+	block.clear();
+}
+
+//---------------------------------------------------------------------------
+// PositionWriter::writeIndex
+//---------------------------------------------------------------------------
+void PositionWriter::writeIndex()
+{
+	string indexPath = path + ".idx";
+
+	f = fopen( indexPath.c_str(), "wb" );
+	if( f == NULL )
+	{
+		fprintf( stderr, "Failed opening position index \"%s\" for writing\n", indexPath.c_str() );
+		exit( 1 );
+	}
+
+	fwrite( IndexMagic, sizeof(IndexMagic), 1, f );
+	WRITE( Version );
+
+	int32_t nblocks = blocks.size();
+	WRITE( nblocks );
+	for( size_t i = 0; i < blocks.size(); i++ )
+	{
+		WRITE( blocks[i].step );
+		WRITE( blocks[i].offset );
+	}
+
+	int32_t nagents = agents.size();
+	WRITE( nagents );
+	for( map<long, AgentEntry>::iterator it = agents.begin(); it != agents.end(); ++it )
+	{
+		int32_t agent = it->first;
+		WRITE( agent );
+		WRITE( it->second.firstStep );
+		WRITE( it->second.lastStep );
+		WRITE( it->second.offset );
+	}
+
+	fclose( f );
+	f = NULL;
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::PositionReader
+//---------------------------------------------------------------------------
+PositionReader::PositionReader( const char *path )
+{
+	this->path = path;
+
+	f = fopen( path, "rb" );
+	if( f == NULL )
+	{
+		fprintf( stderr, "Failed opening position log \"%s\"\n", path );
+		exit( 1 );
+	}
+
+	char magic[sizeof(LogMagic)];
+	int32_t version;
+	if( (fread(magic, sizeof(magic), 1, f) != 1)
+		|| (memcmp(magic, LogMagic, sizeof(magic)) != 0)
+		|| !READ(version)
+		|| (version != Version) )
+	{
+		fprintf( stderr, "\"%s\" is not a position log\n", path );
+		exit( 1 );
+	}
+
+	if( !readIndex() )
+		buildIndex();
+
+	iblock = 0;
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::~PositionReader
+//---------------------------------------------------------------------------
+PositionReader::~PositionReader()
+{
+	fclose( f );
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::getFirstStep
+//---------------------------------------------------------------------------
+long PositionReader::getFirstStep()
+{
+	return blocks.empty() ? -1 : blocks.front().step;
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::getLastStep
+//---------------------------------------------------------------------------
+long PositionReader::getLastStep()
+{
+	return blocks.empty() ? -1 : blocks.back().step;
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::getAgent
+//---------------------------------------------------------------------------
+bool PositionReader::getAgent( long agent, vector<Position> &positions )
+{
+	positions.clear();
+
+	map<long, AgentEntry>::iterator it = agents.find( agent );
+	if( it == agents.end() )
+		return false;
+
+	AgentEntry &entry = it->second;
+
+	// Blocks are in step order, so find the agent's first block by step.
+	size_t lo = 0, hi = blocks.size();
+	while( lo < hi )
+	{
+		size_t mid = (lo + hi) / 2;
+		if( blocks[mid].step < entry.firstStep )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	assert( lo < blocks.size() && blocks[lo].offset == entry.offset );
+
+	vector<Position> block;
+	for( size_t i = lo; i < blocks.size() && blocks[i].step <= entry.lastStep; i++ )
+	{
+		long step;
+		if( !readBlock(blocks[i].offset, step, block) )
+			break;
+
+		for( size_t j = 0; j < block.size(); j++ )
+		{
+			if( block[j].agent == agent )
+			{
+				positions.push_back( block[j] );
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::seekStep
+//---------------------------------------------------------------------------
+void PositionReader::seekStep( long step )
+{
+	size_t lo = 0, hi = blocks.size();
+	while( lo < hi )
+	{
+		size_t mid = (lo + hi) / 2;
+		if( blocks[mid].step < step )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	iblock = lo;
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::nextStep
+//---------------------------------------------------------------------------
+bool PositionReader::nextStep( long &step, vector<Position> &positions )
+{
+	if( iblock >= blocks.size() )
+		return false;
+
+	return readBlock( blocks[iblock++].offset, step, positions );
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::readIndex
+//
+// Returns false if there is no usable index.
+//---------------------------------------------------------------------------
+bool PositionReader::readIndex()
+{
+	string indexPath = path + ".idx";
+	FILE *fidx = fopen( indexPath.c_str(), "rb" );
+	if( fidx == NULL )
+		return false;
+
+	FILE *flog = f;
+	f = fidx;
+
+	bool ok = true;
+	char magic[sizeof(IndexMagic)];
+	int32_t version;
+	int32_t nblocks;
+	int32_t nagents;
+
+	if( (fread(magic, sizeof(magic), 1, f) != 1)
+		|| (memcmp(magic, IndexMagic, sizeof(magic)) != 0)
+		|| !READ(version)
+		|| (version != Version)
+		|| !READ(nblocks) )
+	{
+		ok = false;
+	}
+
+	for( int32_t i = 0; ok && i < nblocks; i++ )
+	{
+		int32_t step;
+		int64_t offset;
+		if( !READ(step) || !READ(offset) )
+		{
+			ok = false;
+			break;
+		}
+		BlockEntry entry = { step, offset };
+		blocks.push_back( entry );
+	}
+
+	if( ok && !READ(nagents) )
+		ok = false;
+
+	for( int32_t i = 0; ok && i < nagents; i++ )
+	{
+		int32_t agent, firstStep, lastStep;
+		int64_t offset;
+		if( !READ(agent) || !READ(firstStep) || !READ(lastStep) || !READ(offset) )
+		{
+			ok = false;
+			break;
+		}
+		AgentEntry &entry = agents[agent];
+		entry.firstStep = firstStep;
+		entry.lastStep = lastStep;
+		entry.offset = offset;
+	}
+
+	fclose( fidx );
+	f = flog;
+
+	if( !ok )
+	{
+		fprintf( stderr, "Warning: ignoring corrupt position index \"%s\"\n", indexPath.c_str() );
+		blocks.clear();
+		agents.clear();
+	}
+
+	return ok;
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::buildIndex
+//
+// Walks the whole log. A block truncated by an interrupted run ends it.
+//---------------------------------------------------------------------------
+void PositionReader::buildIndex()
+{
+	int64_t offset = HeaderSize;
+	vector<Position> block;
+	long step;
+
+	while( readBlock(offset, step, block) )
+	{
+		BlockEntry entry = { step, offset };
+		blocks.push_back( entry );
+
+		for( size_t i = 0; i < block.size(); i++ )
+		{
+			map<long, AgentEntry>::iterator it = agents.find( block[i].agent );
+			if( it == agents.end() )
+			{
+				AgentEntry &agent = agents[block[i].agent];
+				agent.firstStep = agent.lastStep = step;
+				agent.offset = offset;
+			}
+			else
+			{
+				it->second.lastStep = step;
+			}
+		}
+
+		offset += 2 * sizeof(int32_t) + block.size() * RecordSize;
+	}
+}
+
+//---------------------------------------------------------------------------
+// PositionReader::readBlock
+//---------------------------------------------------------------------------
+bool PositionReader::readBlock( int64_t offset, long &step, vector<Position> &positions )
+{
+	positions.clear();
+
+	int32_t blockStep;
+	int32_t count;
+
+	if( (fseeko(f, offset, SEEK_SET) != 0) || !READ(blockStep) || !READ(count) )
+		return false;
+
+	step = blockStep;
+
+	buffer.resize( count * RecordSize );
+	if( count > 0 && fread(&buffer[0], RecordSize, count, f) != (size_t)count )
+		return false;
+
+	positions.resize( count );
+	for( int32_t i = 0; i < count; i++ )
+	{
+		Record rec;
+		memcpy( &rec, &buffer[i * RecordSize], RecordSize );
+
+		Position &pos = positions[i];
+		pos.step = step;
+		pos.agent = rec.agent;
+		pos.x = rec.x;
+		pos.y = rec.y;
+		pos.z = rec.z;
+	}
+
+	return true;
+}
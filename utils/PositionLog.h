@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+//===========================================================================
+// Position log
+//
+// The positions of all agents for a whole run, in a single binary file
+// instead of one datalib file per agent. The file is a 4-byte magic and a
+// version, followed by one block per step, appended as the simulation runs:
+//
+//     int32 step, int32 count, count * { int32 agent; float x, y, z; }
+//
+// When the writer is closed, an index is written alongside the log (its
+// path plus ".idx"). It holds the offset of every block and, for every
+// agent, the first and last step it was recorded and the offset of the
+// block holding its first record:
+//
+//     magic, version,
+//     int32 nblocks, nblocks * { int32 step; int64 offset; }
+//     int32 nagents, nagents * { int32 agent; int32 firstStep;
+//                                int32 lastStep; int64 offset; }
+//
+// If the index is missing (e.g. the run was killed) the reader rebuilds it
+// by walking the block headers. All values are in host byte order.
+//===========================================================================
+
+namespace positionlog
+{
+	struct Position
+	{
+		long step;
+		long agent;
+		float x, y, z;
+	};
+
+	// On-disk layout of one record within a block
+	struct Record
+	{
+		int32_t agent;
+		float x, y, z;
+	};
+}
+
+//===========================================================================
+// PositionWriter
+//
+// Records must be added in nondecreasing step order, from a single thread.
+//===========================================================================
+class PositionWriter
+{
+ public:
+	PositionWriter( const char *path );
+	~PositionWriter();
+
+	void add( long step, long agent, float x, float y, float z );
+	void close();
+
+ private:
+	struct AgentEntry
+	{
+		int32_t firstStep;
+		int32_t lastStep;
+		int64_t offset;
+	};
+	struct BlockEntry
+	{
+		int32_t step;
+		int64_t offset;
+	};
+
+	void flushBlock();
+	void writeIndex();
+
+	std::string path;
+	FILE *f;
+	int64_t offset;
+	int32_t blockStep;
+	std::vector<positionlog::Record> block;
+	std::vector<BlockEntry> blocks;
+	std::map<long, AgentEntry> agents;
+};
+
+//===========================================================================
+// PositionReader
+//===========================================================================
+class PositionReader
+{
+ public:
+	PositionReader( const char *path );
+	~PositionReader();
+
+	long getFirstStep();
+	long getLastStep();
+
+	// All positions recorded for one agent, in step order. Returns false if
+	// the agent was never recorded.
+	bool getAgent( long agent, std::vector<positionlog::Position> &positions );
+
+	// Sequential access: position at the first block whose step is >= step,
+	// then read one block per call to nextStep() until it returns false.
+	void seekStep( long step );
+	bool nextStep( long &step, std::vector<positionlog::Position> &positions );
+
+ private:
+	struct AgentEntry
+	{
+		long firstStep;
+		long lastStep;
+		int64_t offset;
+	};
+	struct BlockEntry
+	{
+		long step;
+		int64_t offset;
+	};
+
+	bool readIndex();
+	void buildIndex();
+	bool readBlock( int64_t offset, long &step, std::vector<positionlog::Position> &positions );
+
+	std::string path;
+	FILE *f;
+	std::vector<BlockEntry> blocks;
+	std::map<long, AgentEntry> agents;
+	size_t iblock;
+	std::vector<char> buffer;
+};
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <assert.h>
+#include <omp.h>
+
+#include <deque>
+#include <vector>
 
 #include "Mutex.h"
 
@@ -25,7 +29,8 @@ class IQueue
 };
 
 //
-// Posts may be performed by any thread context.
+// Posts may be performed by any thread context. Grows as needed beyond the
+// initial capacity.
 //
 template <class T>
 class SerialQueue : public IQueue<T>
@@ -35,19 +40,17 @@ class SerialQueue : public IQueue<T>
 				 IMutex *mutex = new SpinMutex(),
 				 bool deleteMutex = true )
 	{
-		this->capacity = capacity;
 		this->mutex = mutex;
 		this->deleteMutex = deleteMutex;
 
-		q = new T[capacity];
+		q.reserve( capacity );
 
-		head = tail = 0;
+		head = 0;
 		isPostingActive = true;
 	}
 
 	virtual ~SerialQueue()
 	{
-		delete [] q;
 		if( deleteMutex )
 			delete mutex;
 	}
@@ -55,10 +58,8 @@ class SerialQueue : public IQueue<T>
 	virtual void post( T val )
 	{
 		assert( isPostingActive );
-		assert( tail <= capacity );
-
 
-		MUTEX( mutex, q[tail++] = val );
+		MUTEX( mutex, q.push_back(val) );
 	}
 
 	virtual bool fetch( T *val )
@@ -67,7 +68,7 @@ class SerialQueue : public IQueue<T>
 
 		MUTEX(mutex,
 
-			  if( head < tail )
+			  if( head < q.size() )
 			  {
 				  *val = q[head];
 				  success = true;
@@ -86,114 +87,210 @@ class SerialQueue : public IQueue<T>
 
 	virtual void reset()
 	{
-		assert( head == tail );
+		assert( head == q.size() );
 
-		head = tail = 0;
+		q.clear();
+		head = 0;
 
 		isPostingActive = true;
 	}
 
  private:
-	size_t capacity;
-	T *q;
+	std::vector<T> q;
 	bool isPostingActive;
 
 	IMutex *mutex;
 	bool deleteMutex;
 
 	size_t head;
-	size_t tail;
 };
 
-// With this implementation the poster will never have to enter a mutex region
-// and will therefore never block. That is its key advantage.
+// Each thread posts to and fetches from its own deque, so in the common case
+// threads don't contend with one another; a thread whose deque is empty steals
+// from the front of the others' deques. Fetchers that find nothing to do sleep
+// until something is posted or endOfPosts() is called, rather than spinning.
 //
-// Note that posts must always be performed by the master thread.
+// Posts and fetches must be performed from within a parallel region, and
+// reset() from outside of one. There is no fixed capacity.
 //
-// Fetchers run full tilt until fetch() can return.
+// The time each thread spends between fetches (busy) and inside fetch (idle)
+// is accumulated across resets, and can be retrieved with getTimes().
 template <class T>
-class BusyFetchQueue : public IQueue<T>
+class WorkStealingQueue : public IQueue<T>
 {
  public:
-	BusyFetchQueue( size_t capacity = 1024 * 16,
-					IMutex *mutex = new SpinMutex(),
-					bool deleteMutex = true )
+	WorkStealingQueue()
 	{
-		this->capacity = capacity;
-		this->mutex = mutex;
-		this->deleteMutex = deleteMutex;
-
-		q = new T[capacity];
-
-		head = tail = 0;
+		nthreads = 0;
+		workers = NULL;
+		npending = 0;
+		nwaiting = 0;
 		isPostingActive = true;
 	}
 
-	virtual ~BusyFetchQueue()
+	virtual ~WorkStealingQueue()
 	{
-		delete [] q;
-		if( deleteMutex )
-		{
-			delete mutex;
-		}
+		delete [] workers;
 	}
 
 	virtual void post( T val )
 	{
 		assert( isPostingActive );
-		assert( tail <= capacity );
 
-		q[tail] = val;
+		Worker &w = workers[ omp_get_thread_num() ];
 
+		MUTEX( w.mutex, w.tasks.push_back(val) );
+
+		monitor.lock();
 #pragma omp atomic
-		tail++;
+		npending++;
+		if( nwaiting > 0 )
+			monitor.notify();
+		monitor.unlock();
 	}
 
 	virtual bool fetch( T *val )
 	{
+		int id = omp_get_thread_num();
+		Worker &w = workers[id];
+		double start = omp_get_wtime();
 		bool success = false;
 
-		do
+		if( w.taskStart >= 0 )
+			w.busy += start - w.taskStart;
+
+		while( !success )
 		{
-			MUTEX(mutex,
-			  
-				  if( head < tail )
-				  {
-					  *val = q[head];
-					  success = true;
-					  head++;
-				  }
-
-				  );
-		} while( !success && isPostingActive );
+			success = take( id, val );
+
+			if( !success )
+			{
+				bool done;
+
+				monitor.lock();
+				while( (npending == 0) && isPostingActive )
+				{
+					nwaiting++;
+					monitor.wait();
+					nwaiting--;
+				}
+				done = (npending == 0);
+				monitor.unlock();
+
+				if( done )
+					break;
+			}
+		}
+
+		double end = omp_get_wtime();
+		w.idle += end - start;
+		w.taskStart = success ? end : -1;
 
 		return success;
 	}
 
 	virtual void endOfPosts()
 	{
+		monitor.lock();
 		isPostingActive = false;
+		monitor.notifyAll();
+		monitor.unlock();
 	}
 
 	virtual void reset()
 	{
-		assert( head == tail );
+		assert( npending == 0 );
+
+		int n = omp_get_max_threads();
+		if( n > nthreads )
+		{
+			Worker *old = workers;
+
+			workers = new Worker[n];
+			for( int i = 0; i < nthreads; i++ )
+			{
+				workers[i].busy = old[i].busy;
+				workers[i].idle = old[i].idle;
+			}
+			delete [] old;
+
+			nthreads = n;
+		}
 
-		head = tail = 0;
+		for( int i = 0; i < nthreads; i++ )
+			workers[i].taskStart = -1;
 
 		isPostingActive = true;
 	}
 
+	int getThreadCount()
+	{
+		return nthreads;
+	}
+
+	void getTimes( int thread, double *busy, double *idle )
+	{
+		*busy = workers[thread].busy;
+		*idle = workers[thread].idle;
+	}
+
  private:
-	size_t capacity;
-	T *q;
-	bool isPostingActive;
+	struct Worker
+	{
+		Worker() : busy(0), idle(0), taskStart(-1) {}
+
+		SpinMutex mutex;
+		std::deque<T> tasks;
+		double busy;
+		double idle;
+		double taskStart;	// negative if not running a task
+		char pad[64];		// keep workers off each other's cache lines
+	};
+
+	// Own tasks are taken most recent first; stolen tasks oldest first.
+	bool take( int id, T *val )
+	{
+		for( int i = 0; i < nthreads; i++ )
+		{
+			Worker &w = workers[ (id + i) % nthreads ];
+			bool success = false;
+
+			w.mutex.lock();
+			if( !w.tasks.empty() )
+			{
+				if( i == 0 )
+				{
+					*val = w.tasks.back();
+					w.tasks.pop_back();
+				}
+				else
+				{
+					*val = w.tasks.front();
+					w.tasks.pop_front();
+				}
+				success = true;
+			}
+			w.mutex.unlock();
+
+			if( success )
+			{
+#pragma omp atomic
+				npending--;
 
-	IMutex *mutex;
-	bool deleteMutex;
+				return true;
+			}
+		}
 
-	size_t head;
-	size_t tail;
+		return false;
+	}
+
+	int nthreads;
+	Worker *workers;
+
+	ConditionMonitor monitor;
+	volatile long npending;
+	int nwaiting;
+	bool isPostingActive;
 };
 
 // With this implementation the poster must enter a mutex region and
@@ -1,12 +1,17 @@
 #include "RandomNumberGenerator.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <gsl/gsl_rng.h>
 
+#include "Checkpoint.h"
+
 #include "misc.h"
 
 RandomNumberGenerator::Type RandomNumberGenerator::types[];
+unsigned int RandomNumberGenerator::streamSeed[2];
 
 namespace __RandomNumberGenerator
 {
@@ -18,8 +23,79 @@ namespace __RandomNumberGenerator
 			RandomNumberGenerator::init();
 		}
 	} init;
+
+	// ---
+	// --- Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as
+	// --- 1, 2, 3", SC11). The counter is {index lo, index hi, id, role}, so
+	// --- a stream costs nothing to create and streams never overlap.
+	// ---
+	struct Stream
+	{
+		uint32_t key[2];
+		uint32_t ctr[4];
+		uint32_t out[4];
+		int next;	// index of next unused word in out
+	};
+
+	static inline void philox_round( uint32_t *ctr, const uint32_t *key )
+	{
+		uint64_t p0 = (uint64_t)0xD2511F53 * ctr[0];
+		uint64_t p1 = (uint64_t)0xCD9E8D57 * ctr[2];
+
+		uint32_t c0 = (uint32_t)(p1 >> 32) ^ ctr[1] ^ key[0];
+		uint32_t c1 = (uint32_t)p1;
+		uint32_t c2 = (uint32_t)(p0 >> 32) ^ ctr[3] ^ key[1];
+		uint32_t c3 = (uint32_t)p0;
+
+		ctr[0] = c0; ctr[1] = c1; ctr[2] = c2; ctr[3] = c3;
+	}
+
+	static void philox( Stream *s )
+	{
+		uint32_t key[2] = { s->key[0], s->key[1] };
+		memcpy( s->out, s->ctr, sizeof(s->out) );
+
+		for( int i = 0; i < 10; i++ )
+		{
+			philox_round( s->out, key );
+			key[0] += 0x9E3779B9;
+			key[1] += 0xBB67AE85;
+		}
+
+		if( ++s->ctr[0] == 0 )
+			++s->ctr[1];
+		s->next = 0;
+	}
+
+	static void philox_seed( Stream *s,
+							 const unsigned int *seed,
+							 int role,
+							 long id )
+	{
+		s->key[0] = seed[0];
+		s->key[1] = seed[1];
+		s->ctr[0] = 0;
+		s->ctr[1] = 0;
+		s->ctr[2] = (uint32_t)id;
+		s->ctr[3] = ((uint32_t)role << 16) ^ (uint32_t)((uint64_t)id >> 32);
+		s->next = 4;
+	}
+
+	// Uniform on [0,1) with 53 bits of precision.
+	static inline double philox_drand( Stream *s )
+	{
+		if( s->next == 4 )
+			philox( s );
+
+		uint32_t a = s->out[s->next++] >> 5;
+		uint32_t b = s->out[s->next++] >> 6;
+
+		return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+	}
 }
 
+using namespace __RandomNumberGenerator;
+
 void RandomNumberGenerator::set( Role role,
 								 Type type )
 {
@@ -28,7 +104,7 @@ void RandomNumberGenerator::set( Role role,
 
 RandomNumberGenerator *RandomNumberGenerator::create( Role role )
 {
-	return new RandomNumberGenerator( types[role] );
+	return new RandomNumberGenerator( role, types[role] );
 }
 
 void RandomNumberGenerator::dispose( RandomNumberGenerator *rng )
@@ -36,6 +112,33 @@ void RandomNumberGenerator::dispose( RandomNumberGenerator *rng )
 	delete rng;
 }
 
+void RandomNumberGenerator::setStreamSeed( long seed0,
+										   long seed1 )
+{
+	streamSeed[0] = (unsigned int)seed0;
+	streamSeed[1] = (unsigned int)seed1;
+}
+
+void RandomNumberGenerator::dumpGlobal( std::ostream &out )
+{
+	// seed48() is the only way to get at the drand48 state, and it replaces
+	// it in the process, so put it straight back.
+	unsigned short xsubi[3] = { 0, 0, 0 };
+	unsigned short *prev = seed48( xsubi );
+	memcpy( xsubi, prev, sizeof(xsubi) );
+	seed48( xsubi );
+
+	checkpoint::putArray( out, xsubi, 3 );
+}
+
+void RandomNumberGenerator::loadGlobal( std::istream &in )
+{
+	unsigned short xsubi[3];
+	checkpoint::getArray( in, xsubi, 3 );
+
+	seed48( xsubi );
+}
+
 void RandomNumberGenerator::init()
 {
 	for( Role role = (Role)0;
@@ -46,8 +149,10 @@ void RandomNumberGenerator::init()
 	}
 }
 
-RandomNumberGenerator::RandomNumberGenerator( Type type )
+RandomNumberGenerator::RandomNumberGenerator( Role role,
+											  Type type )
 {
+	this->role = role;
 	this->type = type;
 
 	switch( type )
@@ -55,6 +160,10 @@ RandomNumberGenerator::RandomNumberGenerator( Type type )
 	case LOCAL:
 		state = gsl_rng_alloc( gsl_rng_mt19937 );
 		break;
+	case STREAM:
+		state = new Stream;
+		philox_seed( (Stream *)state, streamSeed, role, 0 );
+		break;
 	case GLOBAL:
 		state = NULL;
 		break;
@@ -70,6 +179,9 @@ RandomNumberGenerator::~RandomNumberGenerator()
 	case LOCAL:
 		gsl_rng_free( (gsl_rng *)state );
 		break;
+	case STREAM:
+		delete (Stream *)state;
+		break;
 	case GLOBAL:
 		// no-op
 		break;
@@ -84,6 +196,9 @@ void RandomNumberGenerator::seed( long x )
 		gsl_rng_set( (gsl_rng *)state,
 					 x );
 		break;
+	case STREAM:
+		philox_seed( (Stream *)state, streamSeed, role, x );
+		break;
 	case GLOBAL:
 		srand48( x );
 		break;
@@ -92,12 +207,20 @@ void RandomNumberGenerator::seed( long x )
 	}
 }
 
+void RandomNumberGenerator::stream( long id )
+{
+	if( type == STREAM )
+		seed( id );
+}
+
 double RandomNumberGenerator::drand()
 {
 	switch( type )
 	{
 	case LOCAL:
 		return gsl_rng_uniform( (gsl_rng *)state );
+	case STREAM:
+		return philox_drand( (Stream *)state );
 	case GLOBAL:
 		return drand48();
 	default:
@@ -112,3 +235,50 @@ double RandomNumberGenerator::range( double lo,
 				   lo,
 				   hi );
 }
+
+void RandomNumberGenerator::dump( std::ostream &out )
+{
+	switch( type )
+	{
+	case LOCAL:
+		{
+			gsl_rng *rng = (gsl_rng *)state;
+			size_t size = gsl_rng_size( rng );
+			checkpoint::put( out, size );
+			out.write( (const char *)gsl_rng_state(rng), size );
+		}
+		break;
+	case STREAM:
+		checkpoint::put( out, *(Stream *)state );
+		break;
+	case GLOBAL:
+		// no-op
+		break;
+	default:
+		assert( false );
+	}
+}
+
+void RandomNumberGenerator::load( std::istream &in )
+{
+	switch( type )
+	{
+	case LOCAL:
+		{
+			gsl_rng *rng = (gsl_rng *)state;
+			size_t size;
+			checkpoint::get( in, size );
+			assert( size == gsl_rng_size(rng) );
+			in.read( (char *)gsl_rng_state(rng), size );
+		}
+		break;
+	case STREAM:
+		checkpoint::get( in, *(Stream *)state );
+		break;
+	case GLOBAL:
+		// no-op
+		break;
+	default:
+		assert( false );
+	}
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <iostream>
+
 namespace __RandomNumberGenerator
 {
 	class ModuleInit;
@@ -16,13 +18,15 @@ class RandomNumberGenerator
 		NERVOUS_SYSTEM = 0,
 		TOPOLOGICAL_DISTORTION,
 		INIT_WEIGHT,
+		GENOME,
 		__NROLES
 	};
 
 	enum Type
 	{
-		GLOBAL,
-		LOCAL
+		GLOBAL,	// drand48
+		LOCAL,	// a private Mersenne Twister
+		STREAM	// counter-based (Philox4x32-10), keyed by seed, role and id
 	};
 
 	// ---
@@ -35,6 +39,14 @@ class RandomNumberGenerator
 	static RandomNumberGenerator *create( Role role );
 	static void dispose( RandomNumberGenerator *rng );
 
+	// Key shared by all STREAM generators; set it before creating any.
+	static void setStreamSeed( long seed0,
+							   long seed1 );
+
+	// Save/restore the state behind GLOBAL generators (drand48).
+	static void dumpGlobal( std::ostream &out );
+	static void loadGlobal( std::istream &in );
+
  private:
 	friend class __RandomNumberGenerator::ModuleInit;
 
@@ -42,21 +54,33 @@ class RandomNumberGenerator
 
  private:
 	static Type types[__NROLES];
+	static unsigned int streamSeed[2];
 
 	// ---
 	// --- INSTANCE
 	// ---
  private:
-	RandomNumberGenerator( Type type );
+	RandomNumberGenerator( Role role,
+						   Type type );
 	~RandomNumberGenerator();
 
  public:
+	// For STREAM generators, seeding selects stream x of this role, so two
+	// generators seeded alike produce the same numbers on any thread.
 	void seed( long x );
+	// Selects stream id (e.g. an agent number) if this is a STREAM generator,
+	// otherwise does nothing.
+	void stream( long id );
 	double drand();
 	double range( double lo,
 				  double hi );
 
+	// Only LOCAL generators carry state of their own.
+	void dump( std::ostream &out );
+	void load( std::istream &in );
+
  private:
+	Role role;
 	Type type;
 	void *state;
 };
@@ -0,0 +1,207 @@
+#include "StepProfiler.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "datalib.h"
+
+static const char *PhaseNames[StepProfiler::__NPhases] =
+{
+	"Barriers",
+	"ConditionalProps",
+	"UpdateAgents",
+	"Vision",
+	"Brain",
+	"Body",
+	"Interact",
+	"Death",
+	"Contact",
+	"Eat",
+	"Carry",
+	"CreateAgents",
+	"MaintainBricks",
+	"MaintainFood",
+	"Monitoring"
+};
+
+//---------------------------------------------------------------------------
+// StepProfiler::StepProfiler
+//---------------------------------------------------------------------------
+StepProfiler::StepProfiler()
+{
+	enabled = false;
+	frequency = 0;
+	table = NULL;
+	traceFile = NULL;
+}
+
+//---------------------------------------------------------------------------
+// StepProfiler::~StepProfiler
+//---------------------------------------------------------------------------
+StepProfiler::~StepProfiler()
+{
+	stop();
+}
+
+//---------------------------------------------------------------------------
+// StepProfiler::start
+//
+// tracePath may be NULL, in which case no trace is written.
+//---------------------------------------------------------------------------
+void StepProfiler::start( const char *tablePath, int frequency, const char *tracePath )
+{
+	assert( !enabled );
+	assert( frequency > 0 );
+
+	this->frequency = frequency;
+	numSteps = 0;
+	memset( phaseTotal, 0, sizeof(phaseTotal) );
+	memset( counterTotal, 0, sizeof(counterTotal) );
+	agentTotal = 0.0;
+	foodTotal = 0.0;
+	stepTotal = 0.0;
+
+	// Columns are Step, StepMs, one per phase, Contacts, Agents, Food
+	const int ncols = 2 + __NPhases + 3;
+	const char *colnames[ncols + 1];
+	datalib::Type coltypes[ncols];
+	int col = 0;
+
+	colnames[col] = "Step"; coltypes[col++] = datalib::INT;
+	colnames[col] = "StepMs"; coltypes[col++] = datalib::FLOAT;
+	for( int i = 0; i < __NPhases; i++ )
+	{
+		colnames[col] = PhaseNames[i]; coltypes[col++] = datalib::FLOAT;
+	}
+	colnames[col] = "Contacts"; coltypes[col++] = datalib::FLOAT;
+	colnames[col] = "Agents"; coltypes[col++] = datalib::FLOAT;
+	colnames[col] = "Food"; coltypes[col++] = datalib::FLOAT;
+	colnames[col] = NULL;
+	assert( col == ncols );
+
+	table = new DataLibWriter( tablePath );
+	table->beginTable( "StepProfile",
+					   colnames,
+					   coltypes );
+
+	if( tracePath )
+	{
+		traceFile = fopen( tracePath, "w" );
+		if( traceFile == NULL )
+		{
+			fprintf( stderr, "Failed opening step trace \"%s\" for writing\n", tracePath );
+			exit( 1 );
+		}
+		fprintf( traceFile, "[\n" );
+		traceOrigin = hirestime();
+		traceFirst = true;
+	}
+
+	enabled = true;
+}
+
+//---------------------------------------------------------------------------
+// StepProfiler::stop
+//---------------------------------------------------------------------------
+void StepProfiler::stop()
+{
+	if( !enabled )
+		return;
+
+	enabled = false;
+
+	table->endTable();
+	delete table;
+	table = NULL;
+
+	if( traceFile )
+	{
+		fprintf( traceFile, "\n]\n" );
+		fclose( traceFile );
+		traceFile = NULL;
+	}
+}
+
+//---------------------------------------------------------------------------
+// StepProfiler::endStep
+//---------------------------------------------------------------------------
+void StepProfiler::endStep( long step, long numAgents, long numFood )
+{
+	if( !enabled )
+		return;
+
+	double now = hirestime();
+
+	stepTotal += now - stepBegin;
+	agentTotal += numAgents;
+	foodTotal += numFood;
+	numSteps++;
+
+	if( traceFile )
+	{
+		fprintf( traceFile,
+				 "%s{\"name\":\"Step %ld\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.0f,\"dur\":%.0f}",
+				 traceFirst ? "" : ",\n",
+				 step,
+				 (stepBegin - traceOrigin) * 1e6,
+				 (now - stepBegin) * 1e6 );
+		traceFirst = false;
+	}
+
+	if( numSteps == frequency )
+	{
+		writeRow( step );
+
+		numSteps = 0;
+		memset( phaseTotal, 0, sizeof(phaseTotal) );
+		memset( counterTotal, 0, sizeof(counterTotal) );
+		agentTotal = 0.0;
+		foodTotal = 0.0;
+		stepTotal = 0.0;
+	}
+}
+
+//---------------------------------------------------------------------------
+// StepProfiler::getName
+//---------------------------------------------------------------------------
+const char *StepProfiler::getName( Phase phase )
+{
+	return PhaseNames[phase];
+}
+
+//---------------------------------------------------------------------------
+// StepProfiler::trace
+//---------------------------------------------------------------------------
+void StepProfiler::trace( Phase phase, double begin, double end )
+{
+	fprintf( traceFile,
+			 "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.0f,\"dur\":%.0f}",
+			 traceFirst ? "" : ",\n",
+			 PhaseNames[phase],
+			 (begin - traceOrigin) * 1e6,
+			 (end - begin) * 1e6 );
+	traceFirst = false;
+}
+
+//---------------------------------------------------------------------------
+// StepProfiler::writeRow
+//
+// Times are milliseconds per step, counts are per step, averaged over the
+// window.
+//---------------------------------------------------------------------------
+void StepProfiler::writeRow( long step )
+{
+	Variant cols[2 + __NPhases + 3];
+	int col = 0;
+
+	cols[col++] = (int)step;
+	cols[col++] = (float)(stepTotal * 1000.0 / numSteps);
+	for( int i = 0; i < __NPhases; i++ )
+		cols[col++] = (float)(phaseTotal[i] * 1000.0 / numSteps);
+	cols[col++] = (float)counterTotal[Contacts] / numSteps;
+	cols[col++] = (float)(agentTotal / numSteps);
+	cols[col++] = (float)(foodTotal / numSteps);
+
+	table->addRow( cols );
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "PwMovieUtils.h"
+
+class DataLibWriter;
+
+//===========================================================================
+// StepProfiler
+//
+// Wall-clock time spent in each phase of TSimulation::Step(), summed over a
+// window of steps and written as one row per window to a datalib table.
+// Optionally, every phase of every step is also written as a Chrome trace
+// (load it at chrome://tracing or ui.perfetto.dev).
+//
+// Phases are either spans, timed once per step with begin()/end(), or
+// accumulated across many short intervals (e.g. one per agent) with
+// start()/stop(). Only spans appear in the trace. All calls must come from
+// the thread running Step(). When the profiler isn't enabled each call is a
+// single test of a bool.
+//===========================================================================
+class StepProfiler
+{
+ public:
+	enum Phase
+	{
+		Barriers,
+		ConditionalProps,
+		UpdateAgents,
+		Vision,
+		Brain,
+		Body,
+		Interact,
+		Death,
+		Contact,	// mate, fight and give
+		Eat,
+		Carry,
+		CreateAgents,
+		MaintainBricks,
+		MaintainFood,
+		Monitoring,	// windows, archived brains, complexity and other logs
+		__NPhases
+	};
+
+	enum Counter
+	{
+		Contacts,	// pairs of agents close enough to interact
+		__NCounters
+	};
+
+	StepProfiler();
+	~StepProfiler();
+
+	void start( const char *tablePath, int frequency, const char *tracePath );
+	void stop();
+	bool isEnabled();
+
+	void beginStep();
+	void begin( Phase phase );
+	void end( Phase phase );
+
+	void start( Phase phase );
+	void stop( Phase phase );
+
+	void count( Counter counter );
+
+	// Finishes the step begun by beginStep(); numAgents and numFood are
+	// sampled for the table.
+	void endStep( long step, long numAgents, long numFood );
+
+	static const char *getName( Phase phase );
+
+ private:
+	void trace( Phase phase, double begin, double end );
+	void writeRow( long step );
+
+	bool enabled;
+	int frequency;
+	long numSteps;
+	double stepBegin;
+	double phaseBegin[__NPhases];
+	double phaseTotal[__NPhases];
+	long counterTotal[__NCounters];
+	double agentTotal;
+	double foodTotal;
+	double stepTotal;
+
+	DataLibWriter *table;
+	FILE *traceFile;
+	double traceOrigin;
+	bool traceFirst;
+};
+
+inline bool StepProfiler::isEnabled() { return enabled; }
+
+inline void StepProfiler::beginStep()
+{
+	if( enabled )
+		stepBegin = hirestime();
+}
+
+inline void StepProfiler::begin( Phase phase )
+{
+	if( enabled )
+		phaseBegin[phase] = hirestime();
+}
+
+inline void StepProfiler::end( Phase phase )
+{
+	if( enabled )
+	{
+		double now = hirestime();
+		phaseTotal[phase] += now - phaseBegin[phase];
+		if( traceFile )
+			trace( phase, phaseBegin[phase], now );
+	}
+}
+
+inline void StepProfiler::start( Phase phase )
+{
+	if( enabled )
+		phaseBegin[phase] = hirestime();
+}
+
+inline void StepProfiler::stop( Phase phase )
+{
+	if( enabled )
+		phaseTotal[phase] += hirestime() - phaseBegin[phase];
+}
+
+inline void StepProfiler::count( Counter counter )
+{
+	if( enabled )
+		counterTotal[counter]++;
+}
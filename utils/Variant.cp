@@ -48,11 +48,18 @@ Variant::Variant( const char *sval )
 
 Variant::Variant( const Variant &variant )
 {
+	type = INVALID;
 	*this = variant;
 }
 
 Variant &Variant::operator = ( const Variant &variant )
 {
+	if( this == &variant )
+		return *this;
+
+	if( type == STRING )
+		free( const_cast<char *>(sval) );
+
 	type = variant.type;
 	switch(type)
 	{
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <list>
 
+#include "Checkpoint.h"
 #include "datalib.h"
 #include "Energy.h"
 #include "globals.h"
@@ -46,6 +47,9 @@ namespace condprop
 		virtual void setActive( long step, bool active ) = 0;
 		virtual long getEnd( long step ) = 0;
 
+		virtual void dump( std::ostream &out ) {}
+		virtual void load( std::istream &in ) {}
+
 		T getEndValue() { return endValue; }
 		CouplingRange getCouplingRange() { return couplingRange; }
 
@@ -155,6 +159,16 @@ namespace condprop
 			return state.end;
 		}
 
+		virtual void dump( std::ostream &out )
+		{
+			checkpoint::put( out, state );
+		}
+
+		virtual void load( std::istream &in )
+		{
+			checkpoint::get( in, state );
+		}
+
 	private:
 		struct Parameters
 		{
@@ -259,6 +273,48 @@ namespace condprop
 			return activeCondition;
 		}
 
+		//---------------------------------------------------------------------------
+		// dump()
+		//---------------------------------------------------------------------------
+		void dump( std::ostream &out )
+		{
+			int activeIndex = -1;
+			int index = 0;
+
+			itfor( typename Conditions, conditions, it )
+			{
+				if( *it == activeCondition )
+					activeIndex = index;
+				index++;
+			}
+
+			checkpoint::put( out, activeIndex );
+
+			itfor( typename Conditions, conditions, it )
+			{
+				(*it)->dump( out );
+			}
+		}
+
+		//---------------------------------------------------------------------------
+		// load()
+		//---------------------------------------------------------------------------
+		void load( std::istream &in )
+		{
+			int activeIndex;
+			int index = 0;
+
+			checkpoint::get( in, activeIndex );
+
+			activeCondition = NULL;
+			itfor( typename Conditions, conditions, it )
+			{
+				if( index++ == activeIndex )
+					activeCondition = *it;
+				(*it)->load( in );
+			}
+		}
+
 		//---------------------------------------------------------------------------
 		// findBalanceRange()
 		// 
@@ -352,6 +408,8 @@ namespace condprop
 		virtual bool isLogging() = 0;
 		virtual float getNormalizedDistance() = 0;
 		virtual void update( long step, float maxNormalizedDistance ) = 0;
+		virtual void dump( std::ostream &out ) = 0;
+		virtual void load( std::istream &in ) = 0;
 	};
 
 	//===========================================================================
@@ -490,6 +548,24 @@ namespace condprop
 			return logger != NULL;
 		}
 
+		//---------------------------------------------------------------------------
+		// dump()
+		//---------------------------------------------------------------------------
+		virtual void dump( std::ostream &out )
+		{
+			checkpoint::put( out, *value );
+			conditionList->dump( out );
+		}
+
+		//---------------------------------------------------------------------------
+		// load()
+		//---------------------------------------------------------------------------
+		virtual void load( std::istream &in )
+		{
+			checkpoint::get( in, *value );
+			conditionList->load( in );
+		}
+
 	private:
 		//---------------------------------------------------------------------------
 		// FIELDS
@@ -554,6 +630,22 @@ namespace condprop
 			properties.push_back( prop );
 		}
 
+		void dump( std::ostream &out )
+		{
+			itfor( Properties, properties, it )
+			{
+				(*it)->dump( out );
+			}
+		}
+
+		void load( std::istream &in )
+		{
+			itfor( Properties, properties, it )
+			{
+				(*it)->load( in );
+			}
+		}
+
 		void update( long step )
 		{
 			const float maxLead = 0.05;
@@ -15,6 +15,12 @@ using namespace std::tr1::placeholders;
 #define VERSION_READ 2
 #define VERSION_WRITE 3
 
+#define RowBufSize 4096
+// Async mode
+#define AsyncRingRows 16384
+#define AsyncBatchRows 1024	// wake the writer once this many rows are queued
+#define AsyncBlockSize (256 * 1024)
+
 char *rfind( char *begin, char *end, char c );
 char *rfind( char *begin, char *end, char c )
 {
@@ -79,9 +85,11 @@ __Column::__Column( const char *name,
 // ------------------------------------------------------------
 DataLibWriter::DataLibWriter( const char *path,
 							  bool _randomAccess,
-							  bool _singleSchema )
+							  bool _singleSchema,
+							  bool _async )
 : randomAccess( _randomAccess )
 , singleSchema( _singleSchema )
+, async( _async )
 {
 	f = fopen( path, "w" );
 	assert( f );
@@ -89,6 +97,19 @@ DataLibWriter::DataLibWriter( const char *path,
 	table = NULL;
 
 	fileHeader();
+
+	ringHead = ringTail = 0;
+	flushRequested = false;
+	quit = false;
+	block = NULL;
+
+	if( async )
+	{
+		block = new char[AsyncBlockSize];
+
+		int rc = pthread_create( &writerThread, NULL, writerMain, this );
+		assert( rc == 0 );
+	}
 }
 
 // ------------------------------------------------------------
@@ -101,6 +122,19 @@ DataLibWriter::~DataLibWriter()
 		endTable();
 	}
 
+	if( async )
+	{
+		monitor.lock();
+		quit = true;
+		monitor.notifyAll();
+		monitor.unlock();
+
+		pthread_join( writerThread, NULL );
+
+		delete [] block;
+		block = NULL;
+	}
+
 	fileFooter();
 
 	fclose( f );
@@ -116,6 +150,12 @@ void DataLibWriter::beginTable( const char *name,
 {
 	assert( table == NULL );
 
+	if( async )
+	{
+		// The writer must be done with the last table's rows and columns
+		drain();
+	}
+
 	tables.push_back( __Table(name) );
 	table = &tables.back();
 
@@ -139,6 +179,11 @@ void DataLibWriter::beginTable( const char *name,
 	tableHeader();
 
 	table->data = ftell( f );
+
+	if( async )
+	{
+		ring.assign( AsyncRingRows * cols.size(), Variant() );
+	}
 }
 
 // ------------------------------------------------------------
@@ -202,7 +247,27 @@ void DataLibWriter::addRow( Variant *colsdata )
 
 	table->nrows++;
 
-	char buf[4096];
+	if( async )
+	{
+		queueRow( colsdata );
+		return;
+	}
+
+	char buf[RowBufSize];
+	size_t nwrite = formatRow( colsdata, buf, sizeof(buf) );
+
+	size_t n = fwrite( buf, 1, nwrite, f );
+	assert( n == nwrite );
+}
+
+// ------------------------------------------------------------
+// --- formatRow()
+// ---
+// --- Returns the number of chars put in buf, which is not
+// --- null-terminated.
+// ------------------------------------------------------------
+size_t DataLibWriter::formatRow( Variant *colsdata, char *buf, size_t bufsize )
+{
 	char *b = buf;
 
 	if( randomAccess )
@@ -245,7 +310,7 @@ void DataLibWriter::addRow( Variant *colsdata )
 		{
 			*(b++) = '\t';
 		}
-		assert( size_t(b - buf) < sizeof(buf) );
+		assert( size_t(b - buf) < bufsize );
 	}
 
 	if( !randomAccess )
@@ -253,7 +318,7 @@ void DataLibWriter::addRow( Variant *colsdata )
 		b--; // erase last tab
 	}
 	*(b++) = '\n';
-	assert( size_t(b - buf) <= sizeof(buf) );
+	assert( size_t(b - buf) <= bufsize );
 
 	size_t nwrite = b - buf;
 
@@ -269,8 +334,133 @@ void DataLibWriter::addRow( Variant *colsdata )
 			assert( nwrite == table->rowlen );
 		}
 	}
-	size_t n = fwrite( buf, 1, nwrite, f );
-	assert( n == nwrite );
+
+	return nwrite;
+}
+
+// ------------------------------------------------------------
+// --- queueRow()
+// ------------------------------------------------------------
+void DataLibWriter::queueRow( Variant *colsdata )
+{
+	size_t ncols = cols.size();
+
+	monitor.lock();
+
+	// Back-pressure: never more than AsyncRingRows rows behind
+	while( ringHead - ringTail == AsyncRingRows )
+	{
+		monitor.notifyAll();
+		monitor.wait();
+	}
+
+	// The writer only touches rows [ringTail, ringHead), so this slot is ours
+	Variant *slot = &ring[ (ringHead % AsyncRingRows) * ncols ];
+	for( size_t i = 0; i < ncols; i++ )
+	{
+		slot[i] = colsdata[i];
+	}
+	ringHead++;
+
+	if( ringHead - ringTail >= AsyncBatchRows )
+	{
+		monitor.notifyAll();
+	}
+
+	monitor.unlock();
+}
+
+// ------------------------------------------------------------
+// --- drain()
+// ---
+// --- Blocks until the writer has written every queued row.
+// ------------------------------------------------------------
+void DataLibWriter::drain()
+{
+	monitor.lock();
+
+	flushRequested = true;
+	monitor.notifyAll();
+	while( ringTail != ringHead )
+	{
+		monitor.wait();
+	}
+	flushRequested = false;
+
+	monitor.unlock();
+}
+
+// ------------------------------------------------------------
+// --- writerMain()
+// ------------------------------------------------------------
+void *DataLibWriter::writerMain( void *arg )
+{
+	((DataLibWriter *)arg)->writerLoop();
+
+	return NULL;
+}
+
+// ------------------------------------------------------------
+// --- writerLoop()
+// ------------------------------------------------------------
+void DataLibWriter::writerLoop()
+{
+	monitor.lock();
+
+	while( true )
+	{
+		size_t pending = ringHead - ringTail;
+
+		if( (pending >= AsyncBatchRows) || ((pending > 0) && (flushRequested || quit)) )
+		{
+			size_t first = ringTail;
+
+			monitor.unlock();
+			writeRows( first, pending );
+			monitor.lock();
+
+			ringTail += pending;
+			monitor.notifyAll();
+		}
+		else if( quit )
+		{
+			break;
+		}
+		else
+		{
+			monitor.wait();
+		}
+	}
+
+	monitor.unlock();
+}
+
+// ------------------------------------------------------------
+// --- writeRows()
+// ---
+// --- Runs on the writer thread.
+// ------------------------------------------------------------
+void DataLibWriter::writeRows( size_t first, size_t nrows )
+{
+	size_t ncols = cols.size();
+	size_t nblock = 0;
+
+	for( size_t row = first; row < first + nrows; row++ )
+	{
+		if( AsyncBlockSize - nblock < RowBufSize )
+		{
+			size_t n = fwrite( block, 1, nblock, f );
+			assert( n == nblock );
+			nblock = 0;
+		}
+
+		nblock += formatRow( &ring[ (row % AsyncRingRows) * ncols ],
+							 block + nblock,
+							 RowBufSize );
+	}
+
+	size_t n = fwrite( block, 1, nblock, f );
+	assert( n == nblock );
 }
 
 // ------------------------------------------------------------
@@ -279,6 +469,11 @@ void DataLibWriter::addRow( Variant *colsdata )
 void DataLibWriter::endTable()
 {
 	assert( table );
+
+	if( async )
+	{
+		drain();
+	}
 		
 	tableFooter();
 
@@ -290,6 +485,11 @@ void DataLibWriter::endTable()
 // ------------------------------------------------------------
 void DataLibWriter::flush()
 {
+	if( async )
+	{
+		drain();
+	}
+
 	fflush( f );
 }
 
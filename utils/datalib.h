@@ -11,6 +11,7 @@
 #include <tr1/functional>
 
 #include "misc.h"
+#include "Mutex.h"
 #include "Variant.h"
 
 // ================================================================================
@@ -89,13 +90,20 @@ namespace datalib
 // ===
 // === CLASS DataLibWriter
 // ===
+// === If async, addRow() only copies the row into a ring buffer, and a
+// === background thread formats and writes the rows in large blocks. When
+// === the ring is full, addRow() waits for the writer. Everything else
+// === (tables, flush, destruction) first waits for the queued rows to be
+// === written, so the file comes out the same either way.
+// ===
 // ================================================================================
 class DataLibWriter
 {
  public:
 	DataLibWriter( const char *path,
 				   bool randomAccess = false,
-				   bool singleSchema = true );
+				   bool singleSchema = true,
+				   bool async = false );
 	~DataLibWriter();
 
 	void beginTable( const char *name,
@@ -112,6 +120,13 @@ class DataLibWriter
 	void tableHeader();
 	void tableFooter();
 	void colMetaData();
+	size_t formatRow( Variant *colsdata, char *buf, size_t bufsize );
+
+	void queueRow( Variant *colsdata );
+	void drain();
+	static void *writerMain( void *arg );
+	void writerLoop();
+	void writeRows( size_t first, size_t nrows );
 
  private:
 	FILE *f;
@@ -120,6 +135,16 @@ class DataLibWriter
 	datalib::__TableVector tables;
 	datalib::__Table *table;
 	datalib::__ColVector cols;
+
+	bool async;
+	pthread_t writerThread;
+	ConditionMonitor monitor;
+	std::vector<Variant> ring;	// AsyncRingRows rows of cols.size() columns
+	size_t ringHead;			// rows queued
+	size_t ringTail;			// rows written
+	bool flushRequested;
+	bool quit;
+	char *block;				// the writer's output buffer
 };
 
 
@@ -8,9 +8,12 @@
 #define DLINK_H
 
 #define DebugGDL 0
+#define PoolGDL 1
 
 #include <iostream>
+#include <new>
 #include <stdio.h>
+#include <stdlib.h>
 #if DebugGDL
 	#include "debug.h"
 #endif
@@ -19,6 +22,8 @@ template <class TTYPE>
 class gdlist;
 template <class TTYPE>
 class gdlink;
+template <class TTYPE>
+class gdlinkpool;
 
 #if DebugGDL
 	#define gdlPrint( x... ) dbprintf( x )
@@ -49,8 +54,76 @@ public:	/* for debugging only */
 	void insert(gdlink<TTYPE> *n);			
 	void append(gdlink<TTYPE> *n);			
 	void remove();	
+
+#if PoolGDL
+	static void *operator new(size_t size)
+	{
+		if (size != sizeof(gdlink<TTYPE>))
+			return ::operator new(size);
+		return gdlinkpool<TTYPE>::alloc();
+	}
+	static void operator delete(void *p, size_t size)
+	{
+		if (!p) return;
+		if (size != sizeof(gdlink<TTYPE>))
+			::operator delete(p);
+		else
+			gdlinkpool<TTYPE>::free(p);
+	}
+#endif
 };
 
+//-------------------------------------------------------------------------
+// gdlinkpool -- slab allocator for links
+//
+// Links are carved out of slabs of PoolSlabSize and recycled through a
+// free list rather than going to the heap for every add and remove.
+// Links never move once allocated, since gobject and the list cursors
+// hold on to them. Each thread keeps its own free list, so lists may be
+// changed from parallel tasks; a link freed by a thread other than the
+// one that allocated it simply joins the freeing thread's list. Slabs
+// are never handed back to the heap.
+//-------------------------------------------------------------------------
+template <class TTYPE>
+class gdlinkpool {
+public:
+	enum { PoolSlabSize = 256 };
+
+	static void *alloc()
+	{
+		if (!freeList) grow();
+		FreeLink *l = freeList;
+		freeList = l->next;
+		return l;
+	}
+
+	static void free(void *p)
+	{
+		FreeLink *l = (FreeLink *)p;
+		l->next = freeList;
+		freeList = l;
+	}
+
+private:
+	struct FreeLink { FreeLink *next; };
+
+	static void grow()
+	{
+		char *slab = (char *)malloc(PoolSlabSize * sizeof(gdlink<TTYPE>));
+		if (!slab)
+			throw std::bad_alloc();
+		// thread the free list in address order so that a run of adds
+		// lays its links out contiguously.
+		for (int i = PoolSlabSize - 1; i >= 0; i--)
+			free(slab + i * sizeof(gdlink<TTYPE>));
+	}
+
+	static __thread FreeLink *freeList;
+};
+
+template <class TTYPE>
+__thread typename gdlinkpool<TTYPE>::FreeLink *gdlinkpool<TTYPE>::freeList = 0;
+
 //-------------------------------------------------------------------------
 // gdlist -- list declarations
 //-------------------------------------------------------------------------
@@ -78,6 +151,11 @@ public: /* for debugging only */
 			printf("Got one: %s\n",s);		
 	}
 	int isempty() { return lastItem == 0; }  /*lsy*/		
+
+	/* walk the links without the cursor, so several readers can share a list */
+	gdlink<TTYPE>* firstLink() { return lastItem ? lastItem->nextItem : 0; }
+	gdlink<TTYPE>* nextLink(gdlink<TTYPE>* l) { return l == lastItem ? 0 : l->nextItem; }
+
 	void clear();	
 	~gdlist<TTYPE>() { clear(); };			
 	
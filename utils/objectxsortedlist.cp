@@ -7,12 +7,18 @@
  -------------------------------------------------------------------------*/
 
 #include <assert.h>
+#include <math.h>
+
+#include <algorithm>
 
 #include "objectxsortedlist.h"
 #include "agent.h"
 
 #define DebugCounts 0
 
+// Limit on grid cells per side, so tiny cells in a huge world can't exhaust memory
+#define MaxGridDim 1024
+
 #if DebugCounts
 	#define cntPrint( x... ) printf( x )
 #else
@@ -166,6 +172,18 @@ void objectxsortedlist::add( gobject* a )
 #ifdef DEBUGCALLS
     pushproc( "objectxsortedlist::add" );
 #endif // DEBUGCALLS
+	// With a grid, start the search from an object with about the same x
+	// rather than from the head of the list
+	gobject* near = gridEnabled() ? gridNeighbor( a ) : NULL;
+	if( near )
+	{
+		addNear( a, near );
+#ifdef DEBUGCALLS
+		popproc();
+#endif // DEBUGCALLS
+		return;
+	}
+
     bool inserted = false;
     gobject* o;
     this->reset();
@@ -181,6 +199,59 @@ void objectxsortedlist::add( gobject* a )
 
     if( !inserted )
 		a->listLink = this->append( a );
+
+	added( a );
+
+#ifdef DEBUGCALLS
+    popproc();
+#endif // DEBUGCALLS
+
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::addNear
+//---------------------------------------------------------------------------
+// Add an object, searching for its place outward from near, which must be
+// in the list and should have about the same x as a.  Leaves currItem alone.
+void objectxsortedlist::addNear( gobject* a, gobject* near )
+{
+	a->listLink = new gdlink<gobject*>( a );
+	placeNear( a->listLink, near->listLink );
+
+	added( a );
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::addLast
+//---------------------------------------------------------------------------
+// Append an object without searching for its place, for rebuilding a list
+// whose order is already known (e.g. when restoring a checkpoint)
+void objectxsortedlist::addLast( gobject* a )
+{
+	a->listLink = this->append( a );
+
+	added( a );
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::added
+//---------------------------------------------------------------------------
+// Bookkeeping shared by add() and addLast()
+void objectxsortedlist::added( gobject* a )
+{
+	if( a->radius() > maxRadius )
+		maxRadius = a->radius();
+
+	if( gridEnabled() )
+		gridInsert( a );
+
+	// Objects still out of place can mislead the search for a's place, so
+	// have sortMoved() check it as well
+	if( !movedObjects.empty() )
+		moveNear( a );
     
     // Increase object type count based on added object's type
     switch( a->getType() )
@@ -201,11 +272,6 @@ void objectxsortedlist::add( gobject* a )
 			fprintf( stderr, "%s() called for x-sorted object list with invalid object type (%d)\n", __func__, a->getType() );
 			break;
     }
-
-#ifdef DEBUGCALLS
-    popproc();
-#endif // DEBUGCALLS
-
 }
 
 
@@ -285,6 +351,16 @@ void objectxsortedlist::removeCurrentObject()
 				break;
 		}
 
+		if( gridEnabled() )
+			gridRemove( o );
+
+		if( o->xMoved )
+		{
+			o->xMoved = false;
+			*find( movedObjects.begin(), movedObjects.end(), o ) = movedObjects.back();
+			movedObjects.pop_back();
+		}
+
 		// Actually remove the object from the list
 		this->remove();
 		
@@ -372,12 +448,133 @@ void objectxsortedlist::sort()
 		p = o;
 		savecurr = currItem;
     }
+
+	// Objects have moved since the last sort, so bring the grid up to date as well
+	if( gridEnabled() )
+	{
+		this->reset();
+		while( this->next( o ) )
+			updateGrid( o );
+	}
 #ifdef DEBUGCALLS
     popproc();
 #endif // DEBUGCALLS
 }
 
 
+//---------------------------------------------------------------------------
+// objectxsortedlist::moveNear
+//---------------------------------------------------------------------------
+// Note that o has moved or changed size.  The list may be in the middle of
+// a traversal, so o is only queued here, and sortMoved() puts it back in
+// order later, starting from where it was.
+void objectxsortedlist::moveNear( gobject* o )
+{
+	updateGrid( o );
+
+	if( o->radius() > maxRadius )
+		maxRadius = o->radius();
+
+	if( !o->xMoved )
+	{
+		o->xMoved = true;
+		movedObjects.push_back( o );
+	}
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::sortMoved
+//---------------------------------------------------------------------------
+// Put the objects passed to moveNear() back in x order.  This does the job
+// of sort(), provided everything that has moved was passed to moveNear(),
+// but only touches the list around the objects that moved.
+void objectxsortedlist::sortMoved()
+{
+	if( movedObjects.empty() )
+		return;
+
+	gdlink<gobject*> *savecurr = currItem;
+	size_t n = movedObjects.size();
+	vector< gdlink<gobject*>* > hints( n );
+
+	// Before anything is unlinked, find each moved object the closest
+	// preceding object that is staying put (NULL for the head of the list)
+	for( size_t i = 0; i < n; i++ )
+	{
+		gdlink<gobject*> *hint = movedObjects[i]->listLink;
+		do
+			hint = (hint == lastItem->nextItem) ? NULL : hint->prevItem;
+		while( hint && hint->e->xMoved );
+		hints[i] = hint;
+	}
+
+	// With the moved objects out of it the list is in order, so each can
+	// then be placed by a short search from its hint
+	for( size_t i = 0; i < n; i++ )
+	{
+		currItem = movedObjects[i]->listLink;
+		this->unlink();
+	}
+
+	for( size_t i = 0; i < n; i++ )
+	{
+		placeNear( movedObjects[i]->listLink, hints[i] );
+		movedObjects[i]->xMoved = false;
+	}
+
+	movedObjects.clear();
+	currItem = savecurr;
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::placeNear
+//---------------------------------------------------------------------------
+// Link an unlinked link into x order, searching outward from near (or from
+// the head of the list, if near is NULL).  Leaves currItem alone.
+void objectxsortedlist::placeNear( gdlink<gobject*>* link, gdlink<gobject*>* near )
+{
+	gdlink<gobject*> *savecurr = currItem;
+	float edge = link->e->x() - link->e->radius();
+
+	if( !lastItem )
+		this->insert( link );
+	else
+	{
+		gdlink<gobject*> *head = lastItem->nextItem;
+
+		if( !near )
+			near = head;
+
+		// Same place add() would find: after every object that doesn't start after this one
+		if( (near->e->x() - near->e->radius()) <= edge )
+		{
+			while( (near != lastItem) && ((near->nextItem->e->x() - near->nextItem->e->radius()) <= edge) )
+				near = near->nextItem;
+
+			if( near == lastItem )
+				this->append( link );
+			else
+			{
+				currItem = near;
+				this->appendhere( link );
+			}
+		}
+		else
+		{
+			while( (near != head) && ((near->prevItem->e->x() - near->prevItem->e->radius()) > edge) )
+				near = near->prevItem;
+
+			currItem = near;
+			this->inserthere( link );
+		}
+	}
+
+	currItem = savecurr;
+}
+
+
 //---------------------------------------------------------------------------
 // objectxsortedlist::list
 //---------------------------------------------------------------------------
@@ -546,3 +743,289 @@ void objectxsortedlist::getMark( int objType, gobject* gob )
 
 
 
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::range
+//---------------------------------------------------------------------------
+objectxsortedlist::iterator objectxsortedlist::range( int objType, float xmin, float xmax )
+{
+	gdlink<gobject*> *head = lastItem ? lastItem->nextItem : NULL;
+
+	return iterator( head, lastItem, head, NEXT, objType, xmin, xmax, maxRadius );
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::from
+//---------------------------------------------------------------------------
+objectxsortedlist::iterator objectxsortedlist::from( gobject* o, int direction, int objType, float xmin, float xmax )
+{
+	assert( (direction == NEXT) || (direction == PREV) );
+
+	gdlink<gobject*> *head = lastItem->nextItem;
+	gdlink<gobject*> *link = o->GetListLink();
+
+	if( direction == NEXT )
+		link = (link == lastItem) ? NULL : link->nextItem;
+	else
+		link = (link == head) ? NULL : link->prevItem;
+
+	return iterator( head, lastItem, link, direction, objType, xmin, xmax, maxRadius );
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::iterator::iterator
+//---------------------------------------------------------------------------
+objectxsortedlist::iterator::iterator( gdlink<gobject*>* head, gdlink<gobject*>* tail, gdlink<gobject*>* link,
+									   int direction, int objType, float xmin, float xmax, float maxRadius )
+{
+	this->head = head;
+	this->tail = tail;
+	this->link = link;
+	this->direction = direction;
+	this->objType = objType;
+	this->xmin = xmin;
+	this->xmax = xmax;
+	this->maxRadius = maxRadius;
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::iterator::step
+//---------------------------------------------------------------------------
+// The next object of the right type in the window, or NULL at the end
+gobject* objectxsortedlist::iterator::step()
+{
+	while( link )
+	{
+		gobject* o = link->e;
+
+		if( direction == NEXT )
+		{
+			link = (link == tail) ? NULL : link->nextItem;
+
+			if( o->x() - o->radius() > xmax )
+				break;
+			if( o->x() + o->radius() < xmin )
+				continue;
+		}
+		else
+		{
+			link = (link == head) ? NULL : link->prevItem;
+
+			// Left edges only get smaller from here, but a bigger object
+			// further back may still reach xmin
+			if( o->x() - o->radius() + 2 * maxRadius < xmin )
+				break;
+			if( o->x() + o->radius() < xmin )
+				continue;
+			if( o->x() - o->radius() > xmax )
+				continue;
+		}
+
+		if( o->getType() & objType )
+			return o;
+	}
+
+	link = NULL;
+	return NULL;
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::enableGrid
+//---------------------------------------------------------------------------
+// Start maintaining the grid, with cells no smaller than cellSize on a side
+void objectxsortedlist::enableGrid( float worldsize, float cellSize )
+{
+	assert( !gridEnabled() );
+	assert( cellSize > 0.0 );
+
+	gridDim = (int) ceil( worldsize / cellSize );
+	if( gridDim > MaxGridDim )
+		gridDim = MaxGridDim;
+	else if( gridDim < 1 )
+		gridDim = 1;
+	gridCellSize = worldsize / gridDim;
+	gridCells.resize( gridDim * gridDim );
+
+	// Pick up anything already in the list
+	gdlink<gobject*> *savecurr = currItem;
+	gobject* o;
+	this->reset();
+	while( this->next( o ) )
+		gridInsert( o );
+	currItem = savecurr;
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::updateGrid
+//---------------------------------------------------------------------------
+// Move an object to the grid cell for its current position, if it has changed
+void objectxsortedlist::updateGrid( gobject* o )
+{
+	if( !gridEnabled() || (o->gridCell < 0) )
+		return;
+
+	if( o->radius() > gridMaxRadius )
+		gridMaxRadius = o->radius();
+
+	if( gridCellIndex( o ) != o->gridCell )
+	{
+		gridRemove( o );
+		gridInsert( o );
+	}
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::gridNeighbor
+//---------------------------------------------------------------------------
+// Some object in the grid column holding a's center, or in the closest
+// column that has any, or NULL if none turns up before a walk of the list
+// would have been as cheap
+gobject* objectxsortedlist::gridNeighbor( gobject* a )
+{
+	int ix = (int) floor( a->x() / gridCellSize );
+	ix = max( 0, min( ix, gridDim - 1 ) );
+
+	long cellsLeft = kount;
+
+	for( int d = 0; d < gridDim; d++ )
+	{
+		for( int jx = ix - d; jx <= ix + d; jx += (d > 0 ? 2 * d : 1) )
+		{
+			if( (jx < 0) || (jx >= gridDim) )
+				continue;
+
+			for( int iz = 0; iz < gridDim; iz++ )
+			{
+				vector<gobject*>& cell = gridCells[iz * gridDim + jx];
+
+				if( !cell.empty() )
+					return cell[0];
+				if( --cellsLeft <= 0 )
+					return NULL;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::getNearby
+//---------------------------------------------------------------------------
+// Fill nearby with all objects of the given type(s) whose bounding squares
+// overlap the box [x0,x1] x [z0,z1].  The order of the results is arbitrary.
+void objectxsortedlist::getNearby( int objType, float x0, float z0, float x1, float z1, vector<gobject*>& nearby )
+{
+	assert( gridEnabled() );
+
+	nearby.clear();
+
+	// Objects are bucketed by their centers, so widen the search by the largest radius
+	int ix0 = (int) floor( (x0 - gridMaxRadius) / gridCellSize );
+	int ix1 = (int) floor( (x1 + gridMaxRadius) / gridCellSize );
+	int iz0 = (int) floor( -(z1 + gridMaxRadius) / gridCellSize );
+	int iz1 = (int) floor( -(z0 - gridMaxRadius) / gridCellSize );
+
+	ix0 = max( ix0, 0 );
+	iz0 = max( iz0, 0 );
+	ix1 = min( ix1, gridDim - 1 );
+	iz1 = min( iz1, gridDim - 1 );
+
+	for( int iz = iz0; iz <= iz1; iz++ )
+	{
+		for( int ix = ix0; ix <= ix1; ix++ )
+		{
+			vector<gobject*>& cell = gridCells[iz * gridDim + ix];
+
+			for( size_t i = 0; i < cell.size(); i++ )
+			{
+				gobject* o = cell[i];
+				float r = o->radius();
+
+				if( (o->getType() & objType) &&
+					(o->x() + r >= x0) && (o->x() - r <= x1) &&
+					(o->z() + r >= z0) && (o->z() - r <= z1) )
+				{
+					nearby.push_back( o );
+				}
+			}
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::before
+//---------------------------------------------------------------------------
+bool objectxsortedlist::before( gobject* a, gobject* b )
+{
+	float ea = a->x() - a->radius();
+	float eb = b->x() - b->radius();
+
+	if( ea != eb )
+		return ea < eb;
+	if( a->getType() != b->getType() )
+		return a->getType() < b->getType();
+	return a->getTypeNumber() < b->getTypeNumber();
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::gridCellIndex
+//---------------------------------------------------------------------------
+int objectxsortedlist::gridCellIndex( gobject* o )
+{
+	// z runs from 0 to -worldsize
+	int ix = (int) floor( o->x() / gridCellSize );
+	int iz = (int) floor( -o->z() / gridCellSize );
+
+	ix = max( 0, min( ix, gridDim - 1 ) );
+	iz = max( 0, min( iz, gridDim - 1 ) );
+
+	return iz * gridDim + ix;
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::gridInsert
+//---------------------------------------------------------------------------
+void objectxsortedlist::gridInsert( gobject* o )
+{
+	int index = gridCellIndex( o );
+	vector<gobject*>& cell = gridCells[index];
+
+	o->gridCell = index;
+	o->gridSlot = cell.size();
+	cell.push_back( o );
+
+	if( o->radius() > gridMaxRadius )
+		gridMaxRadius = o->radius();
+}
+
+
+//---------------------------------------------------------------------------
+// objectxsortedlist::gridRemove
+//---------------------------------------------------------------------------
+void objectxsortedlist::gridRemove( gobject* o )
+{
+	assert( o->gridCell >= 0 );
+
+	vector<gobject*>& cell = gridCells[o->gridCell];
+	gobject* moved = cell.back();
+
+	// Fill the hole with the last object in the cell
+	cell[o->gridSlot] = moved;
+	moved->gridSlot = o->gridSlot;
+	cell.pop_back();
+
+	o->gridCell = -1;
+	o->gridSlot = -1;
+}
@@ -4,6 +4,10 @@
 #define NEXT 1
 #define PREV 2
 
+#include <float.h>
+
+#include <vector>
+
 #include "gdlink.h"
 #include "gobject.h"
 #include "food.h"
@@ -28,10 +32,67 @@ class objectxsortedlist : public gdlist<gobject*>
     gdlink<gobject*> *markedFood;	
     gdlink<gobject*> *markedBrick;	
 
+	// Objects passed to moveNear() since the last sortMoved()
+	vector<gobject*> movedObjects;
+
+	// Optional uniform grid over the world, bucketing objects by the cell
+	// containing their center, for neighbor queries that don't have to walk
+	// the list.  The grid tracks adds and removes automatically; objects that
+	// move must be passed to updateGrid() (moveNear() and sort() do so).
+	vector< vector<gobject*> > gridCells;
+	int gridDim;
+	float gridCellSize;
+	float gridMaxRadius;	// of any object that has been in the grid
+	float maxRadius;		// of any object that has been in the list
+
+	int gridCellIndex( gobject* o );
+	void gridInsert( gobject* o );
+	void gridRemove( gobject* o );
+
+	void added( gobject* a );
+	void placeNear( gdlink<gobject*>* link, gdlink<gobject*>* near );
+	gobject* gridNeighbor( gobject* a );
+
  public:
-    objectxsortedlist() { markedAgent = 0; markedFood = 0; markedBrick = 0; }
+	//-----------------------------------------------------------------------
+	// Walks objects of some type(s) in one direction without using the
+	// list's cursor or marks, so any number may be in use at once, from any
+	// number of threads, as long as nothing changes the list meanwhile.
+	//
+	//     objectxsortedlist::iterator it = list.range( AGENTTYPE, x0, x1 );
+	//     agent* a;
+	//     while( it.next( &a ) )
+	//         ...
+	//-----------------------------------------------------------------------
+	class iterator
+	{
+	public:
+		template<class T> bool next( T** o );
+
+	private:
+		friend class objectxsortedlist;
+
+		iterator( gdlink<gobject*>* head, gdlink<gobject*>* tail, gdlink<gobject*>* link,
+				  int direction, int objType, float xmin, float xmax, float maxRadius );
+		gobject* step();
+
+		gdlink<gobject*>* head;
+		gdlink<gobject*>* tail;
+		gdlink<gobject*>* link;	// the next one to look at
+		int direction;
+		int objType;
+		float xmin;
+		float xmax;
+		float maxRadius;
+	};
+
+    objectxsortedlist() { markedAgent = 0; markedFood = 0; markedBrick = 0; gridDim = 0; gridCellSize = 0.0; gridMaxRadius = 0.0; maxRadius = 0.0; }
     ~objectxsortedlist() { }
     void add( gobject* a );
+    void addNear( gobject* a, gobject* near );
+    void addLast( gobject* a );
+    void moveNear( gobject* o );
+    void sortMoved();
     void removeCurrentObject();
 	void removeObjectWithLink( gobject* o );
     void sort();
@@ -49,8 +110,36 @@ class objectxsortedlist : public gdlist<gobject*>
     void toMark( int objType );
     void getMark( int objType, gobject* gob );
 
+	void enableGrid( float worldsize, float cellSize );
+	bool gridEnabled();
+	void updateGrid( gobject* o );
+	void getNearby( int objType, float x0, float z0, float x1, float z1, vector<gobject*>& nearby );
+
+	// Objects overlapping [xmin,xmax] in x, from the head of the list
+	iterator range( int objType, float xmin = -FLT_MAX, float xmax = FLT_MAX );
+	// Objects overlapping [xmin,xmax] past o in the given direction (NEXT or
+	// PREV).  The list is sorted by left edge, so going back the walk skips
+	// objects ending before xmin and only ends once no object further back,
+	// however large, could reach xmin.
+	iterator from( gobject* o, int direction, int objType, float xmin = -FLT_MAX, float xmax = FLT_MAX );
+
+	// Order of objects in a freshly sorted list, with ties broken by type and number
+	static bool before( gobject* a, gobject* b );
+
     static objectxsortedlist gXSortedObjects;
 };
 
+inline bool objectxsortedlist::gridEnabled() { return gridDim > 0; }
+
+template<class T>
+inline bool objectxsortedlist::iterator::next( T** o )
+{
+	gobject* g = step();
+	if( !g )
+		return false;
+	*o = (T*) g;
+	return true;
+}
+
 
 #endif
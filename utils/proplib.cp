@@ -8,6 +8,7 @@
 #include <fstream>
 #include <iostream>
 
+#include "Expression.h"
 #include "misc.h"
 
 using namespace std;
@@ -35,16 +36,14 @@ namespace proplib
 
 	// ----------------------------------------------------------------------
 	// ----------------------------------------------------------------------
-	// --- FUNCTION eval()
+	// --- FUNCTION evalPython()
 	// ---
 	// --- Use python to evaluate an expression
 	// ----------------------------------------------------------------------
 	// ----------------------------------------------------------------------
-	typedef map<string,string> SymbolTable;
-
-	static bool eval( const char *expr,
-					  SymbolTable &symbols,
-					  char *result, size_t result_size )
+	static bool evalPython( const char *expr,
+							SymbolTable &symbols,
+							char *result, size_t result_size )
 	{
 		// build a dict() mapping symbol name to value
 		string locals = "{";
@@ -109,6 +108,31 @@ namespace proplib
 		return rc == 0;
 	}
 
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	// --- FUNCTION eval()
+	// ---
+	// --- Evaluate an expression natively if we can, otherwise with python
+	// ----------------------------------------------------------------------
+	// ----------------------------------------------------------------------
+	static bool eval( const char *expr,
+					  SymbolTable &symbols,
+					  char *result, size_t result_size )
+	{
+		string value;
+
+		if( Expression::eval(expr, symbols, value) && (value.length() < result_size) )
+		{
+#if DEBUG_EVAL
+			cout << "<EVAL native>" << expr << " = " << value << "</EVAL>" << endl;
+#endif
+			strcpy( result, value.c_str() );
+			return true;
+		}
+
+		return evalPython( expr, symbols, result, result_size );
+	}
+
 	// ----------------------------------------------------------------------
 	// ----------------------------------------------------------------------
 	// --- CLASS Identifier